@@ -51,6 +51,12 @@ BikeDisplayUI::BikeDisplayUI() {
   ui_bluetooth_icon = NULL;
   ui_turn_left_icon = NULL;
   ui_turn_right_icon = NULL;
+  ui_cell_screen = NULL;
+  for (int pack = 0; pack < 2; pack++) {
+    ui_cell_title[pack] = NULL;
+    for (int i = 0; i < BMS_MAX_CELLS; i++) ui_cell_labels[pack][i] = NULL;
+  }
+  cell_detail_visible = false;
   speed_font = NULL;
 }
 
@@ -691,6 +697,84 @@ void BikeDisplayUI::updateAll(const BikeDataDisplay& data) {
   updateOdometer(data.odometer);
   updateBluetooth(data.bluetoothConnected);
   updateTurnIndicators(data.turnLeftActive, data.turnRightActive);
+  if (cell_detail_visible) updateCellDetail(data);
+}
+
+// Cell detail screen - separate LVGL screen, built the first time it is shown
+void BikeDisplayUI::createCellDetail() {
+  ui_cell_screen = lv_obj_create(NULL);
+  lv_obj_set_style_bg_color(ui_cell_screen, UI_COLOR_BG, LV_PART_MAIN | LV_STATE_DEFAULT);
+  lv_obj_clear_flag(ui_cell_screen, LV_OBJ_FLAG_SCROLLABLE);
+  
+  for (int pack = 0; pack < 2; pack++) {
+    int panelX = pack * CELL_PANEL_WIDTH;
+    
+    ui_cell_title[pack] = lv_label_create(ui_cell_screen);
+    lv_label_set_text(ui_cell_title[pack], pack == 0 ? "BATTERY 1" : "BATTERY 2");
+    lv_obj_set_style_text_color(ui_cell_title[pack], UI_COLOR_TEXT_MUTED, LV_PART_MAIN);
+    lv_obj_set_style_text_font(ui_cell_title[pack], CELL_TITLE_FONT, LV_PART_MAIN);
+    lv_obj_set_pos(ui_cell_title[pack], panelX + 8, 8);
+    lv_obj_set_width(ui_cell_title[pack], CELL_PANEL_WIDTH - 16);
+    lv_label_set_long_mode(ui_cell_title[pack], LV_LABEL_LONG_DOT);
+    
+    for (int i = 0; i < BMS_MAX_CELLS; i++) {
+      lv_obj_t *label = lv_label_create(ui_cell_screen);
+      lv_label_set_text(label, "");
+      lv_obj_set_size(label, CELL_WIDTH, CELL_HEIGHT);
+      lv_obj_set_style_text_font(label, CELL_FONT, LV_PART_MAIN);
+      lv_obj_set_style_text_align(label, LV_TEXT_ALIGN_CENTER, LV_PART_MAIN);
+      lv_obj_set_pos(label, panelX + (i % CELL_GRID_COLUMNS) * (CELL_WIDTH + 2),
+                     CELL_HEADER_HEIGHT + (i / CELL_GRID_COLUMNS) * CELL_HEIGHT);
+      ui_cell_labels[pack][i] = label;
+    }
+  }
+}
+
+void BikeDisplayUI::showCellDetail(bool visible) {
+  if (visible == cell_detail_visible) return;
+  if (visible && !ui_cell_screen) createCellDetail();
+  
+  lv_scr_load(visible ? ui_cell_screen : ui_main_screen);
+  cell_detail_visible = visible;
+}
+
+void BikeDisplayUI::updateCellDetail(const BikeDataDisplay& data) {
+  if (!ui_cell_screen) return;
+  updateCellPack(0, data.battery1CellCount, data.battery1CellMv, data.battery1Version);
+  updateCellPack(1, data.battery2CellCount, data.battery2CellMv, data.battery2Version);
+}
+
+// Lowest cell in red, highest in yellow, so the unbalanced pair stands out
+void BikeDisplayUI::updateCellPack(int pack, uint8_t count, const uint16_t *cellMv, const char *version) {
+  uint8_t lowest = 0, highest = 0;
+  for (uint8_t i = 1; i < count; i++) {
+    if (cellMv[i] < cellMv[lowest]) lowest = i;
+    if (cellMv[i] > cellMv[highest]) highest = i;
+  }
+  
+  char buffer[40];
+  if (count == 0) {
+    snprintf(buffer, sizeof(buffer), "BATTERY %d  --", pack + 1);
+  } else {
+    snprintf(buffer, sizeof(buffer), "BATTERY %d  %dmV %s", pack + 1,
+             cellMv[highest] - cellMv[lowest], version);
+  }
+  lv_label_set_text(ui_cell_title[pack], buffer);
+  
+  for (uint8_t i = 0; i < BMS_MAX_CELLS; i++) {
+    lv_obj_t *label = ui_cell_labels[pack][i];
+    if (i >= count) {
+      lv_label_set_text(label, "");
+      continue;
+    }
+    
+    snprintf(buffer, sizeof(buffer), "%d.%03d", cellMv[i] / 1000, cellMv[i] % 1000);
+    lv_label_set_text(label, buffer);
+    lv_color_t color = UI_COLOR_TEXT_MAIN;
+    if (count > 1 && i == lowest) color = UI_COLOR_DANGER;
+    else if (count > 1 && i == highest) color = UI_COLOR_WARNING;
+    lv_obj_set_style_text_color(label, color, LV_PART_MAIN | LV_STATE_DEFAULT);
+  }
 }
 
 // Theme setting (placeholder)
@@ -199,6 +199,16 @@
 #define TURN_ICON_FONT        &lv_font_montserrat_20
 #define TURN_ICON_TEXT_ALIGN  LV_TEXT_ALIGN_CENTER
 
+// Cell Detail Screen (one half per pack, 4 x 6 cells)
+#define CELL_GRID_COLUMNS     4
+#define CELL_GRID_ROWS        6
+#define CELL_PANEL_WIDTH      240
+#define CELL_HEADER_HEIGHT    50
+#define CELL_WIDTH            58
+#define CELL_HEIGHT           36
+#define CELL_FONT             &lv_font_montserrat_14
+#define CELL_TITLE_FONT       &lv_font_montserrat_16
+
 
 // ================================================
 // BIKE DASHBOARD CLASS
@@ -252,6 +262,12 @@ private:
   lv_obj_t *ui_turn_left_icon;
   lv_obj_t *ui_turn_right_icon;
 
+  // Cell detail screen (created on first use)
+  lv_obj_t *ui_cell_screen;
+  lv_obj_t *ui_cell_title[2];
+  lv_obj_t *ui_cell_labels[2][BMS_MAX_CELLS];
+  bool cell_detail_visible;
+
   // Font reference
   const lv_font_t* speed_font;
 
@@ -264,6 +280,8 @@ private:
   void createOdometer();
   void createBluetoothIcon();
   void createTurnIndicators();
+  void createCellDetail();
+  void updateCellPack(int pack, uint8_t count, const uint16_t *cellMv, const char *version);
   lv_color_t getColorByTemperature(int temp, int lowThresh, int highThresh);
   lv_color_t getColorByPercent(int percent, int lowThresh, int highThresh);
 
@@ -286,6 +304,11 @@ public:
   void updateOdometer(float distance);
   void updateBluetooth(bool connected);
   void updateTurnIndicators(bool leftActive, bool rightActive);
+  void updateCellDetail(const BikeDataDisplay& data);
+  
+  // Cell detail screen - per-cell voltages received over ISO-TP
+  void showCellDetail(bool visible);
+  bool isCellDetailVisible() { return cell_detail_visible; }
   
   // Update method - all data at once
   void updateAll(const BikeDataDisplay& data);
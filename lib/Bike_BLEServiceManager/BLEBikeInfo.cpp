@@ -1,7 +1,7 @@
 #include "BLEBikeInfo.h"
 
 BLEBikeInfo::BLEBikeInfo(BLEService* service) : 
-    BLEServiceManager(service), currentStatus(BIKE_OFF) {
+    BLEServiceManager(service), currentStatus(BIKE_OFF), taskProfiler(nullptr) {
     
     // Add characteristics với bảo mật
     addReadWrite(BIKE_NAME_CHAR_UUID, 
@@ -15,6 +15,10 @@ BLEBikeInfo::BLEBikeInfo(BLEService* service) :
     addReadWrite(BIKE_STATUS_CHAR_UUID, 
         authed([this](BLECharacteristic* p) { onReadStatus(p); }), 
         NULL, true); // Chỉ read và notify
+    
+    addReadWrite(BIKE_PROFILE_CHAR_UUID, 
+        authed([this](BLECharacteristic* p) { onReadProfile(p); }), 
+        NULL); // Read only
 }
 
 void BLEBikeInfo::begin() {
@@ -63,6 +67,10 @@ void BLEBikeInfo::notifyStatusChange(BikeOperationState status) {
     }
 }
 
+void BLEBikeInfo::setTaskProfiler(TaskProfiler* profiler) {
+    taskProfiler = profiler;
+}
+
 void BLEBikeInfo::onReadName(BLECharacteristic* pChar) {
     pChar->setValue(String(name));
 }
@@ -118,6 +126,19 @@ void BLEBikeInfo::onReadStatus(BLECharacteristic* pChar) {
     pChar->setValue(&statusValue, sizeof(statusValue));
 }
 
+void BLEBikeInfo::onReadProfile(BLECharacteristic* pChar) {
+    if (!taskProfiler) {
+        pChar->setValue((uint8_t*)nullptr, 0);
+        return;
+    }
+    
+    // Static: runs on the NimBLE host task, keep the snapshot off its stack
+    static TaskProfilerSnapshot snapshot;
+    static uint8_t encoded[PROFILER_ENCODED_MAX];
+    taskProfiler->getSnapshot(snapshot);
+    pChar->setValue(encoded, encodeTaskProfile(snapshot, encoded, sizeof(encoded)));
+}
+
 void BLEBikeInfo::getStringPref(Preferences& p, const char* key, char* data, size_t maxLen, const char* defaultVal) {
     size_t len = p.getBytes(key, data, maxLen);
     if (len == 0) {
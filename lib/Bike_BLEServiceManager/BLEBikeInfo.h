@@ -5,12 +5,14 @@
 #include <Preferences.h>
 #include <NimBLEDevice.h>
 #include <BikeData.h>
+#include <TaskProfiler.h>
 
 // Service và Characteristic UUIDs cho Bike Info
 #define BIKE_INFO_SERVICE_UUID      "12345678-1234-1234-1234-123456789abc"
 #define BIKE_NAME_CHAR_UUID         "f2c513b7-6b51-4363-b6aa-1ef8bd08c56a"
 #define BIKE_HARDWARE_CHAR_UUID     "dc3c0fd6-c7e1-4f81-8e06-dbdbef8058bb"
 #define BIKE_STATUS_CHAR_UUID       "8b8f9b38-9af4-11ee-b9d1-0242ac120002"
+#define BIKE_PROFILE_CHAR_UUID      "5e1c0a42-3f7d-4b8e-9c61-2a9d7b4e8f10"  // Task profile (encodeTaskProfile())
 
 // Bike specific definitions
 #define BIKE_VERSION                "1.0"
@@ -25,7 +27,7 @@
 #define MAX_HARDWARE_LENGTH       30
 
 
-class BLEBikeInfo : public BLEServiceManager<3> {
+class BLEBikeInfo : public BLEServiceManager<4> {
 public:
     BLEBikeInfo(BLEService* service);
     
@@ -40,6 +42,9 @@ public:
     // Status management
     void setStatus(BikeOperationState status);
     void notifyStatusChange(BikeOperationState status);
+    
+    // Diagnostics
+    void setTaskProfiler(TaskProfiler* profiler);
 
 private:
     Preferences pref;
@@ -48,6 +53,7 @@ private:
     char name[MAX_NAME_LENGTH + 1];
     char hardware[MAX_HARDWARE_LENGTH + 1];
     BikeOperationState currentStatus;
+    TaskProfiler* taskProfiler;
 
     // Characteristic callbacks
     void onReadName(BLECharacteristic* pChar);
@@ -58,6 +64,8 @@ private:
     
     void onReadStatus(BLECharacteristic* pChar);
     
+    void onReadProfile(BLECharacteristic* pChar);
+    
     // Utility functions
     void getStringPref(Preferences& p, const char* key, char* data, size_t maxLen, const char* defaultVal);
     bool validateSecurityKey(const char* input);
@@ -1,6 +1,25 @@
 #include "BLEBikeManager.h"
 #include "BikeRFIDManager.h"
 
+TaskHandle_t BLEBikeManager::wakeTask = NULL;
+
+// Addresses as toString() has them, without the std::string
+static void addressText(const BLEAddress& address, char* text) {
+    const uint8_t* native = address.getNative();
+    snprintf(text, BLE_ADDRESS_TEXT_LEN, "%02x:%02x:%02x:%02x:%02x:%02x",
+             native[5], native[4], native[3], native[2], native[1], native[0]);
+}
+
+static bool parseAddress(const char* text, BLEAddress& address) {
+    unsigned int b[6];
+    if (sscanf(text, "%x:%x:%x:%x:%x:%x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) != 6) return false;
+    ble_addr_t native;
+    native.type = 0;
+    for (int i = 0; i < 6; i++) native.val[5 - i] = (uint8_t)b[i];
+    address = BLEAddress(native);
+    return true;
+}
+
 BLEBikeManager::BLEBikeManager() : 
     pServer(nullptr), 
     pAdvertising(nullptr),
@@ -9,6 +28,7 @@ BLEBikeManager::BLEBikeManager() :
     secured(false),
     currentState(BIKE_STATE_IDLE),
     connectionParam(nullptr),
+    bondedCount(0),
     pairingInProgress(false),
     bootButtonPressed(false),
     lastBootButtonCheck(0),
@@ -28,16 +48,16 @@ void BLEBikeManager::begin() {
     // Initialize boot button
     pinMode(MANUAL_AUTHENTICATION_PIN, INPUT_PULLUP);
     
-    // Initialize preferences for storing bonded devices
+    // Initialize preferences for storing bonded devices; connections check the copy
     preferences.begin("bike-bonds", false);
+    loadBondedDevices();
     
     // Show current bonded devices
-    uint8_t bondCount = preferences.getUChar("bond_count", 0);
     Serial.print("Found ");
-    Serial.print(bondCount);
+    Serial.print(bondedCount);
     Serial.println(" bonded devices");
     
-    if (bondCount > 0) {
+    if (bondedCount > 0) {
         printBondedDevices();
     }
     
@@ -80,6 +100,32 @@ void BLEBikeManager::update() {
     }
 }
 
+void BLEBikeManager::setTaskProfiler(TaskProfiler* profiler) {
+    if (bikeInfoService) bikeInfoService->setTaskProfiler(profiler);
+}
+
+void BLEBikeManager::setWakeTask(TaskHandle_t task) {
+    wakeTask = task;
+    attachInterrupt(digitalPinToInterrupt(MANUAL_AUTHENTICATION_PIN), bootButtonISR, CHANGE);
+}
+
+uint32_t BLEBikeManager::getNextUpdateMs() {
+    // Pressed, or released but not debounced yet
+    if (bootButtonPressed || isBootButtonPressed()) return BLE_BUTTON_POLL_MS;
+    return BLE_NO_TIMED_WORK;
+}
+
+void IRAM_ATTR BLEBikeManager::bootButtonISR() {
+    BaseType_t woken = pdFALSE;
+    xTaskNotifyFromISR(wakeTask, BLE_EVENT_BUTTON, eSetBits, &woken);
+    if (woken) portYIELD_FROM_ISR();
+}
+
+// From the NimBLE host task
+void BLEBikeManager::wake(uint32_t events) {
+    if (wakeTask) xTaskNotify(wakeTask, events, eSetBits);
+}
+
 void BLEBikeManager::setupServer() {
     // Create the BLE Server
     pServer = NimBLEDevice::createServer();
@@ -108,7 +154,7 @@ void BLEBikeManager::setupAdvertising() {
     char macID[7] = {0};
     const uint8_t* pAddrID = NimBLEDevice::getAddress().getNative();
     uint16_t uuidServiceData = 0xFFFF;
-
+    
     // MAC address value inversion (tương tự BLEHandManager)
     macID[5] = *(pAddrID + 0);
     macID[4] = *(pAddrID + 1);
@@ -116,12 +162,12 @@ void BLEBikeManager::setupAdvertising() {
     macID[2] = *(pAddrID + 3);
     macID[1] = *(pAddrID + 4);
     macID[0] = *(pAddrID + 5);
-
+    
     // Setup advertising data
     BLEAdvertisementData data;
     data.setName(bikeName);
     data.setServiceData(BLEUUID(uuidServiceData), macID);
-
+    
     pAdvertising = NimBLEDevice::getAdvertising();
     pAdvertising->addServiceUUID(BIKE_INFO_SERVICE_UUID);
     pAdvertising->setScanResponse(true);
@@ -143,20 +189,15 @@ void BLEBikeManager::onConnect(BLEServer* pServer, ble_gap_conn_desc* param) {
     Serial.println("Device attempting to connect...");
     
     // Lấy địa chỉ của thiết bị đang kết nối
-    std::vector<uint16_t> connIds = pServer->getPeerDevices();
-    BLEAddress deviceAddress("");
-    bool deviceFound = false;
-    
-    if (!connIds.empty()) {
-        auto peerInfo = pServer->getPeerInfo(connIds[0]);
-        deviceAddress = peerInfo.getAddress();
-        deviceFound = true;
-        Serial.print("Connecting device: ");
-        Serial.println(deviceAddress.toString().c_str());
-    }
+    BLEAddress deviceAddress(param->peer_ota_addr);
+    peerAddress = deviceAddress;
+    char addressString[BLE_ADDRESS_TEXT_LEN];
+    addressText(deviceAddress, addressString);
+    Serial.print("Connecting device: ");
+    Serial.println(addressString);
     
     // Kiểm tra xem thiết bị đã được bonded trước đó chưa
-    bool alreadyBonded = deviceFound && isDeviceBonded(deviceAddress);
+    bool alreadyBonded = isDeviceBonded(deviceAddress);
     
     if (alreadyBonded) {
         // Thiết bị đã bonded - cho phép kết nối ngay lập tức
@@ -178,7 +219,7 @@ void BLEBikeManager::onConnect(BLEServer* pServer, ble_gap_conn_desc* param) {
             // Set MTU
             int err = NimBLEDevice::setMTU(517);
             Serial.printf("setMTU: %d\n", err);
-
+            
             // Update connection parameters
             pServer->updateConnParams(param->conn_handle, 0x10, 0x20, 0, 400);
             
@@ -229,9 +270,7 @@ void BLEBikeManager::onConnect(BLEServer* pServer, ble_gap_conn_desc* param) {
             Serial.println("Bike connected successfully");
             
             // Lưu thiết bị mới
-            if (deviceFound) {
-                saveBondedDevice(deviceAddress);
-            }
+            saveBondedDevice(deviceAddress);
             
             // Stop advertising sau khi kết nối
             if (pAdvertising->isAdvertising()) {
@@ -245,7 +284,7 @@ void BLEBikeManager::onConnect(BLEServer* pServer, ble_gap_conn_desc* param) {
                 // Set MTU
                 int err = NimBLEDevice::setMTU(517);
                 Serial.printf("setMTU: %d\n", err);
-
+                
                 // Update connection parameters
                 pServer->updateConnParams(param->conn_handle, 0x10, 0x20, 0, 400);
                 
@@ -258,13 +297,13 @@ void BLEBikeManager::onConnect(BLEServer* pServer, ble_gap_conn_desc* param) {
             Serial.println("Timeout - CONNECTION REJECTED!");
             
             // Ngắt kết nối
-            for (uint16_t connId : connIds) {
-                pServer->disconnect(connId);
-            }
+            pServer->disconnect(param->conn_handle);
             connected = false;
             secured = false;
         }
     }
+    
+    wake(BLE_EVENT_CONNECTION);
 }
 
 void BLEBikeManager::onDisconnect(BLEServer* pServer, ble_gap_conn_desc* param) {
@@ -284,6 +323,8 @@ void BLEBikeManager::onDisconnect(BLEServer* pServer, ble_gap_conn_desc* param)
         
         // Restart advertising
         startAdvertising();
+        
+        wake(BLE_EVENT_CONNECTION);
     }
 }
 
@@ -301,6 +342,10 @@ bool BLEBikeManager::isConnected() {
     return connected;
 }
 
+void BLEBikeManager::getPeerAddress(uint8_t* address) {
+    memcpy(address, peerAddress.getNative(), 6);
+}
+
 bool BLEBikeManager::isSecured() {
     return secured;
 }
@@ -344,7 +389,7 @@ void BLEBikeManager::clearBondedDevices() {
 }
 
 uint8_t BLEBikeManager::getBondedDeviceCount() {
-    return preferences.getUChar("bond_count", 0);
+    return bondedCount;
 }
 
 const char* BLEBikeManager::getBikeName() {
@@ -435,50 +480,65 @@ void BLEBikeManager::updateBootButton() {
     }
 }
 
-void BLEBikeManager::saveBondedDevice(BLEAddress address) {
+void BLEBikeManager::loadBondedDevices() {
+    uint8_t bondCount = preferences.getUChar("bond_count", 0);
+    char key[12];
+    char text[BLE_ADDRESS_TEXT_LEN];
+    
+    bondedCount = 0;
+    for (uint8_t i = 0; i < bondCount && i < MAX_BONDED_DEVICES; i++) {
+        snprintf(key, sizeof(key), "bond_%u", i);
+        if (preferences.getString(key, text, sizeof(text)) && parseAddress(text, bondedDevices[bondedCount])) {
+            bondedCount++;
+        }
+    }
+}
+
+void BLEBikeManager::saveBondedDevice(const BLEAddress& address) {
     // Check if device is already bonded
     if (isDeviceBonded(address)) {
         Serial.println("Device already bonded");
         return;
     }
     
-    uint8_t bondCount = preferences.getUChar("bond_count", 0);
+    char key[12];
+    char text[BLE_ADDRESS_TEXT_LEN];
+    addressText(address, text);
     
-    if (bondCount < MAX_BONDED_DEVICES) {
+    if (bondedCount < MAX_BONDED_DEVICES) {
         // Add new device normally
-        String key = "bond_" + String(bondCount);
-        preferences.putString(key.c_str(), address.toString().c_str());
-        preferences.putUChar("bond_count", bondCount + 1);
+        snprintf(key, sizeof(key), "bond_%u", bondedCount);
+        preferences.putString(key, text);
+        bondedDevices[bondedCount++] = address;
+        preferences.putUChar("bond_count", bondedCount);
         
         Serial.print("New device bonded: ");
-        Serial.println(address.toString().c_str());
+        Serial.println(text);
         Serial.print("Total bonded devices: ");
-        Serial.println(bondCount + 1);
+        Serial.println(bondedCount);
     } else {
         // FIFO replacement: Remove oldest (bond_0) and shift all up
         Serial.println("Maximum bonded devices reached - Replacing oldest device");
         
-        // Get oldest device that will be removed
-        String oldestKey = "bond_0";
-        String oldestDevice = preferences.getString(oldestKey.c_str(), "");
-        Serial.printf("Removing oldest bonded device: %s\n", oldestDevice.c_str());
+        // Oldest device that will be removed
+        char oldest[BLE_ADDRESS_TEXT_LEN];
+        addressText(bondedDevices[0], oldest);
+        Serial.printf("Removing oldest bonded device: %s\n", oldest);
         
-        // Shift all devices up (bond_1 -> bond_0, bond_2 -> bond_1, etc.)
+        // Shift all devices up (bond_1 -> bond_0, bond_2 -> bond_1, etc.), the new one last
         for (uint8_t i = 0; i < MAX_BONDED_DEVICES - 1; i++) {
-            String currentKey = "bond_" + String(i + 1);
-            String targetKey = "bond_" + String(i);
-            String deviceAddress = preferences.getString(currentKey.c_str(), "");
-            
-            if (deviceAddress != "") {
-                preferences.putString(targetKey.c_str(), deviceAddress.c_str());
-            }
+            bondedDevices[i] = bondedDevices[i + 1];
         }
+        bondedDevices[MAX_BONDED_DEVICES - 1] = address;
         
-        // Add new device at the end
-        String newKey = "bond_" + String(MAX_BONDED_DEVICES - 1);
-        preferences.putString(newKey.c_str(), address.toString().c_str());
+        char shifted[BLE_ADDRESS_TEXT_LEN];
+        for (uint8_t i = 0; i < MAX_BONDED_DEVICES; i++) {
+            snprintf(key, sizeof(key), "bond_%u", i);
+            addressText(bondedDevices[i], shifted);
+            preferences.putString(key, shifted);
+        }
         
-        Serial.printf("New device bonded (replaced oldest): %s\n", address.toString().c_str());
+        Serial.printf("New device bonded (replaced oldest): %s\n", text);
         Serial.printf("Total bonded devices: %d (maintained)\n", MAX_BONDED_DEVICES);
     }
     
@@ -486,14 +546,9 @@ void BLEBikeManager::saveBondedDevice(BLEAddress address) {
     printBondedDevices();
 }
 
-bool BLEBikeManager::isDeviceBonded(BLEAddress address) {
-    uint8_t bondCount = preferences.getUChar("bond_count", 0);
-    
-    for (uint8_t i = 0; i < bondCount; i++) {
-        String key = "bond_" + String(i);
-        String bondedAddress = preferences.getString(key.c_str(), "");
-        
-        if (bondedAddress == address.toString().c_str()) {
+bool BLEBikeManager::isDeviceBonded(const BLEAddress& address) {
+    for (uint8_t i = 0; i < bondedCount; i++) {
+        if (bondedDevices[i] == address) {
             return true;
         }
     }
@@ -502,28 +557,25 @@ bool BLEBikeManager::isDeviceBonded(BLEAddress address) {
 }
 
 void BLEBikeManager::printBondedDevices() {
-    uint8_t bondCount = preferences.getUChar("bond_count", 0);
     Serial.println("=== BONDED DEVICES LIST ===");
     
-    if (bondCount == 0) {
+    if (bondedCount == 0) {
         Serial.println("No bonded devices");
     } else {
-        for (uint8_t i = 0; i < bondCount; i++) {
-            String key = "bond_" + String(i);
-            String deviceAddress = preferences.getString(key.c_str(), "");
-            
-            if (deviceAddress != "") {
-                Serial.printf("%d. %s %s\n", i + 1, deviceAddress.c_str(), 
-                             (i == 0) ? "(oldest)" : (i == bondCount - 1) ? "(newest)" : "");
-            }
+        char text[BLE_ADDRESS_TEXT_LEN];
+        for (uint8_t i = 0; i < bondedCount; i++) {
+            addressText(bondedDevices[i], text);
+            Serial.printf("%d. %s %s\n", i + 1, text, 
+                         (i == 0) ? "(oldest)" : (i == bondedCount - 1) ? "(newest)" : "");
         }
     }
-    Serial.printf("Total: %d/%d devices\n", bondCount, MAX_BONDED_DEVICES);
+    Serial.printf("Total: %d/%d devices\n", bondedCount, MAX_BONDED_DEVICES);
     Serial.println("==========================");
 }
 
 void BLEBikeManager::clearBondedDevicesInternal() {
     preferences.clear();
+    bondedCount = 0;
     Serial.println("=== ALL BONDED DEVICES CLEARED ===");
     Serial.println("All previous pairings removed");
     
@@ -14,6 +14,14 @@ class BikeRFIDManager;
 // Security definitions
 #define PAIRING_TIMEOUT_MS 30000  // 30 seconds timeout for pairing
 #define MAX_BONDED_DEVICES 5      // Maximum number of bonded devices
+#define BLE_ADDRESS_TEXT_LEN 18   // "aa:bb:cc:dd:ee:ff" and the terminator, as stored
+
+// Event-driven updates (setWakeTask()): bits set in the wake task's
+// notification value, clear of the data bus topic bits
+#define BLE_EVENT_CONNECTION   (1UL << 16)  // Connected or disconnected
+#define BLE_EVENT_BUTTON       (1UL << 17)  // BOOT button edge
+#define BLE_BUTTON_POLL_MS     50           // Debounce and long-press timing while the button is down
+#define BLE_NO_TIMED_WORK      0xFFFFFFFFUL // getNextUpdateMs(): wait for an event
 
 // Service UUIDs for Bike System
 #define BIKE_INFO_SERVICE_UUID      "12345678-1234-1234-1234-123456789abc"
@@ -38,6 +46,13 @@ public:
     void setRFIDManager(BikeRFIDManager* rfid);  // Set RFID manager reference
     void update();
     
+    // Event-driven: wake a task on connection changes and BOOT button edges
+    void setWakeTask(TaskHandle_t task);
+    uint32_t getNextUpdateMs();                  // BLE_NO_TIMED_WORK unless the button is down
+    
+    // Diagnostics: task profile characteristic (after begin())
+    void setTaskProfiler(TaskProfiler* profiler);
+    
     // BLE Server Callbacks (kế thừa từ BLESecurityManager)
     void onConnect(BLEServer* pServer, ble_gap_conn_desc* param) override;
     void onDisconnect(BLEServer* pServer, ble_gap_conn_desc* param) override;
@@ -45,6 +60,7 @@ public:
     // Connection Management
     bool isConnected();
     bool isSecured();
+    void getPeerAddress(uint8_t* address);  // 6 bytes as getNative(): the device that connected last
     void startAdvertising();
     void stopAdvertising();
     
@@ -82,9 +98,12 @@ private:
     bool secured;
     BikeState currentState;
     ble_gap_conn_desc* connectionParam;
+    BLEAddress peerAddress;                 // Kept after the disconnect, for its event
     
     // Security management
     Preferences preferences;
+    BLEAddress bondedDevices[MAX_BONDED_DEVICES];  // Copy of the stored list, oldest first
+    uint8_t bondedCount;
     bool pairingInProgress;
     bool bootButtonPressed;
     unsigned long lastBootButtonCheck;
@@ -93,6 +112,11 @@ private:
     // RFID integration
     BikeRFIDManager* rfidManager;
     
+    // Event-driven mode
+    static TaskHandle_t wakeTask;
+    static void IRAM_ATTR bootButtonISR();
+    static void wake(uint32_t events);
+    
     // Internal functions
     void setupServer();
     void setupServices();
@@ -104,8 +128,9 @@ private:
     bool isBootButtonPressed();
     bool isRFIDAuthenticated();  // Check RFID authentication
     void updateBootButton();
-    void saveBondedDevice(BLEAddress address);
-    bool isDeviceBonded(BLEAddress address);
+    void loadBondedDevices();
+    void saveBondedDevice(const BLEAddress& address);
+    bool isDeviceBonded(const BLEAddress& address);
     void clearBondedDevicesInternal();
     
     // Security integration
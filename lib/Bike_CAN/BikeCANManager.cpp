@@ -1,28 +1,65 @@
 #include "BikeCANManager.h"
+#include "BikeLog.h"
 
-BikeCANManager::BikeCANManager() : 
+#if defined(ESP32)
+BikeCANManager::BikeCANManager() : BikeCANManager(ESP32CANTransport::instance()) {
+}
+#endif
+
+BikeCANManager::BikeCANManager(CANTransport& canTransport) : 
     initialized(false),
     messagesSent(0),
     messagesReceived(0),
-    sendSequence(0),
-    receiveCallback(nullptr) {
+    receiveCallback(nullptr),
+    logger(nullptr),
+    busStats((uint32_t)CAN_SPEED),
+    latencyTrace(nullptr),
+    lastTimeSyncMs(0),
+    isoTpCallback(nullptr),
+    nextCellsDueMs(0),
+    nextInfoDueMs(0),
+    nextCellsPack(1),
+    nextInfoPack(1),
+    cellsPeriodMs(CAN_PERIOD_CELLS_MS),
+    infoPeriodMs(CAN_PERIOD_BMS_INFO_MS),
+    subscriptionActive(false),
+    subscriptionMask(CAN_GROUPS_ALL),
+    lastSubscriptionMs(0),
+    subscriptionsReceived(0),
+    transport(&canTransport),
+    nodeRole(CAN_NODE_MAIN),
+    lastRxTimestampUs(0),
+    rxFiltered(0),
+    rxHighWater(0),
+    busLoadBudgetPct(CAN_BUS_LOAD_BUDGET_PCT),
+    rateDivider(1),
+    budgetBits(0),
+    lastBudgetRefillMs(0),
+    budgetDeferrals(0),
+    scheduledSend(false),
+    messagesSuppressed(0),
+    lastTxSuppressed(false) {
+    memset(subscriptionPeriodMs, 0, sizeof(subscriptionPeriodMs));
+    memset(announcedSeq, 0, sizeof(announcedSeq));
+    memset(&stagedStamp, 0, sizeof(stagedStamp));
+    resetSchedule();
+    resetTxCache();
+    resetTxHealth();
 }
 
 BikeCANManager::~BikeCANManager() {
 }
 
 bool BikeCANManager::begin() {
-    return begin(CAN_TX_PIN, CAN_RX_PIN);
+    return begin(CAN_TX_PIN, CAN_RX_PIN, CAN_NODE_MAIN);
 }
 
-bool BikeCANManager::begin(int txPin, int rxPin) {
+bool BikeCANManager::begin(int txPin, int rxPin, CANNodeRole role) {
     Serial.println("=== CAN Manager Initialization ===");
     
-    // Set CAN pins
-    CAN.setPins(rxPin, txPin);
+    nodeRole = role;
     
-    // Initialize CAN bus
-    if (!CAN.begin(CAN_SPEED)) {
+    if (!transport->begin(txPin, rxPin, role)) {
         Serial.println("❌ CAN initialization failed!");
         initialized = false;
         return false;
@@ -31,10 +68,34 @@ bool BikeCANManager::begin(int txPin, int rxPin) {
     initialized = true;
     messagesSent = 0;
     messagesReceived = 0;
-    sendSequence = 0;
+    messagesSuppressed = 0;
+    rxFiltered = 0;
+    rxHighWater = 0;
+    resetSchedule();
+    resetTxCache();
+    resetTxHealth();
+    
+    // A display keeps its requested subscription across a restart, the main board starts on defaults
+    if (role != CAN_NODE_DISPLAY) subscriptionActive = false;
+    applySubscription();
+    lastSubscriptionMs = millis() - CAN_SUBSCRIPTION_REFRESH_MS;
+    
+    // Sample stamps are re-announced, the display re-syncs right away
+    timeSync.reset();
+    memset(announcedSeq, 0, sizeof(announcedSeq));
+    lastTimeSyncMs = millis() - CAN_TIME_SYNC_PERIOD_MS;
+    
+    // Each node sends on its own ISO-TP ID and listens on the other's
+    if (role == CAN_NODE_DISPLAY) {
+        isoTp.configure(MSG_ID_ISOTP_TO_MAIN, MSG_ID_ISOTP_TO_DISPLAY, isoTpSendFrame, this);
+    } else {
+        isoTp.configure(MSG_ID_ISOTP_TO_DISPLAY, MSG_ID_ISOTP_TO_MAIN, isoTpSendFrame, this);
+    }
+    nextCellsDueMs = millis() + CAN_PERIOD_CELLS_MS;
+    nextInfoDueMs = millis() + CAN_PERIOD_CELLS_MS / 2;   // Info first, then cells, half a period apart
     
     Serial.println("✅ CAN Manager initialized successfully");
-    Serial.printf("CAN Speed: %.0f kbps\n", CAN_SPEED / 1000.0f);
+    Serial.printf("CAN Speed: %.0f kbps, backend: %s\n", CAN_SPEED / 1000.0f, getBackendName());
     Serial.printf("TX Pin: %d, RX Pin: %d\n", txPin, rxPin);
     
     return true;
@@ -43,309 +104,1131 @@ bool BikeCANManager::begin(int txPin, int rxPin) {
 void BikeCANManager::update() {
     if (!initialized) return;
     
-    // Check for incoming messages
-    int packetSize = CAN.parsePacket();
-    if (packetSize > 0) {
-        uint32_t id = CAN.packetId();
-        uint8_t data[8];
-        uint8_t length = 0;
+    transport->poll();
+    updateTxHealth(millis());
+    
+    uint32_t pending = transport->getRxPending();
+    if (pending > rxHighWater) rxHighWater = pending;
+    
+    // Dispatch everything received since the last call, bounded so a
+    // babbling bus cannot keep the caller here forever
+    CANFrame frame;
+    uint32_t budget = transport->getRxCapacity();
+    while (budget-- > 0 && transport->receive(frame)) {
+        if (logger) logger->record(frame, false);
+        busStats.onReceive(frame.id, frame.data, frame.dlc, frame.timestampUs);
         
-        // Read data
-        while (CAN.available() && length < 8) {
-            data[length++] = CAN.read();
+        if (!acceptId(frame.id)) {
+            rxFiltered++;
+            continue;
         }
         
         messagesReceived++;
+        lastRxTimestampUs = frame.timestampUs;
+        
+        // Segmented transfer frames never reach the per-frame callback
+        if (frame.id == isoTp.getRxId()) {
+            isoTp.onFrame(frame.data, frame.dlc, frame.timestampUs);
+            dispatchIsoTp();
+            continue;
+        }
+        
+        if (frame.id == MSG_ID_DISPLAY_CMD && handleDisplayCommand(frame)) continue;
+        if (handleTraceFrame(frame)) continue;
+        
+        int8_t source = latencyTrace ? traceSource(frame.id) : -1;
+        if (source >= 0) latencyTrace->onFrame(source, frame.timestampUs);
         
         // Call callback if registered
         if (receiveCallback) {
-            receiveCallback(id, data, length);
+            receiveCallback(frame.id, frame.data, frame.dlc);
         }
+        
+        if (source >= 0) latencyTrace->onParsed(source, micros());
+    }
+    
+    // Consecutive frames due (flow control may just have arrived) and timeouts
+    isoTp.poll(micros());
+    
+    uint32_t now = millis();
+    updateSubscription(now);
+    
+    if (nodeRole == CAN_NODE_DISPLAY && now - lastTimeSyncMs >= CAN_TIME_SYNC_PERIOD_MS) {
+        uint8_t request[1 + CAN_TIME_SYNC_REQUEST_LEN] = { CAN_DISPLAY_CMD_TIME_SYNC };
+        uint8_t length = 1 + timeSync.makeRequest(request + 1, micros());
+        transmitFrame(CAN_MSG_COUNT, MSG_ID_DISPLAY_CMD, request, length);
+        lastTimeSyncMs = now;
     }
 }
 
 bool BikeCANManager::sendBikeStatus(const BikeStatus& status, bool bikeUnlocked, bool bleConnected) {
     if (!initialized) return false;
     
-    CAN.beginPacket(MSG_ID_BIKE_STATUS);
-    CAN.write(status.operationState);           // Bike operation state
-    CAN.write(bikeUnlocked ? 1 : 0);            // Unlock status
-    CAN.write(bleConnected ? 1 : 0);            // BLE status
-    CAN.write((uint8_t)(status.bikeSpeed));     // Speed (km/h)
-    
-    // Status flags byte (key, brake, charging, signals)
-    uint8_t flags = 0;
-    if (status.keyOn) flags |= 0x01;
-    if (status.brakePressed) flags |= 0x02;
-    if (status.bms1.isCharging || status.bms2.isCharging) flags |= 0x04;
-    if (status.leftSignal) flags |= 0x08;
-    if (status.rightSignal) flags |= 0x10;
-    CAN.write(flags);
-    
-    // Reserved bytes
-    CAN.write(0x00);
-    CAN.write(0x00);
-    
-    if (CAN.endPacket()) {
-        messagesSent++;
-        return true;
-    }
-    
-    return false;
+    announceSample(CAN_TRACE_STATUS, status.sampleSeq, status.sampleUs);
+    
+    CANBikeStatusFrame frame;
+    frame.operationState = status.operationState;
+    frame.bikeUnlocked = bikeUnlocked;
+    frame.bleConnected = bleConnected;
+    frame.speed = status.bikeSpeed;
+    frame.keyOn = status.keyOn;
+    frame.brakePressed = status.brakePressed;
+    frame.charging = status.bms1.isCharging || status.bms2.isCharging;
+    frame.leftSignal = status.leftSignal;
+    frame.rightSignal = status.rightSignal;
+    
+    uint8_t data[8];
+    frame.pack(data);
+    return transmitFrame(CAN_MSG_BIKE_STATUS, MSG_ID_BIKE_STATUS, data, CANBikeStatusFrame::length);
 }
 
 bool BikeCANManager::sendBMSData(const BMSData& bms, uint8_t bmsId) {
     if (!initialized) return false;
     
-    CAN.beginPacket(MSG_ID_BMS_DATA + bmsId);
-    
-    // Pack voltage (2 bytes) - multiply by 100 to preserve 2 decimal places
-    uint16_t voltage = (uint16_t)(bms.voltage * 100);
-    CAN.write(voltage >> 8);
-    CAN.write(voltage & 0xFF);
+    if (bmsId == 1 || bmsId == 2) {
+        announceSample(bmsId == 1 ? CAN_TRACE_BMS1 : CAN_TRACE_BMS2, bms.sampleSeq, bms.sampleUs);
+    }
     
-    // Pack current (2 bytes) - multiply by 100, handle negative values
-    int16_t current = (int16_t)(bms.current * 100);
-    CAN.write(current >> 8);
-    CAN.write(current & 0xFF);
+    CANBmsFrame frame;
+    frame.voltage = bms.voltage;
+    frame.current = bms.current;
+    frame.soc = bms.soc;
+    frame.temperature = getMaxBMSTemperature(bms);  // Hottest of cell/MOSFET/box sensors
+    frame.connected = bms.connected;
+    frame.isCharging = bms.isCharging;
+    frame.isDischarging = bms.isDischarging;
+    frame.chargingEnabled = bms.chargingEnabled;
+    frame.dischargingEnabled = bms.dischargingEnabled;
+    frame.numCells = bms.numCells;
+    
+    uint8_t data[8];
+    frame.pack(data);
+    return transmitFrame(bmsMessageType(bmsId), MSG_ID_BMS_DATA + bmsId, data, CANBmsFrame::length);
+}
+
+bool BikeCANManager::sendVESCData(const VESCData& vesc) {
+    if (!initialized) return false;
     
-    // SOC percentage (1 byte)
-    CAN.write(bms.soc);
+    announceSample(CAN_TRACE_VESC, vesc.sampleSeq, vesc.sampleUs);
     
-    // Calculate maximum temperature from all available sensors
-    float maxTemp = bms.temperature;  // Battery temperature (primary)
+    CANVescFrame frame;
+    frame.motorRPM = vesc.motorRPM;
+    frame.inputVoltage = vesc.inputVoltage;
+    frame.motorCurrent = vesc.motorCurrent;
+    frame.tempMotor = vesc.tempMotor;
+    frame.tempFET = vesc.tempFET;
     
-    // Check power temperature (MOSFET temperature)
-    if (bms.powerTemp > -50.0f && bms.powerTemp < 150.0f) {  // Valid range check
-        maxTemp = max(maxTemp, bms.powerTemp);
+    uint8_t data[8];
+    frame.pack(data);
+    return transmitFrame(CAN_MSG_VESC_DATA, MSG_ID_VESC_DATA, data, CANVescFrame::length);
+}
+
+// =============================================================================
+// SEGMENTED TRANSFERS (ISO-TP)
+// =============================================================================
+
+bool BikeCANManager::sendCellVoltages(const BMSData& bms, uint8_t bmsId) {
+    uint8_t payload[3 + 2 * BMS_MAX_CELLS];
+    uint8_t cells = bms.numCells > BMS_MAX_CELLS ? BMS_MAX_CELLS : bms.numCells;
+    
+    payload[0] = CAN_ISOTP_PDU_CELLS;
+    payload[1] = bmsId;
+    payload[2] = cells;
+    for (uint8_t i = 0; i < cells; i++) {
+        payload[3 + 2 * i] = bms.cellVoltagesMv[i] & 0xFF;
+        payload[4 + 2 * i] = bms.cellVoltagesMv[i] >> 8;
     }
+    return sendIsoTp(payload, 3 + 2 * cells);
+}
+
+bool BikeCANManager::sendBMSInfo(const BMSInfo& info, uint8_t bmsId) {
+    uint8_t payload[4 + 2 * (BMS_INFO_MAX_LEN - 1)];
+    uint8_t length = 0;
+    
+    payload[length++] = CAN_ISOTP_PDU_BMS_INFO;
+    payload[length++] = bmsId;
+    
+    const char* fields[2] = { info.softwareVersion, info.deviceInfo };
+    for (uint8_t f = 0; f < 2; f++) {
+        uint8_t size = strnlen(fields[f], BMS_INFO_MAX_LEN - 1);
+        payload[length++] = size;
+        memcpy(payload + length, fields[f], size);
+        length += size;
+    }
+    return sendIsoTp(payload, length);
+}
+
+bool BikeCANManager::sendIsoTp(const uint8_t* payload, uint16_t length) {
+    if (!initialized) return false;
+    return isoTp.send(payload, length, micros());
+}
+
+bool BikeCANManager::isIsoTpBusy() {
+    return isoTp.isSending();
+}
+
+void BikeCANManager::setIsoTpFlowControl(uint8_t blockSize, uint8_t separationTimeMs) {
+    isoTp.setFlowControl(blockSize, separationTimeMs);
+}
+
+CANIsoTpStats BikeCANManager::getIsoTpStats() {
+    return isoTp.getStats();
+}
+
+void BikeCANManager::setIsoTpCallback(CANIsoTpCallback callback) {
+    isoTpCallback = callback;
+}
+
+// Raw frames for the ISO-TP channel: uncached, counted against the bus-load budget
+bool BikeCANManager::isoTpSendFrame(void* context, uint32_t id, const uint8_t* data, uint8_t length) {
+    BikeCANManager* manager = static_cast<BikeCANManager*>(context);
+    manager->budgetBits = manager->budgetBits > CAN_FRAME_MAX_BITS ? manager->budgetBits - CAN_FRAME_MAX_BITS : 0;
+    return manager->transmitFrame(CAN_MSG_COUNT, id, data, length);
+}
+
+void BikeCANManager::dispatchIsoTp() {
+    if (!isoTp.hasMessage()) return;
     
-    // Check box temperature (BMS controller temperature)  
-    if (bms.boxTemp > -50.0f && bms.boxTemp < 150.0f) {  // Valid range check
-        maxTemp = max(maxTemp, bms.boxTemp);
+    if (isoTpCallback) {
+        isoTpCallback(isoTp.getMessage(), isoTp.getMessageLength());
+    }
+    isoTp.release();
+}
+
+// Cell voltages and BMS strings for connected packs, while the channel is free
+// and the TX path keeps up
+void BikeCANManager::sendDueTransfers(const SharedBikeData& sharedData, uint32_t now) {
+    if (isoTp.isSending() || busOffActive || txSuspended || isTxCongested()) return;
+    
+    const BMSData* packs[2] = { &sharedData.sensorData.bms1, &sharedData.sensorData.bms2 };
+    const BMSInfo* infos[2] = { &sharedData.identity.bms1, &sharedData.identity.bms2 };
+    
+    if (infoPeriodMs > 0 && (int32_t)(now - nextInfoDueMs) >= 0) {
+        nextInfoDueMs = now + infoPeriodMs;
+        uint8_t pack = nextInfoPack;
+        nextInfoPack = (pack == 1) ? 2 : 1;
+        if (packs[pack - 1]->connected && sendBMSInfo(*infos[pack - 1], pack)) return;
     }
     
-    // Temperature (1 byte) - send maximum temperature with offset
-    CAN.write((uint8_t)(maxTemp + 50));
+    if (cellsPeriodMs > 0 && (int32_t)(now - nextCellsDueMs) >= 0) {
+        nextCellsDueMs = now + cellsPeriodMs;
+        uint8_t pack = nextCellsPack;
+        nextCellsPack = (pack == 1) ? 2 : 1;
+        if (packs[pack - 1]->connected && packs[pack - 1]->numCells > 0) {
+            sendCellVoltages(*packs[pack - 1], pack);
+        }
+    }
+}
+
+// =============================================================================
+// SUBSCRIPTIONS
+// =============================================================================
+
+static const uint8_t messageGroups[CAN_MSG_COUNT] = {
+    CAN_GROUP_STATUS,    // CAN_MSG_BIKE_STATUS
+    CAN_GROUP_BATTERY,   // CAN_MSG_BMS1_DATA
+    CAN_GROUP_BATTERY,   // CAN_MSG_BMS2_DATA
+    CAN_GROUP_MOTOR,     // CAN_MSG_VESC_DATA
+    CAN_GROUP_BATTERY,   // CAN_MSG_BATTERY_EXT
+    CAN_GROUP_TRIP,      // CAN_MSG_DISTANCE_DATA
+    CAN_GROUP_TRIP,      // CAN_MSG_TIME_DATA
+};
+
+bool BikeCANManager::setSubscription(uint8_t groupMask, const uint16_t* periodMs) {
+    subscriptionMask = groupMask & CAN_GROUPS_ALL;
+    for (uint8_t g = 0; g < CAN_GROUP_COUNT; g++) {
+        subscriptionPeriodMs[g] = periodMs ? periodMs[g] : 0;
+    }
+    subscriptionActive = true;
+    return sendSubscription();
+}
+
+bool BikeCANManager::sendSubscription() {
+    if (!initialized) return false;
     
-    // Debug: Log temperature being sent via CAN (simplified)
-    // Serial.printf("📤 [CAN-BMS%d] Temp: %.1f°C\n", bmsId, maxTemp);
+    uint8_t data[2 + CAN_GROUP_COUNT];
+    data[0] = CAN_DISPLAY_CMD_SUBSCRIBE;
+    data[1] = subscriptionMask;
+    for (uint8_t g = 0; g < CAN_GROUP_COUNT; g++) {
+        uint16_t units = (subscriptionPeriodMs[g] + CAN_SUBSCRIPTION_PERIOD_UNIT_MS / 2) / CAN_SUBSCRIPTION_PERIOD_UNIT_MS;
+        if (subscriptionPeriodMs[g] > 0 && units == 0) units = 1;
+        data[2 + g] = units > 255 ? 255 : units;
+    }
     
-    // Status flags (2 bytes)
-    uint8_t status1 = 0;
-    status1 |= (bms.connected ? 0x01 : 0x00);
-    status1 |= (bms.isCharging ? 0x02 : 0x00);
-    status1 |= (bms.isDischarging ? 0x04 : 0x00);
-    status1 |= (bms.chargingEnabled ? 0x08 : 0x00);
-    status1 |= (bms.dischargingEnabled ? 0x10 : 0x00);
+    lastSubscriptionMs = millis();
+    return transmitFrame(CAN_MSG_COUNT, MSG_ID_DISPLAY_CMD, data, sizeof(data));
+}
+
+// Main board side. Other display commands are left to the receive callback.
+bool BikeCANManager::handleDisplayCommand(const CANFrame& frame) {
+    if (nodeRole == CAN_NODE_DISPLAY || frame.dlc < 1) return false;
+    
+    if (frame.data[0] == CAN_DISPLAY_CMD_TIME_SYNC) {
+        // t2 is when the request arrived, t3 is now
+        uint8_t reply[CAN_TIME_SYNC_REPLY_LEN];
+        uint8_t length = CANTimeSync::makeReply(reply, frame.data + 1, frame.dlc - 1, frame.timestampUs, micros());
+        if (length) transmitFrame(CAN_MSG_COUNT, MSG_ID_TIME_SYNC, reply, length);
+        return true;
+    }
     
-    CAN.write(status1);
-    CAN.write(bms.numCells);
+    if (frame.data[0] != CAN_DISPLAY_CMD_SUBSCRIBE || frame.dlc < 2 + CAN_GROUP_COUNT) return false;
     
-    if (CAN.endPacket()) {
-        messagesSent++;
-        return true;
+    uint8_t mask = frame.data[1] & CAN_GROUPS_ALL;
+    bool changed = !subscriptionActive || mask != subscriptionMask;
+    for (uint8_t g = 0; g < CAN_GROUP_COUNT; g++) {
+        uint16_t periodMs = frame.data[2 + g] * CAN_SUBSCRIPTION_PERIOD_UNIT_MS;
+        if (periodMs != subscriptionPeriodMs[g]) changed = true;
+        subscriptionPeriodMs[g] = periodMs;
     }
     
-    return false;
+    uint8_t previous = getSubscribedGroups();
+    subscriptionMask = mask;
+    subscriptionActive = true;
+    lastSubscriptionMs = millis();
+    subscriptionsReceived++;
+    
+    if (changed) {
+        // Groups the display just started showing need fresh data, not a heartbeat later
+        for (uint8_t i = 0; i < CAN_MSG_COUNT; i++) {
+            if ((mask & ~previous) & CAN_GROUP_BIT(messageGroups[i])) txCache[i].valid = false;
+        }
+        applySubscription();
+        BIKE_LOGI("[CAN] Display subscription: groups 0x%02X", mask);
+    }
+    return true;
 }
 
-bool BikeCANManager::sendVESCData(const VESCData& vesc) {
-    if (!initialized) return false;
-    
-    CAN.beginPacket(MSG_ID_VESC_DATA);
-    
-    // Motor RPM (2 bytes) - divide by 10 to fit in 16-bit
-    int16_t rpm = (int16_t)(vesc.motorRPM / 10);
-    CAN.write(rpm >> 8);
-    CAN.write(rpm & 0xFF);
+void BikeCANManager::updateSubscription(uint32_t now) {
+    if (!subscriptionActive) return;
+    
+    if (nodeRole == CAN_NODE_DISPLAY) {
+        if (now - lastSubscriptionMs >= CAN_SUBSCRIPTION_REFRESH_MS) sendSubscription();
+    } else if (now - lastSubscriptionMs >= CAN_SUBSCRIPTION_TIMEOUT_MS) {
+        // Display went quiet (rebooting, older firmware): send everything again
+        subscriptionActive = false;
+        invalidateTxCache();
+        applySubscription();
+        BIKE_LOGW("[CAN] Display subscription timed out, default schedule");
+    }
+}
+
+// Effective period: stretched by the rate divider, at most what fits the entry
+static uint16_t dividedPeriod(uint16_t periodMs, uint8_t divider) {
+    uint32_t divided = (uint32_t)periodMs * divider;
+    return divided > 0xFFFF ? 0xFFFF : (uint16_t)divided;
+}
+
+// Effective periods from the configured ones, the subscription in force and the rate divider
+void BikeCANManager::applySubscription() {
+    bool filtered = subscriptionActive && nodeRole != CAN_NODE_DISPLAY;
+    uint32_t now = millis();
+    
+    for (uint8_t i = 0; i < CAN_MSG_COUNT; i++) {
+        CANScheduleEntry& entry = schedule[i];
+        uint8_t group = messageGroups[i];
+        uint16_t periodMs = entry.configuredMs;
+        
+        if (filtered && periodMs > 0) {
+            if (!(subscriptionMask & CAN_GROUP_BIT(group))) periodMs = 0;
+            else if (subscriptionPeriodMs[group] > 0) periodMs = subscriptionPeriodMs[group];
+        }
+        periodMs = dividedPeriod(periodMs, rateDivider);
+        
+        // Re-enabled entries become due immediately instead of at a stale deadline,
+        // shortened ones no later than one new period from now
+        if (entry.periodMs == 0 && periodMs > 0) entry.nextDueMs = now;
+        else if (periodMs > 0 && (int32_t)(entry.nextDueMs - (now + periodMs)) > 0) entry.nextDueMs = now + periodMs;
+        entry.periodMs = periodMs;
+    }
     
-    // Input voltage (2 bytes) - multiply by 100
-    uint16_t voltage = (uint16_t)(vesc.inputVoltage * 100);
-    CAN.write(voltage >> 8);
-    CAN.write(voltage & 0xFF);
+    uint16_t cells = CAN_PERIOD_CELLS_MS, info = CAN_PERIOD_BMS_INFO_MS;
+    if (filtered) {
+        cells = !(subscriptionMask & CAN_GROUP_BIT(CAN_GROUP_CELLS)) ? 0 :
+                subscriptionPeriodMs[CAN_GROUP_CELLS] ? subscriptionPeriodMs[CAN_GROUP_CELLS] : CAN_PERIOD_CELLS_MS;
+        info = !(subscriptionMask & CAN_GROUP_BIT(CAN_GROUP_BMS_INFO)) ? 0 :
+               subscriptionPeriodMs[CAN_GROUP_BMS_INFO] ? subscriptionPeriodMs[CAN_GROUP_BMS_INFO] : CAN_PERIOD_BMS_INFO_MS;
+    }
+    cells = dividedPeriod(cells, rateDivider);
+    info = dividedPeriod(info, rateDivider);
+    if (cellsPeriodMs == 0 && cells > 0) nextCellsDueMs = now;
+    else if (cells > 0 && (int32_t)(nextCellsDueMs - (now + cells)) > 0) nextCellsDueMs = now + cells;
+    if (infoPeriodMs == 0 && info > 0) nextInfoDueMs = now;
+    else if (info > 0 && (int32_t)(nextInfoDueMs - (now + info)) > 0) nextInfoDueMs = now + info;
+    cellsPeriodMs = cells;
+    infoPeriodMs = info;
+}
+
+uint8_t BikeCANManager::getSubscribedGroups() {
+    return (subscriptionActive && nodeRole != CAN_NODE_DISPLAY) ? subscriptionMask : CAN_GROUPS_ALL;
+}
+
+bool BikeCANManager::isSubscriptionActive() {
+    return subscriptionActive;
+}
+
+uint32_t BikeCANManager::getSubscriptionsReceived() {
+    return subscriptionsReceived;
+}
+
+// =============================================================================
+// LATENCY TRACING
+// =============================================================================
+
+void BikeCANManager::setLatencyTrace(CANLatencyTrace* trace) {
+    latencyTrace = trace;
+}
+
+const CANTimeSync& BikeCANManager::getTimeSync() {
+    return timeSync;
+}
+
+bool BikeCANManager::isTimeSynced() {
+    return timeSync.isSynced(micros());
+}
+
+// Main board: stamp of a new sample for the data frame about to be encoded.
+// transmitFrame() sends it just ahead of that frame, and only if the frame
+// itself goes out: a suppressed frame takes its stamp with it. Behind a
+// scheduled frame the stamp is charged to the bus-load budget as a frame of
+// its own; with no budget left it waits for the next frame of the sample.
+void BikeCANManager::announceSample(uint8_t source, uint8_t sequence, uint32_t sampleUs) {
+    stagedStamp.pending = false;
+    if (nodeRole == CAN_NODE_DISPLAY || sequence == 0 || sequence == announcedSeq[source]) return;
+    
+    stagedStamp.source = source;
+    stagedStamp.sequence = sequence;
+    stagedStamp.sampleUs = sampleUs;
+    stagedStamp.pending = true;
+}
+
+void BikeCANManager::sendSampleStamp(const SampleStamp& stamp) {
+    if (scheduledSend) {
+        if (budgetBits < CAN_FRAME_MAX_BITS) {
+            budgetDeferrals++;
+            return;
+        }
+        budgetBits -= CAN_FRAME_MAX_BITS;
+    }
     
-    // Motor current (2 bytes) - multiply by 100
-    int16_t current = (int16_t)(vesc.motorCurrent * 100);
-    CAN.write(current >> 8);
-    CAN.write(current & 0xFF);
+    uint8_t data[6] = {
+        stamp.source, stamp.sequence,
+        (uint8_t)(stamp.sampleUs >> 24), (uint8_t)(stamp.sampleUs >> 16),
+        (uint8_t)(stamp.sampleUs >> 8), (uint8_t)stamp.sampleUs
+    };
+    if (transmitFrame(CAN_MSG_COUNT, MSG_ID_SAMPLE_INFO, data, sizeof(data))) {
+        announcedSeq[stamp.source] = stamp.sequence;
+    } else if (scheduledSend) {
+        budgetBits += CAN_FRAME_MAX_BITS;
+    }
+}
+
+// Display side: clock sync replies and sample stamps never reach the receive callback
+bool BikeCANManager::handleTraceFrame(const CANFrame& frame) {
+    if (nodeRole == CAN_NODE_MAIN) return false;
     
-    // Temperature (2 bytes) - Motor and FET temps
-    CAN.write((uint8_t)(vesc.tempMotor + 50));
-    CAN.write((uint8_t)(vesc.tempFET + 50));
+    if (frame.id == MSG_ID_TIME_SYNC) {
+        timeSync.onReply(frame.data, frame.dlc, frame.timestampUs);
+        return true;
+    }
     
-    if (CAN.endPacket()) {
-        messagesSent++;
+    if (frame.id == MSG_ID_SAMPLE_INFO) {
+        if (latencyTrace && frame.dlc >= 6) {
+            uint32_t captureUs = ((uint32_t)frame.data[2] << 24) | ((uint32_t)frame.data[3] << 16) |
+                                 ((uint32_t)frame.data[4] << 8) | frame.data[5];
+            latencyTrace->onSample(frame.data[0], frame.data[1], timeSync.toLocal(captureUs),
+                                   timeSync.isSynced(frame.timestampUs));
+        }
         return true;
     }
     
     return false;
 }
 
+int8_t BikeCANManager::traceSource(uint32_t id) {
+    switch (id) {
+        case MSG_ID_BIKE_STATUS:    return CAN_TRACE_STATUS;
+        case MSG_ID_BMS_DATA + 1:   return CAN_TRACE_BMS1;
+        case MSG_ID_BMS_DATA + 2:   return CAN_TRACE_BMS2;
+        case MSG_ID_VESC_DATA:      return CAN_TRACE_VESC;
+        default:                    return -1;
+    }
+}
 
+// =============================================================================
+// TRANSMIT SCHEDULER
+// =============================================================================
 
-void BikeCANManager::sendNextInSequence(const SharedBikeData& sharedData) {
-    if (!initialized) return;
+void BikeCANManager::resetSchedule() {
+    static const CANScheduleEntry defaults[CAN_MSG_COUNT] = {
+        { CAN_PERIOD_BIKE_STATUS_MS, 0, 0, 0, 0 },  // CAN_MSG_BIKE_STATUS
+        { CAN_PERIOD_BMS_MS,         2, 0, 0, 0 },  // CAN_MSG_BMS1_DATA
+        { CAN_PERIOD_BMS_MS,         2, 0, 0, 0 },  // CAN_MSG_BMS2_DATA
+        { CAN_PERIOD_VESC_MS,        1, 0, 0, 0 },  // CAN_MSG_VESC_DATA
+        { CAN_PERIOD_BATTERY_EXT_MS, 3, 0, 0, 0 },  // CAN_MSG_BATTERY_EXT
+        { CAN_PERIOD_DISTANCE_MS,    4, 0, 0, 0 },  // CAN_MSG_DISTANCE_DATA
+        { CAN_PERIOD_TIME_MS,        5, 0, 0, 0 },  // CAN_MSG_TIME_DATA
+    };
+    
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < CAN_MSG_COUNT; i++) {
+        schedule[i] = defaults[i];
+        schedule[i].configuredMs = defaults[i].periodMs;
+        // Stagger first deadlines so equal-period frames don't burst together
+        schedule[i].nextDueMs = now + i * CAN_SCHEDULER_TICK_MS;
+    }
     
-    bool success = false;
+    budgetBits = 0;
+    lastBudgetRefillMs = now;
+    budgetDeferrals = 0;
+}
+
+void BikeCANManager::refillBudget(uint32_t now) {
+    uint32_t elapsed = now - lastBudgetRefillMs;
+    lastBudgetRefillMs = now;
+    
+    // Bits per ms available to the scheduler at the configured bus share
+    uint32_t bitsPerMs = (uint32_t)(CAN_SPEED / 1000) * busLoadBudgetPct / 100;
+    uint32_t maxBits = bitsPerMs * CAN_BUDGET_WINDOW_MS;
+    
+    if (elapsed >= CAN_BUDGET_WINDOW_MS) {
+        budgetBits = maxBits;
+    } else {
+        budgetBits += bitsPerMs * elapsed;
+        if (budgetBits > maxBits) budgetBits = maxBits;
+    }
+}
+
+// Earliest deadline first among due entries, priority breaks ties
+int8_t BikeCANManager::pickDueMessage(uint32_t now) {
+    int8_t best = -1;
+    
+    for (uint8_t i = 0; i < CAN_MSG_COUNT; i++) {
+        const CANScheduleEntry& entry = schedule[i];
+        if (entry.periodMs == 0) continue;
+        if ((int32_t)(now - entry.nextDueMs) < 0) continue;  // Not due yet
+        
+        if (best < 0) {
+            best = i;
+            continue;
+        }
+        
+        int32_t diff = (int32_t)(entry.nextDueMs - schedule[best].nextDueMs);
+        if (diff < 0 || (diff == 0 && entry.priority < schedule[best].priority)) {
+            best = i;
+        }
+    }
     
-    // Convert to display data for additional info
-    BikeDataDisplay displayData = convertToDisplayData(sharedData.sensorData, sharedData.bleConnected);
+    return best;
+}
+
+uint8_t BikeCANManager::sendDueMessages(const SharedBikeData& sharedData) {
+    if (!initialized) return 0;
     
-    switch (sendSequence % CAN_MSG_COUNT) {
-        case CAN_MSG_BIKE_STATUS:
-            success = sendBikeStatus(sharedData.sensorData, sharedData.bikeUnlocked, sharedData.bleConnected);
+    uint32_t now = millis();
+    refillBudget(now);
+    
+    uint8_t sent = 0;
+    int8_t index;
+    
+    while ((index = pickDueMessage(now)) >= 0) {
+        CANScheduleEntry& entry = schedule[index];
+        bool highPriority = entry.priority <= CAN_TX_RETRY_PRIORITY;
+        
+        if (budgetBits < CAN_FRAME_MAX_BITS) {
+            // Over budget - leave remaining frames due, their deadlines keep them first next tick
+            budgetDeferrals++;
             break;
-            
+        }
+        
+        if (!highPriority && isTxCongested()) {
+            // Queue backing up: this value would be stale by the time it got out,
+            // the next period brings a fresh one
+            txDropped++;
+        } else {
+            budgetBits -= CAN_FRAME_MAX_BITS;
+            scheduledSend = true;
+            bool accepted = sendMessage((CANMessageType)index, sharedData);
+            scheduledSend = false;
+            if (accepted) {
+                if (lastTxSuppressed) {
+                    budgetBits += CAN_FRAME_MAX_BITS;  // Unchanged payload never reached the bus
+                } else {
+                    sent++;
+                }
+            } else {
+                budgetBits += CAN_FRAME_MAX_BITS;
+                
+                // Try again next tick, encoded from the data current then
+                if (highPriority && !busOffActive && !txSuspended) {
+                    if (entry.retries < CAN_TX_MAX_RETRIES) {
+                        entry.retries++;
+                        txRetried++;
+                        entry.nextDueMs = now + CAN_SCHEDULER_TICK_MS;
+                        continue;
+                    }
+                    txRetriesExhausted++;
+                }
+            }
+        }
+        
+        entry.retries = 0;
+        entry.nextDueMs += entry.periodMs;
+        
+        // Fell more than a period behind (budget, task stall) - don't burst to catch up
+        if ((int32_t)(now - entry.nextDueMs) >= 0) {
+            entry.nextDueMs = now + entry.periodMs;
+        }
+    }
+    
+    sendDueTransfers(sharedData, now);
+    
+    return sent;
+}
+
+// How long canTask may sleep when no frame arrives: the nearest schedule or
+// transfer deadline. Retries and recovery keep the tick. A transfer in flight
+// wakes the task for each consecutive frame, poll() sends one per STmin.
+uint32_t BikeCANManager::getIdleMs() {
+    if (busOffActive || txSuspended) return CAN_SCHEDULER_TICK_MS;
+    
+    uint32_t now = millis();
+    int32_t idle = CAN_IDLE_MAX_MS;
+    
+    for (uint8_t i = 0; i < CAN_MSG_COUNT; i++) {
+        if (schedule[i].periodMs == 0) continue;
+        int32_t untilDue = (int32_t)(schedule[i].nextDueMs - now);
+        if (untilDue < idle) idle = untilDue;
+    }
+    if (infoPeriodMs > 0 && (int32_t)(nextInfoDueMs - now) < idle) idle = (int32_t)(nextInfoDueMs - now);
+    if (cellsPeriodMs > 0 && (int32_t)(nextCellsDueMs - now) < idle) idle = (int32_t)(nextCellsDueMs - now);
+    if (idle < CAN_SCHEDULER_TICK_MS) idle = CAN_SCHEDULER_TICK_MS;
+    
+    if (isoTp.isSending()) {
+        uint32_t frameMs = (isoTp.getTxDueUs(micros()) + 999) / 1000;
+        if (frameMs < 1) frameMs = 1;  // At least one RTOS tick
+        if (frameMs < (uint32_t)idle) idle = frameMs;
+    }
+    
+    return (uint32_t)idle;
+}
+
+bool BikeCANManager::sendMessage(CANMessageType type, const SharedBikeData& sharedData) {
+    switch (type) {
+        case CAN_MSG_BIKE_STATUS:
+            return sendBikeStatus(sharedData.sensorData, sharedData.bikeUnlocked, sharedData.bleConnected);
+        
         case CAN_MSG_BMS1_DATA:
-            success = sendBMSData(sharedData.sensorData.bms1, 1);
-            break;
-            
+            return sendBMSData(sharedData.sensorData.bms1, 1);
+        
         case CAN_MSG_BMS2_DATA:
-            success = sendBMSData(sharedData.sensorData.bms2, 2);
-            break;
-            
+            return sendBMSData(sharedData.sensorData.bms2, 2);
+        
         case CAN_MSG_VESC_DATA:
-            success = sendVESCData(sharedData.sensorData.vesc);
-            break;
-            
+            return sendVESCData(sharedData.sensorData.vesc);
+        
         case CAN_MSG_BATTERY_EXT:
-            success = sendBatteryExtended(sharedData.sensorData.bms1, sharedData.sensorData.bms2);
-            break;
-            
-        case CAN_MSG_DISTANCE_DATA:
-            success = sendDistanceData(displayData.odometer, displayData.distance, displayData.tripDistance);
-            break;
-            
+            return sendBatteryExtended(sharedData.sensorData.bms1, sharedData.sensorData.bms2);
+        
+        case CAN_MSG_DISTANCE_DATA: {
+            // Only the low-rate frames need the converted display data
+            BikeDataDisplay displayData = convertToDisplayData(sharedData.sensorData, sharedData.bleConnected);
+            return sendDistanceData(displayData.odometer, displayData.distance, displayData.tripDistance);
+        }
+        
         case CAN_MSG_TIME_DATA:
-            success = sendTimeData(displayData.time);
-            break;
+            return sendTimeData(millis() / 1000);  // Main board uptime, s
+        
+        default:
+            return false;
     }
+}
+
+void BikeCANManager::setMessagePeriod(CANMessageType type, uint16_t periodMs) {
+    if (type >= CAN_MSG_COUNT) return;
     
-    sendSequence++;
+    schedule[type].configuredMs = periodMs;
+    applySubscription();
 }
 
-void BikeCANManager::setReceiveCallback(CANReceiveCallback callback) {
-    receiveCallback = callback;
+void BikeCANManager::setMessagePriority(CANMessageType type, uint8_t priority) {
+    if (type >= CAN_MSG_COUNT) return;
+    schedule[type].priority = priority;
 }
 
+void BikeCANManager::setBusLoadBudget(uint8_t percent) {
+    busLoadBudgetPct = constrain(percent, 1, 100);
+}
 
+void BikeCANManager::setRateDivider(uint8_t divider) {
+    rateDivider = divider ? divider : 1;
+    applySubscription();
+}
 
-bool BikeCANManager::isInitialized() {
-    return initialized;
+uint16_t BikeCANManager::getMessagePeriod(CANMessageType type) {
+    return (type < CAN_MSG_COUNT) ? schedule[type].periodMs : 0;
 }
 
-uint32_t BikeCANManager::getMessagesSent() {
-    return messagesSent;
+uint8_t BikeCANManager::getBusLoadBudget() {
+    return busLoadBudgetPct;
 }
 
-uint32_t BikeCANManager::getMessagesReceived() {
-    return messagesReceived;
+uint8_t BikeCANManager::getRateDivider() {
+    return rateDivider;
 }
 
+uint32_t BikeCANManager::getBudgetDeferrals() {
+    return budgetDeferrals;
+}
 
+// =============================================================================
+// CHANGE-DRIVEN TRANSMISSION
+// =============================================================================
 
-bool BikeCANManager::sendBatteryExtended(const BMSData& bms1, const BMSData& bms2) {
-    if (!initialized) return false;
+void BikeCANManager::resetTxCache() {
+    memset(txCache, 0, sizeof(txCache));
     
-    CAN.beginPacket(MSG_ID_BATTERY_EXT);
+    // Status: any change goes out at the next 50 ms tick, otherwise 2 Hz keepalive
+    setTransmitMode(CAN_MSG_BIKE_STATUS, CAN_TX_ON_CHANGE, CAN_HEARTBEAT_STATUS_MS);
     
-    // Battery differential voltages (already in mV, clip to 255mV max)
-    uint8_t bms1DeltaByte = (bms1.cellVoltageDelta > 255) ? 255 : (uint8_t)bms1.cellVoltageDelta;
-    uint8_t bms2DeltaByte = (bms2.cellVoltageDelta > 255) ? 255 : (uint8_t)bms2.cellVoltageDelta;
+    // Packs: ignore ADC noise on voltage (50 mV) and current (0.1 A)
+    for (uint8_t type = CAN_MSG_BMS1_DATA; type <= CAN_MSG_BMS2_DATA; type++) {
+        setTransmitMode((CANMessageType)type, CAN_TX_ON_CHANGE);
+        setDeadband((CANMessageType)type, 0, 2, 5);
+        setDeadband((CANMessageType)type, 2, 2, 10, true);
+    }
     
-    CAN.write(bms1DeltaByte); 
-    CAN.write(bms2DeltaByte);
+    // Motor: RPM (50 rpm), voltage (50 mV), current (0.1 A)
+    setTransmitMode(CAN_MSG_VESC_DATA, CAN_TX_ON_CHANGE);
+    setDeadband(CAN_MSG_VESC_DATA, 0, 2, 5, true);
+    setDeadband(CAN_MSG_VESC_DATA, 2, 2, 5);
+    setDeadband(CAN_MSG_VESC_DATA, 4, 2, 10, true);
     
-    // Calculate maximum temperatures for each BMS
-    float maxTemp1 = bms1.temperature;
-    if (bms1.powerTemp > -50.0f && bms1.powerTemp < 150.0f) maxTemp1 = max(maxTemp1, bms1.powerTemp);
-    if (bms1.boxTemp > -50.0f && bms1.boxTemp < 150.0f) maxTemp1 = max(maxTemp1, bms1.boxTemp);
+    // Extended: power (10 W)
+    setTransmitMode(CAN_MSG_BATTERY_EXT, CAN_TX_ON_CHANGE);
+    setDeadband(CAN_MSG_BATTERY_EXT, 4, 2, 10, true);
     
-    float maxTemp2 = bms2.temperature;
-    if (bms2.powerTemp > -50.0f && bms2.powerTemp < 150.0f) maxTemp2 = max(maxTemp2, bms2.powerTemp);
-    if (bms2.boxTemp > -50.0f && bms2.boxTemp < 150.0f) maxTemp2 = max(maxTemp2, bms2.boxTemp);
+    // Distance and time stay periodic at their low scheduled rate
+    setTransmitMode(CAN_MSG_DISTANCE_DATA, CAN_TX_PERIODIC);
+    setTransmitMode(CAN_MSG_TIME_DATA, CAN_TX_PERIODIC);
+}
+
+void BikeCANManager::setTransmitMode(CANMessageType type, CANTxMode mode, uint16_t heartbeatMs) {
+    if (type >= CAN_MSG_COUNT) return;
+    txCache[type].mode = mode;
+    txCache[type].heartbeatMs = heartbeatMs;
+}
+
+bool BikeCANManager::setDeadband(CANMessageType type, uint8_t startByte, uint8_t length, uint16_t threshold, bool isSigned) {
+    if (type >= CAN_MSG_COUNT) return false;
+    if (length != 1 && length != 2 && length != 4) return false;
+    if (startByte + length > 8) return false;
+    
+    for (uint8_t i = 0; i < CAN_MAX_DEADBANDS; i++) {
+        CANDeadband& band = txCache[type].deadbands[i];
+        if (band.length == 0 || band.startByte == startByte) {
+            band.startByte = startByte;
+            band.length = length;
+            band.isSigned = isSigned;
+            band.threshold = threshold;
+            return true;
+        }
+    }
     
-    // Battery maximum temperatures (1 byte each + 40 offset)
-    CAN.write((uint8_t)(maxTemp1 + 40));
-    CAN.write((uint8_t)(maxTemp2 + 40));
+    return false;  // All slots used
+}
+
+void BikeCANManager::clearDeadbands(CANMessageType type) {
+    if (type >= CAN_MSG_COUNT) return;
+    memset(txCache[type].deadbands, 0, sizeof(txCache[type].deadbands));
+}
+
+CANTxMode BikeCANManager::getTransmitMode(CANMessageType type) {
+    return (type < CAN_MSG_COUNT) ? txCache[type].mode : CAN_TX_PERIODIC;
+}
+
+void BikeCANManager::invalidateTxCache() {
+    // Next send of every type goes out regardless of payload (e.g. display reconnected)
+    for (uint8_t i = 0; i < CAN_MSG_COUNT; i++) {
+        txCache[i].valid = false;
+    }
+}
+
+// Read a big-endian field as a signed 32-bit value
+static int32_t readField(const uint8_t* data, uint8_t startByte, uint8_t length, bool isSigned) {
+    uint32_t raw = 0;
+    for (uint8_t i = 0; i < length; i++) {
+        raw = (raw << 8) | data[startByte + i];
+    }
+    
+    if (isSigned && length < 4) {
+        uint32_t signBit = 1UL << (length * 8 - 1);
+        raw = (raw ^ signBit) - signBit;
+    }
     
-    // Debug: Log extended temperatures (simplified)
-    // Serial.printf("📤 [CAN-EXT] BMS1: %.1f°C, BMS2: %.1f°C\n", maxTemp1, maxTemp2);
+    return (int32_t)raw;
+}
+
+bool BikeCANManager::payloadChanged(const CANTxCache& cache, const uint8_t* data, uint8_t length) {
+    if (!cache.valid || cache.length != length) return true;
     
-    // Power calculations (2 bytes)
-    int16_t motorPower = (int16_t)((bms1.voltage + bms2.voltage) * (bms1.current + bms2.current) / 2);
-    CAN.write(motorPower >> 8);
-    CAN.write(motorPower & 0xFF);
+    uint8_t covered = 0;  // Bit per payload byte handled by a deadband
     
-    // Status flags
-    uint8_t flags = 0;
-    if (bms1.isCharging || bms2.isCharging) flags |= 0x01;
-    if (bms1.connected) flags |= 0x02;
-    if (bms2.connected) flags |= 0x04;
-    CAN.write(flags);
+    for (uint8_t i = 0; i < CAN_MAX_DEADBANDS; i++) {
+        const CANDeadband& band = cache.deadbands[i];
+        if (band.length == 0 || band.startByte + band.length > length) continue;
+        
+        int32_t previous = readField(cache.data, band.startByte, band.length, band.isSigned);
+        int32_t current = readField(data, band.startByte, band.length, band.isSigned);
+        int32_t delta = current - previous;
+        if (delta < 0) delta = -delta;
+        
+        if ((uint32_t)delta > band.threshold) return true;
+        
+        covered |= ((1 << band.length) - 1) << band.startByte;
+    }
     
-    if (CAN.endPacket()) {
-        messagesSent++;
-        return true;
+    // Everything outside a deadband must match exactly
+    for (uint8_t i = 0; i < length; i++) {
+        if (covered & (1 << i)) continue;
+        if (data[i] != cache.data[i]) return true;
     }
     
     return false;
 }
 
-bool BikeCANManager::sendDistanceData(float odometer, float distance, float tripDistance) {
-    if (!initialized) return false;
+bool BikeCANManager::transmitFrame(CANMessageType type, uint32_t id, const uint8_t* data, uint8_t length) {
+    lastTxSuppressed = false;
+    uint32_t now = millis();
+    CANTxCache* cache = (type < CAN_MSG_COUNT) ? &txCache[type] : nullptr;
+    
+    // A staged sample stamp belongs to this frame only, whether it goes out or not
+    SampleStamp stamp = stagedStamp;
+    stagedStamp.pending = false;
+    
+    if (cache && cache->mode == CAN_TX_ON_CHANGE && cache->valid &&
+        (now - cache->lastTxMs) < cache->heartbeatMs &&
+        !payloadChanged(*cache, data, length)) {
+        messagesSuppressed++;
+        lastTxSuppressed = true;
+        return true;
+    }
     
-    CAN.beginPacket(MSG_ID_DISTANCE_DATA);
+    if (!txAllowed(now)) {
+        txDropped++;
+        return false;
+    }
     
-    // Odometer (4 bytes, km * 100)
-    uint32_t odometerScaled = (uint32_t)(odometer * 100);
-    CAN.write((odometerScaled >> 24) & 0xFF);
-    CAN.write((odometerScaled >> 16) & 0xFF);
-    CAN.write((odometerScaled >> 8) & 0xFF);
-    CAN.write(odometerScaled & 0xFF);
+    if (stamp.pending) sendSampleStamp(stamp);
     
-    // Current distance (2 bytes, km * 100)
-    uint16_t distanceScaled = (uint16_t)(distance * 100);
-    CAN.write((distanceScaled >> 8) & 0xFF);
-    CAN.write(distanceScaled & 0xFF);
+    bool sent = transport->transmit(id, data, length);
+    busStats.onTransmit(id, data, length, sent, micros());
+    onTxResult(sent, now);
+    if (!sent) {
+        return false;
+    }
     
-    // Trip distance (2 bytes, km * 100)
-    uint16_t tripScaled = (uint16_t)(tripDistance * 100);
-    CAN.write((tripScaled >> 8) & 0xFF);
-    CAN.write(tripScaled & 0xFF);
+    messagesSent++;
     
-    if (CAN.endPacket()) {
-        messagesSent++;
-        return true;
+    if (logger) {
+        CANFrame frame;
+        frame.id = id;
+        frame.timestampUs = micros();
+        frame.dlc = length;
+        memcpy(frame.data, data, length);
+        logger->record(frame, true);
     }
     
-    return false;
+    if (cache) {
+        // Deadbands compare against what the display last saw, so slow drift still gets sent
+        memcpy(cache->data, data, length);
+        cache->length = length;
+        cache->lastTxMs = now;
+        cache->valid = true;
+    }
+    
+    return true;
 }
 
-bool BikeCANManager::sendTimeData(int time) {
-    if (!initialized) return false;
+// =============================================================================
+// TX ERROR HANDLING
+// =============================================================================
+
+void BikeCANManager::resetTxHealth() {
+    errorState = CAN_STATE_ACTIVE;
+    busOffActive = false;
+    txSuspended = false;
+    txFailStreak = 0;
+    backoffMs = CAN_BACKOFF_MIN_MS;
+    nextAttemptMs = 0;
+    lastTroubleMs = millis();
+    txPendingPeak = 0;
+    txRetried = 0;
+    txRetriesExhausted = 0;
+    txDropped = 0;
+    txSuspensions = 0;
+    busOffs = 0;
+    recoveries = 0;
+}
+
+// Follows the controller state from update(). Bus-off: wait the backoff
+// delay, start recovery, and double the delay for the next attempt; it only
+// comes back down after CAN_BACKOFF_RESET_MS without trouble.
+void BikeCANManager::updateTxHealth(uint32_t now) {
+    errorState = transport->getErrorState();
+    uint32_t pending = transport->getTxPending();
+    if (pending > txPendingPeak) txPendingPeak = pending;
+    
+    bool offBus = errorState == CAN_STATE_BUS_OFF || errorState == CAN_STATE_RECOVERING ||
+                  errorState == CAN_STATE_STOPPED;
+    if (offBus) {
+        if (!busOffActive) {
+            busOffActive = true;
+            busOffs++;
+            lastTroubleMs = now;
+            nextAttemptMs = now + backoffMs;
+            BIKE_LOGE("❌ CAN %s, recovery in %lu ms", canErrorStateName(errorState), (unsigned long)backoffMs);
+        } else if (errorState != CAN_STATE_RECOVERING && (int32_t)(now - nextAttemptMs) >= 0) {
+            transport->recover();
+            growBackoff(now);
+        }
+        return;
+    }
     
-    CAN.beginPacket(MSG_ID_TIME_DATA);
+    if (busOffActive) {
+        busOffActive = false;
+        resumeTx("back on the bus");
+    }
     
-    // Total time (4 bytes, seconds)
-    CAN.write((time >> 24) & 0xFF);
-    CAN.write((time >> 16) & 0xFF);
-    CAN.write((time >> 8) & 0xFF);
-    CAN.write(time & 0xFF);
+    if (!txSuspended && backoffMs > CAN_BACKOFF_MIN_MS && now - lastTroubleMs >= CAN_BACKOFF_RESET_MS) {
+        backoffMs = CAN_BACKOFF_MIN_MS;
+    }
+}
+
+// Suspended: one probe frame per backoff period, and only once the TX queue
+// has drained - a frame nobody acknowledges keeps it from emptying
+bool BikeCANManager::txAllowed(uint32_t now) {
+    if (busOffActive) return false;
+    if (!txSuspended) return true;
+    if ((int32_t)(now - nextAttemptMs) < 0) return false;
+    
+    if (transport->getTxPending() > 0) {
+        growBackoff(now);
+        return false;
+    }
+    return true;
+}
+
+void BikeCANManager::onTxResult(bool sent, uint32_t now) {
+    if (sent) {
+        txFailStreak = 0;
+        if (txSuspended) {
+            txSuspended = false;
+            resumeTx("TX resumed");
+        }
+        return;
+    }
     
-    // Reserved bytes for future use
-    CAN.write(0x00);
-    CAN.write(0x00);
-    CAN.write(0x00);
-    CAN.write(0x00);
+    lastTroubleMs = now;
+    if (txSuspended) {
+        growBackoff(now);   // Probe failed
+        return;
+    }
     
-    if (CAN.endPacket()) {
-        messagesSent++;
-        return true;
+    if (++txFailStreak >= CAN_TX_FAIL_LIMIT) {
+        // Stop spending time on writes that fail; whatever is queued is stale
+        // by the time the link is back
+        txSuspended = true;
+        txSuspensions++;
+        nextAttemptMs = now + backoffMs;
+        transport->clearTxQueue();
+        BIKE_LOGW("⚠️ CAN TX suspended after %u failed writes", txFailStreak);
     }
+}
+
+bool BikeCANManager::isTxCongested() {
+    uint32_t capacity = transport->getTxCapacity();
+    return capacity > 0 && transport->getTxPending() * 100 >= capacity * CAN_TX_CONGESTED_PCT;
+}
+
+void BikeCANManager::growBackoff(uint32_t now) {
+    backoffMs = backoffMs * 2 > CAN_BACKOFF_MAX_MS ? CAN_BACKOFF_MAX_MS : backoffMs * 2;
+    nextAttemptMs = now + backoffMs;
+    lastTroubleMs = now;
+}
+
+void BikeCANManager::resumeTx(const char* reason) {
+    recoveries++;
+    txFailStreak = 0;
+    for (uint8_t i = 0; i < CAN_MSG_COUNT; i++) schedule[i].retries = 0;
+    invalidateTxCache();   // The display may have missed anything: send everything once
+    BIKE_LOGI("✅ CAN %s", reason);
+}
+
+CANErrorState BikeCANManager::getErrorState() {
+    return errorState;
+}
+
+bool BikeCANManager::isTxSuspended() {
+    return txSuspended;
+}
+
+CANMessageType BikeCANManager::bmsMessageType(uint8_t bmsId) {
+    if (bmsId == 1) return CAN_MSG_BMS1_DATA;
+    if (bmsId == 2) return CAN_MSG_BMS2_DATA;
+    return CAN_MSG_COUNT;  // Uncached, always sent
+}
+
+void BikeCANManager::setReceiveCallback(CANReceiveCallback callback) {
+    receiveCallback = callback;
+}
+
+void BikeCANManager::setLogger(CANLogBuffer* log) {
+    logger = log;
+}
+
+
+
+bool BikeCANManager::isInitialized() {
+    return initialized;
+}
+
+uint32_t BikeCANManager::getMessagesSent() {
+    return messagesSent;
+}
+
+uint32_t BikeCANManager::getMessagesReceived() {
+    return messagesReceived;
+}
+
+uint32_t BikeCANManager::getMessagesSuppressed() {
+    return messagesSuppressed;
+}
+
+uint32_t BikeCANManager::getRxOverflows() {
+    return transport->getRxOverflows();
+}
+
+uint32_t BikeCANManager::getRxHighWater() {
+    return rxHighWater;
+}
+
+uint32_t BikeCANManager::getRxPending() {
+    return transport->getRxPending();
+}
+
+uint32_t BikeCANManager::getRxCapacity() {
+    return transport->getRxCapacity();
+}
+
+uint32_t BikeCANManager::getRxFiltered() {
+    return rxFiltered;
+}
+
+uint32_t BikeCANManager::getLastRxTimestamp() {
+    return lastRxTimestampUs;
+}
+
+CANAlertCounters BikeCANManager::getAlertCounters() {
+    return transport->getAlertCounters();
+}
+
+bool BikeCANManager::isBusOff() {
+    return transport->isBusOff();
+}
+
+const char* BikeCANManager::getBackendName() {
+    return transport->getName();
+}
+
+CANTransport* BikeCANManager::getTransport() {
+    return transport;
+}
+
+void BikeCANManager::getBusStats(CANBusStatsSnapshot& stats) {
+    busStats.snapshot(stats);
+    
+    CANAlertCounters alerts = transport->getAlertCounters();
+    CANTxHealthSnapshot& health = stats.health;
+    health.errorState = errorState;
+    health.txErrorCounter = alerts.txErrorCounter;
+    health.rxErrorCounter = alerts.rxErrorCounter;
+    health.suspended = txSuspended;
+    health.backoffMs = backoffMs;
+    health.txPending = transport->getTxPending();
+    health.txPendingPeak = txPendingPeak;
+    health.txCapacity = transport->getTxCapacity();
+    health.retried = txRetried;
+    health.retriesExhausted = txRetriesExhausted;
+    health.dropped = txDropped;
+    health.suspensions = txSuspensions;
+    health.busOffs = busOffs;
+    health.recoveries = recoveries;
+}
+
+void BikeCANManager::resetBusStats() {
+    busStats.reset();
+    txPendingPeak = 0;
+    txRetried = 0;
+    txRetriesExhausted = 0;
+    txDropped = 0;
+    txSuspensions = 0;
+    busOffs = 0;
+    recoveries = 0;
+}
+
+// Software half of the acceptance filter; the transport's own filter is only
+// as tight as its hardware allows
+bool BikeCANManager::acceptId(uint32_t id) {
+    if (nodeRole == CAN_NODE_LOOPBACK) return true;
+    if (id & CAN_FRAME_EXT_FLAG) return false;  // Bike frames are all 11-bit
+    
+    bool displayBlock = (id & MSG_ID_DISPLAY_MASK) == MSG_ID_DISPLAY_CMD;
+    if (nodeRole == CAN_NODE_MAIN) return displayBlock;
+    return id >= MSG_ID_BIKE_STATUS && !displayBlock;
+}
+
+
+
+bool BikeCANManager::sendBatteryExtended(const BMSData& bms1, const BMSData& bms2) {
+    if (!initialized) return false;
     
-    return false;
+    CANBatteryExtFrame frame;
+    frame.bms1CellDelta = bms1.cellVoltageDelta;   // mV, saturates at 255
+    frame.bms2CellDelta = bms2.cellVoltageDelta;
+    frame.bms1MaxTemp = getMaxBMSTemperature(bms1);
+    frame.bms2MaxTemp = getMaxBMSTemperature(bms2);
+    frame.motorPower = (bms1.voltage + bms2.voltage) * (bms1.current + bms2.current) / 2;
+    frame.charging = bms1.isCharging || bms2.isCharging;
+    frame.bms1Connected = bms1.connected;
+    frame.bms2Connected = bms2.connected;
+    
+    uint8_t data[8];
+    frame.pack(data);
+    return transmitFrame(CAN_MSG_BATTERY_EXT, MSG_ID_BATTERY_EXT, data, CANBatteryExtFrame::length);
+}
+
+bool BikeCANManager::sendDistanceData(float odometer, float distance, float tripDistance) {
+    if (!initialized) return false;
+    
+    CANDistanceFrame frame;
+    frame.odometer = odometer;
+    frame.distance = distance;
+    frame.tripDistance = tripDistance;
+    
+    uint8_t data[8];
+    frame.pack(data);
+    return transmitFrame(CAN_MSG_DISTANCE_DATA, MSG_ID_DISTANCE_DATA, data, CANDistanceFrame::length);
+}
+
+bool BikeCANManager::sendTimeData(int time) {
+    if (!initialized) return false;
+    
+    CANTimeFrame frame;
+    frame.time = time;
+    
+    uint8_t data[8];
+    frame.pack(data);
+    return transmitFrame(CAN_MSG_TIME_DATA, MSG_ID_TIME_DATA, data, CANTimeFrame::length);
 }
 
 // =============================================================================
@@ -353,79 +1236,55 @@ bool BikeCANManager::sendTimeData(int time) {
 // =============================================================================
 
 bool BikeCANManager::parseBikeStatus(uint8_t* data, uint8_t length, BikeStatus& status, bool& bikeUnlocked, bool& bleConnected) {
-    if (!data || length < 7) return false;
-    
-    // Debug raw data (disabled)
-    // Serial.printf("🔍 [parseBikeStatus] Raw: [%d][%d][%d][%d][%d]\n", data[0], data[1], data[2], data[3], data[4]);
+    if (!data || length < CANBikeStatusFrame::minLength) return false;
     
-    status.operationState = (BikeOperationState)data[0];
-    bikeUnlocked = (data[1] == 1);
-    bleConnected = (data[2] == 1);
-    status.bikeSpeed = (float)data[3];
+    CANBikeStatusFrame frame;
+    frame.unpack(data, length);
     
-    // Debug parsed data (disabled)
-    // Serial.printf("🔍 [parseBikeStatus] BLE: %s, Speed: %.0f\n", bleConnected ? "ON" : "OFF", status.bikeSpeed);
-    
-    // Parse status flags
-    uint8_t flags = data[4];
-    status.keyOn = (flags & 0x01) != 0;
-    status.brakePressed = (flags & 0x02) != 0;
+    status.operationState = (BikeOperationState)(uint8_t)frame.operationState;
+    bikeUnlocked = frame.bikeUnlocked == 1;
+    bleConnected = frame.bleConnected == 1;
+    status.bikeSpeed = frame.speed;
+    status.keyOn = frame.keyOn != 0;
+    status.brakePressed = frame.brakePressed != 0;
     // Charging status is in flags but will be parsed from BMS data
-    status.leftSignal = (flags & 0x08) != 0;
-    status.rightSignal = (flags & 0x10) != 0;
+    status.leftSignal = frame.leftSignal != 0;
+    status.rightSignal = frame.rightSignal != 0;
     
     return true;
 }
 
 bool BikeCANManager::parseBMSData(uint8_t* data, uint8_t length, BMSData& bms) {
-    if (!data || length < 8) return false;
-    
-    // Voltage (2 bytes)
-    uint16_t voltage = (data[0] << 8) | data[1];
-    bms.voltage = voltage / 100.0f;
-    
-    // Current (2 bytes, signed)
-    int16_t current = (data[2] << 8) | data[3];
-    bms.current = current / 100.0f;
-    
-    // SOC
-    bms.soc = data[4];
-    
-    // Temperature (with offset)
-    bms.temperature = (float)data[5] - 50.0f;
-    
-    // Status flags
-    uint8_t status1 = data[6];
-    bms.connected = (status1 & 0x01) != 0;
-    bms.isCharging = (status1 & 0x02) != 0;
-    bms.isDischarging = (status1 & 0x04) != 0;
-    bms.chargingEnabled = (status1 & 0x08) != 0;
-    bms.dischargingEnabled = (status1 & 0x10) != 0;
-    
-    // Number of cells
-    bms.numCells = data[7];
+    if (!data || length < CANBmsFrame::minLength) return false;
+    
+    CANBmsFrame frame;
+    frame.unpack(data, length);
+    
+    bms.voltage = frame.voltage;
+    bms.current = frame.current;
+    bms.soc = (uint8_t)frame.soc;
+    bms.temperature = frame.temperature;
+    bms.connected = frame.connected != 0;
+    bms.isCharging = frame.isCharging != 0;
+    bms.isDischarging = frame.isDischarging != 0;
+    bms.chargingEnabled = frame.chargingEnabled != 0;
+    bms.dischargingEnabled = frame.dischargingEnabled != 0;
+    bms.numCells = (uint8_t)frame.numCells;
     
     return true;
 }
 
 bool BikeCANManager::parseVESCData(uint8_t* data, uint8_t length, VESCData& vesc) {
-    if (!data || length < 8) return false;
-    
-    // Motor RPM (2 bytes, multiply by 10 to restore)
-    int16_t rpm = (data[0] << 8) | data[1];
-    vesc.motorRPM = rpm * 10.0f;
+    if (!data || length < CANVescFrame::minLength) return false;
     
-    // Input voltage (2 bytes)
-    uint16_t voltage = (data[2] << 8) | data[3];
-    vesc.inputVoltage = voltage / 100.0f;
+    CANVescFrame frame;
+    frame.unpack(data, length);
     
-    // Motor current (2 bytes, signed)
-    int16_t current = (data[4] << 8) | data[5];
-    vesc.motorCurrent = current / 100.0f;
-    
-    // Temperatures (with offset)
-    vesc.tempMotor = (float)data[6] - 50.0f;
-    vesc.tempFET = (float)data[7] - 50.0f;
+    vesc.motorRPM = frame.motorRPM;
+    vesc.inputVoltage = frame.inputVoltage;
+    vesc.motorCurrent = frame.motorCurrent;
+    vesc.tempMotor = frame.tempMotor;
+    vesc.tempFET = frame.tempFET;
     
     vesc.connected = true; // If we receive data, assume connected
     
@@ -434,34 +1293,31 @@ bool BikeCANManager::parseVESCData(uint8_t* data, uint8_t length, VESCData& vesc
 
 bool BikeCANManager::parseBatteryExtended(uint8_t* data, uint8_t length, BMSData& bms1, BMSData& bms2, int& motorPower) {
     if (!data) {
-        Serial.println("❌ [parseBatteryExtended] data is NULL");
+        BIKE_LOGE("❌ [parseBatteryExtended] data is NULL");
         return false;
     }
-    if (length < 7) {
-        Serial.printf("❌ [parseBatteryExtended] length=%d < 7\n", length);
+    if (length < CANBatteryExtFrame::minLength) {
+        BIKE_LOGE("❌ [parseBatteryExtended] length=%d < %d", length, (int)CANBatteryExtFrame::minLength);
         return false;
     }
     
+    CANBatteryExtFrame frame;
+    frame.unpack(data, length);
+    
     // Cell voltage deltas (keep in mV)
-    bms1.cellVoltageDelta = (uint16_t)data[0];
-    bms2.cellVoltageDelta = (uint16_t)data[1];
+    bms1.cellVoltageDelta = (uint16_t)frame.bms1CellDelta;
+    bms2.cellVoltageDelta = (uint16_t)frame.bms2CellDelta;
     
-    // Temperatures (with offset)
-    bms1.temperature = (float)data[2] - 40.0f;
-    bms2.temperature = (float)data[3] - 40.0f;
+    bms1.temperature = frame.bms1MaxTemp;
+    bms2.temperature = frame.bms2MaxTemp;
     
-    // Motor power (2 bytes, signed)
-    int16_t power = (data[4] << 8) | data[5];
-    motorPower = power;
+    motorPower = (int)frame.motorPower;
     
-    // Status flags
-    uint8_t flags = data[6];
-    bool isCharging = (flags & 0x01) != 0;
-    bms1.connected = (flags & 0x02) != 0;
-    bms2.connected = (flags & 0x04) != 0;
+    bms1.connected = frame.bms1Connected != 0;
+    bms2.connected = frame.bms2Connected != 0;
     
     // Update charging status
-    if (isCharging) {
+    if (frame.charging != 0) {
         bms1.isCharging = true;
         bms2.isCharging = true;
     }
@@ -470,28 +1326,25 @@ bool BikeCANManager::parseBatteryExtended(uint8_t* data, uint8_t length, BMSData
 }
 
 bool BikeCANManager::parseDistanceData(uint8_t* data, uint8_t length, float& odometer, float& distance, float& tripDistance) {
-    if (!data || length < 8) return false;
-    
-    // Odometer (4 bytes)
-    uint32_t odometerScaled = (data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
-    odometer = odometerScaled / 100.0f;
+    if (!data || length < CANDistanceFrame::minLength) return false;
     
-    // Current distance (2 bytes)
-    uint16_t distanceScaled = (data[4] << 8) | data[5];
-    distance = distanceScaled / 100.0f;
+    CANDistanceFrame frame;
+    frame.unpack(data, length);
     
-    // Trip distance (2 bytes)
-    uint16_t tripScaled = (data[6] << 8) | data[7];
-    tripDistance = tripScaled / 100.0f;
+    odometer = frame.odometer;
+    distance = frame.distance;
+    tripDistance = frame.tripDistance;
     
     return true;
 }
 
 bool BikeCANManager::parseTimeData(uint8_t* data, uint8_t length, int& time) {
-    if (!data || length < 8) return false;
+    if (!data || length < CANTimeFrame::minLength) return false;
     
-    // Total time (4 bytes)
-    time = (data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+    CANTimeFrame frame;
+    frame.unpack(data, length);
+    
+    time = (int)frame.time;
     
     return true;
 }
@@ -573,7 +1426,7 @@ bool BikeCANManager::parseCANMessage(uint32_t id, uint8_t* data, uint8_t length,
                 // Debug: Log extended temperatures (simplified)
                 // Serial.printf("🌡️ [CAN-EXT] BMS1: %.1f°C, BMS2: %.1f°C\n", tempBMS1.temperature, tempBMS2.temperature);
             } else {
-                Serial.println("❌ [parseCANMessage] Failed to parse MSG_ID_BATTERY_EXT");
+                BIKE_LOGW("❌ [parseCANMessage] Failed to parse MSG_ID_BATTERY_EXT");
             }
             break;
         }
@@ -589,7 +1442,7 @@ bool BikeCANManager::parseCANMessage(uint32_t id, uint8_t* data, uint8_t length,
         }
         
         default:
-            Serial.printf("[CAN] Unknown message ID: 0x%03X\n", id);
+            BIKE_LOGD("[CAN] Unknown message ID: 0x%03X", id);
             return false;
     }
     
@@ -604,3 +1457,43 @@ bool BikeCANManager::parseCANMessage(uint32_t id, uint8_t* data, uint8_t length,
     return success;
 }
 
+bool BikeCANManager::parseIsoTpMessage(const uint8_t* payload, uint16_t length, BikeDataDisplay& displayData) {
+    if (!payload || length < 3) return false;
+    
+    uint8_t bmsId = payload[1];
+    if (bmsId != 1 && bmsId != 2) return false;
+    
+    switch (payload[0]) {
+        case CAN_ISOTP_PDU_CELLS: {
+            uint8_t cells = payload[2];
+            if (cells > BMS_MAX_CELLS || length < 3 + 2 * cells) return false;
+            
+            uint16_t* target = (bmsId == 1) ? displayData.battery1CellMv : displayData.battery2CellMv;
+            for (uint8_t i = 0; i < cells; i++) {
+                target[i] = payload[3 + 2 * i] | (payload[4 + 2 * i] << 8);
+            }
+            if (bmsId == 1) displayData.battery1CellCount = cells;
+            else displayData.battery2CellCount = cells;
+            return true;
+        }
+        
+        case CAN_ISOTP_PDU_BMS_INFO: {
+            char* fields[2] = {
+                (bmsId == 1) ? displayData.battery1Version : displayData.battery2Version,
+                (bmsId == 1) ? displayData.battery1Device : displayData.battery2Device
+            };
+            uint16_t offset = 2;
+            for (uint8_t f = 0; f < 2; f++) {
+                if (offset >= length) return false;
+                uint8_t size = payload[offset++];
+                if (size >= BMS_INFO_MAX_LEN || offset + size > length) return false;
+                memcpy(fields[f], payload + offset, size);
+                fields[f][size] = '\0';
+                offset += size;
+            }
+            return true;
+        }
+    }
+    
+    return false;
+}
@@ -2,9 +2,19 @@
 #define BIKE_CAN_MANAGER_H
 
 #include <Arduino.h>
-#include <CAN.h>
 #include "BikeData.h"
 #include "BikeMainHardware.h"
+#include "CANFrame.h"
+#include "CANTransport.h"
+#include "CANLog.h"
+#include "CANBusStats.h"
+#include "CANIsoTp.h"
+#include "CANTimeSync.h"
+#include "CANLatencyTrace.h"
+#include "BikeCANSignals.h"
+#if defined(ESP32)
+#include "ESP32CANTransport.h"
+#endif
 
 // CAN Configuration
 #define CAN_TX_PIN    MAIN_CAN_TX
@@ -18,7 +28,58 @@
 #define MSG_ID_BATTERY_EXT    0x400  // Extended battery data
 #define MSG_ID_DISTANCE_DATA  0x500  // Distance & trip data
 #define MSG_ID_TIME_DATA      0x600  // Time data
-#define MSG_ID_DISPLAY_CMD    0x800  // Commands from display
+#define MSG_ID_TIME_SYNC      0x610  // Clock sync reply to the display (CANTimeSync.h)
+#define MSG_ID_SAMPLE_INFO    0x620  // Sensor sample stamp: [source][seq][capture us, 32 BE]
+#define MSG_ID_ISOTP_TO_DISPLAY 0x680  // ISO-TP main -> display (data; flow control for display's transfers)
+#define MSG_ID_DISPLAY_CMD    0x700  // Commands from display (0x7xx block is display -> main)
+#define MSG_ID_ISOTP_TO_MAIN  0x701  // ISO-TP display -> main (flow control; data for main)
+#define MSG_ID_DISPLAY_MASK   0x700  // ID bits that select the display command block
+
+// Display commands (MSG_ID_DISPLAY_CMD): first payload byte is the command
+#define CAN_DISPLAY_CMD_SUBSCRIBE  0x01   // [cmd][group mask][period per group x6, 50 ms units, 0 = default]
+#define CAN_DISPLAY_CMD_TIME_SYNC  0x02   // [cmd][display us, 32 BE]
+
+// Subscriptions: the display lists the groups its current screen shows and
+// re-sends the list every refresh interval. The main board sends only those
+// groups and goes back to the full default schedule if the list stops coming.
+#define CAN_SUBSCRIPTION_PERIOD_UNIT_MS  50
+#define CAN_SUBSCRIPTION_REFRESH_MS      1000
+#define CAN_SUBSCRIPTION_TIMEOUT_MS      3000
+
+// Segmented (ISO-TP) messages: first payload byte is the type
+#define CAN_ISOTP_PDU_CELLS     0x01   // [type][bmsId][n][cell mV, uint16 LE x n]
+#define CAN_ISOTP_PDU_BMS_INFO  0x02   // [type][bmsId][len][software version][len][device info]
+
+// Transmit schedule (period per message type, ms)
+#define CAN_PERIOD_BIKE_STATUS_MS   50     // 20 Hz - speed, signals
+#define CAN_PERIOD_BMS_MS           500    // 2 Hz  - pack data (BMS1 and BMS2)
+#define CAN_PERIOD_VESC_MS          100    // 10 Hz - motor current/temps
+#define CAN_PERIOD_BATTERY_EXT_MS   1000   // 1 Hz  - deltas, power
+#define CAN_PERIOD_DISTANCE_MS      5000   // 0.2 Hz
+#define CAN_PERIOD_TIME_MS          5000   // 0.2 Hz
+#define CAN_PERIOD_CELLS_MS         1000   // Cell voltages, one pack per period (alternating)
+#define CAN_PERIOD_BMS_INFO_MS      15000  // Version/device strings, one pack per period
+
+// Scheduler tick and bus-load budget
+#define CAN_SCHEDULER_TICK_MS       10     // Retry/recovery granularity, shortest canTask sleep
+#define CAN_IDLE_MAX_MS             1000   // Longest canTask sleep (subscription timeout, ISO-TP)
+#define CAN_BUS_LOAD_BUDGET_PCT     30     // Max share of CAN_SPEED used by scheduled frames
+#define CAN_BUDGET_WINDOW_MS        100    // Unused budget carried over at most this long
+#define CAN_FRAME_MAX_BITS          135    // 8-byte std frame incl. worst-case stuffing + IFS
+
+// Change-driven transmission
+#define CAN_HEARTBEAT_STATUS_MS     500    // Unchanged status still repeats at 2 Hz
+#define CAN_HEARTBEAT_DEFAULT_MS    2000   // Unchanged BMS/VESC/EXT data keepalive
+#define CAN_MAX_DEADBANDS           3      // Deadband fields per message type
+
+// TX error handling
+#define CAN_TX_RETRY_PRIORITY       1      // Scheduled frames with priority <= this are retried
+#define CAN_TX_MAX_RETRIES          3      // Ticks a failed high-priority frame is retried, then dropped
+#define CAN_TX_CONGESTED_PCT        50     // TX queue fill at which lower-priority frames are dropped
+#define CAN_TX_FAIL_LIMIT           8      // Consecutive failed writes that suspend transmission
+#define CAN_BACKOFF_MIN_MS          100    // First bus-off recovery / TX probe delay, doubled per failure
+#define CAN_BACKOFF_MAX_MS          5000
+#define CAN_BACKOFF_RESET_MS        10000  // Trouble-free time that brings the delay back to the minimum
 
 // CAN Message Types
 enum CANMessageType {
@@ -32,18 +93,74 @@ enum CANMessageType {
     CAN_MSG_COUNT = 7
 };
 
+// Message groups a display can subscribe to (bit n of the mask = group n)
+enum CANMessageGroup {
+    CAN_GROUP_STATUS = 0,       // Bike status
+    CAN_GROUP_BATTERY = 1,      // BMS1, BMS2, extended battery
+    CAN_GROUP_MOTOR = 2,        // VESC
+    CAN_GROUP_TRIP = 3,         // Distance, time
+    CAN_GROUP_CELLS = 4,        // Per-cell voltages (ISO-TP)
+    CAN_GROUP_BMS_INFO = 5,     // BMS version/device strings (ISO-TP)
+    CAN_GROUP_COUNT = 6
+};
+
+#define CAN_GROUP_BIT(group)  (1 << (group))
+#define CAN_GROUPS_ALL        0x3F
+#define CAN_GROUPS_DASHBOARD  (CAN_GROUP_BIT(CAN_GROUP_STATUS) | CAN_GROUP_BIT(CAN_GROUP_BATTERY) | \
+                               CAN_GROUP_BIT(CAN_GROUP_MOTOR) | CAN_GROUP_BIT(CAN_GROUP_TRIP))
+
+// Per message type transmit schedule entry
+struct CANScheduleEntry {
+    uint16_t periodMs;     // 0 = disabled
+    uint8_t priority;      // Lower value wins a deadline tie
+    uint32_t nextDueMs;    // Absolute deadline (millis)
+    uint16_t configuredMs; // setMessagePeriod() value; periodMs is what the subscription makes of it
+    uint8_t retries;       // Failed sends of the current frame (high-priority entries only)
+};
+
+// Transmit mode per message type
+enum CANTxMode {
+    CAN_TX_PERIODIC = 0,    // Every scheduled/explicit send goes on the bus
+    CAN_TX_ON_CHANGE = 1    // Send on payload change, otherwise heartbeat only
+};
+
+// Big-endian field inside a payload that only counts as changed beyond a threshold
+struct CANDeadband {
+    uint8_t startByte;
+    uint8_t length;        // 1, 2 or 4 bytes, 0 = unused slot
+    bool isSigned;
+    uint16_t threshold;    // In raw (scaled) units as sent on the bus
+};
+
+// Last transmitted payload per message type
+struct CANTxCache {
+    CANTxMode mode;
+    uint16_t heartbeatMs;
+    bool valid;
+    uint8_t length;
+    uint8_t data[8];
+    uint32_t lastTxMs;
+    CANDeadband deadbands[CAN_MAX_DEADBANDS];
+};
+
 // CAN receive callback function type
 typedef void (*CANReceiveCallback)(uint32_t id, uint8_t* data, uint8_t length);
 
+// Complete ISO-TP message callback (payload valid only during the call)
+typedef void (*CANIsoTpCallback)(const uint8_t* payload, uint16_t length);
+
 class BikeCANManager {
 public:
-    BikeCANManager();
+#if defined(ESP32)
+    BikeCANManager();                                  // On-board controller
+#endif
+    explicit BikeCANManager(CANTransport& transport);  // Any transport, e.g. host SocketCAN/loopback
     ~BikeCANManager();
     
     // Initialization
-    bool begin();
-    bool begin(int txPin, int rxPin); // Override pins for display board
-    void update();
+    bool begin();                     // Main board pins, CAN_NODE_MAIN filter
+    bool begin(int txPin, int rxPin, CANNodeRole role = CAN_NODE_DISPLAY); // Override pins for display board
+    void update();                    // Drains every frame queued by the RX interrupt
     
     // Data transmission
     bool sendBikeStatus(const BikeStatus& status, bool bikeUnlocked, bool bleConnected);
@@ -53,8 +170,21 @@ public:
     bool sendDistanceData(float odometer, float distance, float tripDistance);
     bool sendTimeData(int time);
     
+    // Segmented transfers (ISO-TP), progressed by update()
+    bool sendCellVoltages(const BMSData& bms, uint8_t bmsId);
+    bool sendBMSInfo(const BMSInfo& info, uint8_t bmsId);
+    bool sendIsoTp(const uint8_t* payload, uint16_t length);  // False while a transfer is running
+    bool isIsoTpBusy();
+    void setIsoTpFlowControl(uint8_t blockSize, uint8_t separationTimeMs);  // What this node asks of senders
+    CANIsoTpStats getIsoTpStats();
+    
     // Data reception
     void setReceiveCallback(CANReceiveCallback callback);
+    void setIsoTpCallback(CANIsoTpCallback callback);
+    void setLogger(CANLogBuffer* log);  // Records every frame received and sent, nullptr to stop
+    void setLatencyTrace(CANLatencyTrace* trace);  // Display: sample stamps and frame times, nullptr to stop
+    const CANTimeSync& getTimeSync();
+    bool isTimeSynced();
     
     // Data parsing functions
     bool parseBikeStatus(uint8_t* data, uint8_t length, BikeStatus& status, bool& bikeUnlocked, bool& bleConnected);
@@ -66,23 +196,168 @@ public:
     
     // Convenience function to parse any message
     bool parseCANMessage(uint32_t id, uint8_t* data, uint8_t length, BikeDataDisplay& displayData);
+    bool parseIsoTpMessage(const uint8_t* payload, uint16_t length, BikeDataDisplay& displayData);
     
     // Status
     bool isInitialized();
     uint32_t getMessagesSent();
     uint32_t getMessagesReceived();
+    uint32_t getMessagesSuppressed();
+    
+    // Receive path status
+    uint32_t getRxOverflows();        // Frames dropped because the RX queue was full
+    uint32_t getRxHighWater();        // Deepest backlog seen by update()
+    uint32_t getRxPending();
+    uint32_t getRxCapacity();         // Depth of the RX queue for the active backend
+    uint32_t getRxFiltered();         // Frames rejected in software after the hardware filter
+    uint32_t getLastRxTimestamp();    // micros() of the frame being dispatched
+    
+    // Error alerts (TWAI backend; always zero with the CAN library backend)
+    CANAlertCounters getAlertCounters();
+    bool isBusOff();
+    CANErrorState getErrorState();
+    bool isTxSuspended();             // Writes kept failing (e.g. harness unplugged), probing with backoff
+    const char* getBackendName();
+    CANTransport* getTransport();
+    
+    // Per-ID counters, inter-arrival jitter, bus load and TX health (safe from any task)
+    void getBusStats(CANBusStatsSnapshot& stats);
+    void resetBusStats();
+    
+    // Subscriptions. Display: request groups (periodMs per group, nullptr or 0 =
+    // default), re-sent by update(). Main: applied when received.
+    bool setSubscription(uint8_t groupMask, const uint16_t* periodMs = nullptr);
+    uint8_t getSubscribedGroups();    // Main: groups being sent, CAN_GROUPS_ALL without a subscription
+    bool isSubscriptionActive();
+    uint32_t getSubscriptionsReceived();
     
-    // Sequence sending (for RTOS task)
-    void sendNextInSequence(const SharedBikeData& sharedData);
+    // Scheduled sending (for RTOS task, call at least every getIdleMs())
+    uint8_t sendDueMessages(const SharedBikeData& sharedData);
+    uint32_t getIdleMs();             // Until the next deadline, 1..CAN_IDLE_MAX_MS
+    bool sendMessage(CANMessageType type, const SharedBikeData& sharedData);
     
+    // Schedule configuration
+    void setMessagePeriod(CANMessageType type, uint16_t periodMs);
+    void setMessagePriority(CANMessageType type, uint8_t priority);
+    void setBusLoadBudget(uint8_t percent);
+    void setRateDivider(uint8_t divider);    // Every period this many times longer (power profile), 1 = as set
+    uint16_t getMessagePeriod(CANMessageType type);
+    uint8_t getBusLoadBudget();
+    uint32_t getBudgetDeferrals();
+    uint8_t getRateDivider();
+    
+    // Change-driven transmission (payload cache per message type)
+    void setTransmitMode(CANMessageType type, CANTxMode mode, uint16_t heartbeatMs = CAN_HEARTBEAT_DEFAULT_MS);
+    bool setDeadband(CANMessageType type, uint8_t startByte, uint8_t length, uint16_t threshold, bool isSigned = false);
+    void clearDeadbands(CANMessageType type);
+    CANTxMode getTransmitMode(CANMessageType type);
+    void invalidateTxCache();
+
 private:
     bool initialized;
     uint32_t messagesSent;
     uint32_t messagesReceived;
-    uint8_t sendSequence;
     CANReceiveCallback receiveCallback;
+    CANLogBuffer* logger;
+    CANBusStats busStats;
     
-
+    // Latency tracing
+    CANTimeSync timeSync;
+    CANLatencyTrace* latencyTrace;
+    uint8_t announcedSeq[CAN_TRACE_COUNT];  // Main: last sample stamp sent per source
+    struct SampleStamp {
+        uint8_t source;
+        uint8_t sequence;
+        uint32_t sampleUs;
+        bool pending;
+    };
+    SampleStamp stagedStamp;                // Main: goes out with the next data frame, if that one does
+    uint32_t lastTimeSyncMs;
+    
+    // Segmented transfers
+    CANIsoTp isoTp;
+    CANIsoTpCallback isoTpCallback;
+    uint32_t nextCellsDueMs;
+    uint32_t nextInfoDueMs;
+    uint8_t nextCellsPack;          // 1 or 2, alternates
+    uint8_t nextInfoPack;
+    uint16_t cellsPeriodMs;         // 0 = not subscribed
+    uint16_t infoPeriodMs;
+    
+    // Subscription: requested (display) or in force (main)
+    bool subscriptionActive;
+    uint8_t subscriptionMask;
+    uint16_t subscriptionPeriodMs[CAN_GROUP_COUNT];
+    uint32_t lastSubscriptionMs;    // Display: last sent, main: last received
+    uint32_t subscriptionsReceived;
+    CANTransport* transport;
+    CANNodeRole nodeRole;
+    
+    // Receive path
+    uint32_t lastRxTimestampUs;
+    uint32_t rxFiltered;
+    uint32_t rxHighWater;
+    
+    // Transmit scheduler state
+    CANScheduleEntry schedule[CAN_MSG_COUNT];
+    uint8_t busLoadBudgetPct;
+    uint8_t rateDivider;
+    uint32_t budgetBits;
+    uint32_t lastBudgetRefillMs;
+    uint32_t budgetDeferrals;
+    bool scheduledSend;                     // sendDueMessages() is sending: stamps are charged too
+    
+    // Change-driven transmission state
+    CANTxCache txCache[CAN_MSG_COUNT];
+    uint32_t messagesSuppressed;
+    bool lastTxSuppressed;
+    
+    // TX error handling
+    CANErrorState errorState;
+    bool busOffActive;              // Bus-off until frames can be sent again
+    bool txSuspended;
+    uint8_t txFailStreak;
+    uint32_t backoffMs;
+    uint32_t nextAttemptMs;         // Next recovery (bus-off) or probe (suspended)
+    uint32_t lastTroubleMs;
+    uint32_t txPendingPeak;
+    uint32_t txRetried;
+    uint32_t txRetriesExhausted;
+    uint32_t txDropped;
+    uint32_t txSuspensions;
+    uint32_t busOffs;
+    uint32_t recoveries;
+    
+    void resetSchedule();
+    void applySubscription();
+    bool sendSubscription();
+    bool handleDisplayCommand(const CANFrame& frame);
+    void updateSubscription(uint32_t now);
+    
+    void announceSample(uint8_t source, uint8_t sequence, uint32_t sampleUs);
+    void sendSampleStamp(const SampleStamp& stamp);
+    bool handleTraceFrame(const CANFrame& frame);
+    int8_t traceSource(uint32_t id);
+    void refillBudget(uint32_t now);
+    int8_t pickDueMessage(uint32_t now);
+    
+    void resetTxCache();
+    bool payloadChanged(const CANTxCache& cache, const uint8_t* data, uint8_t length);
+    bool transmitFrame(CANMessageType type, uint32_t id, const uint8_t* data, uint8_t length);
+    
+    void resetTxHealth();
+    void updateTxHealth(uint32_t now);
+    bool txAllowed(uint32_t now);
+    void onTxResult(bool sent, uint32_t now);
+    bool isTxCongested();
+    void growBackoff(uint32_t now);
+    void resumeTx(const char* reason);
+    CANMessageType bmsMessageType(uint8_t bmsId);
+    bool acceptId(uint32_t id);
+    
+    static bool isoTpSendFrame(void* context, uint32_t id, const uint8_t* data, uint8_t length);
+    void dispatchIsoTp();
+    void sendDueTransfers(const SharedBikeData& sharedData, uint32_t now);
 };
 
 #endif
\ No newline at end of file
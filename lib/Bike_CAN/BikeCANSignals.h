@@ -0,0 +1,77 @@
+#ifndef BIKE_CAN_SIGNALS_H
+#define BIKE_CAN_SIGNALS_H
+
+#include "CANSignalCodec.h"
+
+// =============================================================================
+// Bike CAN signal database
+//
+// One row per signal: X(name, startBit, length, scale, offset, isSigned)
+// startBit 0 is the MSB of byte 0; single flag bits inside a byte are numbered
+// so that bit 0 (LSB) of byte N is startBit N*8+7.
+// All temperatures share one encoding: 1 degC/bit, offset -40 (-40..215 degC).
+// Both boards include this file, so adding a signal is a single row here.
+// =============================================================================
+
+// MSG_ID_BIKE_STATUS (0x100)
+#define CAN_BIKE_STATUS_SIGNALS(X)                          \
+    X(operationState,   0,  8, 1.0f,   0.0f,   false)       \
+    X(bikeUnlocked,     8,  8, 1.0f,   0.0f,   false)       \
+    X(bleConnected,    16,  8, 1.0f,   0.0f,   false)       \
+    X(speed,           24,  8, 1.0f,   0.0f,   false)       \
+    X(keyOn,           39,  1, 1.0f,   0.0f,   false)       \
+    X(brakePressed,    38,  1, 1.0f,   0.0f,   false)       \
+    X(charging,        37,  1, 1.0f,   0.0f,   false)       \
+    X(leftSignal,      36,  1, 1.0f,   0.0f,   false)       \
+    X(rightSignal,     35,  1, 1.0f,   0.0f,   false)
+
+// MSG_ID_BMS_DATA + 1 / + 2 (0x201, 0x202)
+#define CAN_BMS_SIGNALS(X)                                  \
+    X(voltage,          0, 16, 0.01f,  0.0f,   false)       \
+    X(current,         16, 16, 0.01f,  0.0f,   true)        \
+    X(soc,             32,  8, 1.0f,   0.0f,   false)       \
+    X(temperature,     40,  8, 1.0f,  -40.0f,  false)       \
+    X(connected,       55,  1, 1.0f,   0.0f,   false)       \
+    X(isCharging,      54,  1, 1.0f,   0.0f,   false)       \
+    X(isDischarging,   53,  1, 1.0f,   0.0f,   false)       \
+    X(chargingEnabled, 52,  1, 1.0f,   0.0f,   false)       \
+    X(dischargingEnabled, 51, 1, 1.0f, 0.0f,   false)       \
+    X(numCells,        56,  8, 1.0f,   0.0f,   false)
+
+// MSG_ID_VESC_DATA (0x300)
+#define CAN_VESC_SIGNALS(X)                                 \
+    X(motorRPM,         0, 16, 10.0f,  0.0f,   true)        \
+    X(inputVoltage,    16, 16, 0.01f,  0.0f,   false)       \
+    X(motorCurrent,    32, 16, 0.01f,  0.0f,   true)        \
+    X(tempMotor,       48,  8, 1.0f,  -40.0f,  false)       \
+    X(tempFET,         56,  8, 1.0f,  -40.0f,  false)
+
+// MSG_ID_BATTERY_EXT (0x400)
+#define CAN_BATTERY_EXT_SIGNALS(X)                          \
+    X(bms1CellDelta,    0,  8, 1.0f,   0.0f,   false)       \
+    X(bms2CellDelta,    8,  8, 1.0f,   0.0f,   false)       \
+    X(bms1MaxTemp,     16,  8, 1.0f,  -40.0f,  false)       \
+    X(bms2MaxTemp,     24,  8, 1.0f,  -40.0f,  false)       \
+    X(motorPower,      32, 16, 1.0f,   0.0f,   true)        \
+    X(charging,        55,  1, 1.0f,   0.0f,   false)       \
+    X(bms1Connected,   54,  1, 1.0f,   0.0f,   false)       \
+    X(bms2Connected,   53,  1, 1.0f,   0.0f,   false)
+
+// MSG_ID_DISTANCE_DATA (0x500)
+#define CAN_DISTANCE_SIGNALS(X)                             \
+    X(odometer,         0, 32, 0.01f,  0.0f,   false)       \
+    X(distance,        32, 16, 0.01f,  0.0f,   false)       \
+    X(tripDistance,    48, 16, 0.01f,  0.0f,   false)
+
+// MSG_ID_TIME_DATA (0x600) - signals travel as float, exact up to 2^24
+#define CAN_TIME_SIGNALS(X)                                 \
+    X(time,             0, 32, 1.0f,   0.0f,   false)
+
+CAN_DEFINE_MESSAGE(CANBikeStatusFrame,  8, CAN_BIKE_STATUS_SIGNALS)
+CAN_DEFINE_MESSAGE(CANBmsFrame,         8, CAN_BMS_SIGNALS)
+CAN_DEFINE_MESSAGE(CANVescFrame,        8, CAN_VESC_SIGNALS)
+CAN_DEFINE_MESSAGE(CANBatteryExtFrame,  8, CAN_BATTERY_EXT_SIGNALS)
+CAN_DEFINE_MESSAGE(CANDistanceFrame,    8, CAN_DISTANCE_SIGNALS)
+CAN_DEFINE_MESSAGE(CANTimeFrame,        8, CAN_TIME_SIGNALS)
+
+#endif
@@ -0,0 +1,247 @@
+#include "CANBusStats.h"
+#include <Arduino.h>
+#include <math.h>
+#include "CANFrame.h"
+
+// =============================================================================
+// FRAME LENGTH
+// =============================================================================
+
+#define CAN_CRC15_POLY     0x4599
+#define CAN_FRAME_TAIL_BITS 13    // CRC delimiter, ACK slot + delimiter, EOF (7), IFS (3)
+
+namespace {
+
+// Bits from SOF to the end of the CRC: the stuffed part of the frame
+struct StuffedBits {
+    uint8_t bits[128];
+    uint8_t count;
+    uint16_t crc;
+    
+    StuffedBits() : count(0), crc(0) {}
+    
+    void push(uint32_t value, uint8_t width) {
+        for (int8_t i = width - 1; i >= 0; i--) {
+            uint8_t bit = (value >> i) & 1;
+            bits[count++] = bit;
+            
+            uint8_t next = bit ^ ((crc >> 14) & 1);
+            crc = (crc << 1) & 0x7FFF;
+            if (next) crc ^= CAN_CRC15_POLY;
+        }
+    }
+    
+    void pushCrc() {
+        uint16_t value = crc;
+        for (int8_t i = 14; i >= 0; i--) bits[count++] = (value >> i) & 1;
+    }
+    
+    // A complementary bit follows every run of five equal bits, stuff bits included
+    uint8_t stuffCount() const {
+        uint8_t stuffed = 0, run = 1, previous = bits[0];
+        for (uint8_t i = 1; i < count; i++) {
+            if (bits[i] != previous) {
+                previous = bits[i];
+                run = 1;
+            } else if (++run == 5) {
+                stuffed++;
+                previous = !bits[i];
+                run = 1;
+            }
+        }
+        return stuffed;
+    }
+};
+
+}
+
+uint16_t canFrameBits(uint32_t id, const uint8_t* data, uint8_t dlc) {
+    if (dlc > 8) dlc = 8;
+    
+    StuffedBits frame;
+    frame.push(0, 1);                                   // SOF
+    if (id & CAN_FRAME_EXT_FLAG) {
+        uint32_t extId = id & 0x1FFFFFFFUL;
+        frame.push(extId >> 18, 11);                    // Base ID
+        frame.push(0x3, 2);                             // SRR, IDE
+        frame.push(extId & 0x3FFFF, 18);                // ID extension
+        frame.push(0, 3);                               // RTR, r1, r0
+    } else {
+        frame.push(id & 0x7FF, 11);
+        frame.push(0, 3);                               // RTR, IDE, r0
+    }
+    frame.push(dlc, 4);
+    for (uint8_t i = 0; i < dlc; i++) frame.push(data[i], 8);
+    frame.pushCrc();
+    
+    return frame.count + frame.stuffCount() + CAN_FRAME_TAIL_BITS;
+}
+
+// =============================================================================
+// STATISTICS
+// =============================================================================
+
+CANBusStats::CANBusStats(uint32_t rate) : bitrate(rate) {
+    reset();
+}
+
+void CANBusStats::reset() {
+    std::lock_guard<std::mutex> guard(lock);
+    
+    entryCount = 0;
+    frames = 0;
+    untracked = 0;
+    resetUs = micros();
+    totalBits = 0;
+    windowStartUs = resetUs;
+    windowBits = 0;
+    windowLoadPct = 0;
+    peakLoadPct = 0;
+}
+
+CANBusStats::IdEntry* CANBusStats::findEntry(uint32_t id) {
+    for (uint8_t i = 0; i < entryCount; i++) {
+        if (entries[i].id == id) return &entries[i];
+    }
+    if (entryCount == CAN_STATS_MAX_IDS) return nullptr;
+    
+    IdEntry* entry = &entries[entryCount++];
+    memset(entry, 0, sizeof(*entry));
+    entry->id = id;
+    entry->minGapUs = CAN_STATS_NEVER;
+    return entry;
+}
+
+void CANBusStats::countFrame(IdEntry* entry, uint16_t bits, uint32_t nowUs) {
+    rollWindow(nowUs);
+    frames++;
+    totalBits += bits;
+    windowBits += bits;
+    
+    if (!entry) {
+        untracked++;
+        return;
+    }
+    entry->bits += bits;
+    
+    if (entry->txOk + entry->rx > 1) {
+        uint32_t gap = nowUs - entry->lastSeenUs;
+        if (gap < entry->minGapUs) entry->minGapUs = gap;
+        if (gap > entry->maxGapUs) entry->maxGapUs = gap;
+        
+        entry->gapCount++;
+        float delta = gap - entry->gapMeanUs;
+        entry->gapMeanUs += delta / entry->gapCount;
+        entry->gapM2 += delta * (gap - entry->gapMeanUs);
+    }
+    entry->lastSeenUs = nowUs;
+}
+
+void CANBusStats::rollWindow(uint32_t nowUs) {
+    uint32_t elapsed = nowUs - windowStartUs;
+    if (elapsed < CAN_STATS_WINDOW_MS * 1000UL) return;
+    
+    // Quiet periods longer than one window are averaged in, not skipped
+    windowLoadPct = windowBits * 100.0f / (bitrate * (elapsed / 1e6f));
+    if (windowLoadPct > peakLoadPct) peakLoadPct = windowLoadPct;
+    windowBits = 0;
+    windowStartUs = nowUs;
+}
+
+void CANBusStats::onTransmit(uint32_t id, const uint8_t* data, uint8_t dlc, bool ok, uint32_t nowUs) {
+    uint16_t bits = ok ? canFrameBits(id, data, dlc) : 0;  // Outside the lock
+    
+    std::lock_guard<std::mutex> guard(lock);
+    IdEntry* entry = findEntry(id);
+    if (!ok) {
+        if (entry) entry->txFailed++;
+        return;
+    }
+    if (entry) entry->txOk++;
+    countFrame(entry, bits, nowUs);
+}
+
+void CANBusStats::onReceive(uint32_t id, const uint8_t* data, uint8_t dlc, uint32_t timestampUs) {
+    uint16_t bits = canFrameBits(id, data, dlc);
+    
+    std::lock_guard<std::mutex> guard(lock);
+    IdEntry* entry = findEntry(id);
+    if (entry) entry->rx++;
+    countFrame(entry, bits, timestampUs);
+}
+
+void CANBusStats::snapshot(CANBusStatsSnapshot& out) {
+    uint32_t now = micros();
+    std::lock_guard<std::mutex> guard(lock);
+    rollWindow(now);
+    
+    uint32_t elapsedUs = now - resetUs;
+    float bitsAvailable = bitrate * (elapsedUs / 1e6f);
+    
+    out.bitrate = bitrate;
+    out.elapsedMs = elapsedUs / 1000;
+    out.frames = frames;
+    out.untracked = untracked;
+    out.busLoadPct = windowLoadPct;
+    out.peakLoadPct = peakLoadPct;
+    out.avgLoadPct = bitsAvailable > 0 ? totalBits * 100.0f / bitsAvailable : 0;
+    out.idCount = entryCount;
+    
+    for (uint8_t i = 0; i < entryCount; i++) {
+        const IdEntry& e = entries[i];
+        CANIdStatsSnapshot& s = out.ids[i];
+        s.id = e.id;
+        s.txOk = e.txOk;
+        s.txFailed = e.txFailed;
+        s.rx = e.rx;
+        s.ageMs = (e.txOk + e.rx) ? (now - e.lastSeenUs) / 1000 : CAN_STATS_NEVER;
+        s.minGapUs = e.gapCount ? e.minGapUs : 0;
+        s.avgGapUs = (uint32_t)e.gapMeanUs;
+        s.maxGapUs = e.maxGapUs;
+        s.jitterUs = e.gapCount ? (uint32_t)sqrtf(e.gapM2 / e.gapCount) : 0;
+        s.loadPct = bitsAvailable > 0 ? e.bits * 100.0f / bitsAvailable : 0;
+    }
+}
+
+void canPrintBusStats(const CANBusStatsSnapshot& stats) {
+    Serial.printf("[CAN] Bus load %.1f%% (peak %.1f%%, avg %.1f%%) at %lu kbps | %lu frames in %lu ms",
+                  stats.busLoadPct, stats.peakLoadPct, stats.avgLoadPct,
+                  (unsigned long)(stats.bitrate / 1000), (unsigned long)stats.frames, (unsigned long)stats.elapsedMs);
+    if (stats.untracked) Serial.printf(" | %lu untracked", (unsigned long)stats.untracked);
+    Serial.println();
+    
+    Serial.println("  ID         TX  TXfail       RX   age ms  gap min/avg/max us      jitter  load");
+    for (uint8_t i = 0; i < stats.idCount; i++) {
+        const CANIdStatsSnapshot& s = stats.ids[i];
+        char age[12];
+        if (s.ageMs == CAN_STATS_NEVER) strcpy(age, "-");
+        else snprintf(age, sizeof(age), "%lu", (unsigned long)s.ageMs);
+        
+        Serial.printf((s.id & CAN_FRAME_EXT_FLAG) ? "  %08lX" : "  0x%03lX   ", (unsigned long)(s.id & ~CAN_FRAME_EXT_FLAG));
+        Serial.printf(" %8lu %7lu %8lu %8s  %6lu/%6lu/%6lu  %9lu  %4.1f%%\n",
+                      (unsigned long)s.txOk, (unsigned long)s.txFailed, (unsigned long)s.rx, age,
+                      (unsigned long)s.minGapUs, (unsigned long)s.avgGapUs, (unsigned long)s.maxGapUs,
+                      (unsigned long)s.jitterUs, s.loadPct);
+    }
+    
+    const CANTxHealthSnapshot& h = stats.health;
+    Serial.printf("  Controller %s (TEC %u, REC %u)%s | TX queue %lu/%lu (peak %lu) | backoff %lu ms\n",
+                  canErrorStateName(h.errorState), h.txErrorCounter, h.rxErrorCounter,
+                  h.suspended ? ", TX SUSPENDED" : "", (unsigned long)h.txPending, (unsigned long)h.txCapacity,
+                  (unsigned long)h.txPendingPeak, (unsigned long)h.backoffMs);
+    Serial.printf("  Retried %lu (gave up %lu) | dropped %lu | suspended %lu | bus-off %lu | recovered %lu\n",
+                  (unsigned long)h.retried, (unsigned long)h.retriesExhausted, (unsigned long)h.dropped,
+                  (unsigned long)h.suspensions, (unsigned long)h.busOffs, (unsigned long)h.recoveries);
+}
+
+const char* canErrorStateName(CANErrorState state) {
+    switch (state) {
+        case CAN_STATE_ACTIVE:     return "error-active";
+        case CAN_STATE_WARNING:    return "warning";
+        case CAN_STATE_PASSIVE:    return "error-passive";
+        case CAN_STATE_BUS_OFF:    return "bus-off";
+        case CAN_STATE_RECOVERING: return "recovering";
+        case CAN_STATE_STOPPED:    return "stopped";
+        default:                   return "?";
+    }
+}
@@ -0,0 +1,114 @@
+#ifndef CAN_BUS_STATS_H
+#define CAN_BUS_STATS_H
+
+#include <stdint.h>
+#include <mutex>
+#include "CANTransport.h"
+
+#define CAN_STATS_MAX_IDS     16     // IDs tracked; further IDs only count toward bus load
+#define CAN_STATS_WINDOW_MS   1000   // Bus-load measurement window
+#define CAN_STATS_NEVER       0xFFFFFFFFUL
+
+// Exact on-wire length of a classic data frame in bits, from SOF through
+// the 3-bit interframe space. Stuff bits are counted from the actual ID,
+// DLC, data and CRC-15, so the result is between 47 + 8*dlc and the
+// worst case (135 for an 8-byte standard frame).
+uint16_t canFrameBits(uint32_t id, const uint8_t* data, uint8_t dlc);
+
+// Per-ID figures in a snapshot. Inter-arrival times cover every frame of
+// the ID this node saw, sent or received.
+struct CANIdStatsSnapshot {
+    uint32_t id;               // CAN_FRAME_EXT_FLAG for 29-bit
+    uint32_t txOk;
+    uint32_t txFailed;
+    uint32_t rx;
+    uint32_t ageMs;            // Since last sent/received, CAN_STATS_NEVER if not yet
+    uint32_t minGapUs;         // Inter-arrival, 0 until two frames were seen
+    uint32_t avgGapUs;
+    uint32_t maxGapUs;
+    uint32_t jitterUs;         // Standard deviation of the inter-arrival time
+    float loadPct;             // Share of the bitrate this ID used since reset
+};
+
+// Controller state and TX error handling (BikeCANManager fills this in)
+struct CANTxHealthSnapshot {
+    CANErrorState errorState;
+    uint8_t txErrorCounter;
+    uint8_t rxErrorCounter;
+    bool suspended;            // Writes kept failing: one probe per backoff period
+    uint32_t backoffMs;        // Current recovery/probe delay
+    uint32_t txPending;        // Frames in the transport's TX queue
+    uint32_t txPendingPeak;
+    uint32_t txCapacity;       // 0 = no queue, transmit() completes the frame
+    uint32_t retried;          // Failed high-priority frames sent again next tick
+    uint32_t retriesExhausted; // ... and given up after CAN_TX_MAX_RETRIES
+    uint32_t dropped;          // Not handed to the transport: congested, suspended or bus-off
+    uint32_t suspensions;
+    uint32_t busOffs;
+    uint32_t recoveries;       // Bus-off or suspension ended, frames flowing again
+};
+
+struct CANBusStatsSnapshot {
+    uint32_t bitrate;
+    uint32_t elapsedMs;        // Since reset
+    uint32_t frames;           // All frames counted, sent OK + received
+    uint32_t untracked;        // Frames of IDs beyond CAN_STATS_MAX_IDS
+    float busLoadPct;          // Last complete CAN_STATS_WINDOW_MS window
+    float peakLoadPct;         // Highest window since reset
+    float avgLoadPct;          // Since reset
+    uint8_t idCount;
+    CANIdStatsSnapshot ids[CAN_STATS_MAX_IDS];
+    CANTxHealthSnapshot health;
+};
+
+// Frame counters and bus-load meter for the frames one node sends and
+// receives (on a two-node bus that is all of the traffic). Updated from
+// the CAN task, read from any task: a mutex guards the tables.
+class CANBusStats {
+public:
+    explicit CANBusStats(uint32_t bitrate);
+    
+    void onTransmit(uint32_t id, const uint8_t* data, uint8_t dlc, bool ok, uint32_t nowUs);
+    void onReceive(uint32_t id, const uint8_t* data, uint8_t dlc, uint32_t timestampUs);
+    
+    void snapshot(CANBusStatsSnapshot& out);
+    void reset();
+
+private:
+    struct IdEntry {
+        uint32_t id;
+        uint32_t txOk;
+        uint32_t txFailed;
+        uint32_t rx;
+        uint32_t lastSeenUs;
+        uint32_t gapCount;
+        uint32_t minGapUs;
+        uint32_t maxGapUs;
+        float gapMeanUs;       // Welford running mean/variance
+        float gapM2;
+        uint64_t bits;
+    };
+    
+    IdEntry* findEntry(uint32_t id);             // Adds the ID if there is room
+    void countFrame(IdEntry* entry, uint16_t bits, uint32_t nowUs);
+    void rollWindow(uint32_t nowUs);
+    
+    std::mutex lock;
+    uint32_t bitrate;
+    IdEntry entries[CAN_STATS_MAX_IDS];
+    uint8_t entryCount;
+    uint32_t frames;
+    uint32_t untracked;
+    uint32_t resetUs;
+    uint64_t totalBits;
+    uint32_t windowStartUs;
+    uint32_t windowBits;
+    float windowLoadPct;
+    float peakLoadPct;
+};
+
+// Prints a snapshot as a table on Serial
+void canPrintBusStats(const CANBusStatsSnapshot& stats);
+const char* canErrorStateName(CANErrorState state);
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef CAN_FRAME_H
+#define CAN_FRAME_H
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+// Set in CANFrame::id for 29-bit identifiers (same bit as SocketCAN's CAN_EFF_FLAG)
+#define CAN_FRAME_EXT_FLAG  0x80000000UL
+
+// Single received/transmitted CAN frame
+struct CANFrame {
+    uint32_t id;            // 11- or 29-bit identifier, CAN_FRAME_EXT_FLAG for extended
+    uint32_t timestampUs;   // micros() when the frame was taken off the controller
+    uint8_t dlc;
+    uint8_t data[8];
+};
+
+// Lock-free single-producer/single-consumer ring of frames.
+// The producer is the CAN RX interrupt, the consumer is BikeCANManager::update().
+// N must be a power of two; indices run free and wrap naturally.
+template <uint32_t N>
+class CANFrameRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "CANFrameRing size must be a power of two");
+
+public:
+    CANFrameRing() : head(0), tail(0), overflows(0), highWater(0) {}
+
+    // Producer side (ISR). Returns false and counts an overflow when full.
+    bool push(const CANFrame& frame) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t t = tail.load(std::memory_order_acquire);
+
+        if (h - t >= N) {
+            overflows.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        frames[h & (N - 1)] = frame;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false when empty.
+    bool pop(CANFrame& frame) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        uint32_t h = head.load(std::memory_order_acquire);
+
+        if (h == t) return false;
+
+        uint32_t depth = h - t;
+        if (depth > highWater) highWater = depth;
+
+        frame = frames[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint32_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    uint32_t capacity() const { return N; }
+    uint32_t getOverflows() const { return overflows.load(std::memory_order_relaxed); }
+    uint32_t getHighWater() const { return highWater; }
+
+    // Consumer side only, while the producer is stopped
+    void clear() {
+        tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+        overflows.store(0, std::memory_order_relaxed);
+        highWater = 0;
+    }
+
+private:
+    CANFrame frames[N];
+    std::atomic<uint32_t> head;     // Written by producer
+    std::atomic<uint32_t> tail;     // Written by consumer
+    std::atomic<uint32_t> overflows;
+    uint32_t highWater;             // Deepest backlog seen by the consumer
+};
+
+#endif
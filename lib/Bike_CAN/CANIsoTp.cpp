@@ -0,0 +1,262 @@
+#include "CANIsoTp.h"
+#include <string.h>
+
+#define ISOTP_PCI_SINGLE       0x00
+#define ISOTP_PCI_FIRST        0x10
+#define ISOTP_PCI_CONSECUTIVE  0x20
+#define ISOTP_PCI_FLOW         0x30
+
+#define ISOTP_FC_CTS           0
+#define ISOTP_FC_WAIT          1
+#define ISOTP_FC_OVERFLOW      2
+
+// STmin byte to microseconds; reserved values mean the maximum (127 ms)
+static uint32_t separationTimeUs(uint8_t stMin) {
+    if (stMin <= 0x7F) return stMin * 1000UL;
+    if (stMin >= 0xF1 && stMin <= 0xF9) return (stMin - 0xF0) * 100UL;
+    return 127000UL;
+}
+
+CANIsoTp::CANIsoTp() :
+    txId(0),
+    rxId(0),
+    sendFrame(nullptr),
+    sendContext(nullptr),
+    blockSize(CAN_ISOTP_DEFAULT_BS),
+    separationTime(CAN_ISOTP_DEFAULT_STMIN_MS) {
+    memset(&stats, 0, sizeof(stats));
+    reset();
+}
+
+void CANIsoTp::configure(uint32_t transmitId, uint32_t receiveId, CANIsoTpSendFn send, void* context) {
+    txId = transmitId;
+    rxId = receiveId;
+    sendFrame = send;
+    sendContext = context;
+    reset();
+}
+
+void CANIsoTp::setFlowControl(uint8_t frames, uint8_t separationTimeMs) {
+    blockSize = frames;
+    separationTime = separationTimeMs > 0x7F ? 0x7F : separationTimeMs;
+}
+
+void CANIsoTp::reset() {
+    txState = TX_IDLE;
+    txLength = 0;
+    txOffset = 0;
+    rxState = RX_IDLE;
+    rxLength = 0;
+    rxOffset = 0;
+    rxComplete = false;
+}
+
+bool CANIsoTp::transmit(const uint8_t* data, uint8_t length) {
+    return sendFrame && sendFrame(sendContext, txId, data, length);
+}
+
+// =============================================================================
+// SENDER
+// =============================================================================
+
+bool CANIsoTp::send(const uint8_t* payload, uint16_t length, uint32_t nowUs) {
+    if (txState != TX_IDLE || length == 0 || length > CAN_ISOTP_MAX_PAYLOAD) return false;
+    
+    uint8_t frame[8];
+    if (length <= 7) {
+        frame[0] = ISOTP_PCI_SINGLE | length;
+        memcpy(frame + 1, payload, length);
+        if (!transmit(frame, length + 1)) {
+            stats.txAborted++;
+            return false;
+        }
+        stats.messagesSent++;
+        return true;
+    }
+    
+    memcpy(txBuffer, payload, length);
+    txLength = length;
+    
+    frame[0] = ISOTP_PCI_FIRST | (length >> 8);
+    frame[1] = length & 0xFF;
+    memcpy(frame + 2, txBuffer, 6);
+    if (!transmit(frame, 8)) {
+        stats.txAborted++;
+        return false;
+    }
+    
+    txOffset = 6;
+    txSequence = 1;
+    txWaitFrames = 0;
+    txLastUs = nowUs;
+    txState = TX_WAIT_FC;
+    return true;
+}
+
+void CANIsoTp::sendConsecutiveFrame(uint32_t nowUs) {
+    uint8_t frame[8];
+    uint8_t chunk = (txLength - txOffset) > 7 ? 7 : (uint8_t)(txLength - txOffset);
+    
+    frame[0] = ISOTP_PCI_CONSECUTIVE | (txSequence & 0x0F);
+    memcpy(frame + 1, txBuffer + txOffset, chunk);
+    if (!transmit(frame, chunk + 1)) {
+        abortTx();
+        return;
+    }
+    
+    txOffset += chunk;
+    txSequence = (txSequence + 1) & 0x0F;
+    txLastUs = nowUs;
+    
+    if (txOffset >= txLength) {
+        txState = TX_IDLE;
+        stats.messagesSent++;
+    } else if (txBlockRemaining > 0 && --txBlockRemaining == 0) {
+        txState = TX_WAIT_FC;   // Block done, the receiver sends the next flow control
+    }
+}
+
+void CANIsoTp::onFlowControl(const uint8_t* data, uint8_t length, uint32_t nowUs) {
+    if (txState != TX_WAIT_FC || length < 3) return;
+    
+    switch (data[0] & 0x0F) {
+        case ISOTP_FC_CTS:
+            txBlockRemaining = data[1];
+            txSeparationUs = separationTimeUs(data[2]);
+            txState = TX_SENDING;
+            txLastUs = nowUs - txSeparationUs;   // First frame of the block may go at once
+            break;
+        
+        case ISOTP_FC_WAIT:
+            if (++txWaitFrames > CAN_ISOTP_MAX_WAIT_FRAMES) abortTx();
+            else txLastUs = nowUs;
+            break;
+        
+        default:  // Overflow or invalid
+            abortTx();
+            break;
+    }
+}
+
+void CANIsoTp::abortTx() {
+    txState = TX_IDLE;
+    stats.txAborted++;
+}
+
+// =============================================================================
+// RECEIVER
+// =============================================================================
+
+bool CANIsoTp::sendFlowControl(uint8_t status) {
+    uint8_t frame[3] = { (uint8_t)(ISOTP_PCI_FLOW | status), blockSize, separationTime };
+    return transmit(frame, sizeof(frame));
+}
+
+void CANIsoTp::onFrame(const uint8_t* data, uint8_t length, uint32_t nowUs) {
+    if (length == 0) return;
+    
+    switch (data[0] & 0xF0) {
+        case ISOTP_PCI_SINGLE: {
+            uint8_t size = data[0] & 0x0F;
+            if (size == 0 || size > 7 || size + 1 > length || rxComplete) return;
+            if (rxState == RX_RECEIVING) abortRx();   // A new message replaces the one in progress
+            
+            memcpy(rxBuffer, data + 1, size);
+            rxLength = size;
+            rxComplete = true;
+            stats.messagesReceived++;
+            break;
+        }
+        
+        case ISOTP_PCI_FIRST: {
+            if (length < 8) return;
+            if (rxState == RX_RECEIVING) abortRx();
+            
+            uint16_t size = ((data[0] & 0x0F) << 8) | data[1];
+            if (size <= 7) return;
+            if (size > CAN_ISOTP_MAX_PAYLOAD || rxComplete) {
+                // Too long, or the last message has not been taken yet
+                sendFlowControl(ISOTP_FC_OVERFLOW);
+                stats.rxAborted++;
+                return;
+            }
+            
+            memcpy(rxBuffer, data + 2, 6);
+            rxLength = size;
+            rxOffset = 6;
+            rxSequence = 1;
+            rxBlockCount = 0;
+            rxLastUs = nowUs;
+            rxState = RX_RECEIVING;
+            sendFlowControl(ISOTP_FC_CTS);
+            break;
+        }
+        
+        case ISOTP_PCI_CONSECUTIVE: {
+            if (rxState != RX_RECEIVING) return;
+            if ((data[0] & 0x0F) != rxSequence) {
+                abortRx();
+                return;
+            }
+            
+            uint16_t remaining = rxLength - rxOffset;
+            uint8_t chunk = remaining > 7 ? 7 : (uint8_t)remaining;
+            if (length < chunk + 1) {
+                abortRx();
+                return;
+            }
+            
+            memcpy(rxBuffer + rxOffset, data + 1, chunk);
+            rxOffset += chunk;
+            rxSequence = (rxSequence + 1) & 0x0F;
+            rxLastUs = nowUs;
+            
+            if (rxOffset >= rxLength) {
+                rxState = RX_IDLE;
+                rxComplete = true;
+                stats.messagesReceived++;
+            } else if (blockSize > 0 && ++rxBlockCount == blockSize) {
+                rxBlockCount = 0;
+                sendFlowControl(ISOTP_FC_CTS);
+            }
+            break;
+        }
+        
+        case ISOTP_PCI_FLOW:
+            onFlowControl(data, length, nowUs);
+            break;
+    }
+}
+
+void CANIsoTp::abortRx() {
+    rxState = RX_IDLE;
+    stats.rxAborted++;
+}
+
+// =============================================================================
+// TIMING
+// =============================================================================
+
+// Sending side only: the next consecutive frame at STmin, or the flow control
+// timeout. 0 when poll() has something to do now.
+uint32_t CANIsoTp::getTxDueUs(uint32_t nowUs) const {
+    uint32_t wait = (txState == TX_SENDING) ? txSeparationUs : CAN_ISOTP_TIMEOUT_MS * 1000UL;
+    uint32_t elapsed = nowUs - txLastUs;
+    return elapsed >= wait ? 0 : wait - elapsed;
+}
+
+void CANIsoTp::poll(uint32_t nowUs) {
+    if (txState == TX_WAIT_FC && nowUs - txLastUs >= CAN_ISOTP_TIMEOUT_MS * 1000UL) {
+        abortTx();
+    }
+    
+    // STmin 0 sends the rest of the block at once, otherwise one frame per gap
+    while (txState == TX_SENDING && nowUs - txLastUs >= txSeparationUs) {
+        sendConsecutiveFrame(nowUs);
+        if (txSeparationUs > 0) break;
+    }
+    
+    if (rxState == RX_RECEIVING && nowUs - rxLastUs >= CAN_ISOTP_TIMEOUT_MS * 1000UL) {
+        abortRx();
+    }
+}
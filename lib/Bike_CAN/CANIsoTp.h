@@ -0,0 +1,111 @@
+#ifndef CAN_ISOTP_H
+#define CAN_ISOTP_H
+
+#include <stdint.h>
+
+// ISO 15765-2 (ISO-TP) segmentation over classic CAN, one channel per node
+// pair: frames go out on txId, and the peer's frames (data and flow control)
+// arrive on rxId.
+//
+//   Single frame       [0x0L] data...                 payload <= 7 bytes
+//   First frame        [0x1H] [L] data x6             12-bit length
+//   Consecutive frame  [0x2N] data x7                 N = sequence 0-15
+//   Flow control       [0x3S] [block size] [STmin]    S: 0 CTS, 1 WAIT, 2 OVERFLOW
+//
+// The receiver paces the sender: after the first frame and after every
+// block of consecutive frames it answers with flow control carrying the
+// block size (0 = rest of the message in one block) and the minimum gap
+// between consecutive frames (STmin: 0-127 ms, 0xF1-0xF9 = 100-900 us).
+// Frames are not padded, so short last frames cost less bus time.
+//
+// Non-blocking: poll() sends due consecutive frames and runs the timeouts.
+// It must be called at least every STmin. On the boards that is update(),
+// and canTask sleeps no longer than getTxDueUs() while a transfer runs.
+
+#define CAN_ISOTP_MAX_PAYLOAD      128    // Reassembly/transmit buffer (ISO-TP allows 4095)
+#define CAN_ISOTP_DEFAULT_BS       8      // Frames per block advertised by the receiver
+#define CAN_ISOTP_DEFAULT_STMIN_MS 1      // Gap between consecutive frames advertised by the receiver
+#define CAN_ISOTP_TIMEOUT_MS       1000   // N_Bs / N_Cr: flow control or next frame overdue
+#define CAN_ISOTP_MAX_WAIT_FRAMES  10     // WAIT flow controls accepted before giving up
+
+// Sends one raw frame for the channel, false if the transport refused it
+typedef bool (*CANIsoTpSendFn)(void* context, uint32_t id, const uint8_t* data, uint8_t length);
+
+struct CANIsoTpStats {
+    uint32_t messagesSent;
+    uint32_t messagesReceived;
+    uint32_t txAborted;        // Flow control timeout/overflow, or a frame the transport refused
+    uint32_t rxAborted;        // Sequence error, timeout, or a message too long for the buffer
+};
+
+class CANIsoTp {
+public:
+    CANIsoTp();
+    
+    void configure(uint32_t txId, uint32_t rxId, CANIsoTpSendFn send, void* context);
+    void setFlowControl(uint8_t blockSize, uint8_t separationTimeMs);
+    void reset();                                   // Drops transfers in progress
+    
+    uint32_t getTxId() const { return txId; }
+    uint32_t getRxId() const { return rxId; }
+    
+    // Sending: copies the payload. False while busy or if it is too long.
+    bool send(const uint8_t* payload, uint16_t length, uint32_t nowUs);
+    bool isSending() const { return txState != TX_IDLE; }
+    uint32_t getTxDueUs(uint32_t nowUs) const;      // Until poll() sends the next frame or times out
+    
+    // Receiving: feed every frame that arrived on rxId
+    void onFrame(const uint8_t* data, uint8_t length, uint32_t nowUs);
+    void poll(uint32_t nowUs);
+    
+    // A completed message stays available until release()
+    bool hasMessage() const { return rxComplete; }
+    const uint8_t* getMessage() const { return rxBuffer; }
+    uint16_t getMessageLength() const { return rxLength; }
+    void release() { rxComplete = false; }
+    
+    CANIsoTpStats getStats() const { return stats; }
+
+private:
+    enum TxState { TX_IDLE, TX_WAIT_FC, TX_SENDING };
+    enum RxState { RX_IDLE, RX_RECEIVING };
+    
+    uint32_t txId;
+    uint32_t rxId;
+    CANIsoTpSendFn sendFrame;
+    void* sendContext;
+    uint8_t blockSize;              // Advertised to the sender
+    uint8_t separationTime;         // Advertised STmin, raw encoding
+    
+    // Sender
+    TxState txState;
+    uint8_t txBuffer[CAN_ISOTP_MAX_PAYLOAD];
+    uint16_t txLength;
+    uint16_t txOffset;
+    uint8_t txSequence;
+    uint8_t txBlockRemaining;       // 0 = unlimited (BS 0)
+    uint32_t txSeparationUs;
+    uint32_t txLastUs;              // Last CF sent, or when waiting for FC began
+    uint8_t txWaitFrames;
+    
+    // Receiver
+    RxState rxState;
+    uint8_t rxBuffer[CAN_ISOTP_MAX_PAYLOAD];
+    uint16_t rxLength;
+    uint16_t rxOffset;
+    uint8_t rxSequence;
+    uint8_t rxBlockCount;
+    uint32_t rxLastUs;
+    bool rxComplete;
+    
+    CANIsoTpStats stats;
+    
+    bool transmit(const uint8_t* data, uint8_t length);
+    bool sendFlowControl(uint8_t status);
+    void sendConsecutiveFrame(uint32_t nowUs);
+    void onFlowControl(const uint8_t* data, uint8_t length, uint32_t nowUs);
+    void abortTx();
+    void abortRx();
+};
+
+#endif
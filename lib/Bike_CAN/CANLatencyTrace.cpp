@@ -0,0 +1,114 @@
+#include "CANLatencyTrace.h"
+#include <Arduino.h>
+#include <algorithm>
+#include "CANTimeSync.h"
+
+CANLatencyTrace::CANLatencyTrace() {
+    reset();
+}
+
+void CANLatencyTrace::reset() {
+    memset(sources, 0, sizeof(sources));
+}
+
+void CANLatencyTrace::onSample(uint8_t source, uint8_t sequence, uint32_t captureUs, bool clockValid) {
+    if (source >= CAN_TRACE_COUNT) return;
+    Source& s = sources[source];
+    if (s.haveSample && sequence == s.sequence) return;   // Repeated announcement
+
+    if (s.haveSample) {
+        // Samples in between were never announced, the current one never made it through.
+        // Sequences run 1-255, 0 is skipped on wrap.
+        uint8_t gap = sequence - s.sequence;
+        if (sequence < s.sequence) gap--;
+        s.skipped += gap - 1;
+        if (!s.measured) s.skipped++;
+    }
+    s.haveSample = true;
+    s.sequence = sequence;
+    s.captureUs = captureUs;
+    s.clockValid = clockValid;
+    s.measured = false;
+    s.phase = IDLE;
+}
+
+void CANLatencyTrace::onFrame(uint8_t source, uint32_t rxUs) {
+    if (source >= CAN_TRACE_COUNT) return;
+    Source& s = sources[source];
+    if (!s.haveSample || s.measured || s.phase != IDLE) return;
+
+    s.rxUs = rxUs;
+    s.phase = RECEIVED;
+}
+
+void CANLatencyTrace::onParsed(uint8_t source, uint32_t nowUs) {
+    if (source >= CAN_TRACE_COUNT) return;
+    Source& s = sources[source];
+    if (s.phase != RECEIVED) return;
+
+    s.parsedUs = nowUs;
+    s.phase = PARSED;
+}
+
+void CANLatencyTrace::onDisplayed(uint32_t nowUs) {
+    for (uint8_t i = 0; i < CAN_TRACE_COUNT; i++) {
+        Source& s = sources[i];
+        if (s.phase != PARSED) continue;
+        s.phase = IDLE;
+        s.measured = true;
+        if (!s.clockValid) continue;   // Capture time not comparable, counted neither way
+
+        // Sync error can put the capture a little after reception: clamp at 0
+        int32_t received = (int32_t)(s.rxUs - s.captureUs);
+        uint32_t slot = s.count % CAN_TRACE_HISTORY;
+        s.history[CAN_STAGE_RECEIVED][slot] = received > 0 ? received : 0;
+        s.history[CAN_STAGE_PARSED][slot] = s.parsedUs - s.rxUs;
+        s.history[CAN_STAGE_LABELS][slot] = nowUs - s.parsedUs;
+        s.history[CAN_STAGE_TOTAL][slot] = s.history[CAN_STAGE_RECEIVED][slot] + (nowUs - s.rxUs);
+        s.count++;
+    }
+}
+
+void CANLatencyTrace::getStats(uint8_t source, CANTraceStats& out) const {
+    memset(&out, 0, sizeof(out));
+    if (source >= CAN_TRACE_COUNT) return;
+    const Source& s = sources[source];
+
+    out.measured = s.count;
+    out.skipped = s.skipped;
+    uint32_t n = s.count < CAN_TRACE_HISTORY ? s.count : CAN_TRACE_HISTORY;
+    if (n == 0) return;
+
+    uint32_t sorted[CAN_TRACE_HISTORY];
+    for (uint8_t stage = 0; stage < CAN_STAGE_COUNT; stage++) {
+        memcpy(sorted, s.history[stage], n * sizeof(uint32_t));
+        std::sort(sorted, sorted + n);
+        out.p50Us[stage] = sorted[(n - 1) * 50 / 100];
+        out.p90Us[stage] = sorted[(n - 1) * 90 / 100];
+        out.p99Us[stage] = sorted[(n - 1) * 99 / 100];
+        out.maxUs[stage] = sorted[n - 1];
+    }
+}
+
+const char* CANLatencyTrace::sourceName(uint8_t source) {
+    static const char* names[CAN_TRACE_COUNT] = { "status", "bms1", "bms2", "vesc" };
+    return source < CAN_TRACE_COUNT ? names[source] : "?";
+}
+
+void canPrintLatency(const CANLatencyTrace& trace, const CANTimeSync& sync) {
+    Serial.printf("[CAN] Latency, ms p50/p90/p99/max | clock offset %ld us, rtt %lu us, %lu syncs%s\n",
+                  (long)sync.getOffsetUs(), (unsigned long)sync.getRttUs(), (unsigned long)sync.getExchanges(),
+                  sync.isSynced(micros()) ? "" : " (NOT SYNCED)");
+    Serial.println("  source    n  skip  capture->rx              rx->parsed         parsed->labels     total");
+
+    CANTraceStats stats;
+    for (uint8_t i = 0; i < CAN_TRACE_COUNT; i++) {
+        trace.getStats(i, stats);
+        Serial.printf("  %-6s %4lu %5lu", CANLatencyTrace::sourceName(i), (unsigned long)stats.measured, (unsigned long)stats.skipped);
+        for (uint8_t stage = 0; stage < CAN_STAGE_COUNT; stage++) {
+            Serial.printf("  %.1f/%.1f/%.1f/%.1f", stats.p50Us[stage] / 1000.0f, stats.p90Us[stage] / 1000.0f,
+                          stats.p99Us[stage] / 1000.0f, stats.maxUs[stage] / 1000.0f);
+        }
+        Serial.println();
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef CAN_LATENCY_TRACE_H
+#define CAN_LATENCY_TRACE_H
+
+#include <stdint.h>
+
+class CANTimeSync;
+
+// Sensor-to-label latency on the display. The main board stamps every
+// sensor sample (BikeSensorManager) with a rolling sequence number and its
+// capture time, and announces it in a MSG_ID_SAMPLE_INFO frame just ahead
+// of the first data frame that carries it, if that frame goes out at all. The display converts the capture time
+// to its own clock (CANTimeSync) and follows the sample through:
+//
+//   capture -> received    sensor read, sensorTask hand-off, canTask, bus
+//   received -> parsed     onCANMessage() and parseCANMessage()
+//   parsed -> labels set   until updateAll() has called lv_label_set_text()
+//
+// Only the first frame of each sample is measured, so the figures are how
+// old a new value is when it reaches the screen. Samples announced but
+// never measured (data frame lost after its stamp, sequence gaps) count as
+// skipped.
+// Not thread safe: feed and read it from the display's loop.
+
+enum CANTraceSource {
+    CAN_TRACE_STATUS = 0,      // Speed, signals (MSG_ID_BIKE_STATUS)
+    CAN_TRACE_BMS1 = 1,
+    CAN_TRACE_BMS2 = 2,
+    CAN_TRACE_VESC = 3,        // Motor current and temperatures
+    CAN_TRACE_COUNT = 4
+};
+
+enum CANTraceStage {
+    CAN_STAGE_RECEIVED = 0,    // Capture -> frame received
+    CAN_STAGE_PARSED = 1,      // Received -> parsed
+    CAN_STAGE_LABELS = 2,      // Parsed -> labels set
+    CAN_STAGE_TOTAL = 3,       // Capture -> labels set
+    CAN_STAGE_COUNT = 4
+};
+
+#define CAN_TRACE_HISTORY  64     // Latest measurements kept per source for percentiles
+
+struct CANTraceStats {
+    uint32_t measured;
+    uint32_t skipped;
+    uint32_t p50Us[CAN_STAGE_COUNT];
+    uint32_t p90Us[CAN_STAGE_COUNT];
+    uint32_t p99Us[CAN_STAGE_COUNT];
+    uint32_t maxUs[CAN_STAGE_COUNT];
+};
+
+class CANLatencyTrace {
+public:
+    CANLatencyTrace();
+    void reset();
+
+    // captureUs already in the display clock; clockValid false while unsynced
+    void onSample(uint8_t source, uint8_t sequence, uint32_t captureUs, bool clockValid);
+    void onFrame(uint8_t source, uint32_t rxUs);
+    void onParsed(uint8_t source, uint32_t nowUs);
+    void onDisplayed(uint32_t nowUs);             // Right after the labels were updated
+
+    void getStats(uint8_t source, CANTraceStats& out) const;
+    static const char* sourceName(uint8_t source);
+
+private:
+    enum Phase { IDLE, RECEIVED, PARSED };
+
+    struct Source {
+        bool haveSample;
+        uint8_t sequence;
+        uint32_t captureUs;
+        bool clockValid;
+        bool measured;            // Current sample already went through
+        Phase phase;
+        uint32_t rxUs;
+        uint32_t parsedUs;
+        uint32_t count;           // Measurements, history holds the last CAN_TRACE_HISTORY
+        uint32_t skipped;
+        uint32_t history[CAN_STAGE_COUNT][CAN_TRACE_HISTORY];
+    };
+
+    Source sources[CAN_TRACE_COUNT];
+};
+
+// Per-source percentile table and the clock sync state, on Serial
+void canPrintLatency(const CANLatencyTrace& trace, const CANTimeSync& sync);
+
+#endif
@@ -0,0 +1,192 @@
+#include "CANLog.h"
+#include <Arduino.h>
+
+// =============================================================================
+// RECORDS AND CANDUMP TEXT
+// =============================================================================
+
+CANLogRecord canLogMakeRecord(uint32_t id, const uint8_t* data, uint8_t dlc, uint32_t deltaUs, bool transmitted) {
+    CANLogRecord record;
+    if (dlc > 8) dlc = 8;
+    if (deltaUs > CAN_LOG_DELTA_MASK) deltaUs = CAN_LOG_DELTA_MASK;
+    
+    record.deltaDlc = deltaUs | ((uint32_t)dlc << CAN_LOG_DLC_SHIFT);
+    record.id = id | (transmitted ? CAN_LOG_TX_FLAG : 0);
+    memset(record.data, 0, sizeof(record.data));
+    memcpy(record.data, data, dlc);
+    return record;
+}
+
+void canLogInitHeader(CANLogFileHeader& header, uint32_t startUs, uint32_t recordCount) {
+    memcpy(header.magic, CAN_LOG_MAGIC, sizeof(header.magic));
+    header.version = CAN_LOG_VERSION;
+    header.recordSize = sizeof(CANLogRecord);
+    header.reserved = 0;
+    header.startUs = startUs;
+    header.recordCount = recordCount;
+}
+
+bool canLogCheckHeader(const CANLogFileHeader& header) {
+    return memcmp(header.magic, CAN_LOG_MAGIC, sizeof(header.magic)) == 0 &&
+           header.version == CAN_LOG_VERSION &&
+           header.recordSize == sizeof(CANLogRecord);
+}
+
+int canLogFormatCandump(char* out, size_t outSize, uint64_t timeUs, const char* interfaceName, const CANLogRecord& record) {
+    uint32_t id = canLogId(record);
+    bool extended = (id & CAN_FRAME_EXT_FLAG) != 0;
+    
+    int n = snprintf(out, outSize, extended ? "(%lu.%06lu) %s %08lX#" : "(%lu.%06lu) %s %03lX#",
+                     (unsigned long)(timeUs / 1000000ULL), (unsigned long)(timeUs % 1000000ULL),
+                     interfaceName, (unsigned long)(id & ~CAN_FRAME_EXT_FLAG));
+    
+    uint8_t dlc = canLogDlc(record);
+    for (uint8_t i = 0; i < dlc && n > 0 && (size_t)n + 2 < outSize; i++) {
+        n += snprintf(out + n, outSize - n, "%02X", record.data[i]);
+    }
+    return n;
+}
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool canLogParseCandump(const char* line, uint64_t& timeUs, CANLogRecord& record) {
+    const char* p = line;
+    while (*p == ' ' || *p == '\t') p++;
+    if (*p++ != '(') return false;
+    
+    // (seconds.fraction)
+    uint64_t seconds = 0;
+    if (*p < '0' || *p > '9') return false;
+    while (*p >= '0' && *p <= '9') seconds = seconds * 10 + (*p++ - '0');
+    
+    uint32_t micro = 0, scale = 100000;
+    if (*p == '.') {
+        p++;
+        while (*p >= '0' && *p <= '9') {
+            micro += (*p++ - '0') * scale;
+            scale /= 10;
+        }
+    }
+    if (*p++ != ')') return false;
+    timeUs = seconds * 1000000ULL + micro;
+    
+    // Interface name
+    while (*p == ' ') p++;
+    if (!*p || *p == ' ') return false;
+    while (*p && *p != ' ') p++;
+    while (*p == ' ') p++;
+    
+    // ID#DATA, 3 hex digits for standard IDs, 8 for extended
+    uint32_t id = 0;
+    int digits = 0;
+    for (int d; (d = hexDigit(*p)) >= 0; p++, digits++) id = (id << 4) | d;
+    if (*p++ != '#' || digits == 0 || digits > 8) return false;
+    if (*p == 'R' || *p == '#') return false;  // Remote and CAN FD frames
+    
+    if (digits > 3) id = (id & 0x1FFFFFFFUL) | CAN_FRAME_EXT_FLAG;
+    else if (id > 0x7FF) return false;
+    
+    uint8_t data[8];
+    uint8_t dlc = 0;
+    while (hexDigit(p[0]) >= 0) {
+        if (dlc == 8 || hexDigit(p[1]) < 0) return false;
+        data[dlc++] = (uint8_t)((hexDigit(p[0]) << 4) | hexDigit(p[1]));
+        p += 2;
+    }
+    if (*p && *p != ' ' && *p != '\r' && *p != '\n') return false;
+    
+    record = canLogMakeRecord(id, data, dlc, 0, false);
+    return true;
+}
+
+// =============================================================================
+// RAM FLIGHT RECORDER
+// =============================================================================
+
+CANLogBuffer::CANLogBuffer(CANLogRecord* storage, uint32_t capacity) :
+    records(storage),
+    recordCapacity(capacity),
+    written(0),
+    startUs(0),
+    lastUs(0),
+    enabled(true) {
+}
+
+void CANLogBuffer::record(const CANFrame& frame, bool transmitted) {
+    if (!enabled || recordCapacity == 0) return;
+    
+    uint32_t delta = written ? frame.timestampUs - lastUs : 0;
+    lastUs = frame.timestampUs;
+    
+    if (written == 0) startUs = frame.timestampUs;
+    
+    records[written % recordCapacity] = canLogMakeRecord(frame.id, frame.data, frame.dlc, delta, transmitted);
+    written++;
+    
+    // Full: the oldest record was overwritten, the next one is the new start
+    if (written > recordCapacity) startUs += canLogDelta(at(0));
+}
+
+void CANLogBuffer::clear() {
+    written = 0;
+    startUs = 0;
+    lastUs = 0;
+}
+
+void CANLogBuffer::setEnabled(bool enable) {
+    enabled = enable;
+}
+
+bool CANLogBuffer::isEnabled() const {
+    return enabled;
+}
+
+uint32_t CANLogBuffer::size() const {
+    return written < recordCapacity ? written : recordCapacity;
+}
+
+uint32_t CANLogBuffer::capacity() const {
+    return recordCapacity;
+}
+
+uint32_t CANLogBuffer::getOverwritten() const {
+    return written - size();
+}
+
+const CANLogRecord& CANLogBuffer::at(uint32_t index) const {
+    return records[(written - size() + index) % recordCapacity];
+}
+
+uint32_t CANLogBuffer::getStartUs() const {
+    return startUs;
+}
+
+void CANLogBuffer::printCandump(const char* interfaceName) const {
+    char line[CAN_LOG_CANDUMP_MAX];
+    uint64_t timeUs = startUs;
+    
+    for (uint32_t i = 0; i < size(); i++) {
+        const CANLogRecord& record = at(i);
+        if (i > 0) timeUs += canLogDelta(record);
+        
+        canLogFormatCandump(line, sizeof(line), timeUs, interfaceName, record);
+        Serial.println(line);
+    }
+}
+
+bool CANLogBuffer::writeCapture(FILE* file) const {
+    CANLogFileHeader header;
+    canLogInitHeader(header, startUs, size());
+    if (fwrite(&header, sizeof(header), 1, file) != 1) return false;
+    
+    // Two runs at most: oldest..end of storage, then the wrapped part
+    uint32_t first = (written - size()) % recordCapacity;
+    uint32_t run = size() < recordCapacity - first ? size() : recordCapacity - first;
+    if (fwrite(&records[first], sizeof(CANLogRecord), run, file) != run) return false;
+    return fwrite(records, sizeof(CANLogRecord), size() - run, file) == size() - run;
+}
@@ -0,0 +1,109 @@
+#ifndef CAN_LOG_H
+#define CAN_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "CANFrame.h"
+
+// Binary CAN capture format.
+//
+// A capture is a CANLogFileHeader followed by CANLogRecords, little-endian
+// (ESP32 and x86 both are, so records are written with plain memcpy/fwrite).
+// Each record stores the time since the previous record instead of an
+// absolute time, so 16 bytes cover ID, DLC, data and timing. The first
+// record's delta is ignored; the header holds its absolute time.
+//
+// Candump text ("(1700000000.000123) can0 100#0011223344556677", as written
+// by candump -L / -l) converts both ways with canLogFormatCandump() and
+// canLogParseCandump().
+
+#define CAN_LOG_MAGIC          "BCAN"
+#define CAN_LOG_VERSION        1
+#define CAN_LOG_TX_FLAG        0x40000000UL   // Record id: frame was sent by the logging node
+#define CAN_LOG_DELTA_MASK     0x0FFFFFFFUL   // Record deltaDlc: µs since previous record (saturates at ~268 s)
+#define CAN_LOG_DLC_SHIFT      28             // Record deltaDlc: DLC in the top 4 bits
+#define CAN_LOG_CANDUMP_MAX    64             // Longest candump line canLogFormatCandump() writes
+
+struct CANLogRecord {
+    uint32_t deltaDlc;     // Low 28 bits: µs since previous record, high 4 bits: DLC
+    uint32_t id;           // CAN_FRAME_EXT_FLAG for 29-bit, CAN_LOG_TX_FLAG for own frames
+    uint8_t data[8];
+};
+
+struct CANLogFileHeader {
+    char magic[4];         // CAN_LOG_MAGIC
+    uint8_t version;       // CAN_LOG_VERSION
+    uint8_t recordSize;    // sizeof(CANLogRecord)
+    uint16_t reserved;
+    uint32_t startUs;      // Logging node's micros() at the first record
+    uint32_t recordCount;
+};
+
+static_assert(sizeof(CANLogRecord) == 16, "CANLogRecord must stay 16 bytes");
+static_assert(sizeof(CANLogFileHeader) == 16, "CANLogFileHeader must stay 16 bytes");
+
+inline uint32_t canLogDelta(const CANLogRecord& record) { return record.deltaDlc & CAN_LOG_DELTA_MASK; }
+inline uint8_t canLogDlc(const CANLogRecord& record) { return (uint8_t)(record.deltaDlc >> CAN_LOG_DLC_SHIFT); }
+inline uint32_t canLogId(const CANLogRecord& record) { return record.id & ~CAN_LOG_TX_FLAG; }  // Keeps CAN_FRAME_EXT_FLAG
+inline bool canLogIsTx(const CANLogRecord& record) { return (record.id & CAN_LOG_TX_FLAG) != 0; }
+
+CANLogRecord canLogMakeRecord(uint32_t id, const uint8_t* data, uint8_t dlc, uint32_t deltaUs, bool transmitted);
+void canLogInitHeader(CANLogFileHeader& header, uint32_t startUs, uint32_t recordCount);
+bool canLogCheckHeader(const CANLogFileHeader& header);
+
+// Writes one candump line (no newline) for a frame seen at timeUs, returns its length
+int canLogFormatCandump(char* out, size_t outSize, uint64_t timeUs, const char* interfaceName, const CANLogRecord& record);
+
+// Parses one candump line. The delta is left 0; callers derive it from timeUs.
+// Returns false for anything else (other log output, RTR and CAN FD frames).
+bool canLogParseCandump(const char* line, uint64_t& timeUs, CANLogRecord& record);
+
+// RAM flight recorder: keeps the newest records, overwriting the oldest.
+// Not locked - record from the task that calls BikeCANManager::update() and
+// the send functions, and dump from the same task (or after setEnabled(false)).
+class CANLogBuffer {
+public:
+    CANLogBuffer(CANLogRecord* storage, uint32_t capacity);
+    
+    void record(const CANFrame& frame, bool transmitted);
+    void clear();
+    
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+    
+    uint32_t size() const;
+    uint32_t capacity() const;
+    uint32_t getOverwritten() const;                    // Records lost to wrap-around
+    const CANLogRecord& at(uint32_t index) const;       // 0 = oldest
+    uint32_t getStartUs() const;                        // micros() of at(0)
+    
+    // Prints the buffer as candump lines with the node's uptime as timestamps
+    void printCandump(const char* interfaceName = "can0") const;
+    
+    // Writes header + records as a binary capture (host builds, SD card)
+    bool writeCapture(FILE* file) const;
+
+private:
+    CANLogRecord* records;
+    uint32_t recordCapacity;
+    uint32_t written;             // Total records ever written, indexes run free
+    uint32_t startUs;             // Timestamp of the oldest record held
+    uint32_t lastUs;              // Timestamp of the newest record
+    bool enabled;
+};
+
+// Buffer with its own storage: CANLogRing<1024> canLog;
+// N is a power of two so the free-running write index wraps cleanly.
+template <uint32_t N>
+class CANLogRing : public CANLogBuffer {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "CANLogRing size must be a power of two");
+
+public:
+    CANLogRing() : CANLogBuffer(storage, N) {}
+
+private:
+    CANLogRecord storage[N];
+};
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef CAN_SIGNAL_CODEC_H
+#define CAN_SIGNAL_CODEC_H
+
+#include <stdint.h>
+
+// =============================================================================
+// DBC-style signal codec
+//
+// A message is declared once as a list of signal rows:
+//
+//   X(name, startBit, length, scale, offset, isSigned)
+//
+// startBit counts from the MSB of byte 0 (byte 0 = bits 0..7, byte 1 = 8..15,
+// ...), so multi-byte signals are big-endian like the original hand-packed
+// frames. physical = raw * scale + offset.
+//
+// CAN_DEFINE_MESSAGE expands the rows into a struct with one float per signal
+// and inline pack()/unpack() that are a straight sequence of constant
+// shift/mask/multiply operations - no table walk and no per-signal branches.
+// Encoding rounds to nearest and saturates to the raw range.
+// =============================================================================
+
+// ---- constexpr helpers (C++11 single-return style) --------------------------
+
+constexpr uint64_t canSignalMask(uint8_t startBit, uint8_t length) {
+    return (((length >= 64) ? ~0ULL : ((1ULL << length) - 1)) << (64 - startBit - length));
+}
+
+constexpr uint8_t canPopCount(uint64_t v) {
+    return v ? (uint8_t)((v & 1) + canPopCount(v >> 1)) : 0;
+}
+
+constexpr uint8_t canTrailingZeros(uint64_t v) {
+    return (v & 1) ? 0 : (uint8_t)(1 + canTrailingZeros(v >> 1));
+}
+
+// Bytes needed to carry every bit in a 64-bit big-endian usage mask
+constexpr uint8_t canBytesUsed(uint64_t usedMask) {
+    return usedMask ? (uint8_t)((64 - canTrailingZeros(usedMask) + 7) / 8) : 0;
+}
+
+// Largest float that converts to an integer below 2^bits without overflow
+constexpr float canRawLimit(uint8_t bits) {
+    return (bits <= 24) ? (float)((1ULL << bits) - 1)
+                        : (float)((1ULL << bits) - (1ULL << (bits - 24)));
+}
+
+// ---- per-signal codec -------------------------------------------------------
+
+template <uint8_t StartBit, uint8_t Length, bool IsSigned>
+struct CANSignalField {
+    static_assert(Length >= 1 && Length <= 32, "CAN signal length must be 1..32 bits");
+    static_assert(StartBit + Length <= 64, "CAN signal runs past the 8-byte payload");
+
+    static constexpr uint8_t shift = 64 - StartBit - Length;
+    static constexpr uint32_t mask = (Length == 32) ? 0xFFFFFFFFUL : ((1UL << Length) - 1);
+    static constexpr uint32_t signBit = IsSigned ? (1UL << (Length - 1)) : 0;
+    static constexpr float rawMin = IsSigned ? -(float)(1ULL << (Length - 1)) : 0.0f;
+    static constexpr float rawMax = IsSigned ? canRawLimit(Length - 1) : canRawLimit(Length);
+
+    // invScale is passed as a literal (1.0f / scale) so it folds at compile time
+    static inline uint64_t encode(float value, float invScale, float offset) {
+        if (Length == 1 && !IsSigned) {
+            // Flag: no scaling work, NaN reads as clear
+            return (uint64_t)(value >= 0.5f) << shift;
+        }
+
+        float raw = (value - offset) * invScale;
+        raw = (raw >= rawMin) ? raw : rawMin;     // Saturate as selects; NaN takes rawMin
+        raw = (raw <= rawMax) ? raw : rawMax;
+        raw += (IsSigned && raw < 0.0f) ? -0.5f : 0.5f;  // Round half away from zero
+
+        uint32_t bits = (Length == 32 && !IsSigned) ? (uint32_t)raw
+                                                    : (uint32_t)(int32_t)raw;
+        return (uint64_t)(bits & mask) << shift;
+    }
+
+    static inline float decode(uint64_t word, float scale, float offset) {
+        uint32_t raw = (uint32_t)(word >> shift) & mask;
+        float value = IsSigned ? (float)(int32_t)((raw ^ signBit) - signBit)  // Branch-free sign extension
+                               : (float)raw;
+        // Literal arguments: both tests fold away at compile time
+        if (scale != 1.0f) value *= scale;
+        if (offset != 0.0f) value += offset;
+        return value;
+    }
+};
+
+// ---- payload byte order -----------------------------------------------------
+
+// length is the compile-time DLC, so only one path survives inlining
+inline void canStoreBE64(uint8_t* out, uint64_t word, uint8_t length) {
+    if (length == 8) {
+        // Merged by the compiler into a single byte-swapped store
+        out[0] = (uint8_t)(word >> 56); out[1] = (uint8_t)(word >> 48);
+        out[2] = (uint8_t)(word >> 40); out[3] = (uint8_t)(word >> 32);
+        out[4] = (uint8_t)(word >> 24); out[5] = (uint8_t)(word >> 16);
+        out[6] = (uint8_t)(word >> 8);  out[7] = (uint8_t)word;
+        return;
+    }
+    for (uint8_t i = 0; i < length; i++) {
+        out[i] = (uint8_t)(word >> (56 - 8 * i));
+    }
+}
+
+// Missing trailing bytes (short frame) read as zero
+inline uint64_t canLoadBE64(const uint8_t* in, uint8_t length) {
+    if (length >= 8) {
+        // Common case: a straight big-endian load the compiler turns into a byte swap
+        return ((uint64_t)in[0] << 56) | ((uint64_t)in[1] << 48) |
+               ((uint64_t)in[2] << 40) | ((uint64_t)in[3] << 32) |
+               ((uint64_t)in[4] << 24) | ((uint64_t)in[5] << 16) |
+               ((uint64_t)in[6] << 8)  |  (uint64_t)in[7];
+    }
+    uint64_t word = 0;
+    for (uint8_t i = 0; i < 8; i++) {
+        word = (word << 8) | (i < length ? in[i] : 0);
+    }
+    return word;
+}
+
+// ---- row expanders ----------------------------------------------------------
+
+#define CAN_SIGNAL_FIELD(name, start, len, scale, offset, sign) \
+    float name;
+
+#define CAN_SIGNAL_MASK(name, start, len, scale, offset, sign) \
+    | canSignalMask(start, len)
+
+#define CAN_SIGNAL_BITS(name, start, len, scale, offset, sign) \
+    + (len)
+
+#define CAN_SIGNAL_PACK(name, start, len, scale, offset, sign) \
+    word |= CANSignalField<start, len, sign>::encode(name, 1.0f / (scale), offset);
+
+#define CAN_SIGNAL_UNPACK(name, start, len, scale, offset, sign) \
+    name = CANSignalField<start, len, sign>::decode(word, scale, offset);
+
+// Declare a message struct from a signal list macro.
+// dlc is the transmitted length; signals must fit inside it and must not overlap.
+#define CAN_DEFINE_MESSAGE(Name, dlc, SIGNALS)                                        \
+    struct Name {                                                                     \
+        SIGNALS(CAN_SIGNAL_FIELD)                                                     \
+                                                                                      \
+        static constexpr uint8_t length = dlc;                                        \
+        static constexpr uint64_t usedBits = 0 SIGNALS(CAN_SIGNAL_MASK);              \
+        static constexpr uint8_t minLength = canBytesUsed(usedBits);                  \
+                                                                                      \
+        static_assert(dlc >= 1 && dlc <= 8, #Name ": DLC must be 1..8");              \
+        static_assert(minLength <= dlc, #Name ": signals run past the DLC");          \
+        static_assert(canPopCount(usedBits) == 0 SIGNALS(CAN_SIGNAL_BITS),            \
+                      #Name ": overlapping signals");                                 \
+                                                                                      \
+        void pack(uint8_t* out) const {                                               \
+            uint64_t word = 0;                                                        \
+            SIGNALS(CAN_SIGNAL_PACK)                                                  \
+            canStoreBE64(out, word, dlc);                                             \
+        }                                                                             \
+                                                                                      \
+        void unpack(const uint8_t* in, uint8_t inLength) {                            \
+            uint64_t word = canLoadBE64(in, inLength);                                \
+            SIGNALS(CAN_SIGNAL_UNPACK)                                                \
+        }                                                                             \
+    };
+
+#endif
@@ -0,0 +1,78 @@
+#include "CANTimeSync.h"
+
+static void storeBE32(uint8_t* out, uint32_t value) {
+    out[0] = value >> 24;
+    out[1] = value >> 16;
+    out[2] = value >> 8;
+    out[3] = value;
+}
+
+static uint32_t loadBE32(const uint8_t* in) {
+    return ((uint32_t)in[0] << 24) | ((uint32_t)in[1] << 16) | ((uint32_t)in[2] << 8) | in[3];
+}
+
+CANTimeSync::CANTimeSync() {
+    reset();
+}
+
+void CANTimeSync::reset() {
+    pendingT1 = 0;
+    pending = false;
+    count = 0;
+    next = 0;
+    offsetUs = 0;
+    bestRttUs = 0;
+    lastReplyUs = 0;
+    exchanges = 0;
+}
+
+uint8_t CANTimeSync::makeRequest(uint8_t* out, uint32_t nowUs) {
+    pendingT1 = nowUs;
+    pending = true;
+    storeBE32(out, nowUs);
+    return CAN_TIME_SYNC_REQUEST_LEN;
+}
+
+uint8_t CANTimeSync::makeReply(uint8_t* out, const uint8_t* request, uint8_t length, uint32_t rxUs, uint32_t nowUs) {
+    if (length < CAN_TIME_SYNC_REQUEST_LEN) return 0;
+
+    uint32_t hold = nowUs - rxUs;
+    if (hold > 0xFFFF) hold = 0xFFFF;
+
+    out[0] = request[2];            // t1 low 16 bits
+    out[1] = request[3];
+    out[2] = hold >> 8;
+    out[3] = hold;
+    storeBE32(out + 4, nowUs);
+    return CAN_TIME_SYNC_REPLY_LEN;
+}
+
+bool CANTimeSync::onReply(const uint8_t* data, uint8_t length, uint32_t rxUs) {
+    if (!pending || length < CAN_TIME_SYNC_REPLY_LEN) return false;
+    if ((uint16_t)((data[0] << 8) | data[1]) != (uint16_t)pendingT1) return false;  // Reply to an older request
+    pending = false;
+
+    uint32_t hold = (data[2] << 8) | data[3];
+    uint32_t t3 = loadBE32(data + 4);
+    uint32_t elapsed = rxUs - pendingT1;
+    uint32_t rtt = elapsed > hold ? elapsed - hold : 0;
+
+    rtts[next] = rtt;
+    offsets[next] = (int32_t)(t3 + rtt / 2 - rxUs);
+    next = (next + 1) % CAN_TIME_SYNC_WINDOW;
+    if (count < CAN_TIME_SYNC_WINDOW) count++;
+
+    uint8_t best = 0;
+    for (uint8_t i = 1; i < count; i++) {
+        if (rtts[i] < rtts[best]) best = i;
+    }
+    offsetUs = offsets[best];
+    bestRttUs = rtts[best];
+    lastReplyUs = rxUs;
+    exchanges++;
+    return true;
+}
+
+bool CANTimeSync::isSynced(uint32_t nowUs) const {
+    return exchanges > 0 && nowUs - lastReplyUs < CAN_TIME_SYNC_STALE_MS * 1000UL;
+}
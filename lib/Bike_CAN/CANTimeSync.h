@@ -0,0 +1,55 @@
+#ifndef CAN_TIME_SYNC_H
+#define CAN_TIME_SYNC_H
+
+#include <stdint.h>
+
+// Aligns the display's micros() with the main board's, NTP style, over the
+// display command channel:
+//
+//   display -> main   t1 (display us, 32 bit)                     request
+//   main -> display   t1 low 16 | hold us (16) | t3 (main us, 32)  reply
+//
+// hold = t3 - t2 is how long the request waited on the main board before
+// the reply went out (up to one scheduler tick), so it is taken out of the
+// round trip: rtt = (t4 - t1) - hold, offset = t3 + rtt/2 - t4. Queueing
+// only ever adds delay, so the exchange with the smallest rtt among the last
+// CAN_TIME_SYNC_WINDOW wins. All fields are big-endian.
+
+#define CAN_TIME_SYNC_PERIOD_MS    1000   // Display sends a request this often
+#define CAN_TIME_SYNC_WINDOW       8      // Exchanges the best rtt is picked from
+#define CAN_TIME_SYNC_STALE_MS     5000   // No reply this long = not synced
+#define CAN_TIME_SYNC_REQUEST_LEN  4
+#define CAN_TIME_SYNC_REPLY_LEN    8
+
+class CANTimeSync {
+public:
+    CANTimeSync();
+    void reset();
+
+    // Display side
+    uint8_t makeRequest(uint8_t* out, uint32_t nowUs);
+    bool onReply(const uint8_t* data, uint8_t length, uint32_t rxUs);
+
+    // Main board side: reply to a request that arrived at rxUs
+    static uint8_t makeReply(uint8_t* out, const uint8_t* request, uint8_t length, uint32_t rxUs, uint32_t nowUs);
+
+    bool isSynced(uint32_t nowUs) const;
+    uint32_t toLocal(uint32_t remoteUs) const { return remoteUs - (uint32_t)offsetUs; }
+    int32_t getOffsetUs() const { return offsetUs; }    // Main board clock minus display clock
+    uint32_t getRttUs() const { return bestRttUs; }
+    uint32_t getExchanges() const { return exchanges; }
+
+private:
+    uint32_t pendingT1;
+    bool pending;
+    uint32_t rtts[CAN_TIME_SYNC_WINDOW];
+    int32_t offsets[CAN_TIME_SYNC_WINDOW];
+    uint8_t count;
+    uint8_t next;
+    int32_t offsetUs;
+    uint32_t bestRttUs;
+    uint32_t lastReplyUs;
+    uint32_t exchanges;
+};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef CAN_TRANSPORT_H
+#define CAN_TRANSPORT_H
+
+#include <stdint.h>
+#include "CANFrame.h"
+
+// Which frames a node accepts; transports set their acceptance filter from it
+enum CANNodeRole {
+    CAN_NODE_MAIN = 0,      // Main controller: display commands (0x7xx) only
+    CAN_NODE_DISPLAY = 1,   // Display: MSG_ID_* data from the main controller (0x100-0x6FF)
+    CAN_NODE_LOOPBACK = 2   // Self-test: own frames are received back, all IDs accepted
+};
+
+// Controller fault confinement state (ISO 11898-1). TEC/REC are the
+// controller's transmit/receive error counters.
+enum CANErrorState {
+    CAN_STATE_ACTIVE = 0,       // TEC and REC below 96
+    CAN_STATE_WARNING = 1,      // Either counter at 96 or above
+    CAN_STATE_PASSIVE = 2,      // Either counter at 128 or above: passive error flags only
+    CAN_STATE_BUS_OFF = 3,      // TEC above 255, off the bus until recovered
+    CAN_STATE_RECOVERING = 4,   // Waiting for 128 x 11 recessive bits
+    CAN_STATE_STOPPED = 5       // Controller not running (recovered, not restarted yet)
+};
+
+// Controller/driver error events
+struct CANAlertCounters {
+    uint32_t busErrors;        // Bit/stuff/CRC/form/ACK errors seen on the bus
+    uint32_t txFailures;       // Frames the controller gave up on
+    uint32_t rxOverruns;       // Driver queue full or controller FIFO overrun
+    uint32_t errorPassive;     // Transitions into error-passive
+    uint32_t busOffEvents;     // Transitions into bus-off
+    uint32_t arbitrationLost;
+    uint8_t txErrorCounter;    // Current TEC/REC, not events
+    uint8_t rxErrorCounter;
+};
+
+// Moves raw frames between BikeCANManager and a bus.
+//
+//   ESP32CANTransport     on-board controller (TWAI driver or CAN library)
+//   SocketCANTransport    Linux SocketCAN, e.g. vcan0 (host builds)
+//   LoopbackCANTransport  in-memory bus shared by several managers
+//
+// transmit() and receive() never block. Frame timestamps are micros().
+// Transports without a TX queue report a capacity of 0: transmit() has
+// finished with the frame by the time it returns.
+class CANTransport {
+public:
+    virtual ~CANTransport() {}
+    
+    // Pins are only used by the ESP32 transport
+    virtual bool begin(int txPin, int rxPin, CANNodeRole role) = 0;
+    virtual void end() = 0;
+    
+    virtual bool transmit(uint32_t id, const uint8_t* data, uint8_t length) = 0;
+    virtual bool receive(CANFrame& frame) = 0;     // false when nothing is queued
+    
+    virtual void poll() {}                         // Read error alerts, called from update()
+    virtual CANAlertCounters getAlertCounters() = 0;
+    virtual bool isBusOff() { return false; }
+    virtual CANErrorState getErrorState() { return isBusOff() ? CAN_STATE_BUS_OFF : CAN_STATE_ACTIVE; }
+    virtual bool recover() { return false; }      // Leave bus-off/stopped; false if not possible now
+    
+    virtual uint32_t getTxPending() { return 0; } // Frames queued, including the one on the wire
+    virtual uint32_t getTxCapacity() { return 0; }
+    virtual void clearTxQueue() {}                // Drop queued frames that have not started
+    
+    virtual uint32_t getRxPending() = 0;
+    virtual uint32_t getRxOverflows() = 0;
+    virtual uint32_t getRxCapacity() = 0;          // Max frames update() drains per call
+    virtual const char* getName() = 0;
+};
+
+#endif
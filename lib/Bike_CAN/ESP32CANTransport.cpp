@@ -0,0 +1,352 @@
+#include "ESP32CANTransport.h"
+
+#if defined(ESP32)
+
+#include "BikeCANManager.h"
+#include "BikeLog.h"
+
+#ifdef BIKE_CAN_BACKEND_TWAI
+// Alerts the driver raises; read without blocking from poll()
+#ifdef TWAI_ALERT_RX_FIFO_OVERRUN
+#define CAN_TWAI_ALERTS (TWAI_ALERT_BUS_ERROR | TWAI_ALERT_TX_FAILED | TWAI_ALERT_RX_QUEUE_FULL | \
+                         TWAI_ALERT_RX_FIFO_OVERRUN | TWAI_ALERT_ERR_PASS | TWAI_ALERT_BUS_OFF | \
+                         TWAI_ALERT_BUS_RECOVERED | TWAI_ALERT_ARB_LOST)
+#else
+#define CAN_TWAI_ALERTS (TWAI_ALERT_BUS_ERROR | TWAI_ALERT_TX_FAILED | TWAI_ALERT_RX_QUEUE_FULL | \
+                         TWAI_ALERT_ERR_PASS | TWAI_ALERT_BUS_OFF | \
+                         TWAI_ALERT_BUS_RECOVERED | TWAI_ALERT_ARB_LOST)
+#endif
+#else
+ESP32CANTransport* ESP32CANTransport::rxInstance = nullptr;
+#endif
+
+ESP32CANTransport& ESP32CANTransport::instance() {
+    static ESP32CANTransport transport;
+    return transport;
+}
+
+ESP32CANTransport::ESP32CANTransport() :
+    started(false),
+    nodeRole(CAN_NODE_MAIN),
+    busOff(false),
+    errorState(CAN_STATE_STOPPED),
+    rxNotifyTask(NULL),
+    rxNotifyBits(0)
+#ifdef BIKE_CAN_BACKEND_TWAI
+    , alertTask(NULL),
+    pendingAlerts(0)
+#endif
+{
+    memset(&alerts, 0, sizeof(alerts));
+}
+
+CANAlertCounters ESP32CANTransport::getAlertCounters() {
+    return alerts;
+}
+
+bool ESP32CANTransport::isBusOff() {
+    return busOff;
+}
+
+#ifdef BIKE_CAN_BACKEND_TWAI
+
+bool ESP32CANTransport::begin(int txPin, int rxPin, CANNodeRole role) {
+    if (started) end();
+    
+    nodeRole = role;
+    busOff = false;
+    errorState = CAN_STATE_STOPPED;
+    memset(&alerts, 0, sizeof(alerts));
+    
+    twai_mode_t mode = (nodeRole == CAN_NODE_LOOPBACK) ? TWAI_MODE_NO_ACK : TWAI_MODE_NORMAL;
+    twai_general_config_t general = TWAI_GENERAL_CONFIG_DEFAULT((gpio_num_t)txPin, (gpio_num_t)rxPin, mode);
+    general.rx_queue_len = CAN_TWAI_RX_QUEUE_LEN;
+    general.tx_queue_len = CAN_TWAI_TX_QUEUE_LEN;
+    general.alerts_enabled = alertTask ? (CAN_TWAI_ALERTS | TWAI_ALERT_RX_DATA) : CAN_TWAI_ALERTS;
+    
+    twai_timing_config_t timing = TWAI_TIMING_CONFIG_500KBITS();  // CAN_SPEED
+    
+    // Single filter, standard frames: bits 31..21 = ID, bit 20 = RTR, the rest
+    // covers data bytes. Mask bit 1 = don't care. RTR must be 0 in both roles.
+    twai_filter_config_t filter = TWAI_FILTER_CONFIG_ACCEPT_ALL();
+    if (nodeRole == CAN_NODE_MAIN) {
+        // Exact: only the 0x7xx display command block
+        filter.acceptance_code = (uint32_t)MSG_ID_DISPLAY_CMD << 21;
+        filter.acceptance_mask = ((uint32_t)(~MSG_ID_DISPLAY_MASK & 0x7FF) << 21) | 0x000FFFFF;
+    } else if (nodeRole == CAN_NODE_DISPLAY) {
+        // 0x100-0x6FF is not a single code/mask pair; drop RTR frames here and
+        // leave the ID range to BikeCANManager::acceptId()
+        filter.acceptance_code = 0;
+        filter.acceptance_mask = ((uint32_t)0x7FF << 21) | 0x000FFFFF;
+    }
+    
+    if (twai_driver_install(&general, &timing, &filter) != ESP_OK) {
+        Serial.println("❌ TWAI driver install failed");
+        return false;
+    }
+    
+    if (twai_start() != ESP_OK) {
+        Serial.println("❌ TWAI start failed");
+        twai_driver_uninstall();
+        return false;
+    }
+    
+    started = true;
+    errorState = CAN_STATE_ACTIVE;
+    return true;
+}
+
+void ESP32CANTransport::end() {
+    if (!started) return;
+    twai_stop();
+    twai_driver_uninstall();
+    started = false;
+}
+
+bool ESP32CANTransport::transmit(uint32_t id, const uint8_t* data, uint8_t length) {
+    twai_message_t message;
+    memset(&message, 0, sizeof(message));
+    message.identifier = id;
+    message.data_length_code = length;
+    message.self = (nodeRole == CAN_NODE_LOOPBACK) ? 1 : 0;
+    memcpy(message.data, data, length);
+    
+    // Queue and return; TX failures come back as alerts
+    return twai_transmit(&message, 0) == ESP_OK;
+}
+
+bool ESP32CANTransport::receive(CANFrame& frame) {
+    twai_message_t message;
+    if (twai_receive(&message, 0) != ESP_OK) return false;
+    
+    // The driver does not timestamp frames, so this is dequeue time
+    frame.timestampUs = micros();
+    frame.id = message.identifier | (message.extd ? CAN_FRAME_EXT_FLAG : 0);
+    frame.dlc = message.rtr ? 0 : (message.data_length_code > 8 ? 8 : message.data_length_code);
+    memcpy(frame.data, message.data, frame.dlc);
+    
+    return true;
+}
+
+void ESP32CANTransport::setRxNotify(TaskHandle_t task, uint32_t bits) {
+    rxNotifyTask = task;
+    rxNotifyBits = bits;
+    if (alertTask || !task) return;
+    
+    // One alert per received frame from now on
+    twai_reconfigure_alerts(CAN_TWAI_ALERTS | TWAI_ALERT_RX_DATA, NULL);
+    alertTask = xTaskCreateStaticPinnedToCore(alertTaskMain, "CANAlerts", CAN_ALERT_TASK_STACK, this,
+                                              uxTaskPriorityGet(task) + 1, alertTaskStack, &alertTaskBuffer,
+                                              xPortGetCoreID());
+}
+
+void ESP32CANTransport::alertTaskMain(void* arg) {
+    ESP32CANTransport* transport = static_cast<ESP32CANTransport*>(arg);
+    
+    while (true) {
+        uint32_t triggered = 0;
+        if (twai_read_alerts(&triggered, portMAX_DELAY) != ESP_OK) {
+            vTaskDelay(pdMS_TO_TICKS(100));   // Driver not installed (between end() and begin())
+            continue;
+        }
+        transport->pendingAlerts.fetch_or(triggered);
+        if (transport->rxNotifyTask) xTaskNotify(transport->rxNotifyTask, transport->rxNotifyBits, eSetBits);
+    }
+}
+
+void ESP32CANTransport::poll() {
+    if (!started) return;
+    
+    // With the alert task running, it has read (and cleared) the alerts already
+    uint32_t triggered = 0;
+    bool haveAlerts = alertTask ? (triggered = pendingAlerts.exchange(0)) != 0
+                                : twai_read_alerts(&triggered, 0) == ESP_OK;
+    if (haveAlerts) {
+        if (triggered & TWAI_ALERT_ERR_PASS) {
+            alerts.errorPassive++;
+            BIKE_LOGW("⚠️ CAN error passive");
+        }
+        if (triggered & TWAI_ALERT_BUS_OFF) {
+            alerts.busOffEvents++;
+            busOff = true;
+            BIKE_LOGE("❌ CAN bus-off");
+        }
+        if (triggered & TWAI_ALERT_BUS_RECOVERED) {
+            // The driver comes out of recovery stopped
+            busOff = false;
+            bool restarted = twai_start() == ESP_OK;
+            if (restarted) BIKE_LOGI("✅ CAN bus recovered");
+            else BIKE_LOGE("❌ CAN restart after recovery failed");
+        }
+#ifdef TWAI_ALERT_RX_FIFO_OVERRUN
+        if (triggered & TWAI_ALERT_RX_FIFO_OVERRUN) alerts.rxOverruns++;
+#endif
+    }
+    
+    // Alerts latch, so take exact totals from the driver counters
+    twai_status_info_t status;
+    if (twai_get_status_info(&status) == ESP_OK) {
+        alerts.busErrors = status.bus_error_count;
+        alerts.txFailures = status.tx_failed_count;
+        alerts.arbitrationLost = status.arb_lost_count;
+        if (status.rx_missed_count > alerts.rxOverruns) alerts.rxOverruns = status.rx_missed_count;
+        alerts.txErrorCounter = status.tx_error_counter > 255 ? 255 : status.tx_error_counter;
+        alerts.rxErrorCounter = status.rx_error_counter > 255 ? 255 : status.rx_error_counter;
+        
+        switch (status.state) {
+            case TWAI_STATE_BUS_OFF:    errorState = CAN_STATE_BUS_OFF; break;
+            case TWAI_STATE_RECOVERING: errorState = CAN_STATE_RECOVERING; break;
+            case TWAI_STATE_STOPPED:    errorState = CAN_STATE_STOPPED; break;
+            default: {
+                uint32_t worst = status.tx_error_counter > status.rx_error_counter ?
+                                 status.tx_error_counter : status.rx_error_counter;
+                errorState = worst >= 128 ? CAN_STATE_PASSIVE : worst >= 96 ? CAN_STATE_WARNING : CAN_STATE_ACTIVE;
+                break;
+            }
+        }
+    }
+}
+
+CANErrorState ESP32CANTransport::getErrorState() {
+    return started ? errorState : CAN_STATE_STOPPED;
+}
+
+// Bus-off: start the 128 x 11 recessive bit wait (poll() restarts the driver
+// once it is done). Stopped: start again.
+bool ESP32CANTransport::recover() {
+    if (!started) return false;
+    if (errorState == CAN_STATE_BUS_OFF) return twai_initiate_recovery() == ESP_OK;
+    if (errorState == CAN_STATE_STOPPED) return twai_start() == ESP_OK;
+    return false;
+}
+
+uint32_t ESP32CANTransport::getTxPending() {
+    twai_status_info_t status;
+    if (!started || twai_get_status_info(&status) != ESP_OK) return 0;
+    return status.msgs_to_tx;
+}
+
+uint32_t ESP32CANTransport::getTxCapacity() {
+    return CAN_TWAI_TX_QUEUE_LEN;
+}
+
+// A frame already on the wire stays pending until it is sent or the bus goes off
+void ESP32CANTransport::clearTxQueue() {
+    if (started) twai_clear_transmit_queue();
+}
+
+uint32_t ESP32CANTransport::getRxPending() {
+    twai_status_info_t status;
+    if (!started || twai_get_status_info(&status) != ESP_OK) return 0;
+    return status.msgs_to_rx;
+}
+
+uint32_t ESP32CANTransport::getRxOverflows() {
+    return alerts.rxOverruns;
+}
+
+uint32_t ESP32CANTransport::getRxCapacity() {
+    return CAN_TWAI_RX_QUEUE_LEN;
+}
+
+const char* ESP32CANTransport::getName() {
+    return "TWAI";
+}
+
+#else
+
+bool ESP32CANTransport::begin(int txPin, int rxPin, CANNodeRole role) {
+    if (started) end();
+    
+    nodeRole = role;
+    busOff = false;
+    memset(&alerts, 0, sizeof(alerts));
+    
+    CAN.setPins(rxPin, txPin);
+    
+    if (!CAN.begin(CAN_SPEED)) {
+        return false;
+    }
+    
+    // The library's filter() takes a "must match" mask for standard IDs
+    if (nodeRole == CAN_NODE_MAIN) {
+        CAN.filter(MSG_ID_DISPLAY_CMD, MSG_ID_DISPLAY_MASK);
+    } else if (nodeRole == CAN_NODE_LOOPBACK) {
+        CAN.loopback();
+    }
+    
+    // Frames are pulled off the controller in the RX interrupt, not by polling in update()
+    rxRing.clear();
+    rxInstance = this;
+    CAN.onReceive(onReceiveISR);
+    
+    started = true;
+    return true;
+}
+
+void ESP32CANTransport::end() {
+    if (!started) return;
+    CAN.end();
+    started = false;
+}
+
+// Runs from the CAN controller interrupt: copy the frame out and get back
+void IRAM_ATTR ESP32CANTransport::onReceiveISR(int packetSize) {
+    if (!rxInstance || CAN.packetRtr()) return;
+    
+    CANFrame frame;
+    frame.timestampUs = micros();
+    frame.id = CAN.packetId() | (CAN.packetExtended() ? CAN_FRAME_EXT_FLAG : 0);
+    frame.dlc = 0;
+    
+    while (CAN.available() && frame.dlc < 8) {
+        frame.data[frame.dlc++] = CAN.read();
+    }
+    
+    rxInstance->rxRing.push(frame);  // Counts an overflow if update() fell behind
+    
+    if (rxInstance->rxNotifyTask) {
+        BaseType_t woken = pdFALSE;
+        xTaskNotifyFromISR(rxInstance->rxNotifyTask, rxInstance->rxNotifyBits, eSetBits, &woken);
+        if (woken) portYIELD_FROM_ISR();
+    }
+}
+
+void ESP32CANTransport::setRxNotify(TaskHandle_t task, uint32_t bits) {
+    rxNotifyTask = task;
+    rxNotifyBits = bits;
+}
+
+bool ESP32CANTransport::transmit(uint32_t id, const uint8_t* data, uint8_t length) {
+    CAN.beginPacket(id);
+    CAN.write(data, length);
+    return CAN.endPacket();
+}
+
+bool ESP32CANTransport::receive(CANFrame& frame) {
+    return rxRing.pop(frame);
+}
+
+void ESP32CANTransport::poll() {
+    // The library reports no error events
+}
+
+uint32_t ESP32CANTransport::getRxPending() {
+    return rxRing.size();
+}
+
+uint32_t ESP32CANTransport::getRxOverflows() {
+    return rxRing.getOverflows();
+}
+
+uint32_t ESP32CANTransport::getRxCapacity() {
+    return CAN_RX_RING_SIZE;
+}
+
+const char* ESP32CANTransport::getName() {
+    return "CAN library";
+}
+
+#endif
+
+#endif
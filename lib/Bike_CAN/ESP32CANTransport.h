@@ -0,0 +1,88 @@
+#ifndef ESP32_CAN_TRANSPORT_H
+#define ESP32_CAN_TRANSPORT_H
+
+#if defined(ESP32)
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+#ifdef BIKE_CAN_BACKEND_TWAI
+#include "driver/twai.h"
+#else
+#include <CAN.h>
+#endif
+#include "CANTransport.h"
+
+// Backend selection (build flag):
+//   -DBIKE_CAN_BACKEND_TWAI  ESP-IDF TWAI driver: driver RX/TX queues, hardware
+//                            acceptance filter, alerts
+//   (none)                   sandeepmistry CAN library with an interrupt-fed RX ring
+#define CAN_RX_RING_SIZE       64  // Frames buffered between RX interrupt and update()
+#define CAN_TWAI_RX_QUEUE_LEN  64  // Driver-level RX queue (frames)
+#define CAN_TWAI_TX_QUEUE_LEN  16  // Driver-level TX queue (frames)
+#define CAN_ALERT_TASK_STACK   2048
+
+// On-board CAN controller. There is one per chip, so there is one instance.
+class ESP32CANTransport : public CANTransport {
+public:
+    static ESP32CANTransport& instance();
+    
+    bool begin(int txPin, int rxPin, CANNodeRole role) override;
+    void end() override;
+    
+    bool transmit(uint32_t id, const uint8_t* data, uint8_t length) override;
+    bool receive(CANFrame& frame) override;
+    
+    void poll() override;
+    CANAlertCounters getAlertCounters() override;
+    bool isBusOff() override;
+#ifdef BIKE_CAN_BACKEND_TWAI
+    CANErrorState getErrorState() override;
+    bool recover() override;
+    
+    uint32_t getTxPending() override;
+    uint32_t getTxCapacity() override;
+    void clearTxQueue() override;
+#endif
+    
+    uint32_t getRxPending() override;
+    uint32_t getRxOverflows() override;
+    uint32_t getRxCapacity() override;
+    const char* getName() override;
+    
+    // Set notification bits on a task when a frame arrives (and, with TWAI,
+    // on any driver alert), so it can block instead of polling receive().
+    // Call after begin().
+    void setRxNotify(TaskHandle_t task, uint32_t bits);
+
+private:
+    ESP32CANTransport();
+    
+    bool started;
+    CANNodeRole nodeRole;
+    CANAlertCounters alerts;
+    bool busOff;
+    CANErrorState errorState;
+    TaskHandle_t rxNotifyTask;
+    uint32_t rxNotifyBits;
+
+#ifdef BIKE_CAN_BACKEND_TWAI
+    // The driver has no RX callback: a small task blocks on its alerts, keeps
+    // them for poll() and notifies rxNotifyTask
+    TaskHandle_t alertTask;
+    StackType_t alertTaskStack[CAN_ALERT_TASK_STACK];   // Static: no heap after setup
+    StaticTask_t alertTaskBuffer;
+    std::atomic<uint32_t> pendingAlerts;
+    static void alertTaskMain(void* arg);
+#else
+    // Receive ring, filled from the CAN interrupt
+    CANFrameRing<CAN_RX_RING_SIZE> rxRing;
+    static ESP32CANTransport* rxInstance;
+    static void onReceiveISR(int packetSize);
+#endif
+};
+
+#endif
+
+#endif
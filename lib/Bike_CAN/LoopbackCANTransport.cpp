@@ -0,0 +1,130 @@
+#include "LoopbackCANTransport.h"
+#include <Arduino.h>
+
+// =============================================================================
+// LOOPBACK BUS
+// =============================================================================
+
+LoopbackCANBus::LoopbackCANBus() : framesCarried(0), connected(true) {
+    for (uint8_t i = 0; i < CAN_LOOPBACK_MAX_NODES; i++) {
+        nodes[i] = nullptr;
+    }
+}
+
+bool LoopbackCANBus::attach(LoopbackCANTransport* node) {
+    std::lock_guard<std::mutex> guard(lock);
+    
+    for (uint8_t i = 0; i < CAN_LOOPBACK_MAX_NODES; i++) {
+        if (nodes[i] == node) return true;
+    }
+    for (uint8_t i = 0; i < CAN_LOOPBACK_MAX_NODES; i++) {
+        if (!nodes[i]) {
+            nodes[i] = node;
+            return true;
+        }
+    }
+    return false;
+}
+
+void LoopbackCANBus::detach(LoopbackCANTransport* node) {
+    std::lock_guard<std::mutex> guard(lock);
+    
+    for (uint8_t i = 0; i < CAN_LOOPBACK_MAX_NODES; i++) {
+        if (nodes[i] == node) nodes[i] = nullptr;
+    }
+}
+
+bool LoopbackCANBus::deliver(LoopbackCANTransport* sender, const CANFrame& frame) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (!connected) return false;
+    
+    framesCarried++;
+    for (uint8_t i = 0; i < CAN_LOOPBACK_MAX_NODES; i++) {
+        LoopbackCANTransport* node = nodes[i];
+        if (!node) continue;
+        if (node == sender && node->nodeRole != CAN_NODE_LOOPBACK) continue;
+        
+        node->rxRing.push(frame);  // Full queue counts an overflow on that node
+    }
+    return true;
+}
+
+void LoopbackCANBus::setConnected(bool isConnected) {
+    std::lock_guard<std::mutex> guard(lock);
+    connected = isConnected;
+}
+
+uint32_t LoopbackCANBus::getFramesCarried() {
+    std::lock_guard<std::mutex> guard(lock);
+    return framesCarried;
+}
+
+// =============================================================================
+// LOOPBACK TRANSPORT
+// =============================================================================
+
+LoopbackCANTransport::LoopbackCANTransport(LoopbackCANBus& loopbackBus) :
+    bus(loopbackBus),
+    nodeRole(CAN_NODE_LOOPBACK),
+    started(false) {
+}
+
+LoopbackCANTransport::~LoopbackCANTransport() {
+    end();
+}
+
+// No pins: the bus is the LoopbackCANBus given to the constructor
+bool LoopbackCANTransport::begin(int, int, CANNodeRole role) {
+    end();
+    
+    nodeRole = role;
+    rxRing.clear();
+    
+    started = bus.attach(this);
+    return started;
+}
+
+void LoopbackCANTransport::end() {
+    if (!started) return;
+    bus.detach(this);
+    started = false;
+}
+
+bool LoopbackCANTransport::transmit(uint32_t id, const uint8_t* data, uint8_t length) {
+    if (!started || length > 8) return false;
+    
+    CANFrame frame;
+    frame.id = id;
+    frame.timestampUs = micros();  // Bus is instantaneous: TX time is RX time
+    frame.dlc = length;
+    memcpy(frame.data, data, length);
+    
+    return bus.deliver(this, frame);
+}
+
+bool LoopbackCANTransport::receive(CANFrame& frame) {
+    return rxRing.pop(frame);
+}
+
+CANAlertCounters LoopbackCANTransport::getAlertCounters() {
+    CANAlertCounters alerts;
+    memset(&alerts, 0, sizeof(alerts));
+    alerts.rxOverruns = rxRing.getOverflows();
+    return alerts;
+}
+
+uint32_t LoopbackCANTransport::getRxPending() {
+    return rxRing.size();
+}
+
+uint32_t LoopbackCANTransport::getRxOverflows() {
+    return rxRing.getOverflows();
+}
+
+uint32_t LoopbackCANTransport::getRxCapacity() {
+    return CAN_LOOPBACK_RX_DEPTH;
+}
+
+const char* LoopbackCANTransport::getName() {
+    return "loopback";
+}
@@ -0,0 +1,65 @@
+#ifndef LOOPBACK_CAN_TRANSPORT_H
+#define LOOPBACK_CAN_TRANSPORT_H
+
+#include <mutex>
+#include "CANTransport.h"
+
+#define CAN_LOOPBACK_MAX_NODES  4     // Transports attached to one LoopbackCANBus
+#define CAN_LOOPBACK_RX_DEPTH   256   // Per-node receive queue (frames), power of two
+
+class LoopbackCANTransport;
+
+// In-memory bus. A frame sent by one node is queued on every other attached
+// node (and on the sender too when it runs as CAN_NODE_LOOPBACK). There is no
+// bit timing, so throughput is bounded only by the CPU; a node that does not
+// drain its queue loses frames and counts them as RX overflows.
+// setConnected(false) models an unplugged harness: every transmit fails, as
+// it would without an ACK. Safe to use from several threads.
+class LoopbackCANBus {
+public:
+    LoopbackCANBus();
+    
+    bool attach(LoopbackCANTransport* node);
+    void detach(LoopbackCANTransport* node);
+    bool deliver(LoopbackCANTransport* sender, const CANFrame& frame);
+    
+    void setConnected(bool connected);
+    uint32_t getFramesCarried();
+
+private:
+    std::mutex lock;
+    LoopbackCANTransport* nodes[CAN_LOOPBACK_MAX_NODES];
+    uint32_t framesCarried;
+    bool connected;
+};
+
+class LoopbackCANTransport : public CANTransport {
+public:
+    explicit LoopbackCANTransport(LoopbackCANBus& bus);
+    ~LoopbackCANTransport();
+    
+    bool begin(int txPin, int rxPin, CANNodeRole role) override;
+    void end() override;
+    
+    bool transmit(uint32_t id, const uint8_t* data, uint8_t length) override;
+    bool receive(CANFrame& frame) override;
+    
+    CANAlertCounters getAlertCounters() override;
+    
+    uint32_t getRxPending() override;
+    uint32_t getRxOverflows() override;
+    uint32_t getRxCapacity() override;
+    const char* getName() override;
+
+private:
+    friend class LoopbackCANBus;
+    
+    LoopbackCANBus& bus;
+    CANNodeRole nodeRole;
+    bool started;
+    
+    // Producers are serialised by the bus lock, so the SPSC ring is enough
+    CANFrameRing<CAN_LOOPBACK_RX_DEPTH> rxRing;
+};
+
+#endif
@@ -0,0 +1,169 @@
+#include "SocketCANTransport.h"
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include "BikeCANManager.h"
+
+#ifndef SO_RXQ_OVFL
+#define SO_RXQ_OVFL 40
+#endif
+
+SocketCANTransport::SocketCANTransport(const char* name, int rcvBufBytes) :
+    receiveBufferBytes(rcvBufBytes),
+    sock(-1) {
+    strncpy(interfaceName, name, sizeof(interfaceName) - 1);
+    interfaceName[sizeof(interfaceName) - 1] = '\0';
+    memset(&alerts, 0, sizeof(alerts));
+}
+
+SocketCANTransport::~SocketCANTransport() {
+    end();
+}
+
+// No pins: the interface is named in the constructor
+bool SocketCANTransport::begin(int, int, CANNodeRole role) {
+    end();
+    memset(&alerts, 0, sizeof(alerts));
+    
+    sock = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if (sock < 0) {
+        Serial.printf("❌ SocketCAN: socket() failed: %s\n", strerror(errno));
+        return false;
+    }
+    
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    snprintf(ifr.ifr_name, IFNAMSIZ, "%s", interfaceName);
+    if (ioctl(sock, SIOCGIFINDEX, &ifr) < 0) {
+        Serial.printf("❌ SocketCAN: no interface %s\n", interfaceName);
+        end();
+        return false;
+    }
+    
+    // Same acceptance as the ESP32 nodes, but exact: the kernel takes a list.
+    // EFF/RTR bits in the mask reject extended and remote frames.
+    const canid_t flagMask = CAN_EFF_FLAG | CAN_RTR_FLAG;
+    struct can_filter filters[6];
+    int filterCount = 0;
+    if (role == CAN_NODE_MAIN) {
+        filters[filterCount].can_id = MSG_ID_DISPLAY_CMD;
+        filters[filterCount].can_mask = flagMask | MSG_ID_DISPLAY_MASK;
+        filterCount++;
+    } else if (role == CAN_NODE_DISPLAY) {
+        for (canid_t block = MSG_ID_BIKE_STATUS; block < MSG_ID_DISPLAY_CMD; block += 0x100) {
+            filters[filterCount].can_id = block;
+            filters[filterCount].can_mask = flagMask | MSG_ID_DISPLAY_MASK;
+            filterCount++;
+        }
+    }
+    if (filterCount > 0) {
+        setsockopt(sock, SOL_CAN_RAW, CAN_RAW_FILTER, filters, filterCount * sizeof(struct can_filter));
+    }
+    
+    int enable = 1;
+    if (role == CAN_NODE_LOOPBACK) {
+        setsockopt(sock, SOL_CAN_RAW, CAN_RAW_RECV_OWN_MSGS, &enable, sizeof(enable));
+    }
+    setsockopt(sock, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable));
+    if (receiveBufferBytes > 0) {
+        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &receiveBufferBytes, sizeof(receiveBufferBytes));
+    }
+    
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+    
+    struct sockaddr_can addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = ifr.ifr_ifindex;
+    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        Serial.printf("❌ SocketCAN: bind to %s failed: %s\n", interfaceName, strerror(errno));
+        end();
+        return false;
+    }
+    
+    return true;
+}
+
+void SocketCANTransport::end() {
+    if (sock < 0) return;
+    close(sock);
+    sock = -1;
+}
+
+bool SocketCANTransport::transmit(uint32_t id, const uint8_t* data, uint8_t length) {
+    if (sock < 0 || length > 8) return false;
+    
+    struct can_frame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.can_id = (id & CAN_FRAME_EXT_FLAG) ? ((id & CAN_EFF_MASK) | CAN_EFF_FLAG) : (id & CAN_SFF_MASK);
+    frame.can_dlc = length;
+    memcpy(frame.data, data, length);
+    
+    if (write(sock, &frame, sizeof(frame)) != (ssize_t)sizeof(frame)) {
+        alerts.txFailures++;  // ENOBUFS: interface queue full
+        return false;
+    }
+    return true;
+}
+
+bool SocketCANTransport::receive(CANFrame& out) {
+    if (sock < 0) return false;
+    
+    struct can_frame frame;
+    struct iovec iov;
+    iov.iov_base = &frame;
+    iov.iov_len = sizeof(frame);
+    
+    char control[CMSG_SPACE(sizeof(uint32_t))];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    
+    if (recvmsg(sock, &msg, 0) != (ssize_t)sizeof(frame)) return false;
+    
+    for (struct cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SO_RXQ_OVFL) {
+            memcpy(&alerts.rxOverruns, CMSG_DATA(c), sizeof(uint32_t));  // Cumulative
+        }
+    }
+    
+    out.timestampUs = micros();
+    out.id = (frame.can_id & CAN_EFF_FLAG) ? ((frame.can_id & CAN_EFF_MASK) | CAN_FRAME_EXT_FLAG)
+                                           : (frame.can_id & CAN_SFF_MASK);
+    out.dlc = frame.can_dlc > 8 ? 8 : frame.can_dlc;
+    memcpy(out.data, frame.data, out.dlc);
+    
+    return true;
+}
+
+CANAlertCounters SocketCANTransport::getAlertCounters() {
+    return alerts;
+}
+
+uint32_t SocketCANTransport::getRxPending() {
+    return 0;
+}
+
+uint32_t SocketCANTransport::getRxOverflows() {
+    return alerts.rxOverruns;
+}
+
+uint32_t SocketCANTransport::getRxCapacity() {
+    return CAN_SOCKETCAN_DRAIN_MAX;
+}
+
+const char* SocketCANTransport::getName() {
+    return "SocketCAN";
+}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef SOCKET_CAN_TRANSPORT_H
+#define SOCKET_CAN_TRANSPORT_H
+
+#if defined(__linux__)
+
+#include "CANTransport.h"
+
+#define CAN_SOCKETCAN_DRAIN_MAX  256   // Frames update() reads per call
+
+// Linux SocketCAN raw socket (host builds). Works on real adapters (can0) and
+// on virtual buses:
+//
+//   sudo modprobe vcan
+//   sudo ip link add dev vcan0 type vcan && sudo ip link set up vcan0
+//
+// The role filter is installed as exact kernel CAN_RAW_FILTERs. RX overflows
+// are the kernel's per-socket drop count (SO_RXQ_OVFL).
+class SocketCANTransport : public CANTransport {
+public:
+    explicit SocketCANTransport(const char* interfaceName = "vcan0", int receiveBufferBytes = 0);
+    ~SocketCANTransport();
+    
+    bool begin(int txPin, int rxPin, CANNodeRole role) override;
+    void end() override;
+    
+    bool transmit(uint32_t id, const uint8_t* data, uint8_t length) override;
+    bool receive(CANFrame& frame) override;
+    
+    CANAlertCounters getAlertCounters() override;
+    
+    uint32_t getRxPending() override;     // Not reported by the kernel, always 0
+    uint32_t getRxOverflows() override;
+    uint32_t getRxCapacity() override;
+    const char* getName() override;
+
+private:
+    char interfaceName[16];
+    int receiveBufferBytes;    // SO_RCVBUF override, 0 = kernel default
+    int sock;
+    CANAlertCounters alerts;
+};
+
+#endif
+
+#endif
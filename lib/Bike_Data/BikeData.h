@@ -2,6 +2,7 @@
 #define BIKE_DATA_H
 
 #include <Arduino.h>
+#include <type_traits>
 
 // ================================================
 // BIKE DATA STRUCTURE for MAIN
@@ -25,6 +26,19 @@ enum SystemEvent {
     EVENT_EMERGENCY_STOP
 };
 
+// Power profiles (BikePowerManager, chosen by systemTask): task rates, poll
+// rates, CAN schedule and CPU clock for what the bike is doing
+enum BikePowerProfile {
+    POWER_RIDING = 0,       // Unlocked and moving
+    POWER_PARKED = 1,       // Unlocked, standing still
+    POWER_LOCKED = 2,
+    POWER_CHARGING = 3,     // Standing still, charge current into the packs
+    POWER_PROFILE_COUNT = 4
+};
+
+#define BMS_MAX_CELLS       24     // JK-BMS reports up to 24 cells
+#define BMS_INFO_MAX_LEN    24     // Version/device strings sent to the display (incl. terminator)
+
 // Sensor Data Structures
 struct BMSData {
     // Basic measurements
@@ -44,6 +58,7 @@ struct BMSData {
     float lowestCellVolt;      // Lowest cell voltage (V)
     float highestCellVolt;     // Highest cell voltage (V)
     uint16_t cellVoltageDelta; // Cell voltage difference (mV)
+    uint16_t cellVoltagesMv[BMS_MAX_CELLS];  // Per-cell voltage (mV), numCells valid
     
     // Status flags
     uint16_t alarmStatus;      // Alarm status bits
@@ -53,9 +68,21 @@ struct BMSData {
     bool chargingEnabled;      // Charging MOS enabled
     bool dischargingEnabled;   // Discharging MOS enabled
     
-    // Info
-    String softwareVersion;    // BMS software version
-    String deviceInfo;         // Device information
+    // Sample stamp (latency tracing): set on every successful read
+    uint8_t sampleSeq;         // Rolling 1-255, 0 = never read
+    uint32_t sampleUs;         // micros() at capture
+};
+
+// Pack identity strings. They change about never, so they live in their own
+// record (BikeIdentity) instead of BMSData, which is copied on every sample.
+struct BMSInfo {
+    char softwareVersion[BMS_INFO_MAX_LEN];   // BMS software version, NUL-terminated
+    char deviceInfo[BMS_INFO_MAX_LEN];        // Device information, NUL-terminated
+};
+
+struct BikeIdentity {
+    BMSInfo bms1;
+    BMSInfo bms2;
 };
 
 struct VESCData {
@@ -67,6 +94,8 @@ struct VESCData {
     float tempFET;
     float tempMotor;
     bool connected;
+    uint8_t sampleSeq;      // Rolling 1-255, 0 = never read
+    uint32_t sampleUs;      // micros() at capture
 };
 
 struct BikeStatus {
@@ -77,6 +106,8 @@ struct BikeStatus {
     bool keyOn;
     float hallFrequency;    // Raw Hall sensor frequency (Hz)
     float bikeSpeed;        // Calculated bike speed (km/h)
+    uint8_t sampleSeq;      // GPIO/Hall sample: rolling 1-255, 0 = never read
+    uint32_t sampleUs;      // micros() at capture
     BMSData bms1;
     BMSData bms2;
     VESCData vesc;
@@ -89,8 +120,17 @@ struct SharedBikeData {
     bool bikeUnlocked;
     bool bleConnected;
     BikeOperationState currentState;
+    BikeIdentity identity;
+    BikePowerProfile powerProfile;
 };
 
+// Copied on every sample, snapshot read and received frame: no String or
+// other owning members, so a copy is a plain memcpy and never allocates
+static_assert(std::is_trivially_copyable<BMSData>::value, "BMSData must stay trivially copyable");
+static_assert(std::is_trivially_copyable<VESCData>::value, "VESCData must stay trivially copyable");
+static_assert(std::is_trivially_copyable<BikeStatus>::value, "BikeStatus must stay trivially copyable");
+static_assert(std::is_trivially_copyable<SharedBikeData>::value, "SharedBikeData must stay trivially copyable");
+
 
 // ================================================
 // BIKE DATA STRUCTURE for DISPLAY
@@ -127,6 +167,16 @@ struct BikeDataDisplay {
   float battery2Current = 0;  // Dòng điện battery 2 (A)
   uint16_t battery2DiffVolt = 0; // Chênh lệch điện áp battery 2 (mV)
 
+  // Per-cell detail (ISO-TP transfers, slower than the frames above)
+  uint8_t battery1CellCount = 0;
+  uint16_t battery1CellMv[BMS_MAX_CELLS] = {};
+  uint8_t battery2CellCount = 0;
+  uint16_t battery2CellMv[BMS_MAX_CELLS] = {};
+  char battery1Version[BMS_INFO_MAX_LEN] = "";
+  char battery1Device[BMS_INFO_MAX_LEN] = "";
+  char battery2Version[BMS_INFO_MAX_LEN] = "";
+  char battery2Device[BMS_INFO_MAX_LEN] = "";
+
   // Distance data
   float odometer = 0;
   float distance = 0;
@@ -0,0 +1,263 @@
+#ifndef BIKE_DATA_BUS_H
+#define BIKE_DATA_BUS_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+#include "BikeData.h"
+#include "SnapshotBuffer.h"
+
+// Topic-based publish/subscribe between the main board tasks. Every piece of
+// shared state is a topic with a single writer task. A subscriber follows a
+// set of topics and gets a task notification, one bit per topic, only when
+// one of them changes; it then copies just those topics.
+//
+//   writer      bus.pack1.publish(value)    version + 1, change time, notify
+//   subscriber  bus.subscribe(topics)       once, from the subscribing task
+//               bits = bus.waitEvents(timeout)
+//               bus.readTopics(bits, copy)  only the topics that changed
+//   reader      bus.readNew(cursor, copy)   tasks running on their own
+//                                           schedule: topics whose version
+//                                           moved since the last call
+//
+// Topics are SnapshotBuffers, so neither side ever waits for the other.
+// Topic notifications use the low TOPIC_COUNT bits of the task notification
+// value. Bits from BUS_TASK_EVENT_FIRST up are free for a task's own wakeups
+// (interrupts, driver callbacks, queue posts); waitEvents() returns those too.
+
+enum BikeTopic {
+    TOPIC_PACK1 = 0,      // BMSData, on every read or connection change
+    TOPIC_PACK2 = 1,
+    TOPIC_VESC = 2,       // VESCData, on every read or connection change
+    TOPIC_GPIO = 3,       // BusGPIOData, when an input changes
+    TOPIC_HALL = 4,       // BusHallData, when the frequency changes
+    TOPIC_LOCK = 5,       // bool, bike unlocked (rfidTask)
+    TOPIC_BLE = 6,        // bool, BLE connected (bleTask)
+    TOPIC_STATE = 7,      // BikeOperationState (systemTask)
+    TOPIC_IDENTITY = 8,   // BikeIdentity, when a BMS string changes
+    TOPIC_PROFILE = 9,    // BikePowerProfile (systemTask)
+    TOPIC_COUNT = 10
+};
+
+#define TOPIC_BIT(topic)      (1UL << (topic))
+#define TOPIC_ALL             (TOPIC_BIT(TOPIC_COUNT) - 1)
+#define TOPIC_SENSORS         (TOPIC_BIT(TOPIC_PACK1) | TOPIC_BIT(TOPIC_PACK2) | TOPIC_BIT(TOPIC_VESC) | \
+                               TOPIC_BIT(TOPIC_GPIO) | TOPIC_BIT(TOPIC_HALL) | TOPIC_BIT(TOPIC_IDENTITY))
+
+#define BUS_TASK_EVENT_FIRST  16                         // Notification bits 16-31: the task's own events
+#define BUS_TASK_EVENT(n)     (1UL << (BUS_TASK_EVENT_FIRST + (n)))
+
+#define BUS_MAX_SUBSCRIBERS   4                          // Tasks woken on topic changes: system, BLE, sensor, safety
+#define BUS_MAX_READERS       4                          // Tasks reading one topic, at most: pack1 and lock have
+                                                         // system, CAN, logging and safety
+#define BUS_SNAPSHOT_SLOTS    (BUS_MAX_READERS + 2)
+
+static_assert(TOPIC_COUNT <= BUS_TASK_EVENT_FIRST, "Topic bits overlap the task event bits");
+
+// Topic versions a reader has copied (readNew())
+struct BusCursor {
+    uint32_t versions[TOPIC_COUNT];
+};
+
+// Digital inputs, published by sensorTask (BikeStatus fields of the same name)
+struct BusGPIOData {
+    BikeOperationState operationState;
+    bool brakePressed;
+    bool leftSignal;
+    bool rightSignal;
+    bool keyOn;
+    uint8_t sampleSeq;      // Sample stamp of the GPIO/Hall read
+    uint32_t sampleUs;
+};
+
+struct BusHallData {
+    float hallFrequency;    // Hz
+    float bikeSpeed;        // km/h
+    uint8_t sampleSeq;      // Sample stamp of the GPIO/Hall read
+    uint32_t sampleUs;
+};
+
+class BikeDataBus;
+
+// Version and change time of a topic, independent of its type
+class BusTopicBase {
+public:
+    uint32_t getVersion() const { return version.load(std::memory_order_relaxed); }     // Publishes so far
+    uint32_t getChangedMs() const { return changedMs.load(std::memory_order_relaxed); } // millis() of the last one
+    virtual uint32_t getReadRetries() const = 0;
+
+protected:
+    BusTopicBase(BikeDataBus* bus, BikeTopic id);
+    void published();
+
+private:
+    BikeDataBus* bus;
+    BikeTopic id;
+    std::atomic<uint32_t> version;
+    std::atomic<uint32_t> changedMs;
+};
+
+template <typename T>
+class BusTopic : public BusTopicBase {
+public:
+    BusTopic(BikeDataBus* bus, BikeTopic id) : BusTopicBase(bus, id) {}
+    
+    // The topic's writer task only
+    void publish(const T& value) {
+        buffer.publish(value);
+        published();
+    }
+    
+    void read(T& out) { buffer.read(out); }
+    uint32_t getReadRetries() const { return buffer.getReadRetries(); }
+
+private:
+    SnapshotBuffer<T, BUS_SNAPSHOT_SLOTS> buffer;
+};
+
+class BikeDataBus {
+public:
+    BikeDataBus()
+        : pack1(this, TOPIC_PACK1), pack2(this, TOPIC_PACK2), vesc(this, TOPIC_VESC),
+          gpio(this, TOPIC_GPIO), hall(this, TOPIC_HALL), lock(this, TOPIC_LOCK),
+          ble(this, TOPIC_BLE), state(this, TOPIC_STATE), identity(this, TOPIC_IDENTITY),
+          profile(this, TOPIC_PROFILE), nextSubscriber(0), notifications(0) {
+        for (uint8_t i = 0; i < BUS_MAX_SUBSCRIBERS; i++) {
+            subscribers[i].task = NULL;
+            subscribers[i].topics.store(0);
+        }
+    }
+    
+    // Index first: the topics register themselves in it
+    BusTopicBase* topics[TOPIC_COUNT];
+    
+    BusTopic<BMSData> pack1;
+    BusTopic<BMSData> pack2;
+    BusTopic<VESCData> vesc;
+    BusTopic<BusGPIOData> gpio;
+    BusTopic<BusHallData> hall;
+    BusTopic<bool> lock;
+    BusTopic<bool> ble;
+    BusTopic<BikeOperationState> state;
+    BusTopic<BikeIdentity> identity;
+    BusTopic<BikePowerProfile> profile;
+    
+    // Follow topics (TOPIC_BIT mask) from the calling task. False when all
+    // BUS_MAX_SUBSCRIBERS slots are taken.
+    bool subscribe(uint32_t topicMask) {
+        uint32_t slot = nextSubscriber.fetch_add(1);
+        if (slot >= BUS_MAX_SUBSCRIBERS) return false;
+        subscribers[slot].task = xTaskGetCurrentTaskHandle();
+        subscribers[slot].topics.store(topicMask);
+        return true;
+    }
+    
+    // Changed topics (TOPIC_BIT) and task events (BUS_TASK_EVENT) notified
+    // since the last call, 0 after timeout. Works for any task, subscribed or not.
+    uint32_t waitEvents(TickType_t timeout) {
+        uint32_t bits = 0;
+        if (xTaskNotifyWait(0, 0xFFFFFFFFUL, &bits, timeout) != pdTRUE) return 0;
+        return bits;
+    }
+    
+    // Copy the topics published since this cursor last saw them; returns their mask.
+    // A zeroed cursor gets every topic that was published at least once.
+    uint32_t readNew(BusCursor& cursor, SharedBikeData& out) {
+        uint32_t changed = 0;
+        for (uint8_t i = 0; i < TOPIC_COUNT; i++) {
+            uint32_t version = topics[i]->getVersion();
+            if (version == cursor.versions[i]) continue;
+            cursor.versions[i] = version;
+            changed |= TOPIC_BIT(i);
+        }
+        if (changed) readTopics(changed, out);
+        return changed;
+    }
+    
+    // Copy the given topics into a SharedBikeData, leave the rest as it is.
+    // Bits other than topics are ignored.
+    void readTopics(uint32_t topicMask, SharedBikeData& out) {
+        BikeStatus& sensors = out.sensorData;
+        if (topicMask & TOPIC_BIT(TOPIC_PACK1)) pack1.read(sensors.bms1);
+        if (topicMask & TOPIC_BIT(TOPIC_PACK2)) pack2.read(sensors.bms2);
+        if (topicMask & TOPIC_BIT(TOPIC_VESC)) vesc.read(sensors.vesc);
+        if (topicMask & TOPIC_BIT(TOPIC_GPIO)) {
+            BusGPIOData inputs;
+            gpio.read(inputs);
+            sensors.operationState = inputs.operationState;
+            sensors.brakePressed = inputs.brakePressed;
+            sensors.leftSignal = inputs.leftSignal;
+            sensors.rightSignal = inputs.rightSignal;
+            sensors.keyOn = inputs.keyOn;
+            takeStamp(sensors, inputs.sampleSeq, inputs.sampleUs);
+        }
+        if (topicMask & TOPIC_BIT(TOPIC_HALL)) {
+            BusHallData wheel;
+            hall.read(wheel);
+            sensors.hallFrequency = wheel.hallFrequency;
+            sensors.bikeSpeed = wheel.bikeSpeed;
+            takeStamp(sensors, wheel.sampleSeq, wheel.sampleUs);
+        }
+        if (topicMask & TOPIC_BIT(TOPIC_LOCK)) lock.read(out.bikeUnlocked);
+        if (topicMask & TOPIC_BIT(TOPIC_BLE)) ble.read(out.bleConnected);
+        if (topicMask & TOPIC_BIT(TOPIC_STATE)) state.read(out.currentState);
+        if (topicMask & TOPIC_BIT(TOPIC_IDENTITY)) identity.read(out.identity);
+        if (topicMask & TOPIC_BIT(TOPIC_PROFILE)) profile.read(out.powerProfile);
+    }
+    
+    // Called by BusTopic::publish(): notify the tasks following the topic
+    void notify(BikeTopic topic) {
+        uint32_t bit = TOPIC_BIT(topic);
+        for (uint8_t i = 0; i < BUS_MAX_SUBSCRIBERS; i++) {
+            if (!(subscribers[i].topics.load() & bit)) continue;
+            xTaskNotify(subscribers[i].task, bit, eSetBits);
+            notifications.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    
+    uint8_t getSubscriberCount(BikeTopic topic) const {
+        uint8_t count = 0;
+        for (uint8_t i = 0; i < BUS_MAX_SUBSCRIBERS; i++) {
+            if (subscribers[i].topics.load() & TOPIC_BIT(topic)) count++;
+        }
+        return count;
+    }
+    
+    uint32_t getNotifications() const { return notifications.load(std::memory_order_relaxed); }
+    
+    static const char* topicName(uint8_t topic) {
+        static const char* names[TOPIC_COUNT] = { "pack1", "pack2", "vesc", "gpio", "hall", "lock", "ble", "state", "ident",
+                                                  "power" };
+        return topic < TOPIC_COUNT ? names[topic] : "?";
+    }
+
+private:
+    // GPIO and Hall share the BikeStatus stamp: keep the newer one
+    static void takeStamp(BikeStatus& sensors, uint8_t sampleSeq, uint32_t sampleUs) {
+        if (sensors.sampleSeq != 0 && (int32_t)(sampleUs - sensors.sampleUs) < 0) return;
+        sensors.sampleSeq = sampleSeq;
+        sensors.sampleUs = sampleUs;
+    }
+    
+    struct Subscriber {
+        TaskHandle_t task;
+        std::atomic<uint32_t> topics;   // Stored after task: non-zero means the slot is ready
+    };
+    
+    Subscriber subscribers[BUS_MAX_SUBSCRIBERS];
+    std::atomic<uint32_t> nextSubscriber;
+    std::atomic<uint32_t> notifications;
+};
+
+inline BusTopicBase::BusTopicBase(BikeDataBus* bus, BikeTopic id) : bus(bus), id(id), version(0), changedMs(0) {
+    bus->topics[id] = this;
+}
+
+inline void BusTopicBase::published() {
+    changedMs.store(millis(), std::memory_order_relaxed);
+    version.fetch_add(1, std::memory_order_relaxed);
+    bus->notify(id);
+}
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef SNAPSHOT_BUFFER_H
+#define SNAPSHOT_BUFFER_H
+
+#include <stdint.h>
+#include <atomic>
+
+// Latest-value buffer between one writer task and several reader tasks,
+// without a mutex. The writer fills a slot nobody is reading and publishes
+// its index; a reader pins the published slot, checks it is still the
+// published one and copies it out.
+//
+//   publish()  writer only, never waits while at most SLOTS - 2 readers
+//              are inside read() at the same time
+//   read()     any task, never waits for the writer: it only goes round
+//              again if a new version was published between picking the
+//              slot and pinning it (counted in getReadRetries())
+//
+// Works for any copyable T, including types that own memory: a slot is
+// never written while a reader has it pinned.
+template <typename T, uint8_t SLOTS>
+class SnapshotBuffer {
+public:
+    SnapshotBuffer() : latest(0), published(0), readRetries(0) {
+        static_assert(SLOTS >= 3, "SnapshotBuffer needs SLOTS >= readers + 2");
+        for (uint8_t i = 0; i < SLOTS; i++) readers[i].store(0);
+    }
+    
+    void publish(const T& value) {
+        uint32_t slot = freeSlot();
+        slots[slot] = value;
+        latest.store(slot);
+        published.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    void read(T& out) {
+        while (true) {
+            uint32_t slot = latest.load();
+            readers[slot].fetch_add(1);
+            
+            // Still published after pinning: the writer will not pick it until we let go
+            if (latest.load() == slot) {
+                out = slots[slot];
+                readers[slot].fetch_sub(1);
+                return;
+            }
+            
+            readers[slot].fetch_sub(1);
+            readRetries.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    
+    uint32_t getPublished() const { return published.load(std::memory_order_relaxed); }
+    uint32_t getReadRetries() const { return readRetries.load(std::memory_order_relaxed); }
+
+private:
+    // Neither the published slot nor a pinned one. Only spins if more than
+    // SLOTS - 2 readers hold a slot at once.
+    uint32_t freeSlot() {
+        uint32_t current = latest.load(std::memory_order_relaxed);
+        while (true) {
+            for (uint32_t i = 0; i < SLOTS; i++) {
+                if (i != current && readers[i].load() == 0) return i;
+            }
+        }
+    }
+    
+    T slots[SLOTS];
+    std::atomic<uint32_t> readers[SLOTS];
+    std::atomic<uint32_t> latest;
+    std::atomic<uint32_t> published;
+    std::atomic<uint32_t> readRetries;
+};
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef SYSTEM_EVENT_QUEUE_H
+#define SYSTEM_EVENT_QUEUE_H
+
+#include <Arduino.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <atomic>
+#include "BikeData.h"
+
+// Events for systemTask that carry what happened with them: the card that
+// was read, the phone that connected, the rule that tripped. systemTask acts
+// on the message alone, it does not go back to the task that posted it.
+//
+//   post(lane, event)   any task, never waits: false if there is no room
+//                       (counted per lane as an overflow)
+//   receive(event)      systemTask only, never waits: the safety lane first
+//
+// Messages live in a fixed pool; each lane is a static FreeRTOS queue of pool
+// indexes, as long as the pool, so a post that got a slot always gets into
+// its lane. The informational lane may not take the last EVENT_SAFETY_RESERVED
+// slots: a burst of card reads and connection changes leaves room for a stop,
+// and a stop waiting behind them is handled first. Nothing is allocated.
+
+#define EVENT_POOL_SIZE         12
+#define EVENT_SAFETY_RESERVED   4      // Pool slots only the safety lane may take
+#define EVENT_CARD_UID_MAX      10     // MFRC522 UIDs: 4, 7 or 10 bytes
+#define EVENT_PEER_ADDRESS_LEN  6      // BLE address, as BLEAddress::getNative()
+
+static_assert(EVENT_POOL_SIZE <= 32, "One free-mask bit per pool slot");
+static_assert(EVENT_SAFETY_RESERVED < EVENT_POOL_SIZE, "The informational lane needs slots too");
+
+enum SystemEventLane {
+    EVENT_LANE_SAFETY = 0,    // Emergency stop
+    EVENT_LANE_INFO = 1,      // Cards, BLE connections
+    EVENT_LANE_COUNT = 2
+};
+
+struct SystemEventMessage {
+    SystemEvent type;
+    uint32_t atUs;                          // micros() when it happened
+    union {
+        struct {                            // EVENT_RFID_CARD_DETECTED
+            uint8_t uid[EVENT_CARD_UID_MAX];
+            uint8_t length;
+            bool authorized;
+        } card;
+        struct {                            // EVENT_BLE_CONNECTED, EVENT_BLE_DISCONNECTED
+            uint8_t address[EVENT_PEER_ADDRESS_LEN];
+        } peer;
+        struct {                            // EVENT_EMERGENCY_STOP
+            uint8_t rule;                   // SafetyRule
+            uint8_t pack;                   // 1 or 2 for the pack rules, 0 otherwise
+            uint8_t actions;                // SAFETY_ACTION_* asked for
+            float value;                    // What the rule saw
+        } fault;
+    } payload;
+};
+
+// A message of the given type, stamped now, payload zeroed
+inline SystemEventMessage systemEvent(SystemEvent type) {
+    SystemEventMessage event;
+    memset(&event, 0, sizeof(event));
+    event.type = type;
+    event.atUs = micros();
+    return event;
+}
+
+struct EventLaneStats {
+    uint32_t posted;
+    uint32_t overflows;                     // Posts refused: no pool slot for the lane
+    uint8_t depth;                          // Waiting now
+    uint8_t maxDepth;
+};
+
+struct EventQueueStats {
+    EventLaneStats lanes[EVENT_LANE_COUNT];
+    uint8_t poolUsed;
+    uint8_t poolMaxUsed;
+};
+
+class SystemEventQueue {
+public:
+    SystemEventQueue() : freeSlots(ALL_SLOTS), poolMaxUsed(0) {
+        for (uint8_t i = 0; i < EVENT_LANE_COUNT; i++) {
+            lanes[i] = NULL;
+            posted[i].store(0);
+            overflows[i].store(0);
+            maxDepth[i] = 0;
+        }
+    }
+    
+    // setup(), before any task posts
+    bool begin() {
+        for (uint8_t i = 0; i < EVENT_LANE_COUNT; i++) {
+            lanes[i] = xQueueCreateStatic(EVENT_POOL_SIZE, sizeof(uint8_t), laneStorage[i], &laneBuffers[i]);
+            if (lanes[i] == NULL) return false;
+        }
+        return true;
+    }
+    
+    bool post(SystemEventLane lane, const SystemEventMessage& event) {
+        int8_t slot = claim(lane);
+        if (slot < 0) {
+            overflows[lane].fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        pool[slot] = event;
+        
+        uint8_t index = slot;
+        xQueueSend(lanes[lane], &index, 0);     // Never full: one entry per pool slot
+        posted[lane].fetch_add(1, std::memory_order_relaxed);
+        
+        // Statistics only: a racing post may leave a peak a little low
+        uint8_t depth = uxQueueMessagesWaiting(lanes[lane]);
+        if (depth > maxDepth[lane]) maxDepth[lane] = depth;
+        uint8_t used = EVENT_POOL_SIZE - __builtin_popcount(freeSlots.load());
+        if (used > poolMaxUsed) poolMaxUsed = used;
+        return true;
+    }
+    
+    bool receive(SystemEventMessage& event) {
+        uint8_t index;
+        for (uint8_t lane = 0; lane < EVENT_LANE_COUNT; lane++) {
+            if (xQueueReceive(lanes[lane], &index, 0) != pdTRUE) continue;
+            event = pool[index];
+            freeSlots.fetch_or(1UL << index);
+            return true;
+        }
+        return false;
+    }
+    
+    void getStats(EventQueueStats& stats) const {
+        for (uint8_t i = 0; i < EVENT_LANE_COUNT; i++) {
+            stats.lanes[i].posted = posted[i].load(std::memory_order_relaxed);
+            stats.lanes[i].overflows = overflows[i].load(std::memory_order_relaxed);
+            stats.lanes[i].depth = lanes[i] ? uxQueueMessagesWaiting(lanes[i]) : 0;
+            stats.lanes[i].maxDepth = maxDepth[i];
+        }
+        stats.poolUsed = EVENT_POOL_SIZE - __builtin_popcount(freeSlots.load());
+        stats.poolMaxUsed = poolMaxUsed;
+    }
+    
+    static const char* laneName(uint8_t lane) {
+        static const char* names[EVENT_LANE_COUNT] = { "safety", "info" };
+        return lane < EVENT_LANE_COUNT ? names[lane] : "?";
+    }
+
+private:
+    static const uint32_t ALL_SLOTS = (1UL << EVENT_POOL_SIZE) - 1;
+    
+    SystemEventMessage pool[EVENT_POOL_SIZE];
+    std::atomic<uint32_t> freeSlots;        // Bit per pool slot
+    QueueHandle_t lanes[EVENT_LANE_COUNT];
+    StaticQueue_t laneBuffers[EVENT_LANE_COUNT];
+    uint8_t laneStorage[EVENT_LANE_COUNT][EVENT_POOL_SIZE];
+    std::atomic<uint32_t> posted[EVENT_LANE_COUNT];
+    std::atomic<uint32_t> overflows[EVENT_LANE_COUNT];
+    volatile uint8_t maxDepth[EVENT_LANE_COUNT];
+    volatile uint8_t poolMaxUsed;
+    
+    // A free pool slot the lane may take, -1 if none
+    int8_t claim(SystemEventLane lane) {
+        uint32_t free = freeSlots.load();
+        while (true) {
+            uint8_t used = EVENT_POOL_SIZE - __builtin_popcount(free);
+            if (free == 0) return -1;
+            if (lane != EVENT_LANE_SAFETY && used >= EVENT_POOL_SIZE - EVENT_SAFETY_RESERVED) return -1;
+            uint8_t slot = __builtin_ctz(free);
+            if (freeSlots.compare_exchange_weak(free, free & ~(1UL << slot))) return slot;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,203 @@
+#include "BikeLog.h"
+#include <stdio.h>
+
+BikeLog bikeLog;
+
+BikeLog::BikeLog() :
+    writePosition(0),
+    readPosition(0),
+    dropped(0),
+    droppedReported(0),
+    binaryOutput(false) {
+    for (uint32_t i = 0; i < BIKE_LOG_CAPACITY; i++) slots[i].sequence.store(i);
+}
+
+uint32_t BikeLog::drain(uint32_t maxRecords) {
+    uint32_t printed = 0;
+    
+    while (printed < maxRecords) {
+        Slot& slot = slots[readPosition & (BIKE_LOG_CAPACITY - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != readPosition + 1) break;  // Empty, or still being written
+        
+        printRecord(slot.record);
+        slot.sequence.store(readPosition + BIKE_LOG_CAPACITY, std::memory_order_release);  // Free for the next lap
+        readPosition++;
+        printed++;
+    }
+    
+    uint32_t lost = dropped.load(std::memory_order_relaxed);
+    if (lost != droppedReported) {
+        Serial.printf("[LOG] %lu records dropped, ring full\n", (unsigned long)(lost - droppedReported));
+        droppedReported = lost;
+    }
+    return printed;
+}
+
+void BikeLog::setBinaryOutput(bool binary) {
+    binaryOutput = binary;
+}
+
+bool BikeLog::isBinaryOutput() const {
+    return binaryOutput;
+}
+
+uint32_t BikeLog::getWritten() const {
+    return writePosition.load(std::memory_order_relaxed);
+}
+
+uint32_t BikeLog::getDropped() const {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+void BikeLog::printRecord(const BikeLogRecord& record) {
+    char line[BIKE_LOG_LINE_MAX];
+    int n;
+    
+    if (binaryOutput) {
+        n = snprintf(line, sizeof(line), "~L %08lX %08lX %u %u ",
+                     (unsigned long)record.timeUs, (unsigned long)bikeLogHash(record.format),
+                     record.level, record.flags);
+        for (uint8_t i = 0; i < record.length; i++) n += snprintf(line + n, sizeof(line) - n, "%02X", record.payload[i]);
+        if (record.length == 0) snprintf(line + n, sizeof(line) - n, "-");
+    } else {
+        n = snprintf(line, sizeof(line), "[%4lu.%06lu] %c ",
+                     (unsigned long)(record.timeUs / 1000000), (unsigned long)(record.timeUs % 1000000),
+                     bikeLogLevelLetter(record.level));
+        bikeLogFormat(line + n, sizeof(line) - n, record.format, record.payload, record.length,
+                      (record.flags & BIKE_LOG_TRUNCATED) != 0);
+    }
+    Serial.println(line);
+}
+
+// =============================================================================
+// FORMATTING (drain() in text mode, host_log_decode)
+// =============================================================================
+
+uint32_t bikeLogHash(const char* format) {
+    uint32_t hash = 2166136261UL;
+    while (*format) {
+        hash ^= (uint8_t)*format++;
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+char bikeLogLevelLetter(uint8_t level) {
+    static const char letters[] = "-EWID";
+    return level <= BIKE_LOG_LEVEL_DEBUG ? letters[level] : '?';
+}
+
+// Takes size bytes of payload, false once it runs out
+static bool takeArgument(const uint8_t* payload, uint8_t length, uint8_t& offset, void* out, uint8_t size) {
+    if (offset + size > length) return false;
+    memcpy(out, payload + offset, size);
+    offset += size;
+    return true;
+}
+
+int bikeLogFormat(char* out, size_t outSize, const char* format,
+                  const uint8_t* payload, uint8_t length, bool truncated) {
+    if (outSize == 0) return 0;
+    size_t n = 0;
+    uint8_t offset = 0;
+    bool complete = true;
+    const char* p = format;
+    
+    while (*p && n + 1 < outSize) {
+        if (*p != '%') {
+            out[n++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            out[n++] = '%';
+            p += 2;
+            continue;
+        }
+        
+        // %[flags][width][.precision][length]conversion; the length modifier
+        // is replaced by the one matching how the argument was stored
+        char spec[24];
+        size_t specLength = 0;
+        spec[specLength++] = *p++;
+        while (*p && strchr("-+ #0123456789.", *p) && specLength < 16) spec[specLength++] = *p++;
+        uint8_t longs = 0;
+        while (*p && strchr("hlLqjzt", *p)) {
+            if (*p == 'l' || *p == 'q') longs++;
+            p++;
+        }
+        char conversion = *p;
+        if (!conversion) break;
+        p++;
+        
+        char piece[BIKE_LOG_LINE_MAX];
+        piece[0] = '\0';
+        spec[specLength] = '\0';
+        
+        if (strchr("di", conversion)) {
+            long long value;
+            if (longs >= 2) {
+                int64_t wide;
+                complete = takeArgument(payload, length, offset, &wide, 8);
+                value = wide;
+            } else {
+                int32_t word;
+                complete = takeArgument(payload, length, offset, &word, 4);
+                value = word;
+            }
+            if (!complete) break;
+            strcat(spec, "lld");
+            snprintf(piece, sizeof(piece), spec, value);
+        } else if (strchr("uxXoc", conversion)) {
+            unsigned long long value;
+            if (longs >= 2) {
+                uint64_t wide;
+                complete = takeArgument(payload, length, offset, &wide, 8);
+                value = wide;
+            } else {
+                uint32_t word;
+                complete = takeArgument(payload, length, offset, &word, 4);
+                value = word;
+            }
+            if (!complete) break;
+            if (conversion == 'c') {
+                strcat(spec, "c");
+                snprintf(piece, sizeof(piece), spec, (int)value);
+            } else {
+                char tail[4] = { 'l', 'l', conversion, '\0' };
+                strcat(spec, tail);
+                snprintf(piece, sizeof(piece), spec, value);
+            }
+        } else if (strchr("fFeEgGaA", conversion)) {
+            float value;
+            complete = takeArgument(payload, length, offset, &value, 4);
+            if (!complete) break;
+            char tail[2] = { conversion, '\0' };
+            strcat(spec, tail);
+            snprintf(piece, sizeof(piece), spec, (double)value);
+        } else if (conversion == 's') {
+            uint8_t size;
+            char text[BIKE_LOG_PAYLOAD + 1];
+            complete = takeArgument(payload, length, offset, &size, 1) &&
+                       size <= BIKE_LOG_PAYLOAD && takeArgument(payload, length, offset, text, size);
+            if (!complete) break;
+            text[size] = '\0';
+            strcat(spec, "s");
+            snprintf(piece, sizeof(piece), spec, text);
+        } else if (conversion == 'p') {
+            uint32_t address;
+            complete = takeArgument(payload, length, offset, &address, 4);
+            if (!complete) break;
+            snprintf(piece, sizeof(piece), "0x%08lx", (unsigned long)address);
+        } else {
+            snprintf(piece, sizeof(piece), "%s%c", spec, conversion);  // Unknown: print it as written
+        }
+        
+        for (const char* c = piece; *c && n + 1 < outSize; c++) out[n++] = *c;
+    }
+    
+    if (truncated || !complete) {
+        for (const char* c = "..."; *c && n + 1 < outSize; c++) out[n++] = *c;
+    }
+    out[n] = '\0';
+    return (int)n;
+}
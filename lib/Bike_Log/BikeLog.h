@@ -0,0 +1,253 @@
+#ifndef BIKE_LOG_H
+#define BIKE_LOG_H
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+// Deferred binary logging. A log call stores the format string's address,
+// a timestamp and the raw arguments in a RAM ring and returns; no text is
+// formatted and nothing waits for the UART. A low-priority task calls
+// drain(), which prints the records either as text or as compact "~L"
+// lines for the host decoder (host_log_decode):
+//
+//   BIKE_LOGI("[CAN] BMS1: %.2fV, %d%%", volt, percent);
+//
+//   text    [  12.345678] I [CAN] BMS1: 52.10V, 87%
+//   binary  ~L 00BC614E 5A1F03C2 3 0 CDCC5042 57000000
+//           time us, FNV-1a hash of the format string, level, flags, arguments
+//
+// Arguments are stored as the format expects them: integers as 4 bytes
+// (8 for %ll), floating point as a 4-byte float, strings copied with a
+// length byte. Whatever does not fit BIKE_LOG_PAYLOAD bytes is cut and
+// the line ends in "...". Width/precision given as '*' is not supported.
+//
+// Levels above BIKE_LOG_LEVEL compile to nothing, arguments included.
+// The ring is lock-free for any number of writers and one drain: a full
+// ring drops the new record and counts it, it never blocks the caller.
+
+#define BIKE_LOG_LEVEL_NONE   0
+#define BIKE_LOG_LEVEL_ERROR  1
+#define BIKE_LOG_LEVEL_WARN   2
+#define BIKE_LOG_LEVEL_INFO   3
+#define BIKE_LOG_LEVEL_DEBUG  4
+
+#ifndef BIKE_LOG_LEVEL
+#define BIKE_LOG_LEVEL        BIKE_LOG_LEVEL_INFO
+#endif
+
+#ifndef BIKE_LOG_CAPACITY
+#define BIKE_LOG_CAPACITY     128    // Records, power of two
+#endif
+
+#define BIKE_LOG_PAYLOAD      20     // Argument bytes per record
+#define BIKE_LOG_TRUNCATED    0x01   // Record flag: arguments were cut
+#define BIKE_LOG_LINE_MAX     160    // Longest text line drain() and the decoder write
+#define BIKE_LOG_DRAIN_MS     250    // How often the drain task empties the ring
+
+struct BikeLogRecord {
+    uint32_t timeUs;
+    const char* format;
+    uint8_t level;
+    uint8_t length;                  // Payload bytes used
+    uint8_t flags;
+    uint8_t payload[BIKE_LOG_PAYLOAD];
+};
+
+// Argument packing, by C++ type (the printf format check keeps it in line
+// with the conversion the decoder will use)
+struct BikeLogPacker {
+    uint8_t* out;
+    uint8_t length;
+    bool full;
+    bool truncated;
+
+    void put(const void* data, uint8_t size) {
+        if (full || length + size > BIKE_LOG_PAYLOAD) {
+            full = truncated = true;   // Later arguments would be misread, stop here
+            return;
+        }
+        memcpy(out + length, data, size);
+        length += size;
+    }
+};
+
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+bikeLogPack(BikeLogPacker& packer, T value) {
+    // 8 bytes for %ll only; long is 4 bytes on the ESP32 and packed as such
+    if (std::is_same<T, long long>::value || std::is_same<T, unsigned long long>::value) {
+        uint64_t wide = (uint64_t)value;
+        packer.put(&wide, 8);
+    } else {
+        uint32_t word = (uint32_t)value;
+        packer.put(&word, 4);
+    }
+}
+
+template <typename T>
+typename std::enable_if<std::is_floating_point<T>::value>::type
+bikeLogPack(BikeLogPacker& packer, T value) {
+    float single = (float)value;
+    packer.put(&single, 4);
+}
+
+inline void bikeLogPack(BikeLogPacker& packer, const char* text) {
+    if (packer.full || packer.length >= BIKE_LOG_PAYLOAD) {
+        packer.full = packer.truncated = true;
+        return;
+    }
+    if (!text) text = "(null)";
+    
+    // Byte by byte up to the NUL: never reads past a short literal
+    uint8_t room = BIKE_LOG_PAYLOAD - packer.length - 1;
+    uint8_t* copy = packer.out + packer.length + 1;
+    uint8_t size = 0;
+    while (size < room && text[size] != '\0') {
+        copy[size] = text[size];
+        size++;
+    }
+    if (text[size] != '\0') packer.truncated = true;
+    packer.out[packer.length] = size;
+    packer.length += 1 + size;
+}
+
+template <typename T>
+void bikeLogPack(BikeLogPacker& packer, const T* pointer) {
+    uint32_t address = (uint32_t)(uintptr_t)pointer;
+    packer.put(&address, 4);
+}
+
+inline void bikeLogPackArgs(BikeLogPacker&) {}
+
+template <typename T, typename... Rest>
+void bikeLogPackArgs(BikeLogPacker& packer, T first, Rest... rest) {
+    bikeLogPack(packer, first);
+    bikeLogPackArgs(packer, rest...);
+}
+
+class BikeLog {
+public:
+    BikeLog();
+
+    template <typename... Args>
+    void write(uint8_t level, const char* format, Args... args) {
+#ifdef BIKE_LOG_IMMEDIATE
+        // Host builds: nothing to protect, print on the spot
+        BikeLogRecord record;
+        fill(record, level, format);
+        BikeLogPacker packer = { record.payload, 0, false, false };
+        bikeLogPackArgs(packer, args...);
+        finish(record, packer);
+        printRecord(record);
+#else
+        uint32_t position;
+        Slot* slot = reserve(position);
+        if (!slot) return;
+        fill(slot->record, level, format);
+        BikeLogPacker packer = { slot->record.payload, 0, false, false };
+        bikeLogPackArgs(packer, args...);
+        finish(slot->record, packer);
+        slot->sequence.store(position + 1, std::memory_order_release);
+#endif
+    }
+
+    // From one task only: prints up to maxRecords, returns how many
+    uint32_t drain(uint32_t maxRecords = BIKE_LOG_CAPACITY);
+
+    void setBinaryOutput(bool binary);   // "~L" lines for host_log_decode instead of text
+    bool isBinaryOutput() const;
+    uint32_t getWritten() const;
+    uint32_t getDropped() const;         // Ring was full
+
+private:
+    static_assert((BIKE_LOG_CAPACITY & (BIKE_LOG_CAPACITY - 1)) == 0, "BIKE_LOG_CAPACITY must be a power of two");
+
+    // A slot is free for position p when sequence == p, holds the record
+    // written at p when sequence == p + 1
+    struct Slot {
+        std::atomic<uint32_t> sequence;
+        BikeLogRecord record;
+    };
+
+    Slot slots[BIKE_LOG_CAPACITY];
+    std::atomic<uint32_t> writePosition;
+    uint32_t readPosition;
+    std::atomic<uint32_t> dropped;
+    uint32_t droppedReported;
+    bool binaryOutput;
+
+    Slot* reserve(uint32_t& position) {
+        position = writePosition.load(std::memory_order_relaxed);
+        while (true) {
+            Slot* slot = &slots[position & (BIKE_LOG_CAPACITY - 1)];
+            int32_t lag = (int32_t)(slot->sequence.load(std::memory_order_acquire) - position);
+            if (lag == 0) {
+                if (writePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) return slot;
+            } else if (lag < 0) {
+                dropped.fetch_add(1, std::memory_order_relaxed);  // Drain has not freed the slot yet
+                return nullptr;
+            } else {
+                position = writePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    static void fill(BikeLogRecord& record, uint8_t level, const char* format) {
+        record.timeUs = micros();
+        record.format = format;
+        record.level = level;
+    }
+
+    static void finish(BikeLogRecord& record, const BikeLogPacker& packer) {
+        record.length = packer.length;
+        record.flags = packer.truncated ? BIKE_LOG_TRUNCATED : 0;
+    }
+
+    void printRecord(const BikeLogRecord& record);
+};
+
+extern BikeLog bikeLog;
+
+// Shared by drain() and the host decoder
+uint32_t bikeLogHash(const char* format);                         // FNV-1a, 32 bit
+char bikeLogLevelLetter(uint8_t level);
+int bikeLogFormat(char* out, size_t outSize, const char* format,
+                  const uint8_t* payload, uint8_t length, bool truncated);
+
+// Only in dead code: lets the compiler check the arguments against the format
+inline void bikeLogCheckFormat(const char* format, ...) __attribute__((format(printf, 1, 2)));
+inline void bikeLogCheckFormat(const char*, ...) {}
+
+#define BIKE_LOG_AT(level, format, ...) do { \
+        if (0) bikeLogCheckFormat(format, ##__VA_ARGS__); \
+        bikeLog.write(level, format, ##__VA_ARGS__); \
+    } while (0)
+
+#if BIKE_LOG_LEVEL >= BIKE_LOG_LEVEL_ERROR
+#define BIKE_LOGE(format, ...) BIKE_LOG_AT(BIKE_LOG_LEVEL_ERROR, format, ##__VA_ARGS__)
+#else
+#define BIKE_LOGE(format, ...) do {} while (0)
+#endif
+
+#if BIKE_LOG_LEVEL >= BIKE_LOG_LEVEL_WARN
+#define BIKE_LOGW(format, ...) BIKE_LOG_AT(BIKE_LOG_LEVEL_WARN, format, ##__VA_ARGS__)
+#else
+#define BIKE_LOGW(format, ...) do {} while (0)
+#endif
+
+#if BIKE_LOG_LEVEL >= BIKE_LOG_LEVEL_INFO
+#define BIKE_LOGI(format, ...) BIKE_LOG_AT(BIKE_LOG_LEVEL_INFO, format, ##__VA_ARGS__)
+#else
+#define BIKE_LOGI(format, ...) do {} while (0)
+#endif
+
+#if BIKE_LOG_LEVEL >= BIKE_LOG_LEVEL_DEBUG
+#define BIKE_LOGD(format, ...) BIKE_LOG_AT(BIKE_LOG_LEVEL_DEBUG, format, ##__VA_ARGS__)
+#else
+#define BIKE_LOGD(format, ...) do {} while (0)
+#endif
+
+#endif
@@ -0,0 +1,121 @@
+#include "BikePowerManager.h"
+
+//                                    name        MHz   rfid  poll    bms  vesc   can
+static const PowerProfileSettings profiles[POWER_PROFILE_COUNT] = {
+    /* POWER_RIDING   */            { "riding",   240,   100, 1000,  2000, true,   1 },
+    /* POWER_PARKED   */            { "parked",   160,   100, 1000,  2000, true,   2 },
+    /* POWER_LOCKED   */            { "locked",    80,   250, 5000, 10000, false, 10 },
+    /* POWER_CHARGING */            { "charging",  80,   250, 2000,  2000, false,  4 },
+};
+
+BikePowerManager::BikePowerManager() :
+    profile(POWER_LOCKED),
+    profileSinceMs(0),
+    profileSinceUs(0),
+    lastMovingMs(0),
+    lastChargeMs(0),
+    chargeSeen(false) {
+    memset(stats, 0, sizeof(stats));
+}
+
+const PowerProfileSettings& BikePowerManager::settings(BikePowerProfile profile) {
+    return profiles[profile < POWER_PROFILE_COUNT ? profile : POWER_RIDING];
+}
+
+void BikePowerManager::begin(bool unlocked) {
+    enter(unlocked ? POWER_PARKED : POWER_LOCKED, millis());
+}
+
+bool BikePowerManager::charging(uint32_t now) const {
+    return chargeSeen && now - lastChargeMs < POWER_CHARGE_END_MS;
+}
+
+bool BikePowerManager::update(bool unlocked, float speedKmh) {
+    uint32_t now = millis();
+    bool moving = speedKmh >= POWER_RIDING_KMH;
+    if (moving) lastMovingMs = now;
+    
+    // Riding survives short stops (lights, junctions); charge current while
+    // moving is regenerative braking, not a charger
+    BikePowerProfile next;
+    if (unlocked && (moving || (profile == POWER_RIDING && now - lastMovingMs < POWER_PARKED_AFTER_MS))) {
+        next = POWER_RIDING;
+    } else if (!moving && charging(now)) {
+        next = POWER_CHARGING;
+    } else {
+        next = unlocked ? POWER_PARKED : POWER_LOCKED;
+    }
+    
+    if (next == profile) return false;
+    enter(next, now);
+    return true;
+}
+
+void BikePowerManager::addSample(const BMSData& pack1, const BMSData& pack2) {
+    if (!pack1.connected && !pack2.connected) return;
+    
+    float currentA = (pack1.connected ? pack1.current : 0) + (pack2.connected ? pack2.current : 0);
+    bool chargeCurrent = -currentA >= POWER_CHARGE_MIN_A;
+    if (chargeCurrent) {
+        lastChargeMs = millis();
+        chargeSeen = true;
+    }
+    
+    // Only readings taken well inside the profile, and only with both packs:
+    // one pack's current alone is about half the draw. A charger showing up
+    // belongs to the charging profile update() is about to pick, not to this one.
+    if (!pack1.connected || !pack2.connected) return;
+    if (chargeCurrent && (profile == POWER_PARKED || profile == POWER_LOCKED)) return;
+    if ((int32_t)(pack1.sampleUs - profileSinceUs) < (int32_t)(POWER_SETTLE_MS * 1000)) return;
+    PowerProfileStats& s = stats[profile];
+    s.samples++;
+    s.currentSumA += currentA;
+    s.powerSumW += pack1.voltage * pack1.current + pack2.voltage * pack2.current;
+}
+
+uint32_t BikePowerManager::getNextUpdateMs() const {
+    uint32_t now = millis();
+    if (profile == POWER_RIDING) {
+        uint32_t stopped = now - lastMovingMs;
+        return stopped >= POWER_PARKED_AFTER_MS ? 0 : POWER_PARKED_AFTER_MS - stopped;
+    }
+    if (profile == POWER_CHARGING) {
+        uint32_t idle = now - lastChargeMs;
+        return idle >= POWER_CHARGE_END_MS ? 0 : POWER_CHARGE_END_MS - idle;
+    }
+    return POWER_NO_TIMED_WORK;
+}
+
+void BikePowerManager::enter(BikePowerProfile next, uint32_t now) {
+    stats[profile].timeMs += now - profileSinceMs;
+    stats[next].entries++;
+    profileSinceMs = now;
+    profileSinceUs = micros();
+    profile = next;
+}
+
+void BikePowerManager::getSnapshot(PowerSnapshot& snapshot) const {
+    uint32_t now = millis();
+    snapshot.profile = profile;
+    snapshot.sinceMs = now - profileSinceMs;
+    snapshot.cpuMhz = getCpuFrequencyMhz();
+    memcpy(snapshot.stats, stats, sizeof(stats));
+    snapshot.stats[snapshot.profile].timeMs += snapshot.sinceMs;
+}
+
+void powerPrintStats(const PowerSnapshot& snapshot) {
+    Serial.printf("[POWER] Profile %s for %lu s, CPU %u MHz | draw: both packs as the BMS measured it\n",
+                  BikePowerManager::settings(snapshot.profile).name, (unsigned long)(snapshot.sinceMs / 1000),
+                  snapshot.cpuMhz);
+    Serial.println("  profile    MHz  rfid ms  poll ms  bms ms  vesc  can×  entries    time s  samples  draw A  draw W");
+    for (uint8_t i = 0; i < POWER_PROFILE_COUNT; i++) {
+        const PowerProfileSettings& p = BikePowerManager::settings((BikePowerProfile)i);
+        const PowerProfileStats& s = snapshot.stats[i];
+        Serial.printf("  %-9s %4u %8u %8u %7u %5s %4u %8lu %9lu %8lu",
+                      p.name, p.cpuMhz, p.rfidPeriodMs, p.sensorPollMs, p.bmsRequestMs, p.vescPoll ? "on" : "off",
+                      p.canRateDivider, (unsigned long)s.entries, (unsigned long)(s.timeMs / 1000),
+                      (unsigned long)s.samples);
+        if (s.samples) Serial.printf(" %7.2f %7.1f\n", s.currentSumA / s.samples, s.powerSumW / s.samples);
+        else Serial.println("       -       -");
+    }
+}
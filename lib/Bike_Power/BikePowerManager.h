@@ -0,0 +1,83 @@
+#ifndef BIKE_POWER_MANAGER_H
+#define BIKE_POWER_MANAGER_H
+
+#include <Arduino.h>
+#include "BikeData.h"
+
+// Power profiles for the main board. systemTask feeds in the lock state,
+// the speed and the BMS samples; the manager picks the profile and the other
+// tasks apply its settings when the profile topic changes:
+//
+//   riding     unlocked and moving, everything at full rate
+//   parked     unlocked, stopped for POWER_PARKED_AFTER_MS
+//   locked     RFID polled slower, VESC not read, CAN at a tenth
+//   charging   stopped with charge current into the packs; BMS kept at full rate
+//
+// Each profile also records how long it was in force and the pack current
+// the BMS measured meanwhile (both packs, discharge positive). That is the
+// whole bike's draw, the motor included while riding.
+
+#define POWER_RIDING_KMH        3.0f     // At or above: moving
+#define POWER_PARKED_AFTER_MS   20000    // Stopped this long: riding -> parked
+#define POWER_CHARGE_MIN_A      0.5f     // Charge current (both packs) that means a charger
+#define POWER_CHARGE_END_MS     10000    // No charge current this long: charging over
+#define POWER_SETTLE_MS         1000     // BMS samples this soon after a change go to no profile
+#define POWER_NO_TIMED_WORK     0xFFFFFFFFUL
+
+struct PowerProfileSettings {
+    const char* name;
+    uint16_t cpuMhz;            // setCpuFrequencyMhz(); 80 is the lowest that keeps the radio and APB clock
+    uint16_t rfidPeriodMs;      // Reader poll (no IRQ line)
+    uint16_t sensorPollMs;      // VESC read, Hall timeout, input resync
+    uint16_t bmsRequestMs;
+    bool vescPoll;              // false: the VESC is not asked (and reads as disconnected)
+    uint8_t canRateDivider;     // CAN schedule periods times this
+};
+
+struct PowerProfileStats {
+    uint32_t entries;
+    uint32_t timeMs;            // In force so far
+    uint32_t samples;           // BMS sample pairs taken in this profile
+    float currentSumA;
+    float powerSumW;
+};
+
+struct PowerSnapshot {
+    BikePowerProfile profile;
+    uint32_t sinceMs;           // In the current profile
+    uint16_t cpuMhz;            // As running
+    PowerProfileStats stats[POWER_PROFILE_COUNT];
+};
+
+class BikePowerManager {
+public:
+    BikePowerManager();
+    
+    static const PowerProfileSettings& settings(BikePowerProfile profile);
+    
+    // systemTask only
+    void begin(bool unlocked);
+    bool update(bool unlocked, float speedKmh);            // True when the profile changed
+    void addSample(const BMSData& pack1, const BMSData& pack2);  // A new BMS reading
+    uint32_t getNextUpdateMs() const;                      // Until a timed change, POWER_NO_TIMED_WORK if none
+    BikePowerProfile getProfile() const { return profile; }
+    
+    // Any task; may be a change behind
+    void getSnapshot(PowerSnapshot& snapshot) const;
+
+private:
+    volatile BikePowerProfile profile;
+    volatile uint32_t profileSinceMs;
+    uint32_t profileSinceUs;    // For the BMS sample stamps
+    uint32_t lastMovingMs;
+    uint32_t lastChargeMs;
+    bool chargeSeen;
+    PowerProfileStats stats[POWER_PROFILE_COUNT];
+    
+    bool charging(uint32_t now) const;
+    void enter(BikePowerProfile next, uint32_t now);
+};
+
+void powerPrintStats(const PowerSnapshot& snapshot);
+
+#endif
@@ -0,0 +1,149 @@
+#include "BootSequencer.h"
+
+BootSequencer::BootSequencer() :
+    stageCount(0),
+    claimed(0),
+    done(0),
+    runStartUs(0),
+    runEndUs(0),
+    markCount(0) {
+    memset(stages, 0, sizeof(stages));
+    memset(marks, 0, sizeof(marks));
+    workers[0] = NULL;
+    workers[1] = NULL;
+}
+
+uint8_t BootSequencer::add(const char* name, BootStageFunction function, uint32_t after, int8_t core) {
+    if (stageCount >= BOOT_MAX_STAGES) return BOOT_MAX_STAGES;
+    Stage& stage = stages[stageCount];
+    stage.function = function;
+    stage.timing.name = name;
+    stage.timing.after = after & (BOOT_STAGE(stageCount) - 1);
+    stage.timing.core = (core == 0 || core == 1) ? core : BOOT_ANY_CORE;
+    stage.timing.ranOn = BOOT_ANY_CORE;
+    return stageCount++;
+}
+
+void BootSequencer::run() {
+    runStartUs = micros();
+    int8_t own = xPortGetCoreID();
+    int8_t other = 1 - own;
+    workers[own] = xTaskGetCurrentTaskHandle();
+    
+    // The helper only lives for the boot, so its stack comes from the heap and
+    // goes back to it. Same priority as the caller: neither works ahead.
+    TaskHandle_t helper = NULL;
+    if (xTaskCreatePinnedToCore(helperMain, "BootHelper", BOOT_HELPER_STACK, this,
+                                uxTaskPriorityGet(NULL), &helper, other) != pdPASS) {
+        helper = NULL;
+    }
+    workers[other] = helper;
+    
+    // Without a helper the caller runs every stage, whatever core it asked for
+    work(helper ? own : BOOT_ANY_CORE);
+    runEndUs = micros();
+}
+
+void BootSequencer::helperMain(void* parameter) {
+    BootSequencer* sequencer = (BootSequencer*)parameter;
+    sequencer->work(xPortGetCoreID());
+    vTaskDelete(NULL);
+}
+
+// Runs what this core may run until every stage has ended, sleeping while the
+// other core holds the next one up
+void BootSequencer::work(int8_t core) {
+    uint32_t all = BOOT_STAGE(stageCount) - 1;
+    while (done.load() != all) {
+        int8_t id = claim(core);
+        if (id < 0) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        
+        BootStageTiming& timing = stages[id].timing;
+        timing.ranOn = xPortGetCoreID();
+        timing.startUs = micros();
+        stages[id].function();
+        timing.endUs = micros();
+        done.fetch_or(BOOT_STAGE(id));
+        
+        // The other worker may be waiting for this one
+        for (uint8_t i = 0; i < 2; i++) {
+            if (workers[i] && workers[i] != xTaskGetCurrentTaskHandle()) xTaskNotifyGive(workers[i]);
+        }
+    }
+}
+
+// The first stage whose dependencies have ended and that this core may take, -1 if none
+int8_t BootSequencer::claim(int8_t core) {
+    uint32_t finished = done.load();
+    for (uint8_t id = 0; id < stageCount; id++) {
+        const BootStageTiming& timing = stages[id].timing;
+        if ((timing.after & ~finished) != 0) continue;
+        if (core != BOOT_ANY_CORE && timing.core != BOOT_ANY_CORE && timing.core != core) continue;
+        if ((claimed.fetch_or(BOOT_STAGE(id)) & BOOT_STAGE(id)) == 0) return id;
+    }
+    return -1;
+}
+
+void BootSequencer::mark(const char* name) {
+    uint8_t slot = markCount.fetch_add(1);
+    if (slot >= BOOT_MAX_MARKS) return;
+    marks[slot].atUs = micros();
+    marks[slot].name = name;    // Last: the timeline skips the slot until it is set
+}
+
+void BootSequencer::getTimeline(BootTimeline& timeline) const {
+    timeline.runStartUs = runStartUs;
+    timeline.runEndUs = runEndUs;
+    timeline.stageCount = stageCount;
+    for (uint8_t i = 0; i < stageCount; i++) timeline.stages[i] = stages[i].timing;
+    
+    uint8_t count = markCount.load();
+    timeline.markCount = 0;
+    for (uint8_t i = 0; i < count && i < BOOT_MAX_MARKS; i++) {
+        if (marks[i].name) timeline.marks[timeline.markCount++] = marks[i];
+    }
+}
+
+void bootPrintTimeline(const BootTimeline& timeline) {
+    // Bars over the time from power-on to the last stage or mark
+    const uint8_t width = 40;
+    uint32_t endUs = timeline.runEndUs;
+    for (uint8_t i = 0; i < timeline.markCount; i++) {
+        if (timeline.marks[i].atUs > endUs) endUs = timeline.marks[i].atUs;
+    }
+    uint32_t serialUs = 0;
+    for (uint8_t i = 0; i < timeline.stageCount; i++) {
+        serialUs += timeline.stages[i].endUs - timeline.stages[i].startUs;
+    }
+    
+    Serial.printf("[BOOT] Stages %.1f-%.1f ms after power-on: %.1f ms, %.1f ms one after another\n",
+                  timeline.runStartUs / 1000.0f, timeline.runEndUs / 1000.0f,
+                  (timeline.runEndUs - timeline.runStartUs) / 1000.0f, serialUs / 1000.0f);
+    Serial.println("   #  stage         core  after     start ms    end ms  took ms");
+    for (uint8_t i = 0; i < timeline.stageCount; i++) {
+        const BootStageTiming& s = timeline.stages[i];
+        char after[BOOT_MAX_STAGES * 2 + 1];
+        uint8_t pos = 0;
+        for (uint8_t j = 0; j < timeline.stageCount; j++) {
+            if (!(s.after & BOOT_STAGE(j))) continue;
+            pos += snprintf(after + pos, sizeof(after) - pos, pos ? ",%u" : "%u", j);
+        }
+        if (!pos) snprintf(after, sizeof(after), "-");
+        
+        char bar[width + 1];
+        uint32_t from = endUs ? (uint64_t)s.startUs * width / endUs : 0;
+        uint32_t to = endUs ? (uint64_t)s.endUs * width / endUs : 0;
+        for (uint8_t c = 0; c < width; c++) bar[c] = (c >= from && (c < to || c == from)) ? '#' : '.';
+        bar[width] = '\0';
+        
+        char core = s.core == BOOT_ANY_CORE ? '*' : '0' + s.core;
+        Serial.printf("  %2u  %-13s %c→%d   %-8s %9.1f %9.1f %8.1f  %s\n", i, s.name, core, s.ranOn, after,
+                      s.startUs / 1000.0f, s.endUs / 1000.0f, (s.endUs - s.startUs) / 1000.0f, bar);
+    }
+    for (uint8_t i = 0; i < timeline.markCount; i++) {
+        Serial.printf("  %-19s at %.1f ms\n", timeline.marks[i].name, timeline.marks[i].atUs / 1000.0f);
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef BOOT_SEQUENCER_H
+#define BOOT_SEQUENCER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+
+// Staged boot for setup(). Each stage names the stages that must end before
+// it starts and, if its hardware cares, the core it runs on. run() works
+// through them on both cores at once: the calling task (loopTask) takes the
+// stages of its own core, a helper task on the other core takes the rest, and
+// a stage for either core goes to whichever gets to it first. A stage waiting
+// for a slow one (a delay, a flash write, a device probe) no longer holds up
+// the ones that do not need it.
+//
+// Every stage is timed with micros(), i.e. from power-on, and mark() adds
+// points after run() (the first CAN frame out, the first speed on screen):
+// together the boot timeline ("boot"). Stages only depend on earlier ones,
+// so there is always one that can run.
+
+#define BOOT_MAX_STAGES       10
+#define BOOT_MAX_MARKS        4
+#define BOOT_ANY_CORE         -1
+#define BOOT_HELPER_STACK     6144     // NimBLE's init may run on it; freed after run()
+#define BOOT_STAGE(id)        (1UL << (id))
+
+typedef void (*BootStageFunction)();
+
+struct BootStageTiming {
+    const char* name;
+    uint32_t after;                 // BOOT_STAGE() bits
+    int8_t core;                    // Asked for, BOOT_ANY_CORE if either
+    int8_t ranOn;
+    uint32_t startUs;               // micros(): since power-on
+    uint32_t endUs;
+};
+
+struct BootMark {
+    const char* name;
+    uint32_t atUs;
+};
+
+struct BootTimeline {
+    uint32_t runStartUs;            // Before: ROM, bootloader and setup() up to run()
+    uint32_t runEndUs;
+    uint8_t stageCount;
+    BootStageTiming stages[BOOT_MAX_STAGES];
+    uint8_t markCount;
+    BootMark marks[BOOT_MAX_MARKS];
+};
+
+class BootSequencer {
+public:
+    BootSequencer();
+    
+    // setup() only, before run(). Returns the stage's id for BOOT_STAGE(),
+    // BOOT_MAX_STAGES if there is no room; dependencies on later stages are dropped
+    uint8_t add(const char* name, BootStageFunction function, uint32_t after = 0, int8_t core = BOOT_ANY_CORE);
+    
+    // Every stage, once; returns when all have ended
+    void run();
+    
+    // Any task, once per point, any time after run()
+    void mark(const char* name);
+    
+    void getTimeline(BootTimeline& timeline) const;
+
+private:
+    struct Stage {
+        BootStageFunction function;
+        BootStageTiming timing;
+    };
+    
+    Stage stages[BOOT_MAX_STAGES];
+    uint8_t stageCount;
+    std::atomic<uint32_t> claimed;
+    std::atomic<uint32_t> done;
+    TaskHandle_t workers[2];        // By core
+    uint32_t runStartUs;
+    uint32_t runEndUs;
+    BootMark marks[BOOT_MAX_MARKS];
+    std::atomic<uint8_t> markCount;
+    
+    static void helperMain(void* parameter);
+    void work(int8_t core);
+    int8_t claim(int8_t core);
+};
+
+void bootPrintTimeline(const BootTimeline& timeline);
+
+#endif
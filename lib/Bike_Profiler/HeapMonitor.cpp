@@ -0,0 +1,150 @@
+#include "HeapMonitor.h"
+#include <esp_heap_caps.h>
+#include <atomic>
+
+static std::atomic<uint32_t> allocationCount(0);
+static std::atomic<uint32_t> rideAllocationCount(0);
+static volatile bool riding = false;
+
+void heapCountAllocation() {
+    if (!heapAllocationCounted()) return;
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (!riding) return;
+    rideAllocationCount.fetch_add(1, std::memory_order_relaxed);
+#ifdef BIKE_HEAP_STRICT
+    abort();    // The backtrace starts at the allocation
+#endif
+}
+
+__attribute__((weak)) bool heapAllocationCounted() {
+    return true;
+}
+
+#ifdef BIKE_HEAP_COUNT
+extern "C" {
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* block, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    heapCountAllocation();
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    heapCountAllocation();
+    return __real_calloc(count, size);
+}
+
+// realloc(block, 0) frees
+void* __wrap_realloc(void* block, size_t size) {
+    if (size) heapCountAllocation();
+    return __real_realloc(block, size);
+}
+
+}
+#endif
+
+HeapMonitor::HeapMonitor() :
+    started(false),
+    setupFreeBytes(0),
+    setupLargestBlock(0),
+    lowestLargestBlock(0),
+    setupAllocations(0),
+    windowStartMs(0),
+    windowStartCount(0),
+    allocationsPerSec(0),
+    peakAllocationsPerSec(0),
+    rideMs(0),
+    rideSinceMs(0) {
+}
+
+void HeapMonitor::begin() {
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+    setupFreeBytes = info.total_free_bytes;
+    setupLargestBlock = info.largest_free_block;
+    lowestLargestBlock = info.largest_free_block;
+    setupAllocations = allocationCount.load(std::memory_order_relaxed);
+    windowStartMs = millis();
+    windowStartCount = setupAllocations;
+    started = true;
+}
+
+void HeapMonitor::setRiding(bool nowRiding) {
+    uint32_t now = millis();
+    if (riding) rideMs += now - rideSinceMs;
+    rideSinceMs = now;
+    riding = nowRiding;
+}
+
+void HeapMonitor::update() {
+    if (!started) return;
+    uint32_t now = millis();
+    if (now - windowStartMs < HEAP_RATE_WINDOW_MS) return;
+    
+    uint32_t count = allocationCount.load(std::memory_order_relaxed);
+    allocationsPerSec = (count - windowStartCount) * 1000.0f / (now - windowStartMs);
+    if (allocationsPerSec > peakAllocationsPerSec) peakAllocationsPerSec = allocationsPerSec;
+    windowStartMs = now;
+    windowStartCount = count;
+    
+    size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    if (largest < lowestLargestBlock) lowestLargestBlock = largest;
+}
+
+void HeapMonitor::getSnapshot(HeapSnapshot& snapshot) const {
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+    uint32_t now = millis();
+    
+    snapshot.uptimeMs = now;
+    snapshot.freeBytes = info.total_free_bytes;
+    snapshot.minFreeBytes = info.minimum_free_bytes;
+    snapshot.largestFreeBlock = info.largest_free_block;
+    snapshot.freeBlocks = info.free_blocks;
+    snapshot.fragmentationPct = info.total_free_bytes ?
+        100.0f * (1.0f - (float)info.largest_free_block / info.total_free_bytes) : 0.0f;
+    snapshot.setupFreeBytes = setupFreeBytes;
+    snapshot.setupLargestBlock = setupLargestBlock;
+    snapshot.lowestLargestBlock = lowestLargestBlock;
+#ifdef BIKE_HEAP_COUNT
+    snapshot.counting = true;
+#else
+    snapshot.counting = false;
+#endif
+    snapshot.allocations = allocationCount.load(std::memory_order_relaxed);
+    snapshot.steadyAllocations = started ? snapshot.allocations - setupAllocations : 0;
+    snapshot.allocationsPerSec = allocationsPerSec;
+    snapshot.peakAllocationsPerSec = peakAllocationsPerSec;
+    snapshot.rideMs = rideMs + (riding ? now - rideSinceMs : 0);
+    snapshot.rideAllocations = rideAllocationCount.load(std::memory_order_relaxed);
+}
+
+void heapPrintStats(const HeapSnapshot& snapshot) {
+    // Formatted here: Serial.printf() would take the heap for these lines
+    char line[128];
+    snprintf(line, sizeof(line), "[HEAP] %lu s since boot | free %lu B, low-water mark %lu B",
+             (unsigned long)(snapshot.uptimeMs / 1000), (unsigned long)snapshot.freeBytes,
+             (unsigned long)snapshot.minFreeBytes);
+    Serial.println(line);
+    snprintf(line, sizeof(line), "  largest free block %lu B (after setup %lu B, lowest since %lu B)",
+             (unsigned long)snapshot.largestFreeBlock, (unsigned long)snapshot.setupLargestBlock,
+             (unsigned long)snapshot.lowestLargestBlock);
+    Serial.println(line);
+    snprintf(line, sizeof(line), "  %lu free blocks, fragmentation %.1f%%",
+             (unsigned long)snapshot.freeBlocks, snapshot.fragmentationPct);
+    Serial.println(line);
+    if (!snapshot.counting) {
+        Serial.println("  allocations not counted (env Bike_Main_heap counts them)");
+        return;
+    }
+    snprintf(line, sizeof(line), "  allocations: %lu since boot, %lu since setup, %.1f/s (peak %.1f/s)",
+             (unsigned long)snapshot.allocations, (unsigned long)snapshot.steadyAllocations,
+             snapshot.allocationsPerSec, snapshot.peakAllocationsPerSec);
+    Serial.println(line);
+    snprintf(line, sizeof(line), "  riding %lu s: %lu allocations",
+             (unsigned long)(snapshot.rideMs / 1000), (unsigned long)snapshot.rideAllocations);
+    Serial.println(line);
+}
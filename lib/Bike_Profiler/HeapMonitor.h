@@ -0,0 +1,87 @@
+#ifndef HEAP_MONITOR_H
+#define HEAP_MONITOR_H
+
+#include <Arduino.h>
+
+// Heap use of the main board. Tasks, queues and the managers' buffers are
+// all in place by the end of setup(); from then on the firmware should not
+// use the heap on its periodic paths, and a long ride should leave the heap
+// as unfragmented as it found it. The monitor shows whether that holds:
+//
+//   free, low-water mark   heap_caps_get_info(MALLOC_CAP_8BIT)
+//   largest free block     the biggest allocation that can still succeed,
+//                          after setup() and the lowest seen since
+//   fragmentation          100 × (1 - largest free block / free)
+//   allocations/s          counting builds only, see below
+//
+// Counting: built with -DBIKE_HEAP_COUNT and linked with
+// -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc (env Bike_Main_heap), every
+// call through those is counted; operator new and String end up there too.
+// Memory taken with heap_caps_malloc() directly (FreeRTOS objects, the BLE
+// stack's pools) is not seen. setRiding() marks the riding power profile;
+// with -DBIKE_HEAP_STRICT as well, the first allocation while riding aborts,
+// and the panic backtrace names the caller. Serial.printf() allocates for
+// lines over 64 characters, so most serial commands do ("heap" does not):
+// in a strict build, ask for them while parked.
+//
+// The counters are the board's (the allocator wrappers have no instance to
+// go to): one HeapMonitor per firmware.
+
+#define HEAP_RATE_WINDOW_MS   1000     // Allocation rate: counted over at least this long
+
+struct HeapSnapshot {
+    uint32_t uptimeMs;
+    uint32_t freeBytes;
+    uint32_t minFreeBytes;          // Low-water mark since boot
+    uint32_t largestFreeBlock;
+    uint32_t freeBlocks;
+    float fragmentationPct;
+    uint32_t setupFreeBytes;        // At begin(), the end of setup()
+    uint32_t setupLargestBlock;
+    uint32_t lowestLargestBlock;    // Smallest largest block update() saw since begin()
+    bool counting;                  // Built with BIKE_HEAP_COUNT
+    uint32_t allocations;           // Since boot
+    uint32_t steadyAllocations;     // Since begin()
+    float allocationsPerSec;        // Last window
+    float peakAllocationsPerSec;    // Highest window since begin()
+    uint32_t rideMs;                // In the riding profile since boot
+    uint32_t rideAllocations;       // Made while riding
+};
+
+class HeapMonitor {
+public:
+    HeapMonitor();
+    
+    void begin();                   // End of setup(): the steady state starts here
+    void setRiding(bool riding);    // systemTask, with the power profile
+    
+    // One reader task (displayTask): rolls the rate window, tracks the largest block
+    void update();
+    void getSnapshot(HeapSnapshot& snapshot) const;
+
+private:
+    bool started;
+    uint32_t setupFreeBytes;
+    uint32_t setupLargestBlock;
+    uint32_t lowestLargestBlock;
+    uint32_t setupAllocations;
+    
+    uint32_t windowStartMs;
+    uint32_t windowStartCount;
+    float allocationsPerSec;
+    float peakAllocationsPerSec;
+    
+    volatile uint32_t rideMs;       // Closed riding spells
+    volatile uint32_t rideSinceMs;
+};
+
+// Called by the allocator wrappers of a counting build
+void heapCountAllocation();
+
+// Whether an allocation is the firmware's own. The default (weak) says yes;
+// a platform that allocates for itself on the firmware's tasks (the SIL) overrides it.
+bool heapAllocationCounted();
+
+void heapPrintStats(const HeapSnapshot& snapshot);
+
+#endif
@@ -0,0 +1,167 @@
+#include "TaskProfiler.h"
+
+TaskProfiler::TaskProfiler() {
+    memset((void*)profiles, 0, sizeof(profiles));
+}
+
+void TaskProfiler::add(uint8_t slot, const char* name, TaskHandle_t task, uint32_t stackBytes, uint32_t periodMs) {
+    if (slot >= PROFILER_MAX_TASKS) return;
+    Profile& p = profiles[slot];
+    p.task = task;
+    p.stackBytes = stackBytes;
+    p.periodUs = periodMs * 1000;
+    p.name = name;  // Last: snapshots skip the slot until it is set
+}
+
+void TaskProfiler::loopStart(uint8_t slot) {
+    if (slot >= PROFILER_MAX_TASKS) return;
+    profiles[slot].startUs = micros();
+}
+
+void TaskProfiler::loopEnd(uint8_t slot) {
+    if (slot >= PROFILER_MAX_TASKS) return;
+    Profile& p = profiles[slot];
+    uint32_t now = micros();
+    uint32_t us = now - p.startUs;
+    
+    if (p.periodUs) {
+        // Mirrors vTaskDelayUntil: the first wake after add() sets the
+        // grid, each loop has to end before the next point on it
+        if (!p.scheduled) {
+            p.scheduledUs = p.startUs;
+            p.scheduled = true;
+        }
+        if (now - p.scheduledUs > p.periodUs) p.missedDeadlines++;
+        p.scheduledUs += p.periodUs;
+    }
+    
+    p.busyUs += us;
+    if (us > p.maxUs) p.maxUs = us;
+    p.buckets[bucketOf(us)]++;
+    p.iterations++;
+}
+
+void TaskProfiler::dataRead(uint8_t slot, uint32_t us) {
+    if (slot >= PROFILER_MAX_TASKS) return;
+    if (us > profiles[slot].dataReadMaxUs) profiles[slot].dataReadMaxUs = us;
+}
+
+void TaskProfiler::setPeriod(uint8_t slot, uint32_t periodMs) {
+    if (slot >= PROFILER_MAX_TASKS) return;
+    profiles[slot].periodUs = periodMs * 1000;
+    profiles[slot].scheduled = false;  // New grid from the next loop on
+}
+
+uint32_t TaskProfiler::getIterations(uint8_t slot) const {
+    return slot < PROFILER_MAX_TASKS ? profiles[slot].iterations : 0;
+}
+
+void TaskProfiler::getSnapshot(TaskProfilerSnapshot& snapshot) const {
+    snapshot.uptimeMs = millis();
+    snapshot.taskCount = 0;
+    
+    for (uint8_t i = 0; i < PROFILER_MAX_TASKS; i++) {
+        const Profile& p = profiles[i];
+        if (!p.name) continue;
+        
+        TaskProfileSnapshot& s = snapshot.tasks[snapshot.taskCount++];
+        s.name = p.name;
+        s.slot = i;
+        s.priority = uxTaskPriorityGet(p.task);
+        s.stackBytes = p.stackBytes;
+        s.stackFreeBytes = uxTaskGetStackHighWaterMark(p.task);  // Bytes on the ESP32
+        s.periodMs = p.periodUs / 1000;
+        s.iterations = p.iterations;
+        s.cpuPct = snapshot.uptimeMs ? p.busyUs / (snapshot.uptimeMs * 10.0f) : 0;
+        s.maxUs = p.maxUs;
+        for (uint8_t b = 0; b < PROFILER_BUCKETS; b++) s.buckets[b] = p.buckets[b];
+        s.p50Us = percentile(s.buckets, s.iterations, s.maxUs, 0.5f);
+        s.p99Us = percentile(s.buckets, s.iterations, s.maxUs, 0.99f);
+        s.missedDeadlines = p.missedDeadlines;
+        s.dataReadMaxUs = p.dataReadMaxUs;
+    }
+}
+
+uint8_t TaskProfiler::bucketOf(uint32_t us) {
+    uint32_t units = us / PROFILER_BUCKET0_US;
+    if (units == 0) return 0;
+    uint8_t bucket = 32 - __builtin_clz(units);
+    return bucket < PROFILER_BUCKETS ? bucket : PROFILER_BUCKETS - 1;
+}
+
+uint32_t TaskProfiler::percentile(const uint32_t* buckets, uint32_t count, uint32_t maxUs, float p) {
+    uint32_t target = (uint32_t)(p * count);
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < PROFILER_BUCKETS - 1; i++) {
+        seen += buckets[i];
+        if (seen > target) return (uint32_t)PROFILER_BUCKET0_US << i;
+    }
+    return maxUs;
+}
+
+void taskPrintProfile(const TaskProfilerSnapshot& snapshot) {
+    Serial.printf("[TASKS] %lu s since boot | loop time p50/p99 are bucket upper bounds\n",
+                  (unsigned long)(snapshot.uptimeMs / 1000));
+    Serial.println("  task         prio   cpu%   loops/s     p50     p99     max us  missed  data us  stack used/size");
+    for (uint8_t i = 0; i < snapshot.taskCount; i++) {
+        const TaskProfileSnapshot& s = snapshot.tasks[i];
+        char missed[12];
+        char data[12];
+        if (s.periodMs) snprintf(missed, sizeof(missed), "%lu", (unsigned long)s.missedDeadlines);
+        else strcpy(missed, "-");
+        if (s.dataReadMaxUs) snprintf(data, sizeof(data), "%lu", (unsigned long)s.dataReadMaxUs);
+        else strcpy(data, "-");
+        
+        Serial.printf("  %-12s %4u %6.2f %9.1f %7lu %7lu %10lu %7s %8s  %5lu/%lu\n",
+                      s.name, s.priority, s.cpuPct,
+                      snapshot.uptimeMs ? s.iterations * 1000.0f / snapshot.uptimeMs : 0.0f,
+                      (unsigned long)s.p50Us, (unsigned long)s.p99Us, (unsigned long)s.maxUs, missed, data,
+                      (unsigned long)(s.stackBytes - s.stackFreeBytes), (unsigned long)s.stackBytes);
+    }
+    
+    // Histograms, empty buckets left out
+    for (uint8_t i = 0; i < snapshot.taskCount; i++) {
+        const TaskProfileSnapshot& s = snapshot.tasks[i];
+        Serial.printf("  %-12s", s.name);
+        for (uint8_t b = 0; b < PROFILER_BUCKETS; b++) {
+            if (!s.buckets[b]) continue;
+            if (b == PROFILER_BUCKETS - 1) Serial.printf(" >=%luus:%lu", (unsigned long)PROFILER_BUCKET0_US << (b - 1), (unsigned long)s.buckets[b]);
+            else Serial.printf(" <%luus:%lu", (unsigned long)PROFILER_BUCKET0_US << b, (unsigned long)s.buckets[b]);
+        }
+        Serial.println();
+    }
+}
+
+static uint16_t saturate16(uint32_t value) {
+    return value > 0xFFFF ? 0xFFFF : (uint16_t)value;
+}
+
+size_t encodeTaskProfile(const TaskProfilerSnapshot& snapshot, uint8_t* out, size_t maxLength) {
+    if (maxLength < PROFILER_ENCODED_HEADER) return 0;
+    
+    uint8_t count = 0;
+    size_t length = PROFILER_ENCODED_HEADER;
+    for (uint8_t i = 0; i < snapshot.taskCount && length + sizeof(TaskProfileRecord) <= maxLength; i++) {
+        const TaskProfileSnapshot& s = snapshot.tasks[i];
+        TaskProfileRecord record;
+        record.slot = s.slot;
+        record.priority = s.priority;
+        record.cpuPermille = saturate16((uint32_t)(s.cpuPct * 10));
+        record.iterations = s.iterations;
+        record.p50Us = s.p50Us;
+        record.p99Us = s.p99Us;
+        record.maxUs = s.maxUs;
+        record.missedDeadlines = saturate16(s.missedDeadlines);
+        record.dataReadMaxUs = saturate16(s.dataReadMaxUs);
+        record.stackBytes = saturate16(s.stackBytes);
+        record.stackFreeBytes = saturate16(s.stackFreeBytes);
+        memcpy(out + length, &record, sizeof(record));  // ESP32 is little endian
+        length += sizeof(record);
+        count++;
+    }
+    
+    out[0] = PROFILER_RECORD_VERSION;
+    out[1] = count;
+    memcpy(out + 2, &snapshot.uptimeMs, sizeof(snapshot.uptimeMs));
+    return length;
+}
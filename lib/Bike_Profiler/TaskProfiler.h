@@ -0,0 +1,116 @@
+#ifndef TASK_PROFILER_H
+#define TASK_PROFILER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Loop profiling for the main board tasks. Each task marks where its loop
+// body starts and ends; everything else is derived from that:
+//
+//   profiler.loopStart(slot)      right after the task wakes up
+//   profiler.loopEnd(slot)        right before it blocks again
+//   profiler.dataRead(slot, us)   time spent copying shared data
+//
+// A slot is written by its own task only, so the hooks take no lock and
+// never wait. Readers (serial, BLE) copy a snapshot that may be a loop
+// behind. Figures are since boot.
+//
+// Busy time is wall time from loopStart() to loopEnd(). It includes time
+// the task spent preempted by higher-priority tasks, so the CPU share of a
+// low-priority task reads high while the board is busy.
+
+#define PROFILER_MAX_TASKS      8
+#define PROFILER_BUCKETS        16     // Loop time histogram, bucket i: below PROFILER_BUCKET0_US << i
+#define PROFILER_BUCKET0_US     16     // Last bucket also takes everything longer
+#define PROFILER_RECORD_VERSION 1
+
+struct TaskProfileSnapshot {
+    const char* name;
+    uint8_t slot;
+    uint8_t priority;
+    uint32_t stackBytes;        // As created
+    uint32_t stackFreeBytes;    // High-water mark: least free stack so far
+    uint32_t periodMs;          // vTaskDelayUntil period, 0 = event driven
+    uint32_t iterations;
+    float cpuPct;               // Busy time / uptime
+    uint32_t p50Us;             // Loop time percentiles (bucket upper bounds)
+    uint32_t p99Us;
+    uint32_t maxUs;
+    uint32_t buckets[PROFILER_BUCKETS];
+    uint32_t missedDeadlines;   // Periodic tasks: loop ended after the next wake time
+    uint32_t dataReadMaxUs;     // Longest shared data copy, 0 = task reads none
+};
+
+struct TaskProfilerSnapshot {
+    uint32_t uptimeMs;
+    uint8_t taskCount;
+    TaskProfileSnapshot tasks[PROFILER_MAX_TASKS];
+};
+
+// BLE encoding (encodeTaskProfile()), little endian:
+//   [version][task count][uptime ms, 32] then one record per task
+struct __attribute__((packed)) TaskProfileRecord {
+    uint8_t slot;
+    uint8_t priority;
+    uint16_t cpuPermille;
+    uint32_t iterations;
+    uint32_t p50Us;
+    uint32_t p99Us;
+    uint32_t maxUs;
+    uint16_t missedDeadlines;   // Saturating
+    uint16_t dataReadMaxUs;     // Saturating
+    uint16_t stackBytes;
+    uint16_t stackFreeBytes;
+};
+
+#define PROFILER_ENCODED_HEADER 6
+#define PROFILER_ENCODED_MAX    (PROFILER_ENCODED_HEADER + PROFILER_MAX_TASKS * sizeof(TaskProfileRecord))
+
+class TaskProfiler {
+public:
+    TaskProfiler();
+    
+    // Register a task once it exists. The hooks work before this, so a task
+    // that runs before xTaskCreatePinnedToCore() returns loses nothing.
+    void add(uint8_t slot, const char* name, TaskHandle_t task, uint32_t stackBytes, uint32_t periodMs = 0);
+    
+    // From the slot's own task
+    void loopStart(uint8_t slot);
+    void loopEnd(uint8_t slot);
+    void dataRead(uint8_t slot, uint32_t us);
+    void setPeriod(uint8_t slot, uint32_t periodMs);   // The task changed its vTaskDelayUntil period
+    
+    // Any task
+    uint32_t getIterations(uint8_t slot) const;
+    void getSnapshot(TaskProfilerSnapshot& snapshot) const;
+
+private:
+    struct Profile {
+        const char* name;       // nullptr = slot not registered
+        TaskHandle_t task;
+        uint32_t stackBytes;
+        uint32_t periodUs;
+        
+        volatile uint32_t iterations;
+        volatile uint64_t busyUs;
+        volatile uint32_t maxUs;
+        volatile uint32_t buckets[PROFILER_BUCKETS];
+        volatile uint32_t missedDeadlines;
+        volatile uint32_t dataReadMaxUs;
+        
+        uint32_t startUs;
+        uint32_t scheduledUs;   // Periodic tasks: wake time of this loop
+        bool scheduled;
+    };
+    
+    Profile profiles[PROFILER_MAX_TASKS];
+    
+    static uint8_t bucketOf(uint32_t us);
+    static uint32_t percentile(const uint32_t* buckets, uint32_t count, uint32_t maxUs, float p);
+};
+
+void taskPrintProfile(const TaskProfilerSnapshot& snapshot);
+size_t encodeTaskProfile(const TaskProfilerSnapshot& snapshot, uint8_t* out, size_t maxLength);
+
+#endif
@@ -2,6 +2,7 @@
 
 // Configuration constants
 #define CARD_DEBOUNCE_TIME_MS   1500    // Ignore same card within 1.5 seconds
+#define CARD_KEY_MAX_LEN        40      // "card_" + UID, "cardlist_" + index
 
 
 // Master card that always has access (fallback when preferences fail)
@@ -10,7 +11,11 @@ BikeRFIDManager::BikeRFIDManager() :
     mfrc522(SS_PIN, RST_PIN),
     bikeUnlocked(false),
     lastCardTime(0),
-    masterCardUID("") {  // Will be set from main
+    cardReadPending(false),
+    powerCutPending(false) {
+    lastCardUID[0] = '\0';
+    memset(&cardRead, 0, sizeof(cardRead));
+    masterCardUID[0] = '\0';  // Will be set from main
 }
 
 BikeRFIDManager::~BikeRFIDManager() {
@@ -38,15 +43,25 @@ void BikeRFIDManager::begin() {
 }
 
 void BikeRFIDManager::update() {
+    // A power cut is a lock: the state follows the pin before a card can unlock again
+    if (powerCutPending.exchange(false)) {
+        if (bikeUnlocked) lockBike();
+        Serial.println("KEY output cut by the safety monitor - bike locked");
+    }
+    
     // Check for RFID card
     if (mfrc522.PICC_IsNewCardPresent() && mfrc522.PICC_ReadCardSerial()) {
-        String uid = getCardUID();
+        char uid[RFID_UID_MAX_LEN];
+        getCardUID(uid);
         
         // Debounce - ignore same card within defined time
-        if (uid != lastCardUID || (millis() - lastCardTime) > CARD_DEBOUNCE_TIME_MS) {
-            Serial.printf("RFID Card detected: %s\n", uid.c_str());
-            processCard(uid);
-            lastCardUID = uid;
+        if (strcmp(uid, lastCardUID) != 0 || (millis() - lastCardTime) > CARD_DEBOUNCE_TIME_MS) {
+            Serial.printf("RFID Card detected: %s\n", uid);
+            cardRead.authorized = processCard(uid);
+            cardRead.length = mfrc522.uid.size < RFID_UID_MAX_BYTES ? mfrc522.uid.size : RFID_UID_MAX_BYTES;
+            memcpy(cardRead.uid, mfrc522.uid.uidByte, cardRead.length);
+            cardReadPending = true;
+            strcpy(lastCardUID, uid);
             lastCardTime = millis();
         }
         
@@ -56,61 +71,73 @@ void BikeRFIDManager::update() {
     }
 }
 
-void BikeRFIDManager::processCard(String uid) {
-    Serial.printf("DEBUG: Processing card UID: %s\n", uid.c_str());
+bool BikeRFIDManager::takeCardRead(RFIDCardRead& card) {
+    if (!cardReadPending) return false;
+    card = cardRead;
+    cardReadPending = false;
+    return true;
+}
+
+bool BikeRFIDManager::processCard(const char* uid) {
+    Serial.printf("DEBUG: Processing card UID: %s\n", uid);
     
     if (isCardAuthorized(uid)) {
         Serial.println("Authorized card detected!");
         toggleBikeLock();
-    } else {
-        Serial.println("Unauthorized card - Access denied!");
+        return true;
     }
+    Serial.println("Unauthorized card - Access denied!");
+    return false;
 }
 
-bool BikeRFIDManager::isCardAuthorized(String uid) {
-    String key = "card_" + uid;
-    bool authorized = preferences.getBool(key.c_str(), false);
+bool BikeRFIDManager::isCardAuthorized(const char* uid) {
+    char key[CARD_KEY_MAX_LEN];
+    snprintf(key, sizeof(key), "card_%s", uid);
+    bool authorized = preferences.getBool(key, false);
     
     // If not found in preferences, check against master card
-    if (!authorized && uid == masterCardUID && masterCardUID != "") {
+    if (!authorized && masterCardUID[0] != '\0' && strcmp(uid, masterCardUID) == 0) {
         authorized = true;
-        Serial.printf("DEBUG: Using master card: %s\n", uid.c_str());
+        Serial.printf("DEBUG: Using master card: %s\n", uid);
     }
     
     Serial.printf("DEBUG: Card %s: %s\n", 
-                  uid.c_str(), authorized ? "AUTHORIZED" : "NOT AUTHORIZED");
+                  uid, authorized ? "AUTHORIZED" : "NOT AUTHORIZED");
     return authorized;
 }
 
-void BikeRFIDManager::setMasterCard(String uid) {
-    masterCardUID = uid;
-    Serial.printf("DEBUG: Master card set to: %s\n", uid.c_str());
+void BikeRFIDManager::setMasterCard(const char* uid) {
+    strncpy(masterCardUID, uid, RFID_UID_MAX_LEN - 1);
+    masterCardUID[RFID_UID_MAX_LEN - 1] = '\0';
+    Serial.printf("DEBUG: Master card set to: %s\n", masterCardUID);
 }
 
-void BikeRFIDManager::addAuthorizedCard(String uid) {
-    String key = "card_" + uid;
-    Serial.printf("DEBUG: Adding card with key: %s\n", key.c_str());
+void BikeRFIDManager::addAuthorizedCard(const char* uid) {
+    char key[CARD_KEY_MAX_LEN];
+    snprintf(key, sizeof(key), "card_%s", uid);
+    Serial.printf("DEBUG: Adding card with key: %s\n", key);
     
-    bool result = preferences.putBool(key.c_str(), true);
+    bool result = preferences.putBool(key, true);
     Serial.printf("DEBUG: putBool result: %s\n", result ? "SUCCESS" : "FAILED");
     
     // Verify immediately
-    bool verified = preferences.getBool(key.c_str(), false);
+    bool verified = preferences.getBool(key, false);
     Serial.printf("DEBUG: Verification read: %s\n", verified ? "AUTHORIZED" : "NOT FOUND");
     
     // Also add to list for management
     uint8_t cardCount = preferences.getUChar("card_count", 0);
-    String listKey = "cardlist_" + String(cardCount);
-    preferences.putString(listKey.c_str(), uid);
+    snprintf(key, sizeof(key), "cardlist_%u", cardCount);
+    preferences.putString(key, uid);
     preferences.putUChar("card_count", cardCount + 1);
     
-    Serial.printf("Card added: %s (Count: %d)\n", uid.c_str(), cardCount + 1);
+    Serial.printf("Card added: %s (Count: %d)\n", uid, cardCount + 1);
 }
 
-void BikeRFIDManager::removeAuthorizedCard(String uid) {
-    String key = "card_" + uid;
-    preferences.remove(key.c_str());
-    Serial.printf("Card removed: %s\n", uid.c_str());
+void BikeRFIDManager::removeAuthorizedCard(const char* uid) {
+    char key[CARD_KEY_MAX_LEN];
+    snprintf(key, sizeof(key), "card_%s", uid);
+    preferences.remove(key);
+    Serial.printf("Card removed: %s\n", uid);
 }
 
 void BikeRFIDManager::clearAllCards() {
@@ -140,6 +167,11 @@ void BikeRFIDManager::unlockBike() {
     Serial.println("🔓 BIKE UNLOCKED");
 }
 
+void BikeRFIDManager::cutPower() {
+    digitalWrite(KEY_PIN, LOW);
+    powerCutPending = true;
+}
+
 bool BikeRFIDManager::isBikeUnlocked() {
     return bikeUnlocked;
 }
@@ -156,15 +188,12 @@ void BikeRFIDManager::loadBikeState() {
     digitalWrite(KEY_PIN, bikeUnlocked ? HIGH : LOW);
 }
 
-String BikeRFIDManager::getCardUID() {
-    String uid = "";
-    for (byte i = 0; i < mfrc522.uid.size; i++) {
-        if (i > 0) uid += ":";
-        if (mfrc522.uid.uidByte[i] < 0x10) uid += "0";
-        uid += String(mfrc522.uid.uidByte[i], HEX);
+void BikeRFIDManager::getCardUID(char* uid) {
+    size_t length = 0;
+    uid[0] = '\0';
+    for (byte i = 0; i < mfrc522.uid.size && length + 3 <= RFID_UID_MAX_LEN; i++) {
+        length += snprintf(uid + length, RFID_UID_MAX_LEN - length, i > 0 ? ":%02X" : "%02X", mfrc522.uid.uidByte[i]);
     }
-    uid.toUpperCase();
-    return uid;
 }
 
 bool BikeRFIDManager::isCardPresent() {
@@ -173,7 +202,8 @@ bool BikeRFIDManager::isCardPresent() {
 
 bool BikeRFIDManager::authenticateCard() {
     if (isCardPresent()) {
-        String uid = getCardUID();
+        char uid[RFID_UID_MAX_LEN];
+        getCardUID(uid);
         mfrc522.PICC_HaltA();
         mfrc522.PCD_StopCrypto1();
         return isCardAuthorized(uid);
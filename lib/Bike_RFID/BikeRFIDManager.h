@@ -4,8 +4,20 @@
 #include <Preferences.h>
 #include <SPI.h>
 #include <MFRC522.h>
+#include <atomic>
 #include <BikeMainHardware.h>
 
+// Card UIDs are text, "29:0E:72:43": up to 10 bytes, two hex digits each
+#define RFID_UID_MAX_LEN    30      // Including the terminator
+#define RFID_UID_MAX_BYTES  10
+
+// A card update() processed, as read: raw UID bytes and the verdict
+struct RFIDCardRead {
+    uint8_t uid[RFID_UID_MAX_BYTES];
+    uint8_t length;
+    bool authorized;
+};
+
 class BikeRFIDManager {
 public:
     BikeRFIDManager();
@@ -13,15 +25,16 @@ public:
     
     void begin();
     void update();
+    bool takeCardRead(RFIDCardRead& card);  // The card the last update() processed, once
     
     // RFID Management
     bool isCardPresent();
     bool authenticateCard();
-    void addAuthorizedCard(String uid);
-    void removeAuthorizedCard(String uid);
-    bool isCardAuthorized(String uid);
+    void addAuthorizedCard(const char* uid);
+    void removeAuthorizedCard(const char* uid);
+    bool isCardAuthorized(const char* uid);
     void clearAllCards();
-    void setMasterCard(String uid);  // Set master card from main
+    void setMasterCard(const char* uid);  // Set master card from main
     
     // Bike Control
     bool isBikeUnlocked();
@@ -29,19 +42,26 @@ public:
     void lockBike();
     void unlockBike();
     
+    // Safety escalation, from any task: KEY_PIN low at once, and the bike
+    // locked (state, flash, lock topic) by the next update(), before any card
+    void cutPower();
+
 private:
     MFRC522 mfrc522;
     Preferences preferences;
     
     bool bikeUnlocked;
-    String lastCardUID;
+    char lastCardUID[RFID_UID_MAX_LEN];
     unsigned long lastCardTime;
-    String masterCardUID;  // Master card set from main
+    RFIDCardRead cardRead;
+    bool cardReadPending;
+    std::atomic<bool> powerCutPending;
+    char masterCardUID[RFID_UID_MAX_LEN];  // Master card set from main
     
     void saveBikeState();
     void loadBikeState();
-    void processCard(String uid);
-    String getCardUID();
+    bool processCard(const char* uid);  // True if authorized
+    void getCardUID(char* uid);  // RFID_UID_MAX_LEN bytes
 };
 
 #endif
@@ -0,0 +1,160 @@
+#include "BikeSafetyMonitor.h"
+
+BikeSafetyMonitor::BikeSafetyMonitor() :
+    tripped(false),
+    rule(SAFETY_PACKS_LOST),
+    pack(0),
+    value(0),
+    actions(0),
+    detectedUs(0),
+    actedUs(0),
+    escalated(false),
+    samples(0),
+    lastLatencyUs(0),
+    maxLatencyUs(0),
+    deadlineMisses(0),
+    packsLostMs(SAFETY_PACKS_LOST_MS),
+    packSeen(false),
+    lastPackSampleMs(0) {
+    memset(trips, 0, sizeof(trips));
+    packConnected[0] = false;
+    packConnected[1] = false;
+}
+
+const char* BikeSafetyMonitor::ruleName(SafetyRule rule) {
+    static const char* names[SAFETY_RULE_COUNT] = { "packs lost", "cell low", "FET hot", "pack current" };
+    return rule < SAFETY_RULE_COUNT ? names[rule] : "?";
+}
+
+void BikeSafetyMonitor::setBmsRequestMs(uint32_t periodMs) {
+    packsLostMs = max((uint32_t)SAFETY_PACKS_LOST_MS, (uint32_t)(periodMs * SAFETY_PACKS_LOST_REQUESTS));
+}
+
+uint8_t BikeSafetyMonitor::checkPack(uint8_t pack, const BMSData& data) {
+    uint8_t index = pack == 2 ? 1 : 0;
+    packConnected[index] = data.connected;
+    if (!data.connected) {
+        // Both marked down by the sensor manager: no need to wait for the timer
+        if (packSeen && !packConnected[0] && !packConnected[1]) {
+            return trip(SAFETY_PACKS_LOST, 0, millis() - lastPackSampleMs, SAFETY_ACTION_MOTOR);
+        }
+        return 0;
+    }
+    samples++;
+    packSeen = true;
+    lastPackSampleMs = millis();
+    
+    uint8_t discharge = index ? SAFETY_ACTION_PACK2_DISCHARGE : SAFETY_ACTION_PACK1_DISCHARGE;
+    uint8_t charge = index ? SAFETY_ACTION_PACK2_CHARGE : SAFETY_ACTION_PACK1_CHARGE;
+    if (data.numCells > 0 && data.lowestCellVolt < SAFETY_CELL_MIN_V) {
+        return trip(SAFETY_CELL_LOW, pack, data.lowestCellVolt, SAFETY_ACTION_MOTOR | discharge);
+    }
+    if (data.current > SAFETY_DISCHARGE_MAX_A) {
+        return trip(SAFETY_PACK_CURRENT, pack, data.current, SAFETY_ACTION_MOTOR | discharge);
+    }
+    if (-data.current > SAFETY_CHARGE_MAX_A) {
+        return trip(SAFETY_PACK_CURRENT, pack, data.current, SAFETY_ACTION_MOTOR | charge);
+    }
+    return 0;
+}
+
+uint8_t BikeSafetyMonitor::checkVesc(const VESCData& data) {
+    if (!data.connected) return 0;
+    samples++;
+    if (data.tempFET > SAFETY_FET_MAX_C) return trip(SAFETY_FET_HOT, 0, data.tempFET, SAFETY_ACTION_MOTOR);
+    return 0;
+}
+
+uint8_t BikeSafetyMonitor::checkPacksLost() {
+    if (!packSeen) return 0;
+    uint32_t silentMs = millis() - lastPackSampleMs;
+    if (silentMs < packsLostMs) return 0;
+    return trip(SAFETY_PACKS_LOST, 0, silentMs, SAFETY_ACTION_MOTOR);
+}
+
+uint32_t BikeSafetyMonitor::getNextCheckMs() const {
+    if (tripped) {
+        if (actedUs.load() || escalated) return SAFETY_NO_TIMED_WORK;
+        uint32_t elapsedMs = (micros() - detectedUs) / 1000;
+        return elapsedMs >= SAFETY_ACTION_DEADLINE_MS ? 0 : SAFETY_ACTION_DEADLINE_MS - elapsedMs;
+    }
+    if (!packSeen) return SAFETY_NO_TIMED_WORK;
+    uint32_t silentMs = millis() - lastPackSampleMs;
+    return silentMs >= packsLostMs ? 0 : packsLostMs - silentMs;
+}
+
+bool BikeSafetyMonitor::isActionOverdue() const {
+    return tripped && !escalated && !actedUs.load() &&
+           micros() - detectedUs >= SAFETY_ACTION_DEADLINE_MS * 1000UL;
+}
+
+void BikeSafetyMonitor::escalate() {
+    escalated = true;
+    deadlineMisses++;
+}
+
+void BikeSafetyMonitor::reset() {
+    tripped = false;
+    escalated = false;
+    actedUs.store(0);
+}
+
+void BikeSafetyMonitor::acted(uint32_t atUs) {
+    // Stamps from before this trip are a previous stop's
+    if (!tripped || actedUs.load() || !atUs || (int32_t)(atUs - detectedUs) < 0) return;
+    actedUs.store(atUs ? atUs : 1);
+    uint32_t latency = atUs - detectedUs;
+    lastLatencyUs = latency;
+    if (latency > maxLatencyUs) maxLatencyUs = latency;
+    if (latency > SAFETY_ACTION_DEADLINE_MS * 1000UL && !escalated) deadlineMisses++;
+}
+
+uint8_t BikeSafetyMonitor::trip(SafetyRule tripRule, uint8_t tripPack, float tripValue, uint8_t tripActions) {
+    if (tripped) return 0;
+    rule = tripRule;
+    pack = tripPack;
+    value = tripValue;
+    actions = tripActions;
+    detectedUs = micros();
+    actedUs.store(0);
+    escalated = false;
+    trips[tripRule]++;
+    tripped = true;
+    return tripActions;
+}
+
+void BikeSafetyMonitor::getSnapshot(SafetySnapshot& snapshot) const {
+    snapshot.tripped = tripped;
+    snapshot.rule = rule;
+    snapshot.pack = pack;
+    snapshot.value = value;
+    snapshot.actions = actions;
+    snapshot.detectedUs = detectedUs;
+    snapshot.actedUs = actedUs.load();
+    snapshot.escalated = escalated;
+    memcpy(snapshot.trips, trips, sizeof(trips));
+    snapshot.samples = samples;
+    snapshot.lastLatencyUs = lastLatencyUs;
+    snapshot.maxLatencyUs = maxLatencyUs;
+    snapshot.deadlineMisses = deadlineMisses;
+}
+
+void safetyPrintStats(const SafetySnapshot& snapshot) {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < SAFETY_RULE_COUNT; i++) total += snapshot.trips[i];
+    Serial.printf("[SAFETY] %s | %lu samples checked, %lu trips\n", snapshot.tripped ? "STOPPED" : "OK",
+                  (unsigned long)snapshot.samples, (unsigned long)total);
+    if (total == 0) return;
+    Serial.printf("  last: %s", BikeSafetyMonitor::ruleName(snapshot.rule));
+    if (snapshot.pack) Serial.printf(" on pack %u", snapshot.pack);
+    Serial.printf(" (%.2f), actions 0x%02X%s\n", snapshot.value, snapshot.actions,
+                  snapshot.escalated ? ", key output dropped" : "");
+    Serial.printf("  detection to action: last %lu us, max %lu us, deadline %u ms, missed %lu\n",
+                  (unsigned long)snapshot.lastLatencyUs, (unsigned long)snapshot.maxLatencyUs,
+                  SAFETY_ACTION_DEADLINE_MS, (unsigned long)snapshot.deadlineMisses);
+    Serial.print("  trips:");
+    for (uint8_t i = 0; i < SAFETY_RULE_COUNT; i++) {
+        Serial.printf(" %s=%lu", BikeSafetyMonitor::ruleName((SafetyRule)i), (unsigned long)snapshot.trips[i]);
+    }
+    Serial.println();
+}
@@ -0,0 +1,118 @@
+#ifndef BIKE_SAFETY_MONITOR_H
+#define BIKE_SAFETY_MONITOR_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "BikeData.h"
+
+// Safety rules of the main board. safetyTask runs them on every fresh pack
+// and VESC sample, straight from the data bus, and times the one rule no
+// sample can trip (both packs gone) itself:
+//
+//   packs lost     neither pack has answered for SAFETY_PACKS_LOST_MS      motor
+//   cell low       a cell under SAFETY_CELL_MIN_V                          motor, that pack's discharge MOS
+//   FET hot        VESC MOSFETs over SAFETY_FET_MAX_C                      motor
+//   pack current   over SAFETY_DISCHARGE_MAX_A out of a pack, or           motor, that pack's discharge
+//                  SAFETY_CHARGE_MAX_A into it                             or charge MOS
+//
+// "Motor" is VESC current 0 and a light brake current. The VESC and BMS
+// ports belong to sensorTask, so the stop is carried out there: safetyTask
+// hands the actions over (BikeSensorManager::requestSafeStop()) and sensorTask,
+// woken for it, sends them before anything else. Detection to action is
+// bounded by SAFETY_ACTION_DEADLINE_MS; when sensorTask cannot make it (a
+// VESC read can hold it for 100 ms), safetyTask drops the key output that
+// powers the VESC instead (BikeRFIDManager::cutPower()): that locks the bike.
+//
+// The first rule to trip latches the stop, and the motor is held at zero,
+// until the bike is locked. MOS switched off stay off: the packs turn them
+// back on at their next power-up, or from the BMS app.
+
+#define SAFETY_CELL_MIN_V          2.8f     // Lowest cell, V
+#define SAFETY_FET_MAX_C           85.0f    // VESC MOSFETs, °C
+#define SAFETY_DISCHARGE_MAX_A     40.0f    // Per pack
+#define SAFETY_CHARGE_MAX_A        15.0f    // Per pack, into it
+#define SAFETY_PACKS_LOST_MS       5000     // Neither pack sampled this long...
+#define SAFETY_PACKS_LOST_REQUESTS 2.5f     // ...or this many BMS request intervals, if longer
+#define SAFETY_ACTION_DEADLINE_MS  50       // Detection to the commands on the wire
+#define SAFETY_BRAKE_A             2.0f     // Brake current after the motor current is zeroed
+#define SAFETY_NO_TIMED_WORK       0xFFFFFFFFUL
+
+enum SafetyRule {
+    SAFETY_PACKS_LOST = 0,
+    SAFETY_CELL_LOW = 1,
+    SAFETY_FET_HOT = 2,
+    SAFETY_PACK_CURRENT = 3,
+    SAFETY_RULE_COUNT = 4
+};
+
+// What the stop does (BikeSensorManager::requestSafeStop())
+#define SAFETY_ACTION_MOTOR            (1U << 0)   // VESC current 0, then SAFETY_BRAKE_A
+#define SAFETY_ACTION_PACK1_DISCHARGE  (1U << 1)   // Discharge MOS off
+#define SAFETY_ACTION_PACK2_DISCHARGE  (1U << 2)
+#define SAFETY_ACTION_PACK1_CHARGE     (1U << 3)   // Charge MOS off
+#define SAFETY_ACTION_PACK2_CHARGE     (1U << 4)
+
+struct SafetySnapshot {
+    bool tripped;                   // Latched, until the bike is locked
+    SafetyRule rule;                // The one that tripped
+    uint8_t pack;                   // 1 or 2 for the pack rules, 0 otherwise
+    float value;                    // What it saw: V, °C, A, or ms without a pack sample
+    uint8_t actions;                // SAFETY_ACTION_* asked for
+    uint32_t detectedUs;            // micros() at detection
+    uint32_t actedUs;               // micros() when the commands were sent, 0 before
+    bool escalated;                 // Key output dropped: the deadline passed first
+    uint32_t trips[SAFETY_RULE_COUNT];
+    uint32_t samples;               // Pack and VESC samples checked
+    uint32_t lastLatencyUs;         // Detection to action, last trip
+    uint32_t maxLatencyUs;
+    uint32_t deadlineMisses;
+};
+
+class BikeSafetyMonitor {
+public:
+    BikeSafetyMonitor();
+    
+    static const char* ruleName(SafetyRule rule);
+    
+    // safetyTask only. The checks return the actions a new trip needs, 0 if none
+    void setBmsRequestMs(uint32_t periodMs);                 // With the power profile
+    uint8_t checkPack(uint8_t pack, const BMSData& data);   // pack: 1 or 2
+    uint8_t checkVesc(const VESCData& data);
+    uint8_t checkPacksLost();
+    uint32_t getNextCheckMs() const;    // Until the deadline or packs lost, SAFETY_NO_TIMED_WORK if neither
+    bool isActionOverdue() const;       // Tripped, not acted on and past the deadline
+    void escalate();
+    void reset();                       // Bike locked
+    bool isTripped() const { return tripped; }
+    
+    // sensorTask, once the actions are on the wire
+    void acted(uint32_t atUs);
+    
+    // Any task; may be a trip behind
+    void getSnapshot(SafetySnapshot& snapshot) const;
+
+private:
+    volatile bool tripped;
+    volatile SafetyRule rule;
+    volatile uint8_t pack;
+    volatile float value;
+    volatile uint8_t actions;
+    volatile uint32_t detectedUs;
+    std::atomic<uint32_t> actedUs;
+    volatile bool escalated;
+    uint32_t trips[SAFETY_RULE_COUNT];
+    volatile uint32_t samples;
+    volatile uint32_t lastLatencyUs;
+    volatile uint32_t maxLatencyUs;
+    volatile uint32_t deadlineMisses;
+    uint32_t packsLostMs;
+    bool packSeen;                      // Packs lost is armed by the first sample
+    bool packConnected[2];
+    uint32_t lastPackSampleMs;
+    
+    uint8_t trip(SafetyRule rule, uint8_t pack, float value, uint8_t actions);
+};
+
+void safetyPrintStats(const SafetySnapshot& snapshot);
+
+#endif
@@ -5,6 +5,7 @@ volatile unsigned long BikeSensorManager::hallPulseCount = 0;
 volatile unsigned long BikeSensorManager::lastHallTime = 0;
 volatile float BikeSensorManager::hallFrequency = 0.0;
 volatile bool BikeSensorManager::hallFrequencyReady = false;
+TaskHandle_t BikeSensorManager::wakeTask = NULL;
 
 // Hall sensor interrupt service routine
 void IRAM_ATTR BikeSensorManager::hallSensorISR() {
@@ -22,6 +23,35 @@ void IRAM_ATTR BikeSensorManager::hallSensorISR() {
     
     lastHallTime = currentTime;
     hallPulseCount++;
+    
+    if (wakeTask) {
+        BaseType_t woken = pdFALSE;
+        xTaskNotifyFromISR(wakeTask, SENSOR_EVENT_HALL, eSetBits, &woken);
+        if (woken) portYIELD_FROM_ISR();
+    }
+}
+
+// Brake and turn signal edges (event-driven mode only)
+void IRAM_ATTR BikeSensorManager::inputEdgeISR() {
+    BaseType_t woken = pdFALSE;
+    xTaskNotifyFromISR(wakeTask, SENSOR_EVENT_INPUTS, eSetBits, &woken);
+    if (woken) portYIELD_FROM_ISR();
+}
+
+// From task context (UART event task, other tasks)
+void BikeSensorManager::wake(uint32_t events) {
+    if (wakeTask) xTaskNotify(wakeTask, events, eSetBits);
+}
+
+// Rolling sample number for latency tracing, 0 is reserved for "never read"
+static uint8_t nextSampleSeq(uint8_t seq) {
+    return (seq == 255) ? 1 : seq + 1;
+}
+
+// Truncated to the field, zero padded so records compare with memcmp
+static void copyInfoString(char* out, const char* value) {
+    strncpy(out, value, BMS_INFO_MAX_LEN - 1);
+    out[BMS_INFO_MAX_LEN - 1] = '\0';
 }
 
 BikeSensorManager::BikeSensorManager() : 
@@ -30,11 +60,22 @@ BikeSensorManager::BikeSensorManager() :
     vescSerial(VESC_RX, VESC_TX),
     vesc(),
     lastSensorUpdate(0),
+    lastBMSRequest(0),
+    lastBMS1Response(0),
+    lastBMS2Response(0),
+    pollPeriodMs(SENSOR_POLL_PERIOD_MS),
+    bmsRequestMs(SENSOR_BMS_REQUEST_MS),
+    bmsTimeoutMs(SENSOR_BMS_TIMEOUT_MS),
+    vescPollEnabled(true),
+    safeStopPending(0),
+    safeStopSentUs(0),
+    motorHeld(false),
     bmsInitialized(false),
     vescInitialized(false) {
     
     // Initialize status to safe defaults
     memset(&bikeStatus, 0, sizeof(BikeStatus));
+    memset(&identity, 0, sizeof(BikeIdentity));
     bikeStatus.operationState = BIKE_OFF;
 }
 
@@ -78,11 +119,134 @@ void BikeSensorManager::update() {
         updateVESCData();
         updateGPIOSensors();
         updateHallSensors();
+        updateInputStamp();
         
         lastSensorUpdate = currentTime;
     }
 }
 
+void BikeSensorManager::setWakeTask(TaskHandle_t task) {
+    wakeTask = task;
+    
+    // Inputs: any edge, read in the task
+    attachInterrupt(digitalPinToInterrupt(BRAKE_PIN), inputEdgeISR, CHANGE);
+    attachInterrupt(digitalPinToInterrupt(LEFT_PIN), inputEdgeISR, CHANGE);
+    attachInterrupt(digitalPinToInterrupt(RIGHT_PIN), inputEdgeISR, CHANGE);
+    
+    // BMS: one callback once a response has gone quiet, not per byte
+    Serial2.onReceive([]() { wake(SENSOR_EVENT_BMS1); }, true);
+    Serial1.onReceive([]() { wake(SENSOR_EVENT_BMS2); }, true);
+    
+    Serial.println("Sensor wakeups: BMS UART RX, Hall and input interrupts");
+}
+
+void BikeSensorManager::update(uint32_t events) {
+    unsigned long currentTime = millis();
+    bool inputsRead = false;
+    
+    // A safety stop goes out before anything else, whatever woke the task
+    uint8_t stop = safeStopPending.exchange(0);
+    if (stop) sendSafeStop(stop);
+    
+    // Responses to the last BMS request
+    if (bmsInitialized && (events & SENSOR_EVENT_BMS1)) {
+        bms1.update();
+        updatePack(bms1, bikeStatus.bms1, identity.bms1);
+        if (bikeStatus.bms1.connected) lastBMS1Response = currentTime;
+    }
+    if (bmsInitialized && (events & SENSOR_EVENT_BMS2)) {
+        bms2.update();
+        updatePack(bms2, bikeStatus.bms2, identity.bms2);
+        if (bikeStatus.bms2.connected) lastBMS2Response = currentTime;
+    }
+    
+    if (events & SENSOR_EVENT_INPUTS) {
+        updateGPIOSensors();
+        inputsRead = true;
+    }
+    if (events & SENSOR_EVENT_HALL) {
+        updateHallSensors();
+        inputsRead = true;
+    }
+    
+    // Timed work: request/response devices and timeouts
+    if (currentTime - lastSensorUpdate >= pollPeriodMs) {
+        lastSensorUpdate = currentTime;
+        
+        if (bmsInitialized && currentTime - lastBMSRequest >= bmsRequestMs) {
+            bms1.requestData();
+            bms2.requestData();
+            lastBMSRequest = currentTime;
+        }
+        if (currentTime - lastBMS1Response > bmsTimeoutMs) bikeStatus.bms1.connected = false;
+        if (currentTime - lastBMS2Response > bmsTimeoutMs) bikeStatus.bms2.connected = false;
+        
+        if (motorHeld) holdMotor();
+        if (vescPollEnabled) updateVESCData();
+        updateGPIOSensors();   // Resync in case an edge was missed
+        updateHallSensors();   // Speed back to 0 once the pulses stop
+        inputsRead = true;
+    }
+    
+    if (inputsRead) updateInputStamp();
+}
+
+uint32_t BikeSensorManager::getNextUpdateMs() const {
+    unsigned long elapsed = millis() - lastSensorUpdate;
+    return elapsed >= pollPeriodMs ? 0 : pollPeriodMs - elapsed;
+}
+
+void BikeSensorManager::setPollPeriods(uint32_t pollMs, uint32_t bmsMs, bool vescPoll) {
+    pollPeriodMs = pollMs;
+    bmsRequestMs = bmsMs;
+    bmsTimeoutMs = max((uint32_t)SENSOR_BMS_TIMEOUT_MS, (uint32_t)(bmsMs * SENSOR_BMS_TIMEOUT_REQUESTS));
+    
+    // A VESC that is not asked has no current reading: say so instead of keeping the last one
+    if (!vescPoll && vescPollEnabled) bikeStatus.vesc.connected = false;
+    vescPollEnabled = vescPoll;
+}
+
+void BikeSensorManager::requestSafeStop(uint8_t actions) {
+    safeStopPending.fetch_or(actions);
+    wake(SENSOR_EVENT_SAFE_STOP);
+}
+
+void BikeSensorManager::releaseSafeStop() {
+    safeStopPending.store(0);
+    motorHeld = false;
+}
+
+uint32_t BikeSensorManager::getSafeStopUs() const {
+    return safeStopSentUs.load();
+}
+
+// Motor first: it is what the rider feels
+void BikeSensorManager::sendSafeStop(uint8_t actions) {
+    if ((actions & SAFETY_ACTION_MOTOR) && vescInitialized) {
+        holdMotor();
+        motorHeld = true;
+    }
+    if (bmsInitialized) {
+        if (actions & SAFETY_ACTION_PACK1_DISCHARGE) bms1.requestDischargeMOS(false);
+        if (actions & SAFETY_ACTION_PACK2_DISCHARGE) bms2.requestDischargeMOS(false);
+        if (actions & SAFETY_ACTION_PACK1_CHARGE) bms1.requestChargeMOS(false);
+        if (actions & SAFETY_ACTION_PACK2_CHARGE) bms2.requestChargeMOS(false);
+    }
+    uint32_t now = micros();
+    safeStopSentUs.store(now ? now : 1);
+}
+
+// Repeated at every poll while held: the VESC drops a UART command after its timeout
+void BikeSensorManager::holdMotor() {
+    vesc.setCurrent(0);
+    vesc.setBrakeCurrent(SAFETY_BRAKE_A);
+}
+
+void BikeSensorManager::updateInputStamp() {
+    bikeStatus.sampleSeq = nextSampleSeq(bikeStatus.sampleSeq);
+    bikeStatus.sampleUs = micros();
+}
+
 bool BikeSensorManager::initializeBMS() {
     bms1.begin(115200);
     bms2.begin(115200);
@@ -115,88 +279,59 @@ bool BikeSensorManager::initializeVESC() {
 void BikeSensorManager::updateBMSData() {
     if (!bmsInitialized) return;
     
-    // Update BMS1 data using JKBMSInterface
+    // Update BMS1 and BMS2 data using JKBMSInterface
     bms1.update();
+    updatePack(bms1, bikeStatus.bms1, identity.bms1);
     
-    // Check if BMS1 data is valid and update bike status
-    if (bms1.isDataValid()) {
-        // Basic measurements
-        bikeStatus.bms1.voltage = bms1.getVoltage();
-        bikeStatus.bms1.current = bms1.getCurrent();
-        bikeStatus.bms1.soc = bms1.getSOC();
-        bikeStatus.bms1.temperature = bms1.getBatteryTemp();
-        bikeStatus.bms1.connected = true;
-        
-        // Extended data
-        bikeStatus.bms1.cycles = bms1.getCycles();
-        bikeStatus.bms1.powerTemp = bms1.getPowerTemp();
-        bikeStatus.bms1.boxTemp = bms1.getBoxTemp();
-        
-        // Debug: Print BMS1 temperatures (disabled for cleaner output)
-        // Serial.printf("🌡️ [BMS1] Battery: %.1f°C, Power: %.1f°C, Box: %.1f°C\n", 
-        //              bikeStatus.bms1.temperature, bikeStatus.bms1.powerTemp, bikeStatus.bms1.boxTemp);
-        
-        // Cell voltage info
-        bikeStatus.bms1.numCells = bms1.getNumCells();
-        bikeStatus.bms1.lowestCellVolt = bms1.getLowestCellVoltage();
-        bikeStatus.bms1.highestCellVolt = bms1.getHighestCellVoltage();
-        bikeStatus.bms1.cellVoltageDelta = (uint16_t)(bms1.getCellVoltageDelta() * 1000); // Convert V to mV
-        
-        // Status flags
-        bikeStatus.bms1.alarmStatus = bms1.getAlarmStatus();
-        bikeStatus.bms1.statusInfo = bms1.getStatusInfo();
-        bikeStatus.bms1.isCharging = bms1.isCharging();
-        bikeStatus.bms1.isDischarging = bms1.isDischarging();
-        bikeStatus.bms1.chargingEnabled = bms1.isChargingEnabled();
-        bikeStatus.bms1.dischargingEnabled = bms1.isDischargingEnabled();
-        
-        // Device info
-        bikeStatus.bms1.softwareVersion = bms1.getSoftwareVersion();
-        bikeStatus.bms1.deviceInfo = bms1.getDeviceInfo();
-    } else {
-        bikeStatus.bms1.connected = false;
-    }
-    
-    // Update BMS2 data using JKBMSInterface
     bms2.update();
-    
-    // Check if BMS2 data is valid and update bike status
-    if (bms2.isDataValid()) {
+    updatePack(bms2, bikeStatus.bms2, identity.bms2);
+}
+
+// Copy what the interface parsed last into the bike status
+void BikeSensorManager::updatePack(JKBMSInterface& bms, BMSData& data, BMSInfo& info) {
+    // Check if BMS data is valid and update bike status
+    if (bms.isDataValid()) {
         // Basic measurements
-        bikeStatus.bms2.voltage = bms2.getVoltage();
-        bikeStatus.bms2.current = bms2.getCurrent();
-        bikeStatus.bms2.soc = bms2.getSOC();
-        bikeStatus.bms2.temperature = bms2.getBatteryTemp();
-        bikeStatus.bms2.connected = true;
+        data.voltage = bms.getVoltage();
+        data.current = bms.getCurrent();
+        data.soc = bms.getSOC();
+        data.temperature = bms.getBatteryTemp();
+        data.connected = true;
+        data.sampleSeq = nextSampleSeq(data.sampleSeq);
+        data.sampleUs = micros();
         
         // Extended data
-        bikeStatus.bms2.cycles = bms2.getCycles();
-        bikeStatus.bms2.powerTemp = bms2.getPowerTemp();
-        bikeStatus.bms2.boxTemp = bms2.getBoxTemp();
+        data.cycles = bms.getCycles();
+        data.powerTemp = bms.getPowerTemp();
+        data.boxTemp = bms.getBoxTemp();
         
-        // Debug: Print BMS2 temperatures (disabled for cleaner output)
-        // Serial.printf("🌡️ [BMS2] Battery: %.1f°C, Power: %.1f°C, Box: %.1f°C\n", 
-        //              bikeStatus.bms2.temperature, bikeStatus.bms2.powerTemp, bikeStatus.bms2.boxTemp);
+        // Debug: Print BMS temperatures (disabled for cleaner output)
+        // Serial.printf("🌡️ [BMS] Battery: %.1f°C, Power: %.1f°C, Box: %.1f°C\n", 
+        //              data.temperature, data.powerTemp, data.boxTemp);
         
         // Cell voltage info
-        bikeStatus.bms2.numCells = bms2.getNumCells();
-        bikeStatus.bms2.lowestCellVolt = bms2.getLowestCellVoltage();
-        bikeStatus.bms2.highestCellVolt = bms2.getHighestCellVoltage();
-        bikeStatus.bms2.cellVoltageDelta = (uint16_t)(bms2.getCellVoltageDelta() * 1000); // Convert V to mV
+        data.numCells = bms.getNumCells();
+        data.lowestCellVolt = bms.getLowestCellVoltage();
+        data.highestCellVolt = bms.getHighestCellVoltage();
+        data.cellVoltageDelta = (uint16_t)(bms.getCellVoltageDelta() * 1000); // Convert V to mV
+        for (uint8_t i = 0; i < BMS_MAX_CELLS; i++) {
+            float cell = (i < data.numCells) ? bms.getCellVoltage(i) : 0.0f;
+            data.cellVoltagesMv[i] = cell > 0 ? (uint16_t)(cell * 1000 + 0.5f) : 0;
+        }
         
         // Status flags
-        bikeStatus.bms2.alarmStatus = bms2.getAlarmStatus();
-        bikeStatus.bms2.statusInfo = bms2.getStatusInfo();
-        bikeStatus.bms2.isCharging = bms2.isCharging();
-        bikeStatus.bms2.isDischarging = bms2.isDischarging();
-        bikeStatus.bms2.chargingEnabled = bms2.isChargingEnabled();
-        bikeStatus.bms2.dischargingEnabled = bms2.isDischargingEnabled();
+        data.alarmStatus = bms.getAlarmStatus();
+        data.statusInfo = bms.getStatusInfo();
+        data.isCharging = bms.isCharging();
+        data.isDischarging = bms.isDischarging();
+        data.chargingEnabled = bms.isChargingEnabled();
+        data.dischargingEnabled = bms.isDischargingEnabled();
         
         // Device info
-        bikeStatus.bms2.softwareVersion = bms2.getSoftwareVersion();
-        bikeStatus.bms2.deviceInfo = bms2.getDeviceInfo();
+        copyInfoString(info.softwareVersion, bms.getSoftwareVersion());
+        copyInfoString(info.deviceInfo, bms.getDeviceInfo());
     } else {
-        bikeStatus.bms2.connected = false;
+        data.connected = false;
     }
 }
 
@@ -211,6 +346,8 @@ void BikeSensorManager::updateVESCData() {
         bikeStatus.vesc.tempFET = vesc.data.tempMosfet;
         bikeStatus.vesc.tempMotor = vesc.data.tempMotor;
         bikeStatus.vesc.connected = true;
+        bikeStatus.vesc.sampleSeq = nextSampleSeq(bikeStatus.vesc.sampleSeq);
+        bikeStatus.vesc.sampleUs = micros();
     } else {
         bikeStatus.vesc.connected = false;
     }
@@ -234,7 +371,7 @@ void BikeSensorManager::updateHallSensors() {
         
         // Calculate bike speed from Hall frequency
         bikeStatus.bikeSpeed = calculateBikeSpeed(bikeStatus.hallFrequency);
-        
+    
     } else {
         // Check if Hall sensor has been inactive (no pulses for >2 seconds)
         unsigned long currentTime = micros();
@@ -251,8 +388,21 @@ BikeStatus BikeSensorManager::getBikeStatus() const {
     return bikeStatus;
 }
 
+const BikeStatus& BikeSensorManager::peekBikeStatus() const {
+    return bikeStatus;
+}
+
+BikeIdentity BikeSensorManager::getIdentity() const {
+    return identity;
+}
+
+const BikeIdentity& BikeSensorManager::peekIdentity() const {
+    return identity;
+}
+
 void BikeSensorManager::setBikeKeyState(bool keyOn) {
     bikeStatus.keyOn = keyOn;
+    wake(SENSOR_EVENT_INPUTS);  // Published with the inputs
 }
 
 void BikeSensorManager::setMotorCurrent(float current) {
@@ -1,15 +1,39 @@
 #pragma once
 
 #include "Arduino.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include <SoftwareSerial.h>
+#include <atomic>
 #include "../JKBMSInterface/JKBMSInterface.h"
 #include "../Vesc_Uart/src/VescUart.h"
 #include "BikeMainHardware.h"
 #include "BikeData.h"
+#include "BikeSafetyMonitor.h"
+
+// Event-driven updates (setWakeTask()). Each event sets a bit in the wake
+// task's notification value; update(events) then does that part only.
+// Bits 16+ stay clear of the data bus topic bits (BUS_TASK_EVENT_FIRST).
+#define SENSOR_EVENT_BMS1          (1UL << 16)  // BMS1 response received (UART idle after RX)
+#define SENSOR_EVENT_BMS2          (1UL << 17)  // BMS2 response received
+#define SENSOR_EVENT_INPUTS        (1UL << 18)  // Brake/turn signal edge or key state change
+#define SENSOR_EVENT_HALL          (1UL << 19)  // Hall pulse
+#define SENSOR_EVENT_SAFE_STOP     (1UL << 20)  // requestSafeStop() from the safety monitor
+#define SENSOR_EVENTS              (SENSOR_EVENT_BMS1 | SENSOR_EVENT_BMS2 | SENSOR_EVENT_INPUTS | SENSOR_EVENT_HALL | \
+                                    SENSOR_EVENT_SAFE_STOP)
+
+// What still runs on a timer: the VESC and BMS are request/response, and a
+// stopped wheel sends no pulses. Defaults; setPollPeriods() changes them
+// with the power profile.
+#define SENSOR_POLL_PERIOD_MS      1000   // VESC read, Hall timeout, input resync
+#define SENSOR_BMS_REQUEST_MS      2000   // JK-BMS request interval
+#define SENSOR_BMS_TIMEOUT_MS      5000   // No response for this long: pack disconnected
+#define SENSOR_BMS_TIMEOUT_REQUESTS 2.5f  // Longer request intervals: this many of them
 
 class BikeSensorManager {
 private:
     BikeStatus bikeStatus;
+    BikeIdentity identity;     // BMS strings, updated with the BMS reads
     JKBMSInterface bms1;
     JKBMSInterface bms2;
     SoftwareSerial vescSerial;
@@ -17,6 +41,18 @@ private:
     
     // Timing
     unsigned long lastSensorUpdate;
+    unsigned long lastBMSRequest;
+    unsigned long lastBMS1Response;
+    unsigned long lastBMS2Response;
+    uint32_t pollPeriodMs;
+    uint32_t bmsRequestMs;
+    uint32_t bmsTimeoutMs;
+    bool vescPollEnabled;
+    
+    // Safety stop (BikeSafetyMonitor.h): handed over by safetyTask, sent by update()
+    std::atomic<uint8_t> safeStopPending;   // SAFETY_ACTION_* not sent yet
+    std::atomic<uint32_t> safeStopSentUs;
+    volatile bool motorHeld;                // VESC kept at zero until releaseSafeStop()
     
     // Sensor state
     bool bmsInitialized;
@@ -28,11 +64,20 @@ private:
     static volatile float hallFrequency;
     static volatile bool hallFrequencyReady;
     
+    // Event-driven mode
+    static TaskHandle_t wakeTask;
+    static void IRAM_ATTR inputEdgeISR();
+    static void wake(uint32_t events);
+    
     // Private methods
     void updateBMSData();
+    void updatePack(JKBMSInterface& bms, BMSData& data, BMSInfo& info);
+    void updateInputStamp();
     void updateVESCData();
     void updateGPIOSensors();
     void updateHallSensors();
+    void sendSafeStop(uint8_t actions);
+    void holdMotor();
     
     // Hall sensor interrupt handler
     static void IRAM_ATTR hallSensorISR();
@@ -43,10 +88,25 @@ public:
     
     // Core functions
     void begin();
-    void update();
+    void update();                         // Polling: everything, once per second
+    
+    // Event-driven: wakeups from interrupts and UART events instead of polling
+    void setWakeTask(TaskHandle_t task);   // Before the first update(events)
+    void update(uint32_t events);          // SENSOR_EVENT_* bits, plus the timed work when due
+    uint32_t getNextUpdateMs() const;      // Until the timed work is due
+    void setPollPeriods(uint32_t pollMs, uint32_t bmsMs, bool vescPoll);  // From the update() task
+    
+    // Safety stop, from any task: the VESC and BMS ports stay with the update()
+    // task, which sends the actions first thing when woken for them
+    void requestSafeStop(uint8_t actions);  // SAFETY_ACTION_* bits
+    void releaseSafeStop();                 // Stop holding the motor at zero
+    uint32_t getSafeStopUs() const;         // micros() when the last stop was sent, 0 if never
     
     // Data access
     BikeStatus getBikeStatus() const;
+    const BikeStatus& peekBikeStatus() const;  // No copy: only from the task calling update()
+    BikeIdentity getIdentity() const;
+    const BikeIdentity& peekIdentity() const;  // Same rule as peekBikeStatus()
     
     // Bike control
     void setBikeKeyState(bool keyOn);
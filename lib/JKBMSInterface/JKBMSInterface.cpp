@@ -7,7 +7,7 @@ static const uint8_t readAllCommand[] = {
   0x68, 0x00, 0x00, 0x01, 0x29
 };
 
-JKBMSInterface::JKBMSInterface(HardwareSerial* serial) : _serial(serial), _responseIndex(0), _lastCommandSent(0) {
+JKBMSInterface::JKBMSInterface(HardwareSerial* serial) : _serial(serial), _responseIndex(0), _lastCommandSent(0), _mosAcks(0) {
     clearData();
 }
 
@@ -33,8 +33,8 @@ void JKBMSInterface::clearData() {
     _bmsData.alarmStatus = 0;
     _bmsData.statusInfo = 0;
     _bmsData.cycles = 0;
-    _bmsData.softwareVersion = "";
-    _bmsData.deviceInfo = "";
+    _bmsData.softwareVersion[0] = '\0';
+    _bmsData.deviceInfo[0] = '\0';
     
     for (int i = 0; i < 24; i++) {
         _bmsData.cellVoltages[i] = 0;
@@ -58,8 +58,15 @@ void JKBMSInterface::update() {
             _responseBuffer[_responseIndex-3] == 0x00 && // Checksum start
             _responseBuffer[_responseIndex-2] == 0x00) {
             
-            // Parse the complete frame
-            parseRawData(_responseBuffer, _responseIndex);
+            // Parse the complete frame; a write acknowledgement (command word 0x02) only counts.
+            // The frame may start a byte in, behind the last checksum byte of the one before.
+            int start = _responseBuffer[0] == 0x4E ? 0 : 1;
+            if (_responseIndex > start + 10 && _responseBuffer[start] == 0x4E &&
+                _responseBuffer[start + 8] == 0x02 && _responseBuffer[start + 10] == 0x01) {
+                _mosAcks++;
+            } else {
+                parseRawData(_responseBuffer, _responseIndex);
+            }
             _responseIndex = 0;
         }
         
@@ -110,7 +117,7 @@ void JKBMSInterface::parseRawData(uint8_t* data, int length) {
                     }
                 }
                 break;
-                
+            
             case 0x80: // Power tube temperature  
                 if (pos + 1 < length) {
                     uint16_t temp = (data[pos] << 8) | data[pos+1]; // Big endian
@@ -118,7 +125,7 @@ void JKBMSInterface::parseRawData(uint8_t* data, int length) {
                     pos += 2;
                 }
                 break;
-                
+            
             case 0x81: // Box temperature
                 if (pos + 1 < length) {
                     uint16_t temp = (data[pos] << 8) | data[pos+1]; // Big endian
@@ -126,7 +133,7 @@ void JKBMSInterface::parseRawData(uint8_t* data, int length) {
                     pos += 2;
                 }
                 break;
-                
+            
             case 0x82: // Battery temperature
                 if (pos + 1 < length) {
                     uint16_t temp = (data[pos] << 8) | data[pos+1]; // Big endian
@@ -134,7 +141,7 @@ void JKBMSInterface::parseRawData(uint8_t* data, int length) {
                     pos += 2;
                 }
                 break;
-                
+            
             case 0x83: // Total voltage
                 if (pos + 1 < length) {
                     uint16_t voltage = (data[pos] << 8) | data[pos+1]; // Big endian
@@ -142,7 +149,7 @@ void JKBMSInterface::parseRawData(uint8_t* data, int length) {
                     pos += 2;
                 }
                 break;
-                
+            
             case 0x84: // Current
                 if (pos + 1 < length) {
                     uint16_t current = (data[pos] << 8) | data[pos+1]; // Big endian
@@ -161,81 +168,80 @@ void JKBMSInterface::parseRawData(uint8_t* data, int length) {
                     pos += 2;
                 }
                 break;
-                
+            
             case 0x85: // SOC
                 if (pos < length) {
                     _bmsData.soc = data[pos];
                     pos += 1;
                 }
                 break;
-                
+            
             case 0x86: // Temperature sensor count
                 if (pos < length) {
                     pos += 1; // Skip this data
                 }
                 break;
-                
+            
             case 0x87: // Cycles
                 if (pos + 1 < length) {
                     _bmsData.cycles = (data[pos] << 8) | data[pos+1]; // Big endian
                     pos += 2;
                 }
                 break;
-                
+            
             case 0x8B: // Alarm status
                 if (pos + 1 < length) {
                     _bmsData.alarmStatus = (data[pos] << 8) | data[pos+1]; // Big endian
                     pos += 2;
                 }
                 break;
-                
+            
             case 0x8C: // Status info
                 if (pos + 1 < length) {
                     _bmsData.statusInfo = (data[pos] << 8) | data[pos+1]; // Big endian
                     pos += 2;
                 }
                 break;
-                
+            
             case 0xB7: // Software version
                 {
-                    String version = "";
+                    uint8_t len = 0;
                     for (int i = 0; i < 15 && pos < length; i++) {
                         if (data[pos] >= 0x20 && data[pos] <= 0x7E) {
-                            version += (char)data[pos];
+                            _bmsData.softwareVersion[len++] = (char)data[pos];
                         }
                         pos++;
                     }
-                    _bmsData.softwareVersion = version;
+                    _bmsData.softwareVersion[len] = '\0';
                 }
                 break;
-                
+            
             case 0xB4: // Device info part 1
                 {
-                    String info = "";
+                    // Not kept
                     while (pos < length && data[pos] >= 0x20 && data[pos] <= 0x7E) {
-                        info += (char)data[pos];
                         pos++;
                     }
                     if (pos < length && data[pos] == 0x00) pos++; // Skip null
                 }
                 break;
-                
+            
             case 0xBA: // Device info part 2
                 {
-                    String fullName = "";
+                    uint8_t len = 0;
                     while (pos < length && data[pos] >= 0x20 && data[pos] <= 0x7E) {
-                        fullName += (char)data[pos];
+                        if (len < JKBMS_INFO_MAX_LEN - 1) _bmsData.deviceInfo[len++] = (char)data[pos];
                         pos++;
                     }
-                    _bmsData.deviceInfo = fullName;
+                    _bmsData.deviceInfo[len] = '\0';
                     if (pos < length && data[pos] == 0x00) pos++; // Skip null
                 }
                 break;
-                
+            
             case 0x68: // End marker found
                 _bmsData.dataValid = true;
                 return;
-                
+            
             default:
                 // Skip unknown data types
                 if (dataId >= 0x8E && dataId <= 0xC0) {
@@ -343,11 +349,11 @@ bool JKBMSInterface::isDischarging() {
     return _bmsData.dataValid ? _bmsData.current > 0.01f : false;
 }
 
-String JKBMSInterface::getSoftwareVersion() {
+const char* JKBMSInterface::getSoftwareVersion() {
     return _bmsData.dataValid ? _bmsData.softwareVersion : "Unknown";
 }
 
-String JKBMSInterface::getDeviceInfo() {
+const char* JKBMSInterface::getDeviceInfo() {
     return _bmsData.dataValid ? _bmsData.deviceInfo : "Unknown";
 }
 
@@ -365,6 +371,18 @@ uint16_t JKBMSInterface::calculateChecksum(uint8_t* data, int length) {
 }
 
 bool JKBMSInterface::sendMOSCommand(uint8_t dataId, bool enable) {
+    // Clear receive buffer before sending command
+    while (_serial->available()) {
+        _serial->read();
+    }
+    
+    writeMOSCommand(dataId, enable);
+    
+    // Wait for and verify response
+    return waitForMOSResponse(3000);
+}
+
+void JKBMSInterface::writeMOSCommand(uint8_t dataId, bool enable) {
     uint8_t command[32];
     int pos = 0;
     
@@ -420,16 +438,8 @@ bool JKBMSInterface::sendMOSCommand(uint8_t dataId, bool enable) {
     command[pos++] = (checksum >> 8) & 0xFF; // Sum high byte
     command[pos++] = checksum & 0xFF;        // Sum low byte
     
-    // Clear receive buffer before sending command
-    while (_serial->available()) {
-        _serial->read();
-    }
-    
     // Send command
     _serial->write(command, pos);
-    
-    // Wait for and verify response
-    return waitForMOSResponse(3000);
 }
 
 bool JKBMSInterface::waitForMOSResponse(unsigned long timeoutMs) {
@@ -487,6 +497,18 @@ bool JKBMSInterface::setDischargeMOS(bool enable) {
     return sendMOSCommand(0xAC, enable); // 0xAC = Discharge MOS tube switch
 }
 
+void JKBMSInterface::requestChargeMOS(bool enable) {
+    writeMOSCommand(0xAB, enable);
+}
+
+void JKBMSInterface::requestDischargeMOS(bool enable) {
+    writeMOSCommand(0xAC, enable);
+}
+
+uint32_t JKBMSInterface::getMOSAcks() {
+    return _mosAcks;
+}
+
 void JKBMSInterface::enableBatteryOperation() {
     setChargeMOS(true);
     delay(500);
@@ -569,7 +591,7 @@ void JKBMSInterface::printSummary() {
         }
     }
     
-    if (_bmsData.softwareVersion.length() > 0) {
+    if (_bmsData.softwareVersion[0]) {
         Serial.print("║ Software: ");
         Serial.print(_bmsData.softwareVersion);
         Serial.println("           ║");
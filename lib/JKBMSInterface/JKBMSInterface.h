@@ -3,6 +3,8 @@
 
 #include <Arduino.h>
 
+#define JKBMS_INFO_MAX_LEN 32   // Version and device strings, with the NUL
+
 class JKBMSInterface {
 public:
     // Constructor
@@ -44,8 +46,8 @@ public:
     bool isDischarging();
     
     // Info getters
-    String getSoftwareVersion();
-    String getDeviceInfo();
+    const char* getSoftwareVersion();
+    const char* getDeviceInfo();
     
     // Data validity
     bool isDataValid();
@@ -53,6 +55,12 @@ public:
     // MOS Control functions
     bool setChargeMOS(bool enable);
     bool setDischargeMOS(bool enable);
+    
+    // Same commands without waiting for the reply: update() counts the
+    // acknowledgements instead, next to the data responses
+    void requestChargeMOS(bool enable);
+    void requestDischargeMOS(bool enable);
+    uint32_t getMOSAcks();
     void enableBatteryOperation();
     void disableBatteryOperation();
     void enableChargingOnly();
@@ -75,8 +83,8 @@ private:
         uint16_t alarmStatus;
         uint16_t statusInfo;
         uint16_t cycles;
-        String softwareVersion;
-        String deviceInfo;
+        char softwareVersion[JKBMS_INFO_MAX_LEN];
+        char deviceInfo[JKBMS_INFO_MAX_LEN];
         bool dataValid;
     };
     
@@ -85,6 +93,7 @@ private:
     uint8_t _responseBuffer[512];
     int _responseIndex;
     unsigned long _lastCommandSent;
+    uint32_t _mosAcks;
     
     // Private methods
     void parseRawData(uint8_t* data, int length);
@@ -93,6 +102,7 @@ private:
     // MOS Control private methods
     uint16_t calculateChecksum(uint8_t* data, int length);
     bool sendMOSCommand(uint8_t dataId, bool enable);
+    void writeMOSCommand(uint8_t dataId, bool enable);
     bool waitForMOSResponse(unsigned long timeoutMs = 3000);
 };
 
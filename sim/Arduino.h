@@ -0,0 +1,129 @@
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+// Minimal Arduino API for host builds (PlatformIO native envs add -I sim).
+// Only what the protocol libraries use: String, Serial, millis/micros/delay.
+// Time is CLOCK_MONOTONIC, so timestamps taken in different processes on the
+// same machine can be compared directly.
+//
+// With -DBIKE_SIL (host_bike_sil) the board comes from SimBoard.h instead:
+// virtual clock, GPIO, UARTs and the ESP object of the software-in-the-loop
+// build.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+
+#define IRAM_ATTR
+#define PI 3.1415926535897932384626433832795
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+using std::max;
+using std::min;
+
+template <typename T, typename L, typename H>
+inline T constrain(T value, L low, H high) {
+    return value < (T)low ? (T)low : (value > (T)high ? (T)high : value);
+}
+
+#define DEC 10
+#define HEX 16
+
+class String {
+public:
+    String() {}
+    String(const char* s) : str(s ? s : "") {}
+    String(const std::string& s) : str(s) {}
+    String(unsigned char value, unsigned char base = DEC) { format(value, base); }
+    String(int value, unsigned char base = DEC) { format(value, base); }
+    String(unsigned int value, unsigned char base = DEC) { format(value, base); }
+    String(long value, unsigned char base = DEC) { format(value, base); }
+    String(unsigned long value, unsigned char base = DEC) { format(value, base); }
+    String(float value, unsigned char decimals = 2) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+        str = buf;
+    }
+    
+    const char* c_str() const { return str.c_str(); }
+    unsigned int length() const { return (unsigned int)str.length(); }
+    bool isEmpty() const { return str.empty(); }
+    
+    String& operator+=(const String& other) { str += other.str; return *this; }
+    String& operator+=(const char* other) { str += other; return *this; }
+    String& operator+=(char c) { str += c; return *this; }
+    String operator+(const String& other) const { return String(str + other.str); }
+    String operator+(const char* other) const { return String(str + other); }
+    bool operator==(const String& other) const { return str == other.str; }
+    bool operator==(const char* other) const { return str == other; }
+    bool operator!=(const String& other) const { return str != other.str; }
+    bool operator!=(const char* other) const { return str != other; }
+    char operator[](unsigned int i) const { return str[i]; }
+    
+    void toUpperCase() { for (size_t i = 0; i < str.size(); i++) str[i] = toupper((unsigned char)str[i]); }
+
+private:
+    std::string str;
+    
+    // Arduino prints negative numbers in other bases as their two's complement
+    void format(long long value, unsigned char base) {
+        char buf[24];
+        if (base == HEX) snprintf(buf, sizeof(buf), "%llx", (unsigned long long)(value < 0 ? (uint32_t)value : value));
+        else snprintf(buf, sizeof(buf), "%lld", value);
+        str = buf;
+    }
+};
+
+inline String operator+(const char* left, const String& right) { return String(left) + right; }
+
+#ifdef BIKE_SIL
+#include "SimBoard.h"
+#else
+
+inline uint64_t simMonotonicUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+inline uint32_t micros() { return (uint32_t)simMonotonicUs(); }
+inline uint32_t millis() { return (uint32_t)(simMonotonicUs() / 1000); }
+inline void delay(uint32_t ms) { usleep(ms * 1000); }
+inline void delayMicroseconds(uint32_t us) { usleep(us); }
+
+class SimSerial {
+public:
+    void begin(unsigned long) {}
+    int printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, format);
+        int n = vprintf(format, args);
+        va_end(args);
+        return n;
+    }
+    void print(const char* s) { fputs(s, stdout); }
+    void print(const String& s) { fputs(s.c_str(), stdout); }
+    void print(int v) { ::printf("%d", v); }
+    void print(unsigned int v) { ::printf("%u", v); }
+    void print(float v) { ::printf("%.2f", v); }
+    void println() { fputc('\n', stdout); }
+    template <typename T> void println(const T& v) { print(v); println(); }
+    int available() { return 0; }
+    int read() { return -1; }
+};
+
+static SimSerial Serial __attribute__((unused));
+
+#endif
+
+#endif
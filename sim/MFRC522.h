@@ -0,0 +1,87 @@
+#ifndef SIM_MFRC522_H
+#define SIM_MFRC522_H
+
+// MFRC522 reader for the SIL build, with one card field the world side
+// puts cards into (simRfidTap()). Cards follow ISO 14443-3 states: a card
+// answers PICC_IsNewCardPresent() (REQA) only while idle, so after
+// PICC_HaltA() a card held on the reader is not read again until it is
+// taken away and brought back.
+//
+// Each call is charged SIM_RFID_SPI_US of SPI traffic. The REQA timeout of
+// the real chip (the library polls for about 25 ms when no card answers) is
+// not: the SIL runs on one core, and that busy wait would hold off the
+// core 0 tasks the target runs alongside.
+
+#include <Arduino.h>
+
+#define SIM_RFID_SPI_US       200
+
+struct SimRfidField {
+    bool present;
+    bool halted;
+    uint8_t uid[10];
+    uint8_t uidSize;
+    uint32_t reads;             // UIDs read by the firmware
+};
+
+inline SimRfidField& simRfidField() {
+    static SimRfidField field;
+    return field;
+}
+
+// World side: a card enters the field for holdMs, then leaves
+inline void simRfidTap(const uint8_t* uid, uint8_t size, uint32_t holdMs) {
+    SimRfidField& field = simRfidField();
+    field.present = true;
+    field.halted = false;
+    field.uidSize = size > sizeof(field.uid) ? sizeof(field.uid) : size;
+    memcpy(field.uid, uid, field.uidSize);
+    simAfter((uint64_t)holdMs * 1000, []() { simRfidField().present = false; });
+}
+
+class MFRC522 {
+public:
+    enum StatusCode : byte { STATUS_OK = 0, STATUS_TIMEOUT = 3 };
+    
+    struct Uid {
+        byte size;
+        byte uidByte[10];
+        byte sak;
+    };
+    
+    Uid uid;
+    
+    MFRC522(byte, byte) {
+        memset(&uid, 0, sizeof(uid));
+    }
+    
+    void PCD_Init() {}
+    void PCD_DumpVersionToSerial() { Serial.println("Firmware Version: 0x92 = v2.0 (SIL model)"); }
+    
+    bool PICC_IsNewCardPresent() {
+        delayMicroseconds(SIM_RFID_SPI_US);
+        SimRfidField& field = simRfidField();
+        return field.present && !field.halted;
+    }
+    
+    bool PICC_ReadCardSerial() {
+        delayMicroseconds(SIM_RFID_SPI_US);
+        SimRfidField& field = simRfidField();
+        if (!field.present || field.halted) return false;
+        uid.size = field.uidSize;
+        memcpy(uid.uidByte, field.uid, field.uidSize);
+        uid.sak = 0x08;
+        field.reads++;
+        return true;
+    }
+    
+    StatusCode PICC_HaltA() {
+        delayMicroseconds(SIM_RFID_SPI_US);
+        simRfidField().halted = true;
+        return STATUS_OK;
+    }
+    
+    void PCD_StopCrypto1() {}
+};
+
+#endif
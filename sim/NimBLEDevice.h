@@ -0,0 +1,244 @@
+#ifndef SIM_NIMBLE_DEVICE_H
+#define SIM_NIMBLE_DEVICE_H
+
+// NimBLE-Arduino 1.x for the SIL build: the server side the bike uses, one
+// connection at a time.
+//
+// As on the target, the GAP and GATT callbacks run on a NimBLE host task
+// (priority SIM_BLE_HOST_PRIO). The phone is on the world side: its
+// connects, reads and writes are queued to that task by the simBle*()
+// functions and take effect in the order given.
+//
+// getUUID().toString() and getValue() return references: the firmware keeps
+// their c_str() past the end of the statement, which the library allows for
+// its own reasons and a copy here would not.
+
+#include <Arduino.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+#define SIM_BLE_HOST_PRIO     21          // configMAX_PRIORITIES - 4, as the NimBLE port
+#define SIM_BLE_HOST_STACK    4096
+#define SIM_BLE_OP_QUEUE_LEN  16
+
+typedef enum {
+    ESP_PWR_LVL_N12 = 0, ESP_PWR_LVL_N9, ESP_PWR_LVL_N6, ESP_PWR_LVL_N3,
+    ESP_PWR_LVL_N0, ESP_PWR_LVL_P3, ESP_PWR_LVL_P6, ESP_PWR_LVL_P9
+} esp_power_level_t;
+
+typedef enum {
+    ESP_BLE_PWR_TYPE_ADV = 9, ESP_BLE_PWR_TYPE_SCAN = 10, ESP_BLE_PWR_TYPE_DEFAULT = 11
+} esp_ble_power_type_t;
+
+#define BLE_GAP_ROLE_MASTER   0
+#define BLE_GAP_ROLE_SLAVE    1
+
+typedef struct {
+    uint8_t type;
+    uint8_t val[6];             // Little endian
+} ble_addr_t;
+
+struct ble_gap_conn_desc {
+    ble_addr_t peer_ota_addr;   // As seen on the air
+    uint16_t conn_handle;
+    uint8_t role;
+};
+
+namespace NIMBLE_PROPERTY {
+    enum : uint16_t {
+        BROADCAST = 0x0001, READ = 0x0002, WRITE_NR = 0x0004, WRITE = 0x0008,
+        NOTIFY = 0x0010, INDICATE = 0x0020
+    };
+}
+
+class NimBLEAddress {
+public:
+    NimBLEAddress();
+    NimBLEAddress(const std::string& address);          // "aa:bb:cc:dd:ee:ff", "" = 00:...
+    NimBLEAddress(ble_addr_t address);
+    const uint8_t* getNative() const { return address; }
+    std::string toString() const;
+    bool operator==(const NimBLEAddress& other) const { return memcmp(address, other.address, 6) == 0; }
+
+private:
+    uint8_t address[6];     // Little endian, as the NimBLE stack keeps it
+};
+
+class NimBLEUUID {
+public:
+    NimBLEUUID() {}
+    NimBLEUUID(const char* uuid) : text(uuid) {}
+    NimBLEUUID(const std::string& uuid) : text(uuid) {}
+    NimBLEUUID(uint16_t uuid16);
+    const std::string& toString() const { return text; }
+    bool operator==(const NimBLEUUID& other) const { return text == other.text; }
+
+private:
+    std::string text;
+};
+
+class NimBLECharacteristic;
+
+class NimBLECharacteristicCallbacks {
+public:
+    virtual ~NimBLECharacteristicCallbacks() {}
+    virtual void onRead(NimBLECharacteristic*) {}
+    virtual void onWrite(NimBLECharacteristic*) {}
+};
+
+class NimBLECharacteristic {
+public:
+    NimBLECharacteristic(const char* uuid, uint32_t properties);
+    
+    const NimBLEUUID& getUUID() const { return uuid; }
+    uint32_t getProperties() const { return properties; }
+    void setCallbacks(NimBLECharacteristicCallbacks* callbacks) { this->callbacks = callbacks; }
+    NimBLECharacteristicCallbacks* getCallbacks() { return callbacks; }
+    
+    void setValue(const uint8_t* data, size_t length);
+    void setValue(const std::string& data) { value = data; }
+    void setValue(const String& data) { value = data.c_str(); }
+    const std::string& getValue() const { return value; }
+    
+    void notify(bool is_notification = true);    // To the phone, if connected and NOTIFY
+    uint32_t getNotifications() const { return notifications; }
+
+private:
+    NimBLEUUID uuid;
+    uint32_t properties;
+    NimBLECharacteristicCallbacks* callbacks;
+    std::string value;
+    uint32_t notifications;
+};
+
+class NimBLEService {
+public:
+    explicit NimBLEService(const char* uuid) : uuid(uuid), started(false) {}
+    
+    NimBLECharacteristic* createCharacteristic(const char* uuid, uint32_t properties = NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE);
+    NimBLECharacteristic* getCharacteristic(const char* uuid);
+    bool start() { started = true; return true; }
+    const NimBLEUUID& getUUID() const { return uuid; }
+
+private:
+    friend class NimBLEServer;
+    NimBLEUUID uuid;
+    bool started;
+    std::vector<NimBLECharacteristic*> characteristics;
+};
+
+class NimBLEServer;
+
+class NimBLEServerCallbacks {
+public:
+    virtual ~NimBLEServerCallbacks() {}
+    virtual void onConnect(NimBLEServer*) {}
+    virtual void onConnect(NimBLEServer*, ble_gap_conn_desc*) {}
+    virtual void onDisconnect(NimBLEServer*) {}
+    virtual void onDisconnect(NimBLEServer*, ble_gap_conn_desc*) {}
+};
+
+class NimBLEConnInfo {
+public:
+    explicit NimBLEConnInfo(const NimBLEAddress& peer, uint16_t handle) : peer(peer), handle(handle) {}
+    NimBLEAddress getAddress() const { return peer; }
+    uint16_t getConnHandle() const { return handle; }
+
+private:
+    NimBLEAddress peer;
+    uint16_t handle;
+};
+
+class NimBLEServer {
+public:
+    NimBLEServer() : callbacks(nullptr) {}
+    
+    void setCallbacks(NimBLEServerCallbacks* callbacks, bool = true) { this->callbacks = callbacks; }
+    NimBLEService* createService(const char* uuid);
+    NimBLECharacteristic* findCharacteristic(const char* uuid);  // Any service (phone side)
+    
+    std::vector<uint16_t> getPeerDevices();
+    NimBLEConnInfo getPeerInfo(uint16_t connHandle);
+    size_t getConnectedCount();
+    int disconnect(uint16_t connHandle, uint8_t reason = 0x13);  // Takes effect on the host task
+    void updateConnParams(uint16_t, uint16_t, uint16_t, uint16_t, uint16_t) {}
+
+private:
+    friend struct SimBleHost;
+    NimBLEServerCallbacks* callbacks;
+    std::vector<NimBLEService*> services;
+};
+
+class NimBLEAdvertisementData {
+public:
+    void setName(const std::string& name) { this->name = name; }
+    void setServiceData(const NimBLEUUID&, const std::string&) {}
+    const std::string& getName() const { return name; }
+
+private:
+    std::string name;
+};
+
+class NimBLEAdvertising {
+public:
+    NimBLEAdvertising() : advertising(false) {}
+    
+    void addServiceUUID(const char*) {}
+    void setScanResponse(bool) {}
+    void setMinInterval(uint16_t) {}
+    void setMaxInterval(uint16_t) {}
+    void setScanResponseData(NimBLEAdvertisementData& data) { name = data.getName(); }
+    
+    bool start() { advertising = true; return true; }
+    bool stop() { advertising = false; return true; }
+    bool isAdvertising() const { return advertising; }
+    const std::string& getName() const { return name; }
+
+private:
+    bool advertising;
+    std::string name;
+};
+
+class NimBLEDevice {
+public:
+    static void init(const std::string& deviceName);      // Starts the host task
+    static void setPower(esp_power_level_t, esp_ble_power_type_t = ESP_BLE_PWR_TYPE_DEFAULT) {}
+    static NimBLEServer* createServer();
+    static NimBLEAdvertising* getAdvertising();
+    static NimBLEAddress getAddress();
+    static int setMTU(uint16_t) { return 0; }
+};
+
+#define BLEDevice                     NimBLEDevice
+#define BLEServer                     NimBLEServer
+#define BLEService                    NimBLEService
+#define BLECharacteristic             NimBLECharacteristic
+#define BLECharacteristicCallbacks    NimBLECharacteristicCallbacks
+#define BLEServerCallbacks            NimBLEServerCallbacks
+#define BLEAdvertising                NimBLEAdvertising
+#define BLEAdvertisementData          NimBLEAdvertisementData
+#define BLEUUID                       NimBLEUUID
+#define BLEAddress                    NimBLEAddress
+
+// ---- phone (world side) -----------------------------------------------------
+
+struct SimBleStats {
+    uint32_t connects;          // Accepted by the firmware (still connected after onConnect)
+    uint32_t refused;           // Not advertising, or disconnected during onConnect
+    uint32_t disconnects;
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t notifications;     // Received while connected
+    uint32_t failedOps;         // Read/write without a connection or unknown UUID
+};
+
+void simBleConnect(const char* address);
+void simBleDisconnect();
+void simBleRead(const char* uuid, std::function<void(const std::string&)> done = nullptr);
+void simBleWrite(const char* uuid, const std::string& value);
+bool simBleConnected();
+bool simBleAdvertising();
+void simBleGetStats(SimBleStats& stats);
+
+#endif
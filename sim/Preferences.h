@@ -0,0 +1,97 @@
+#ifndef SIM_PREFERENCES_H
+#define SIM_PREFERENCES_H
+
+// NVS preferences for the SIL build: kept in memory for the run. As on the
+// target, every Preferences object opened on a namespace sees the same keys.
+// The maps are the flash: their allocations are the model's (SimHeap.h).
+
+#include <Arduino.h>
+#include <map>
+#include <string>
+#include "SimHeap.h"
+
+class Preferences {
+public:
+    Preferences() : space(nullptr), readOnly(false) {}
+    
+    bool begin(const char* name, bool readOnlyMode = false) {
+        SimHeapExempt flash;
+        space = &store()[name];
+        readOnly = readOnlyMode;
+        return true;
+    }
+    void end() { space = nullptr; }
+    
+    bool clear() {
+        if (!writable()) return false;
+        space->clear();
+        return true;
+    }
+    bool remove(const char* key) {
+        SimHeapExempt flash;
+        return writable() && space->erase(key) > 0;
+    }
+    bool isKey(const char* key) {
+        SimHeapExempt flash;
+        return space && space->count(key) > 0;
+    }
+    
+    size_t putBool(const char* key, bool value) { return putBytes(key, &value, 1); }
+    size_t putUChar(const char* key, uint8_t value) { return putBytes(key, &value, 1); }
+    size_t putString(const char* key, const char* value) { return putBytes(key, value, strlen(value)); }
+    size_t putString(const char* key, const String& value) { return putString(key, value.c_str()); }
+    size_t putBytes(const char* key, const void* value, size_t length) {
+        if (!writable()) return 0;
+        SimHeapExempt flash;
+        (*space)[key].assign((const char*)value, length);
+        return length;
+    }
+    
+    bool getBool(const char* key, bool defaultValue = false) {
+        const std::string* value = find(key);
+        return value && !value->empty() ? (*value)[0] != 0 : defaultValue;
+    }
+    uint8_t getUChar(const char* key, uint8_t defaultValue = 0) {
+        const std::string* value = find(key);
+        return value && !value->empty() ? (uint8_t)(*value)[0] : defaultValue;
+    }
+    String getString(const char* key, const String defaultValue = String()) {
+        const std::string* value = find(key);
+        return value ? String(*value) : defaultValue;
+    }
+    // As nvs_get_str(): the length with the terminator, 0 if missing or too long
+    size_t getString(const char* key, char* value, size_t maxLength) {
+        const std::string* stored = find(key);
+        if (!stored || !value || stored->size() + 1 > maxLength) return 0;
+        memcpy(value, stored->c_str(), stored->size() + 1);
+        return stored->size() + 1;
+    }
+    size_t getBytes(const char* key, void* buffer, size_t maxLength) {
+        const std::string* value = find(key);
+        if (!value || value->size() > maxLength) return 0;
+        memcpy(buffer, value->data(), value->size());
+        return value->size();
+    }
+
+private:
+    typedef std::map<std::string, std::string> Namespace;
+    
+    Namespace* space;
+    bool readOnly;
+    
+    static std::map<std::string, Namespace>& store() {
+        static std::map<std::string, Namespace> namespaces;
+        return namespaces;
+    }
+    
+    bool writable() const { return space && !readOnly; }
+    
+    const std::string* find(const char* key) const {
+        if (!space) return nullptr;
+        SimHeapExempt flash;
+        Namespace::const_iterator it = space->find(key);
+        return it == space->end() ? nullptr : &it->second;
+    }
+};
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef SIM_SPI_H
+#define SIM_SPI_H
+
+// SPI for the SIL build: the MFRC522 model does not go through it
+
+class SPIClass {
+public:
+    void begin() {}
+    void end() {}
+};
+
+static SPIClass SPI __attribute__((unused));
+
+#endif
@@ -0,0 +1,277 @@
+#include <NimBLEDevice.h>
+#include <freertos/queue.h>
+
+#define SIM_BLE_CONN_HANDLE   1
+
+// =============================================================================
+// ADDRESS, UUID, ATTRIBUTES
+// =============================================================================
+
+NimBLEAddress::NimBLEAddress() {
+    memset(address, 0, sizeof(address));
+}
+
+NimBLEAddress::NimBLEAddress(const std::string& text) {
+    unsigned int b[6] = { 0, 0, 0, 0, 0, 0 };
+    sscanf(text.c_str(), "%x:%x:%x:%x:%x:%x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]);
+    for (int i = 0; i < 6; i++) address[5 - i] = (uint8_t)b[i];
+}
+
+NimBLEAddress::NimBLEAddress(ble_addr_t native) {
+    memcpy(address, native.val, sizeof(address));
+}
+
+std::string NimBLEAddress::toString() const {
+    char text[18];
+    snprintf(text, sizeof(text), "%02x:%02x:%02x:%02x:%02x:%02x",
+             address[5], address[4], address[3], address[2], address[1], address[0]);
+    return text;
+}
+
+NimBLEUUID::NimBLEUUID(uint16_t uuid16) {
+    char buf[8];
+    snprintf(buf, sizeof(buf), "0x%04x", uuid16);
+    text = buf;
+}
+
+NimBLECharacteristic::NimBLECharacteristic(const char* uuid, uint32_t properties) :
+    uuid(uuid), properties(properties), callbacks(nullptr), notifications(0) {
+}
+
+void NimBLECharacteristic::setValue(const uint8_t* data, size_t length) {
+    if (data && length) value.assign((const char*)data, length);
+    else value.clear();
+}
+
+NimBLECharacteristic* NimBLEService::createCharacteristic(const char* uuid, uint32_t properties) {
+    NimBLECharacteristic* characteristic = new NimBLECharacteristic(uuid, properties);
+    characteristics.push_back(characteristic);
+    return characteristic;
+}
+
+NimBLECharacteristic* NimBLEService::getCharacteristic(const char* uuid) {
+    for (size_t i = 0; i < characteristics.size(); i++) {
+        if (characteristics[i]->getUUID().toString() == uuid) return characteristics[i];
+    }
+    return nullptr;
+}
+
+// =============================================================================
+// HOST TASK
+// =============================================================================
+
+enum SimBleOpType { BLE_OP_CONNECT, BLE_OP_DISCONNECT, BLE_OP_READ, BLE_OP_WRITE };
+
+struct SimBleOp {
+    SimBleOpType type;
+    std::string address;        // CONNECT
+    std::string uuid;           // READ, WRITE
+    std::string value;          // WRITE
+    std::function<void(const std::string&)> done;   // READ
+};
+
+// The stack: server, advertising, the one connection, and the queue of GAP
+// and GATT work the host task runs in order
+struct SimBleHost {
+    NimBLEServer server;
+    NimBLEAdvertising advertising;
+    NimBLEAddress ownAddress;
+    bool initialized;
+    bool connected;
+    bool disconnectRequested;   // By the firmware, since the last connect
+    NimBLEAddress peer;
+    ble_gap_conn_desc desc;
+    QueueHandle_t ops;
+    SimBleStats stats;
+    
+    SimBleHost() : ownAddress(std::string("24:0a:c4:5a:0b:1e")), initialized(false), connected(false),
+                   disconnectRequested(false), ops(nullptr) {
+        memset(&stats, 0, sizeof(stats));
+        memset(&desc, 0, sizeof(desc));
+        desc.conn_handle = SIM_BLE_CONN_HANDLE;
+        desc.role = BLE_GAP_ROLE_SLAVE;
+    }
+    
+    void post(SimBleOp* op) {
+        if (!ops || (simInTask() ? xQueueSend(ops, &op, 0) : xQueueSendFromISR(ops, &op, nullptr)) != pdTRUE) {
+            stats.failedOps++;
+            delete op;
+        }
+    }
+    
+    void connect(const SimBleOp& op) {
+        if (connected || !advertising.isAdvertising()) {
+            stats.refused++;
+            return;
+        }
+        connected = true;
+        disconnectRequested = false;
+        peer = NimBLEAddress(op.address);
+        memcpy(desc.peer_ota_addr.val, peer.getNative(), sizeof(desc.peer_ota_addr.val));
+        advertising.stop();   // Connectable advertising ends with the connection
+        if (server.callbacks) {
+            server.callbacks->onConnect(&server);
+            server.callbacks->onConnect(&server, &desc);
+        }
+        // A disconnect the firmware asked for meanwhile is queued behind: refused
+        if (disconnectRequested) stats.refused++;
+        else stats.connects++;
+    }
+    
+    void disconnect() {
+        if (!connected) return;
+        connected = false;
+        stats.disconnects++;
+        if (server.callbacks) {
+            server.callbacks->onDisconnect(&server);
+            server.callbacks->onDisconnect(&server, &desc);
+        }
+        if (!advertising.isAdvertising()) advertising.start();   // advertiseOnDisconnect
+    }
+    
+    void access(const SimBleOp& op) {
+        NimBLECharacteristic* characteristic = connected ? server.findCharacteristic(op.uuid.c_str()) : nullptr;
+        if (!characteristic) {
+            stats.failedOps++;
+            return;
+        }
+        if (op.type == BLE_OP_WRITE) {
+            characteristic->setValue(op.value);
+            if (characteristic->getCallbacks()) characteristic->getCallbacks()->onWrite(characteristic);
+            stats.writes++;
+        } else {
+            if (characteristic->getCallbacks()) characteristic->getCallbacks()->onRead(characteristic);
+            stats.reads++;
+            if (op.done) op.done(characteristic->getValue());
+        }
+    }
+    
+    static void taskMain(void* arg) {
+        SimBleHost* host = static_cast<SimBleHost*>(arg);
+        while (true) {
+            SimBleOp* op = nullptr;
+            if (xQueueReceive(host->ops, &op, portMAX_DELAY) != pdTRUE) continue;
+            switch (op->type) {
+                case BLE_OP_CONNECT:    host->connect(*op); break;
+                case BLE_OP_DISCONNECT: host->disconnect(); break;
+                default:                host->access(*op); break;
+            }
+            delete op;
+        }
+    }
+};
+
+static SimBleHost host;
+
+void NimBLECharacteristic::notify(bool) {
+    if (!host.connected || !(properties & (NIMBLE_PROPERTY::NOTIFY | NIMBLE_PROPERTY::INDICATE))) return;
+    notifications++;
+    host.stats.notifications++;
+}
+
+// =============================================================================
+// SERVER, DEVICE
+// =============================================================================
+
+NimBLEService* NimBLEServer::createService(const char* uuid) {
+    NimBLEService* service = new NimBLEService(uuid);
+    services.push_back(service);
+    return service;
+}
+
+NimBLECharacteristic* NimBLEServer::findCharacteristic(const char* uuid) {
+    for (size_t i = 0; i < services.size(); i++) {
+        if (!services[i]->started) continue;
+        NimBLECharacteristic* characteristic = services[i]->getCharacteristic(uuid);
+        if (characteristic) return characteristic;
+    }
+    return nullptr;
+}
+
+std::vector<uint16_t> NimBLEServer::getPeerDevices() {
+    std::vector<uint16_t> handles;
+    if (host.connected) handles.push_back(SIM_BLE_CONN_HANDLE);
+    return handles;
+}
+
+NimBLEConnInfo NimBLEServer::getPeerInfo(uint16_t connHandle) {
+    return NimBLEConnInfo(host.peer, connHandle);
+}
+
+size_t NimBLEServer::getConnectedCount() {
+    return host.connected ? 1 : 0;
+}
+
+int NimBLEServer::disconnect(uint16_t connHandle, uint8_t) {
+    if (!host.connected || connHandle != SIM_BLE_CONN_HANDLE) return 1;
+    host.disconnectRequested = true;
+    SimBleOp* op = new SimBleOp();
+    op->type = BLE_OP_DISCONNECT;
+    host.post(op);
+    return 0;
+}
+
+void NimBLEDevice::init(const std::string&) {
+    if (host.initialized) return;
+    host.initialized = true;
+    host.ops = xQueueCreate(SIM_BLE_OP_QUEUE_LEN, sizeof(SimBleOp*));
+    xTaskCreatePinnedToCore(SimBleHost::taskMain, "nimble_host", SIM_BLE_HOST_STACK, &host,
+                            SIM_BLE_HOST_PRIO, nullptr, 0);
+}
+
+NimBLEServer* NimBLEDevice::createServer() {
+    return &host.server;
+}
+
+NimBLEAdvertising* NimBLEDevice::getAdvertising() {
+    return &host.advertising;
+}
+
+NimBLEAddress NimBLEDevice::getAddress() {
+    return host.ownAddress;
+}
+
+// =============================================================================
+// PHONE
+// =============================================================================
+
+void simBleConnect(const char* address) {
+    SimBleOp* op = new SimBleOp();
+    op->type = BLE_OP_CONNECT;
+    op->address = address;
+    host.post(op);
+}
+
+void simBleDisconnect() {
+    SimBleOp* op = new SimBleOp();
+    op->type = BLE_OP_DISCONNECT;
+    host.post(op);
+}
+
+void simBleRead(const char* uuid, std::function<void(const std::string&)> done) {
+    SimBleOp* op = new SimBleOp();
+    op->type = BLE_OP_READ;
+    op->uuid = uuid;
+    op->done = done;
+    host.post(op);
+}
+
+void simBleWrite(const char* uuid, const std::string& value) {
+    SimBleOp* op = new SimBleOp();
+    op->type = BLE_OP_WRITE;
+    op->uuid = uuid;
+    op->value = value;
+    host.post(op);
+}
+
+bool simBleConnected() {
+    return host.connected;
+}
+
+bool simBleAdvertising() {
+    return host.advertising.isAdvertising();
+}
+
+void simBleGetStats(SimBleStats& stats) {
+    stats = host.stats;
+}
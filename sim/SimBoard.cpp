@@ -0,0 +1,310 @@
+#include <Arduino.h>
+#include "SimHeap.h"
+
+// =============================================================================
+// CLOCK
+// =============================================================================
+
+void delay(uint32_t ms) {
+    if (simInTask()) vTaskDelay(pdMS_TO_TICKS(ms));
+    else simBusyWaitUs(ms * 1000);
+}
+
+void yield() {
+    vPortYield();
+}
+
+static uint32_t cpuMhz = 240;
+
+bool setCpuFrequencyMhz(uint32_t mhz) {
+    if (mhz != 240 && mhz != 160 && mhz != 80) return false;
+    cpuMhz = mhz;
+    return true;
+}
+
+uint32_t getCpuFrequencyMhz() {
+    return cpuMhz;
+}
+
+// =============================================================================
+// GPIO
+// =============================================================================
+
+struct SimPin {
+    uint8_t mode;
+    int output;                 // Level the firmware drives (OUTPUT)
+    int driven;                 // Level the world drives, -1 = floating
+    void (*isr)();
+    int edge;                   // RISING, FALLING, CHANGE
+};
+
+static SimPin pins[SIM_PIN_COUNT];
+
+static int pinLevel(const SimPin& p) {
+    if (p.mode == OUTPUT) return p.output;
+    if (p.driven >= 0) return p.driven;
+    return p.mode == INPUT_PULLUP ? HIGH : LOW;
+}
+
+// Runs the pin's interrupt if the level change matches its edge
+static void pinChanged(SimPin& p, int before) {
+    int after = pinLevel(p);
+    if (!p.isr || after == before) return;
+    if (p.edge == CHANGE || (p.edge == RISING && after == HIGH) || (p.edge == FALLING && after == LOW)) p.isr();
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    if (pin >= SIM_PIN_COUNT) return;
+    int before = pinLevel(pins[pin]);
+    pins[pin].mode = mode;
+    pinChanged(pins[pin], before);
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    if (pin >= SIM_PIN_COUNT) return;
+    pins[pin].output = value ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin) {
+    return pin < SIM_PIN_COUNT ? pinLevel(pins[pin]) : LOW;
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode) {
+    if (pin >= SIM_PIN_COUNT) return;
+    pins[pin].isr = isr;
+    pins[pin].edge = mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+    if (pin < SIM_PIN_COUNT) pins[pin].isr = nullptr;
+}
+
+void noInterrupts() {
+    simSetInterruptsMasked(true);
+}
+
+void interrupts() {
+    simSetInterruptsMasked(false);
+}
+
+void simSetPin(uint8_t pin, int level) {
+    if (pin >= SIM_PIN_COUNT) return;
+    int before = pinLevel(pins[pin]);
+    pins[pin].driven = level ? HIGH : LOW;
+    pinChanged(pins[pin], before);
+}
+
+void simReleasePin(uint8_t pin) {
+    if (pin >= SIM_PIN_COUNT) return;
+    int before = pinLevel(pins[pin]);
+    pins[pin].driven = -1;
+    pinChanged(pins[pin], before);
+}
+
+int simPinLevel(uint8_t pin) {
+    return digitalRead(pin);
+}
+
+static struct PinsInit {
+    PinsInit() {
+        for (uint8_t i = 0; i < SIM_PIN_COUNT; i++) {
+            pins[i].mode = INPUT;
+            pins[i].output = LOW;
+            pins[i].driven = -1;
+            pins[i].isr = nullptr;
+            pins[i].edge = 0;
+        }
+    }
+} pinsInit;
+
+// =============================================================================
+// UART
+// =============================================================================
+
+static SimUart* uarts = nullptr;   // Constant-initialised: safe from other static constructors
+
+SimUart::SimUart(const char* uartName) :
+    name(uartName),
+    baud(0),
+    lineFreeUs(0),
+    device(nullptr),
+    callbackDueUs(0),
+    bytesWritten(0),
+    next(uarts) {
+    uarts = this;
+}
+
+SimUart* SimUart::find(const char* uartName) {
+    for (SimUart* uart = uarts; uart; uart = uart->next) {
+        if (strcmp(uart->name, uartName) == 0) return uart;
+    }
+    return nullptr;
+}
+
+void SimUart::begin(uint32_t baudRate) {
+    baud = baudRate;
+}
+
+int SimUart::available() {
+    uint64_t now = simNowUs();
+    int count = 0;
+    for (size_t i = 0; i < rx.size() && rx[i].atUs <= now; i++) count++;
+    return count;
+}
+
+int SimUart::read() {
+    if (rx.empty() || rx.front().atUs > simNowUs()) return -1;
+    uint8_t value = rx.front().value;
+    rx.pop_front();
+    return value;
+}
+
+int SimUart::peek() {
+    if (rx.empty() || rx.front().atUs > simNowUs()) return -1;
+    return rx.front().value;
+}
+
+size_t SimUart::write(const uint8_t* data, size_t length) {
+    SimHeapExempt world;
+    bytesWritten += length;
+    if (device) device->onFirmwareWrite(data, length);
+    return length;
+}
+
+// On the target the callback runs from the UART event task once the line
+// has been quiet for SIM_UART_RX_TIMEOUT characters (onlyOnTimeout), or as
+// the FIFO fills; both end up here as one call after the last byte
+void SimUart::onReceive(std::function<void()> callback, bool) {
+    receiveCallback = callback;
+}
+
+void SimUart::attach(SimUartDevice* uartDevice) {
+    device = uartDevice;
+}
+
+void SimUart::send(const uint8_t* data, size_t length, uint64_t delayUs) {
+    if (!baud || !length) return;   // Not listening: the bytes are lost
+    uint64_t atUs = simNowUs() + delayUs;
+    if (atUs < lineFreeUs) atUs = lineFreeUs;
+    for (size_t i = 0; i < length; i++) {
+        atUs += byteTimeUs();
+        RxByte entry = { atUs, data[i] };
+        rx.push_back(entry);
+    }
+    lineFreeUs = atUs;
+    scheduleCallback();
+}
+
+// One event at a time: new bytes only move the due time back
+void SimUart::scheduleCallback() {
+    if (!receiveCallback) return;
+    bool pending = callbackDueUs != 0;
+    callbackDueUs = lineFreeUs + SIM_UART_RX_TIMEOUT * byteTimeUs();
+    if (!pending) armCallback();
+}
+
+void SimUart::armCallback() {
+    simAt(callbackDueUs, [this]() {
+        if (simNowUs() < callbackDueUs) {
+            armCallback();
+            return;
+        }
+        callbackDueUs = 0;
+        receiveCallback();
+    });
+}
+
+// =============================================================================
+// PRINT
+// =============================================================================
+
+size_t Print::print(long value, int base) {
+    if (base == DEC) {
+        char buf[24];
+        snprintf(buf, sizeof(buf), "%ld", value);
+        return write(buf);
+    }
+    return print((unsigned long)(uint32_t)value, base);   // Two's complement, 32 bits as on the target
+}
+
+size_t Print::print(unsigned long value, int base) {
+    char buf[72];
+    char* p = buf + sizeof(buf) - 1;
+    *p = '\0';
+    if (base < 2) base = DEC;
+    do {
+        int digit = value % base;
+        *--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+        value /= base;
+    } while (value);
+    return write(p);
+}
+
+size_t Print::print(double value, int digits) {
+    char buf[40];
+    snprintf(buf, sizeof(buf), "%.*f", digits, value);
+    return write(buf);
+}
+
+// As the Arduino core: a 64-byte buffer on the stack, longer lines in a
+// buffer from the heap
+size_t Print::printf(const char* format, ...) {
+    char local[64];
+    char* buf = local;
+    va_list args;
+    va_start(args, format);
+    va_list copy;
+    va_copy(copy, args);
+    int n = vsnprintf(local, sizeof(local), format, copy);
+    va_end(copy);
+    if (n >= (int)sizeof(local)) {
+        buf = (char*)malloc(n + 1);
+        if (buf) vsnprintf(buf, n + 1, format, args);
+    }
+    va_end(args);
+    if (n < 0 || !buf) return 0;
+    size_t written = write((const uint8_t*)buf, n);
+    if (buf != local) free(buf);
+    return written;
+}
+
+// =============================================================================
+// CONSOLE, ESP
+// =============================================================================
+
+HardwareSerial Serial("UART0");
+HardwareSerial Serial1("UART1");
+HardwareSerial Serial2("UART2");
+SimESP ESP;
+
+// Serial monitor: firmware output to stdout, without the CRs
+class SimConsole : public SimUartDevice {
+public:
+    explicit SimConsole(SimUart& uart) : quiet(false) { uart.attach(this); }
+    
+    void onFirmwareWrite(const uint8_t* data, size_t length) override {
+        if (quiet) return;
+        for (size_t i = 0; i < length; i++) {
+            if (data[i] != '\r') fputc(data[i], stdout);
+        }
+    }
+    
+    bool quiet;
+};
+
+static SimConsole console(Serial.getUart());
+
+void simConsoleInput(const char* line) {
+    Serial.getUart().send((const uint8_t*)line, strlen(line));
+    Serial.getUart().send((const uint8_t*)"\n", 1);
+}
+
+void simConsoleQuiet(bool quiet) {
+    console.quiet = quiet;
+}
+
+void SimESP::restart() {
+    fprintf(stdout, "\n[SIM] ESP.restart() at %.3f s: simulation ends\n", simNowUs() / 1e6);
+    fflush(stdout);
+    _exit(3);
+}
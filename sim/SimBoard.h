@@ -0,0 +1,190 @@
+#ifndef SIM_BOARD_H
+#define SIM_BOARD_H
+
+// The ESP32 board of the software-in-the-loop build (host_bike_sil), pulled
+// in by Arduino.h when BIKE_SIL is defined.
+//
+// Firmware side: the Arduino calls the main board uses, on the virtual clock
+// of SimRTOS.h. World side (the sim*() functions and SimUartDevice): what the
+// device models in host_bike_sil.cpp use to drive pins and answer on UARTs.
+// Everything in the SIL runs one thread at a time under the scheduler, so
+// neither side needs locks.
+
+#include <functional>
+#include <deque>
+#include "SimRTOS.h"
+#include "esp_heap_caps.h"
+
+// ---- clock ------------------------------------------------------------------
+
+inline uint32_t micros() { return (uint32_t)simReadClockUs(); }
+inline uint32_t millis() { return (uint32_t)(simReadClockUs() / 1000); }
+inline void delayMicroseconds(uint32_t us) { simBusyWaitUs(us); }
+void delay(uint32_t ms);
+
+// Recorded only: the virtual clock charges a read the same at any speed.
+// 240, 160 and 80 MHz as on the ESP32 (the PLL settings), false otherwise.
+bool setCpuFrequencyMhz(uint32_t mhz);
+uint32_t getCpuFrequencyMhz();
+void yield();
+
+// ---- GPIO -------------------------------------------------------------------
+
+#define INPUT                 0x01
+#define OUTPUT                0x03
+#define INPUT_PULLUP          0x05
+#define INPUT_PULLDOWN        0x09
+#define LOW                   0x0
+#define HIGH                  0x1
+#define RISING                0x01
+#define FALLING               0x02
+#define CHANGE                0x03
+#define SIM_PIN_COUNT         40
+#define digitalPinToInterrupt(pin)  (pin)
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode);
+void detachInterrupt(uint8_t pin);
+void noInterrupts();
+void interrupts();
+
+// World side: drive an input (runs its interrupt on a matching edge), or
+// let it float back to its pull-up/pull-down. simPinLevel() is what the
+// firmware would read, or drives if the pin is an output.
+void simSetPin(uint8_t pin, int level);
+void simReleasePin(uint8_t pin);
+int simPinLevel(uint8_t pin);
+
+// ---- UART -------------------------------------------------------------------
+
+#define SERIAL_8N1            0x800001c
+#define SIM_UART_RX_TIMEOUT   2           // Character times of silence before onReceive(), as on the target
+
+// What sits on the other end of a UART. Writes from the firmware reach it
+// straight away, from the writing task; replies go back through send().
+class SimUartDevice {
+public:
+    virtual ~SimUartDevice() {}
+    virtual void onFirmwareWrite(const uint8_t* data, size_t length) = 0;
+};
+
+// One UART (hardware or SoftwareSerial). Received bytes carry their arrival
+// time: available() counts only those already on the line.
+class SimUart {
+public:
+    explicit SimUart(const char* name);
+    
+    const char* getName() const { return name; }
+    uint32_t getBaud() const { return baud; }
+    uint64_t byteTimeUs() const { return baud ? 10000000ULL / baud : 0; }  // 8N1: 10 bits
+    
+    // Firmware side
+    void begin(uint32_t baudRate);
+    int available();
+    int read();
+    int peek();
+    size_t write(const uint8_t* data, size_t length);
+    void onReceive(std::function<void()> callback, bool onlyOnTimeout);
+    
+    // World side. Bytes arrive back to back starting delayUs from now.
+    void attach(SimUartDevice* device);
+    void send(const uint8_t* data, size_t length, uint64_t delayUs = 0);
+    uint32_t getBytesWritten() const { return bytesWritten; }
+    
+    static SimUart* find(const char* name);     // "UART0".."UART2", "SW<rx pin>"
+
+private:
+    struct RxByte {
+        uint64_t atUs;
+        uint8_t value;
+    };
+    
+    const char* name;
+    uint32_t baud;
+    std::deque<RxByte> rx;
+    uint64_t lineFreeUs;            // The last byte sent so far ends here
+    SimUartDevice* device;
+    std::function<void()> receiveCallback;
+    uint64_t callbackDueUs;         // 0 = none scheduled
+    uint32_t bytesWritten;
+    SimUart* next;
+    
+    void scheduleCallback();
+    void armCallback();
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) { return write(&c, 1); }
+    virtual size_t write(const uint8_t* data, size_t length) = 0;
+    size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    
+    size_t print(const char* s) { return write(s); }
+    size_t print(const String& s) { return write(s.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(int value, int base = DEC) { return print((long)value, base); }
+    size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(double value, int digits = 2);
+    
+    size_t println() { return write("\r\n"); }
+    template <typename T> size_t println(const T& value) { return print(value) + println(); }
+    template <typename T> size_t println(const T& value, int format) { return print(value, format) + println(); }
+    
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+};
+
+class HardwareSerial : public Stream {
+public:
+    explicit HardwareSerial(const char* name) : uart(name) {}
+    
+    void begin(unsigned long baud, uint32_t = SERIAL_8N1, int8_t = -1, int8_t = -1) {
+        uart.begin(baud);
+    }
+    void end() {}
+    void onReceive(std::function<void()> callback, bool onlyOnTimeout = false) {
+        uart.onReceive(callback, onlyOnTimeout);
+    }
+    
+    int available() override { return uart.available(); }
+    int read() override { return uart.read(); }
+    int peek() override { return uart.peek(); }
+    size_t write(const uint8_t* data, size_t length) override { return uart.write(data, length); }
+    using Print::write;
+    
+    SimUart& getUart() { return uart; }
+
+private:
+    SimUart uart;
+};
+
+extern HardwareSerial Serial;     // Console: stdout, commands from simConsoleInput()
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+
+void simConsoleInput(const char* line);   // Typed into the serial monitor, "\n" added
+void simConsoleQuiet(bool quiet);         // Drop console output (the report still prints)
+
+// ---- ESP --------------------------------------------------------------------
+
+class SimESP {
+public:
+    uint32_t getFreeHeap() { return heap_caps_get_free_size(MALLOC_CAP_DEFAULT); }
+    void restart();                       // Ends the simulation: nothing to restart into
+};
+
+extern SimESP ESP;
+
+#endif
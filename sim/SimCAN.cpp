@@ -0,0 +1,437 @@
+#include "SimCAN.h"
+#include <Arduino.h>
+#include <algorithm>
+#include "CANBusStats.h"
+#include "SimHeap.h"
+
+// =============================================================================
+// NODE
+// =============================================================================
+
+SimCANNode::SimCANNode(const char* nodeName) :
+    name(nodeName), installed(false), mode(TWAI_MODE_NORMAL), state(TWAI_STATE_STOPPED),
+    filterCode(0), filterMask(0xFFFFFFFF), txCapacity(0), rxCapacity(0),
+    tec(0), rec(0), txFailed(0), rxMissed(0), arbLost(0), busErrors(0), sending(false),
+    alertsEnabled(0), alertsPending(0) {
+}
+
+// Single filter, standard frame: ID in bits 31..21, RTR in bit 20, the
+// first two data bytes in bits 15..0
+bool SimCANNode::accepts(const twai_message_t& message) const {
+    if (message.extd) return (filterMask & 0xFFE00000) == 0xFFE00000;
+    uint32_t value = (message.identifier & 0x7FF) << 21 | (uint32_t)message.rtr << 20;
+    if (message.data_length_code > 0 && !message.rtr) value |= (uint32_t)message.data[0] << 8;
+    if (message.data_length_code > 1 && !message.rtr) value |= message.data[1];
+    return ((value ^ filterCode) & ~filterMask) == 0;
+}
+
+void SimCANNode::raise(uint32_t alerts) {
+    alerts &= alertsEnabled;
+    if (!alerts) return;
+    alertsPending |= alerts;
+    simWakeAll(alertWaiters);
+}
+
+void SimCANNode::deliver(const twai_message_t& message) {
+    if (rec > 0) rec--;
+    if (rx.size() >= rxCapacity) {
+        rxMissed++;
+        raise(TWAI_ALERT_RX_QUEUE_FULL);
+        return;
+    }
+    rx.push_back(message);
+    raise(TWAI_ALERT_RX_DATA);
+    simWakeAll(rxWaiters);
+}
+
+void SimCANNode::statusInfo(twai_status_info_t& status) const {
+    memset(&status, 0, sizeof(status));
+    status.state = state;
+    status.msgs_to_tx = tx.size();
+    status.msgs_to_rx = rx.size();
+    status.tx_error_counter = tec;
+    status.rx_error_counter = rec;
+    status.tx_failed_count = txFailed;
+    status.rx_missed_count = rxMissed;
+    status.arb_lost_count = arbLost;
+    status.bus_error_count = busErrors;
+}
+
+static bool nodeContends(const SimCANNode* node) {
+    return node->installed && node->state == TWAI_STATE_RUNNING && !node->tx.empty();
+}
+
+// Arbitration order: base ID, then a standard frame before an extended one
+static uint32_t arbitrationKey(const twai_message_t& message) {
+    if (message.extd) return ((message.identifier >> 18) & 0x7FF) << 1 | 1;
+    return (message.identifier & 0x7FF) << 1;
+}
+
+// =============================================================================
+// BUS
+// =============================================================================
+
+SimCANBus::SimCANBus() : busy(false), connected(true), framesCarried(0), busyUs(0) {
+}
+
+void SimCANBus::attach(SimCANNode* node) {
+    if (std::find(nodes.begin(), nodes.end(), node) == nodes.end()) nodes.push_back(node);
+}
+
+void SimCANBus::detach(SimCANNode* node) {
+    nodes.erase(std::remove(nodes.begin(), nodes.end(), node), nodes.end());
+}
+
+void SimCANBus::kick() {
+    arbitrate();
+}
+
+void SimCANBus::setConnected(bool isConnected) {
+    connected = isConnected;
+    arbitrate();
+}
+
+void SimCANBus::arbitrate() {
+    if (busy) return;
+    
+    SimCANNode* winner = nullptr;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (!nodeContends(nodes[i])) continue;
+        if (!winner || arbitrationKey(nodes[i]->tx.front()) < arbitrationKey(winner->tx.front())) {
+            winner = nodes[i];
+        }
+    }
+    if (!winner) return;
+    
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (nodes[i] == winner || !nodeContends(nodes[i])) continue;
+        nodes[i]->arbLost++;
+        nodes[i]->raise(TWAI_ALERT_ARB_LOST);
+    }
+    
+    // Someone has to drive the ACK slot; a self-test sender does not need it
+    bool acked = winner->mode == TWAI_MODE_NO_ACK;
+    for (size_t i = 0; connected && !acked && i < nodes.size(); i++) {
+        acked = nodes[i] != winner && nodes[i]->installed && nodes[i]->state == TWAI_STATE_RUNNING &&
+                nodes[i]->mode != TWAI_MODE_LISTEN_ONLY;
+    }
+    
+    const twai_message_t& message = winner->tx.front();
+    uint32_t id = message.identifier | (message.extd ? CAN_FRAME_EXT_FLAG : 0);
+    uint32_t bits = canFrameBits(id, message.data, message.rtr ? 0 : message.data_length_code);
+    if (!acked) bits += SIM_CAN_ERROR_BITS;
+    
+    busy = true;
+    winner->sending = true;
+    busyUs += bits * SIM_CAN_BIT_US;
+    simAfter(bits * SIM_CAN_BIT_US, [this, winner, acked]() { finish(winner, acked); });
+}
+
+void SimCANBus::finish(SimCANNode* sender, bool acked) {
+    busy = false;
+    bool live = sender->sending && !sender->tx.empty();
+    sender->sending = false;
+    if (!live) {
+        arbitrate();     // Stopped or uninstalled while sending: the frame is gone
+        return;
+    }
+    
+    if (acked) {
+        twai_message_t message = sender->tx.front();
+        sender->tx.pop_front();
+        framesCarried++;
+        if (sender->tec > 0) sender->tec--;
+        
+        for (size_t i = 0; i < nodes.size(); i++) {
+            SimCANNode* node = nodes[i];
+            if (node == sender ? !message.self : node->state != TWAI_STATE_RUNNING) continue;
+            if (node->accepts(message)) node->deliver(message);
+        }
+        sender->raise(TWAI_ALERT_TX_SUCCESS | (sender->tx.empty() ? TWAI_ALERT_TX_IDLE : 0));
+        simWakeAll(sender->txWaiters);
+    } else {
+        sender->busErrors++;
+        sender->raise(TWAI_ALERT_BUS_ERROR);
+        
+        // An error-passive sender does not count ACK errors, so an unplugged
+        // node stays at 128 and retransmits until someone answers
+        if (sender->tec < 128) {
+            uint32_t before = sender->tec;
+            sender->tec += 8;
+            if (before < 96 && sender->tec >= 96) sender->raise(TWAI_ALERT_ABOVE_ERR_WARN);
+            if (sender->tec >= 128) sender->raise(TWAI_ALERT_ERR_PASS);
+        }
+        if (sender->tec > 255) {
+            sender->state = TWAI_STATE_BUS_OFF;
+            sender->txFailed += sender->tx.size();
+            sender->tx.clear();
+            sender->raise(TWAI_ALERT_BUS_OFF | TWAI_ALERT_TX_FAILED);
+        }
+    }
+    arbitrate();
+}
+
+SimCANBus& simCanBus() {
+    static SimCANBus bus;
+    return bus;
+}
+
+SimCANNode& simTwaiNode() {
+    static SimCANNode node("TWAI");
+    return node;
+}
+
+// =============================================================================
+// TWAI DRIVER
+// =============================================================================
+
+esp_err_t twai_driver_install(const twai_general_config_t* general, const twai_timing_config_t* timing,
+                              const twai_filter_config_t* filter) {
+    SimCANNode& node = simTwaiNode();
+    if (!general || !timing || !filter) return ESP_ERR_INVALID_ARG;
+    if (node.installed) return ESP_ERR_INVALID_STATE;
+    
+    node.mode = general->mode;
+    node.state = TWAI_STATE_STOPPED;
+    node.txCapacity = general->tx_queue_len;
+    node.rxCapacity = general->rx_queue_len;
+    node.alertsEnabled = general->alerts_enabled;
+    node.alertsPending = 0;
+    node.filterCode = filter->acceptance_code;
+    node.filterMask = filter->acceptance_mask;
+    node.tec = node.rec = 0;
+    node.txFailed = node.rxMissed = node.arbLost = node.busErrors = 0;
+    node.installed = true;
+    simCanBus().attach(&node);
+    return ESP_OK;
+}
+
+esp_err_t twai_driver_uninstall() {
+    SimCANNode& node = simTwaiNode();
+    if (!node.installed || (node.state != TWAI_STATE_STOPPED && node.state != TWAI_STATE_BUS_OFF)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    node.installed = false;
+    node.sending = false;
+    node.tx.clear();
+    node.rx.clear();
+    simWakeAll(node.alertWaiters);
+    simWakeAll(node.rxWaiters);
+    simWakeAll(node.txWaiters);
+    return ESP_OK;
+}
+
+esp_err_t twai_start() {
+    SimCANNode& node = simTwaiNode();
+    if (!node.installed || node.state != TWAI_STATE_STOPPED) return ESP_ERR_INVALID_STATE;
+    node.state = TWAI_STATE_RUNNING;
+    node.rx.clear();
+    simCanBus().kick();
+    return ESP_OK;
+}
+
+esp_err_t twai_stop() {
+    SimCANNode& node = simTwaiNode();
+    if (!node.installed || node.state != TWAI_STATE_RUNNING) return ESP_ERR_INVALID_STATE;
+    node.state = TWAI_STATE_STOPPED;
+    node.sending = false;
+    node.tx.clear();
+    return ESP_OK;
+}
+
+esp_err_t twai_transmit(const twai_message_t* message, TickType_t ticks) {
+    SimHeapExempt controller;
+    SimCANNode& node = simTwaiNode();
+    if (!message || (message->data_length_code > 8 && !message->dlc_non_comp)) return ESP_ERR_INVALID_ARG;
+    if (!node.installed || node.state != TWAI_STATE_RUNNING) return ESP_ERR_INVALID_STATE;
+    if (node.mode == TWAI_MODE_LISTEN_ONLY) return ESP_ERR_NOT_SUPPORTED;
+    
+    if (node.tx.size() >= node.txCapacity) simWait(node.txWaiters, ticks);
+    if (node.tx.size() >= node.txCapacity || node.state != TWAI_STATE_RUNNING) return ESP_ERR_TIMEOUT;
+    
+    node.tx.push_back(*message);
+    simCanBus().kick();
+    return ESP_OK;
+}
+
+esp_err_t twai_receive(twai_message_t* message, TickType_t ticks) {
+    SimCANNode& node = simTwaiNode();
+    if (!message) return ESP_ERR_INVALID_ARG;
+    if (!node.installed) return ESP_ERR_INVALID_STATE;
+    
+    if (node.rx.empty()) simWait(node.rxWaiters, ticks);
+    if (node.rx.empty()) return ESP_ERR_TIMEOUT;
+    
+    *message = node.rx.front();
+    node.rx.pop_front();
+    return ESP_OK;
+}
+
+esp_err_t twai_read_alerts(uint32_t* alerts, TickType_t ticks) {
+    SimCANNode& node = simTwaiNode();
+    if (!alerts) return ESP_ERR_INVALID_ARG;
+    if (!node.installed) return ESP_ERR_INVALID_STATE;
+    
+    if (!node.alertsPending) simWait(node.alertWaiters, ticks);
+    *alerts = node.alertsPending;
+    node.alertsPending = 0;
+    return *alerts ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t twai_reconfigure_alerts(uint32_t alerts_enabled, uint32_t* current_alerts) {
+    SimCANNode& node = simTwaiNode();
+    if (!node.installed) return ESP_ERR_INVALID_STATE;
+    if (current_alerts) *current_alerts = node.alertsPending;
+    node.alertsEnabled = alerts_enabled;
+    node.alertsPending = 0;
+    return ESP_OK;
+}
+
+// 128 x 11 recessive bits, then stopped until twai_start()
+esp_err_t twai_initiate_recovery() {
+    SimCANNode& node = simTwaiNode();
+    if (!node.installed || node.state != TWAI_STATE_BUS_OFF) return ESP_ERR_INVALID_STATE;
+    node.state = TWAI_STATE_RECOVERING;
+    node.raise(TWAI_ALERT_RECOVERY_IN_PROGRESS);
+    simAfter(SIM_CAN_RECOVERY_BITS * SIM_CAN_BIT_US, []() {
+        SimCANNode& recovered = simTwaiNode();
+        if (recovered.state != TWAI_STATE_RECOVERING) return;
+        recovered.state = TWAI_STATE_STOPPED;
+        recovered.tec = recovered.rec = 0;
+        recovered.raise(TWAI_ALERT_BUS_RECOVERED);
+    });
+    return ESP_OK;
+}
+
+esp_err_t twai_get_status_info(twai_status_info_t* status_info) {
+    SimCANNode& node = simTwaiNode();
+    if (!status_info) return ESP_ERR_INVALID_ARG;
+    if (!node.installed) return ESP_ERR_INVALID_STATE;
+    node.statusInfo(*status_info);
+    return ESP_OK;
+}
+
+// The frame on the wire stays
+esp_err_t twai_clear_transmit_queue() {
+    SimCANNode& node = simTwaiNode();
+    if (!node.installed) return ESP_ERR_INVALID_STATE;
+    size_t keep = node.sending ? 1 : 0;
+    if (node.tx.size() > keep) node.tx.erase(node.tx.begin() + keep, node.tx.end());
+    simWakeAll(node.txWaiters);
+    return ESP_OK;
+}
+
+esp_err_t twai_clear_receive_queue() {
+    SimCANNode& node = simTwaiNode();
+    if (!node.installed) return ESP_ERR_INVALID_STATE;
+    node.rx.clear();
+    return ESP_OK;
+}
+
+// =============================================================================
+// SIM TRANSPORT
+// =============================================================================
+
+SimCANTransport::SimCANTransport() : node("display") {
+}
+
+SimCANTransport::~SimCANTransport() {
+    simCanBus().detach(&node);
+}
+
+bool SimCANTransport::begin(int, int, CANNodeRole role) {
+    end();
+    
+    node.mode = (role == CAN_NODE_LOOPBACK) ? TWAI_MODE_NO_ACK : TWAI_MODE_NORMAL;
+    node.txCapacity = SIM_CAN_TX_QUEUE_LEN;
+    node.rxCapacity = SIM_CAN_RX_QUEUE_LEN;
+    node.filterCode = 0;
+    node.filterMask = (role == CAN_NODE_LOOPBACK) ? 0xFFFFFFFF : 0xFFEFFFFF;   // Drop RTR frames
+    node.tec = node.rec = 0;
+    node.txFailed = node.rxMissed = node.arbLost = node.busErrors = 0;
+    node.installed = true;
+    node.state = TWAI_STATE_RUNNING;
+    simCanBus().attach(&node);
+    simCanBus().kick();
+    return true;
+}
+
+void SimCANTransport::end() {
+    if (!node.installed) return;
+    node.installed = false;
+    node.state = TWAI_STATE_STOPPED;
+    node.sending = false;
+    node.tx.clear();
+    node.rx.clear();
+}
+
+bool SimCANTransport::transmit(uint32_t id, const uint8_t* data, uint8_t length) {
+    if (!node.installed || node.state != TWAI_STATE_RUNNING || length > 8) return false;
+    if (node.tx.size() >= node.txCapacity) return false;
+    
+    twai_message_t message;
+    memset(&message, 0, sizeof(message));
+    message.identifier = id & ~CAN_FRAME_EXT_FLAG;
+    message.extd = (id & CAN_FRAME_EXT_FLAG) ? 1 : 0;
+    message.self = node.mode == TWAI_MODE_NO_ACK ? 1 : 0;
+    message.data_length_code = length;
+    memcpy(message.data, data, length);
+    
+    node.tx.push_back(message);
+    simCanBus().kick();
+    return true;
+}
+
+bool SimCANTransport::receive(CANFrame& frame) {
+    if (node.rx.empty()) return false;
+    const twai_message_t& message = node.rx.front();
+    frame.timestampUs = micros();
+    frame.id = message.identifier | (message.extd ? CAN_FRAME_EXT_FLAG : 0);
+    frame.dlc = message.rtr ? 0 : (message.data_length_code > 8 ? 8 : message.data_length_code);
+    memcpy(frame.data, message.data, frame.dlc);
+    node.rx.pop_front();
+    return true;
+}
+
+CANAlertCounters SimCANTransport::getAlertCounters() {
+    CANAlertCounters alerts;
+    memset(&alerts, 0, sizeof(alerts));
+    alerts.busErrors = node.busErrors;
+    alerts.txFailures = node.txFailed;
+    alerts.rxOverruns = node.rxMissed;
+    alerts.arbitrationLost = node.arbLost;
+    alerts.txErrorCounter = node.tec > 255 ? 255 : node.tec;
+    alerts.rxErrorCounter = node.rec > 255 ? 255 : node.rec;
+    return alerts;
+}
+
+CANErrorState SimCANTransport::getErrorState() {
+    if (!node.installed) return CAN_STATE_STOPPED;
+    if (node.state == TWAI_STATE_BUS_OFF) return CAN_STATE_BUS_OFF;
+    uint32_t worst = node.tec > node.rec ? node.tec : node.rec;
+    return worst >= 128 ? CAN_STATE_PASSIVE : worst >= 96 ? CAN_STATE_WARNING : CAN_STATE_ACTIVE;
+}
+
+uint32_t SimCANTransport::getTxPending() {
+    return node.tx.size();
+}
+
+uint32_t SimCANTransport::getTxCapacity() {
+    return node.txCapacity;
+}
+
+uint32_t SimCANTransport::getRxPending() {
+    return node.rx.size();
+}
+
+uint32_t SimCANTransport::getRxOverflows() {
+    return node.rxMissed;
+}
+
+uint32_t SimCANTransport::getRxCapacity() {
+    return SIM_CAN_RX_QUEUE_LEN;
+}
+
+const char* SimCANTransport::getName() {
+    return "sim";
+}
@@ -0,0 +1,117 @@
+#ifndef SIM_CAN_H
+#define SIM_CAN_H
+
+// The CAN bus of the SIL build: bit-timed at 500 kbit/s on the virtual
+// clock, with arbitration, ACK and fault confinement.
+//
+// The main board's TWAI controller (driver/twai.h) and the display
+// (SimCANTransport, a CANTransport for BikeCANManager) are nodes on
+// simCanBus(). When the bus is idle, every running node with a frame queued
+// starts sending; the lowest ID wins and the others count a lost
+// arbitration. The frame then takes canFrameBits() bit times. It is
+// acknowledged if another running node is on the bus; without an ACK
+// (unplugged harness, or alone) the sender counts a bus error, raises its
+// TEC by 8 (not past error passive: ISO 11898-1 exempts ACK errors there)
+// and sends the frame again after the error frame.
+
+#include <deque>
+#include <vector>
+#include "SimRTOS.h"
+#include "driver/twai.h"
+#include "CANTransport.h"
+
+#define SIM_CAN_BIT_US        2           // 500 kbit/s
+#define SIM_CAN_ERROR_BITS    23          // Error flag, echo, delimiter, intermission
+#define SIM_CAN_RECOVERY_BITS (128 * 11)
+#define SIM_CAN_TX_QUEUE_LEN  16          // SimCANTransport queues, as the main board's driver
+#define SIM_CAN_RX_QUEUE_LEN  64
+
+class SimCANBus;
+
+// One CAN controller with its driver queues, as the TWAI driver keeps them
+struct SimCANNode {
+    const char* name;
+    bool installed;
+    twai_mode_t mode;
+    twai_state_t state;
+    uint32_t filterCode;
+    uint32_t filterMask;            // 1 = don't care
+    size_t txCapacity;
+    size_t rxCapacity;
+    std::deque<twai_message_t> tx;
+    std::deque<twai_message_t> rx;
+    uint32_t tec;
+    uint32_t rec;
+    uint32_t txFailed;
+    uint32_t rxMissed;
+    uint32_t arbLost;
+    uint32_t busErrors;
+    bool sending;                   // tx.front() is on the wire
+    uint32_t alertsEnabled;
+    uint32_t alertsPending;
+    SimWaitList alertWaiters;
+    SimWaitList rxWaiters;
+    SimWaitList txWaiters;
+    
+    explicit SimCANNode(const char* name);
+    
+    bool accepts(const twai_message_t& message) const;
+    void raise(uint32_t alerts);
+    void deliver(const twai_message_t& message);
+    void statusInfo(twai_status_info_t& status) const;
+};
+
+class SimCANBus {
+public:
+    SimCANBus();
+    
+    void attach(SimCANNode* node);
+    void detach(SimCANNode* node);
+    void kick();                                // A node queued a frame or came on the bus
+    
+    void setConnected(bool connected);          // false: the harness is unplugged
+    bool isConnected() const { return connected; }
+    uint32_t getFramesCarried() const { return framesCarried; }
+    uint64_t getBusyUs() const { return busyUs; }
+
+private:
+    std::vector<SimCANNode*> nodes;
+    bool busy;
+    bool connected;
+    uint32_t framesCarried;
+    uint64_t busyUs;
+    
+    void finish(SimCANNode* sender, bool acked);
+    void arbitrate();
+};
+
+SimCANBus& simCanBus();
+SimCANNode& simTwaiNode();                      // The main board's controller
+
+// A second node for BikeCANManager, the display in host_bike_sil
+class SimCANTransport : public CANTransport {
+public:
+    SimCANTransport();
+    ~SimCANTransport();
+    
+    bool begin(int txPin, int rxPin, CANNodeRole role) override;
+    void end() override;
+    
+    bool transmit(uint32_t id, const uint8_t* data, uint8_t length) override;
+    bool receive(CANFrame& frame) override;
+    
+    CANAlertCounters getAlertCounters() override;
+    CANErrorState getErrorState() override;
+    
+    uint32_t getTxPending() override;
+    uint32_t getTxCapacity() override;
+    uint32_t getRxPending() override;
+    uint32_t getRxOverflows() override;
+    uint32_t getRxCapacity() override;
+    const char* getName() override;
+
+private:
+    SimCANNode node;
+};
+
+#endif
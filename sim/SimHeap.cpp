@@ -0,0 +1,67 @@
+#include <Arduino.h>
+#include <new>
+#include "SimHeap.h"
+#include "esp_heap_caps.h"
+#include "HeapMonitor.h"
+
+// SimHeapExempt depth of the calling thread
+static thread_local int exemptDepth = 0;
+
+SimHeapExempt::SimHeapExempt() {
+    exemptDepth++;
+}
+
+SimHeapExempt::~SimHeapExempt() {
+    exemptDepth--;
+}
+
+// HeapMonitor's filter (a weak default there): only the firmware's own
+bool heapAllocationCounted() {
+    return simInTask() && exemptDepth == 0;
+}
+
+// =============================================================================
+// OPERATOR NEW: through malloc, and so through the count, as on the target
+// =============================================================================
+
+void* operator new(size_t size) {
+    void* block = malloc(size ? size : 1);
+    if (!block) throw std::bad_alloc();
+    return block;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* block) noexcept {
+    free(block);
+}
+
+void operator delete[](void* block) noexcept {
+    free(block);
+}
+
+// =============================================================================
+// HEAP INFORMATION
+// =============================================================================
+
+void heap_caps_get_info(multi_heap_info_t* info, uint32_t) {
+    memset(info, 0, sizeof(*info));
+    info->total_free_bytes = SIM_HEAP_FREE_BYTES;
+    info->largest_free_block = SIM_HEAP_LARGEST_BLOCK;
+    info->minimum_free_bytes = SIM_HEAP_FREE_BYTES;
+    info->free_blocks = SIM_HEAP_FREE_BLOCKS;
+}
+
+size_t heap_caps_get_free_size(uint32_t) {
+    return SIM_HEAP_FREE_BYTES;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t) {
+    return SIM_HEAP_LARGEST_BLOCK;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t) {
+    return SIM_HEAP_FREE_BYTES;
+}
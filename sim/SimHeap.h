@@ -0,0 +1,23 @@
+#ifndef SIM_HEAP_H
+#define SIM_HEAP_H
+
+// The heap of the SIL build, as HeapMonitor (lib/Bike_Profiler) sees it.
+//
+// host_bike_sil counts allocations the way the target's debug build does:
+// it links with --wrap for malloc, calloc and realloc, and operator new is
+// replaced here to go through malloc, as libstdc++'s does on the target.
+// An allocation is the firmware's when a task makes it outside the
+// simulator's own code. The kernel (task and queue blocks, wait lists, the
+// event list) and the device models mark themselves with SimHeapExempt; on
+// the target those are heap_caps_malloc() or hardware, which the count does
+// not see either. Device events run outside the tasks and never count.
+//
+// There is no heap model behind esp_heap_caps.h: the free figures are fixed.
+
+class SimHeapExempt {
+public:
+    SimHeapExempt();
+    ~SimHeapExempt();
+};
+
+#endif
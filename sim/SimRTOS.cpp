@@ -0,0 +1,662 @@
+#include "SimRTOS.h"
+#include "SimHeap.h"
+#include "freertos/queue.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+
+#define SIM_NO_WAKE  UINT64_MAX
+
+struct SimTask {
+    enum State { READY, RUNNING, BLOCKED, DELETED };
+    
+    std::string name;
+    TaskFunction_t function;
+    void* parameter;
+    UBaseType_t priority;
+    uint32_t stackBytes;
+    BaseType_t core;
+    
+    State state;
+    uint64_t readySeq;          // Order among ready tasks of one priority
+    uint64_t wakeUs;            // BLOCKED: timeout, SIM_NO_WAKE = none
+    bool timedOut;
+    SimWaitList* waitList;      // BLOCKED on a queue or driver resource
+    
+    uint32_t notifyValue;
+    bool notifyPending;         // FreeRTOS "notified" state
+    bool notifyWaiting;
+    
+    std::condition_variable resume;
+    uint32_t resumes;
+    uint64_t runUs;
+    uint64_t sliceStartUs;
+    uint64_t cpuMarkNs;         // Thread CPU time already charged to the clock
+};
+
+struct SimQueue {
+    uint32_t length;
+    uint32_t itemSize;
+    std::vector<uint8_t> storage;
+    uint32_t head;
+    uint32_t count;
+    SimWaitList receivers;
+    SimWaitList senders;
+};
+
+struct SimEvent {
+    uint64_t atUs;
+    uint64_t seq;               // Same time: in the order they were scheduled
+    std::function<void()> run;
+    
+    bool operator>(const SimEvent& other) const {
+        return atUs != other.atUs ? atUs > other.atUs : seq > other.seq;
+    }
+};
+
+// simLock guards everything below. A task runs only while running == it,
+// and the scheduler (host main thread, also where events run) only while
+// running == nullptr, so task code itself never needs the lock.
+static std::mutex simLock;
+static std::condition_variable schedulerWake;
+static std::vector<SimTask*> tasks;
+static SimTask* running = nullptr;
+static thread_local SimTask* self = nullptr;
+
+static std::atomic<uint64_t> clockUs(0);
+static std::atomic<uint64_t> nextDueUs(SIM_NO_WAKE);   // Earliest event or timeout
+static std::priority_queue<SimEvent, std::vector<SimEvent>, std::greater<SimEvent> > events;
+static uint64_t eventSeq = 0;
+static uint64_t eventCount = 0;
+static uint64_t readySeq = 0;
+static std::atomic<bool> masked(false);
+static float cpuScale = 0;
+
+static SimTask* loopTask = nullptr;
+static void (*loopSetup)() = nullptr;
+static void (*loopBody)() = nullptr;
+
+// =============================================================================
+// SCHEDULING (simLock held)
+// =============================================================================
+
+static uint64_t threadCpuNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Host CPU time since the last charge, scaled to the target
+static void chargeCpu(SimTask* task) {
+    if (cpuScale <= 0) return;
+    uint64_t now = threadCpuNs();
+    clockUs += (uint64_t)((now - task->cpuMarkNs) / 1000.0 * cpuScale);
+    task->cpuMarkNs = now;
+}
+
+static void updateNextDue() {
+    uint64_t due = events.empty() ? SIM_NO_WAKE : events.top().atUs;
+    for (size_t i = 0; i < tasks.size(); i++) {
+        if (tasks[i]->state == SimTask::BLOCKED && tasks[i]->wakeUs < due) due = tasks[i]->wakeUs;
+    }
+    nextDueUs = due;
+}
+
+static void leaveWaitList(SimTask* task) {
+    if (!task->waitList) return;
+    std::vector<TaskHandle_t>& list = task->waitList->tasks;
+    list.erase(std::remove(list.begin(), list.end(), task), list.end());
+    task->waitList = nullptr;
+}
+
+static void makeReady(SimTask* task) {
+    if (task->state != SimTask::BLOCKED) return;
+    leaveWaitList(task);
+    task->state = SimTask::READY;
+    task->readySeq = ++readySeq;
+    task->wakeUs = SIM_NO_WAKE;
+}
+
+static SimTask* highestReady() {
+    SimTask* best = nullptr;
+    for (size_t i = 0; i < tasks.size(); i++) {
+        SimTask* task = tasks[i];
+        if (task->state != SimTask::READY) continue;
+        if (!best || task->priority > best->priority ||
+            (task->priority == best->priority && task->readySeq < best->readySeq)) best = task;
+    }
+    return best;
+}
+
+// Gives the CPU back to the scheduler and waits until it is handed back.
+// The caller has set its own state (READY, BLOCKED or DELETED).
+static void switchOut(std::unique_lock<std::mutex>& guard) {
+    SimTask* task = self;
+    chargeCpu(task);
+    task->runUs += clockUs - task->sliceStartUs;
+    updateNextDue();
+    running = nullptr;
+    schedulerWake.notify_one();
+    task->resume.wait(guard, [task] { return running == task; });
+    if (cpuScale > 0) task->cpuMarkNs = threadCpuNs();
+}
+
+static void yieldLocked(std::unique_lock<std::mutex>& guard) {
+    self->state = SimTask::READY;
+    self->readySeq = ++readySeq;
+    switchOut(guard);
+}
+
+// After waking a task from task context: a higher-priority one runs first
+static void preemptIfOutranked(std::unique_lock<std::mutex>& guard, SimTask* woken) {
+    if (self && woken && woken->state == SimTask::READY && woken->priority > self->priority) yieldLocked(guard);
+}
+
+// Blocks the calling task until made ready or wakeUs; false on timeout
+static bool blockLocked(std::unique_lock<std::mutex>& guard, uint64_t wakeUs, SimWaitList* list = nullptr) {
+    SimHeapExempt kernel;
+    SimTask* task = self;
+    task->state = SimTask::BLOCKED;
+    task->wakeUs = wakeUs;
+    task->timedOut = false;
+    if (list) {
+        list->tasks.push_back(task);
+        task->waitList = list;
+    }
+    switchOut(guard);
+    return !task->timedOut;
+}
+
+// Timeouts count whole ticks, as on the target: the wait ends on the
+// tick interrupt that many ticks from the current one
+static uint64_t wakeAfterTicks(TickType_t ticks) {
+    if (ticks == portMAX_DELAY) return SIM_NO_WAKE;
+    return (clockUs / 1000 + ticks) * 1000;
+}
+
+static SimTask* waitListFirst(SimWaitList& list) {
+    SimTask* best = nullptr;
+    for (size_t i = 0; i < list.tasks.size(); i++) {
+        if (!best || list.tasks[i]->priority > best->priority) best = list.tasks[i];
+    }
+    return best;
+}
+
+static void parkForever(std::unique_lock<std::mutex>& guard) {
+    self->state = SimTask::DELETED;
+    switchOut(guard);   // Never handed back
+}
+
+static void taskMain(SimTask* task) {
+    std::unique_lock<std::mutex> guard(simLock);
+    self = task;
+    task->resume.wait(guard, [task] { return running == task; });
+    if (cpuScale > 0) task->cpuMarkNs = threadCpuNs();
+    guard.unlock();
+    
+    task->function(task->parameter);
+    
+    // Returning from a task function is a fault on the target
+    guard.lock();
+    fprintf(stderr, "[SIM] Task %s returned\n", task->name.c_str());
+    parkForever(guard);
+}
+
+static SimTask* createLocked(TaskFunction_t function, const char* name, uint32_t stackBytes,
+                             void* parameter, UBaseType_t priority, BaseType_t core) {
+    SimHeapExempt kernel;
+    SimTask* task = new SimTask();
+    task->name = name ? name : "";
+    task->function = function;
+    task->parameter = parameter;
+    task->priority = priority < configMAX_PRIORITIES ? priority : configMAX_PRIORITIES - 1;
+    task->stackBytes = stackBytes;
+    task->core = core;
+    task->state = SimTask::READY;
+    task->readySeq = ++readySeq;
+    task->wakeUs = SIM_NO_WAKE;
+    task->timedOut = false;
+    task->waitList = nullptr;
+    task->notifyValue = 0;
+    task->notifyPending = false;
+    task->notifyWaiting = false;
+    task->resumes = 0;
+    task->runUs = 0;
+    task->sliceStartUs = 0;
+    task->cpuMarkNs = 0;
+    tasks.push_back(task);
+    std::thread(taskMain, task).detach();
+    return task;
+}
+
+// =============================================================================
+// CLOCK AND EVENTS
+// =============================================================================
+
+uint64_t simNowUs() {
+    return clockUs;
+}
+
+// A task that reads the clock past a due event or timeout is preempted
+// there, as the interrupt would have been taken on the target
+static void preemptIfDue() {
+    if (masked || clockUs < nextDueUs) return;
+    std::unique_lock<std::mutex> guard(simLock);
+    yieldLocked(guard);
+}
+
+uint64_t simReadClockUs() {
+    if (!self) return clockUs;
+    if (cpuScale > 0) {
+        std::lock_guard<std::mutex> guard(simLock);
+        chargeCpu(self);
+    }
+    clockUs += SIM_CLOCK_READ_US;
+    preemptIfDue();
+    return clockUs;
+}
+
+void simBusyWaitUs(uint32_t us) {
+    clockUs += us;
+    if (self) preemptIfDue();
+}
+
+void simSetCpuScale(float scale) {
+    cpuScale = scale;
+}
+
+void simAt(uint64_t atUs, std::function<void()> event) {
+    SimHeapExempt kernel;
+    std::lock_guard<std::mutex> guard(simLock);
+    SimEvent entry = { atUs, ++eventSeq, event };
+    events.push(entry);
+    if (atUs < nextDueUs) nextDueUs = atUs;
+}
+
+void simAfter(uint64_t delayUs, std::function<void()> event) {
+    simAt(clockUs + delayUs, event);
+}
+
+bool simInTask() {
+    return self != nullptr;
+}
+
+void simSetInterruptsMasked(bool mask) {
+    masked = mask;
+    if (!mask && self) preemptIfDue();
+}
+
+bool simWait(SimWaitList& list, TickType_t ticks) {
+    if (!self || ticks == 0) return false;
+    std::unique_lock<std::mutex> guard(simLock);
+    return blockLocked(guard, wakeAfterTicks(ticks), &list);
+}
+
+void simWakeAll(SimWaitList& list) {
+    std::unique_lock<std::mutex> guard(simLock);
+    SimTask* first = waitListFirst(list);
+    std::vector<TaskHandle_t> waiting;
+    waiting.swap(list.tasks);
+    for (size_t i = 0; i < waiting.size(); i++) {
+        waiting[i]->waitList = nullptr;
+        makeReady(waiting[i]);
+    }
+    preemptIfOutranked(guard, first);
+}
+
+// =============================================================================
+// RUNNING
+// =============================================================================
+
+static void loopTaskMain(void*) {
+    loopSetup();
+    while (true) {
+        loopBody();
+        vTaskDelay(1);   // No busy loop: loop() runs once per tick
+    }
+}
+
+void simRun(uint64_t endUs, void (*setup)(), void (*loop)()) {
+    std::unique_lock<std::mutex> guard(simLock);
+    if (!loopTask) {
+        loopSetup = setup;
+        loopBody = loop;
+        loopTask = createLocked(loopTaskMain, "loopTask", SIM_LOOP_TASK_STACK, nullptr, SIM_LOOP_TASK_PRIO, 1);
+    }
+    
+    while (clockUs < endUs) {
+        // Timeouts first, then interrupts, then the best task
+        for (size_t i = 0; i < tasks.size(); i++) {
+            SimTask* task = tasks[i];
+            if (task->state == SimTask::BLOCKED && task->wakeUs <= clockUs) {
+                makeReady(task);
+                task->timedOut = true;
+            }
+        }
+        
+        if (!events.empty() && events.top().atUs <= clockUs) {
+            SimEvent event = events.top();
+            events.pop();
+            updateNextDue();
+            eventCount++;
+            guard.unlock();
+            event.run();
+            guard.lock();
+            continue;
+        }
+        
+        SimTask* next = highestReady();
+        if (next) {
+            next->state = SimTask::RUNNING;
+            next->resumes++;
+            next->sliceStartUs = clockUs;
+            running = next;
+            next->resume.notify_one();
+            schedulerWake.wait(guard, [] { return running == nullptr; });
+            continue;
+        }
+        
+        // Everything is blocked: on to whatever happens next
+        updateNextDue();
+        clockUs = std::min<uint64_t>(nextDueUs, endUs);
+    }
+}
+
+uint32_t simTaskCount() {
+    std::lock_guard<std::mutex> guard(simLock);
+    return (uint32_t)tasks.size();
+}
+
+bool simGetTaskStats(uint32_t index, SimTaskStats& stats) {
+    std::lock_guard<std::mutex> guard(simLock);
+    if (index >= tasks.size()) return false;
+    const SimTask* task = tasks[index];
+    stats.name = task->name.c_str();
+    stats.priority = task->priority;
+    stats.resumes = task->resumes;
+    stats.runUs = task->runUs;
+    stats.deleted = task->state == SimTask::DELETED;
+    return true;
+}
+
+uint64_t simGetEventCount() {
+    std::lock_guard<std::mutex> guard(simLock);
+    return eventCount;
+}
+
+// =============================================================================
+// FREERTOS: TASKS
+// =============================================================================
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackBytes,
+                                   void* parameter, UBaseType_t priority, TaskHandle_t* created,
+                                   BaseType_t core) {
+    std::unique_lock<std::mutex> guard(simLock);
+    SimTask* task = createLocked(function, name, stackBytes, parameter, priority, core);
+    if (created) *created = task;
+    preemptIfOutranked(guard, task);
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stackBytes,
+                       void* parameter, UBaseType_t priority, TaskHandle_t* created) {
+    return xTaskCreatePinnedToCore(function, name, stackBytes, parameter, priority, created, tskNO_AFFINITY);
+}
+
+// The task runs on a host thread with a stack of its own: the buffers go unused
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t function, const char* name, uint32_t stackBytes,
+                                           void* parameter, UBaseType_t priority, StackType_t* stack,
+                                           StaticTask_t* taskBuffer, BaseType_t core) {
+    if (!stack || !taskBuffer) return nullptr;
+    TaskHandle_t created = nullptr;
+    xTaskCreatePinnedToCore(function, name, stackBytes, parameter, priority, &created, core);
+    return created;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    std::unique_lock<std::mutex> guard(simLock);
+    if (!task || task == self) {
+        if (self) parkForever(guard);
+        return;
+    }
+    // Parked in switchOut() for good: never picked again
+    leaveWaitList(task);
+    task->state = SimTask::DELETED;
+    updateNextDue();
+}
+
+void vPortYield() {
+    if (!self) return;
+    std::unique_lock<std::mutex> guard(simLock);
+    yieldLocked(guard);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    if (!self) return;
+    if (ticks == 0) {
+        vPortYield();
+        return;
+    }
+    std::unique_lock<std::mutex> guard(simLock);
+    blockLocked(guard, wakeAfterTicks(ticks));
+}
+
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t period) {
+    if (!self) return;
+    std::unique_lock<std::mutex> guard(simLock);
+    TickType_t now = (TickType_t)(clockUs / 1000);
+    TickType_t wake = *previousWake + period;
+    
+    // Same overflow handling as FreeRTOS: no wait if the wake time has passed
+    bool wait = (now >= *previousWake) ? (wake < *previousWake || wake > now)
+                                       : (wake < *previousWake && wake > now);
+    *previousWake = wake;
+    if (wait) blockLocked(guard, wakeAfterTicks(wake - now));
+    else yieldLocked(guard);
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)(clockUs / 1000);
+}
+
+TickType_t xTaskGetTickCountFromISR() {
+    return xTaskGetTickCount();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return self;
+}
+
+const char* pcTaskGetName(TaskHandle_t task) {
+    if (!task) task = self;
+    return task ? task->name.c_str() : "";
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) {
+    std::lock_guard<std::mutex> guard(simLock);
+    if (!task) task = self;
+    return task ? task->priority : 0;
+}
+
+void vTaskPrioritySet(TaskHandle_t task, UBaseType_t priority) {
+    std::unique_lock<std::mutex> guard(simLock);
+    if (!task) task = self;
+    if (!task) return;
+    task->priority = priority < configMAX_PRIORITIES ? priority : configMAX_PRIORITIES - 1;
+    SimTask* best = highestReady();
+    if (self && best && best->priority > self->priority) yieldLocked(guard);
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    std::lock_guard<std::mutex> guard(simLock);
+    if (!task) task = self;
+    return task ? task->stackBytes : 0;
+}
+
+BaseType_t xPortGetCoreID() {
+    return (self && self->core != tskNO_AFFINITY) ? self->core : 0;
+}
+
+// =============================================================================
+// FREERTOS: NOTIFICATIONS
+// =============================================================================
+
+static BaseType_t notifyLocked(SimTask* task, uint32_t value, eNotifyAction action) {
+    switch (action) {
+        case eSetBits:                  task->notifyValue |= value; break;
+        case eIncrement:                task->notifyValue++; break;
+        case eSetValueWithOverwrite:    task->notifyValue = value; break;
+        case eSetValueWithoutOverwrite:
+            if (task->notifyPending) return pdFAIL;
+            task->notifyValue = value;
+            break;
+        default: break;
+    }
+    task->notifyPending = true;
+    if (task->notifyWaiting) makeReady(task);
+    return pdPASS;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+    if (!task) return pdFAIL;
+    std::unique_lock<std::mutex> guard(simLock);
+    BaseType_t result = notifyLocked(task, value, action);
+    preemptIfOutranked(guard, task);
+    return result;
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t* woken) {
+    if (!task) return pdFAIL;
+    std::lock_guard<std::mutex> guard(simLock);
+    bool wasBlocked = task->state == SimTask::BLOCKED;
+    BaseType_t result = notifyLocked(task, value, action);
+    if (woken && wasBlocked && task->state == SimTask::READY) *woken = pdTRUE;
+    return result;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t* value, TickType_t ticks) {
+    if (!self) return pdFALSE;
+    std::unique_lock<std::mutex> guard(simLock);
+    SimTask* task = self;
+    
+    if (!task->notifyPending) {
+        task->notifyValue &= ~clearOnEntry;
+        if (ticks > 0) {
+            task->notifyWaiting = true;
+            blockLocked(guard, wakeAfterTicks(ticks));
+            task->notifyWaiting = false;
+        }
+    }
+    
+    if (value) *value = task->notifyValue;
+    if (!task->notifyPending) return pdFALSE;
+    task->notifyValue &= ~clearOnExit;
+    task->notifyPending = false;
+    return pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+    if (!self) return 0;
+    std::unique_lock<std::mutex> guard(simLock);
+    SimTask* task = self;
+    
+    if (task->notifyValue == 0 && ticks > 0) {
+        task->notifyWaiting = true;
+        blockLocked(guard, wakeAfterTicks(ticks));
+        task->notifyWaiting = false;
+    }
+    
+    uint32_t value = task->notifyValue;
+    if (value) task->notifyValue = clearOnExit ? 0 : value - 1;
+    task->notifyPending = false;
+    return value;
+}
+
+// =============================================================================
+// FREERTOS: QUEUES
+// =============================================================================
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    if (length == 0) return nullptr;
+    SimHeapExempt kernel;
+    SimQueue* queue = new SimQueue();
+    queue->length = length;
+    queue->itemSize = itemSize;
+    queue->storage.resize((size_t)length * itemSize);
+    queue->head = 0;
+    queue->count = 0;
+    return queue;
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t itemSize, uint8_t* storage,
+                                 StaticQueue_t* queueBuffer) {
+    if (!storage || !queueBuffer) return nullptr;
+    return xQueueCreate(length, itemSize);
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    delete queue;
+}
+
+// Puts an item in if there is room and wakes the best receiver; false if full
+static bool queuePutLocked(SimQueue* queue, const void* item, SimTask*& woken) {
+    if (queue->count >= queue->length) return false;
+    uint32_t tail = (queue->head + queue->count) % queue->length;
+    memcpy(&queue->storage[(size_t)tail * queue->itemSize], item, queue->itemSize);
+    queue->count++;
+    woken = waitListFirst(queue->receivers);
+    if (woken) makeReady(woken);
+    return true;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks) {
+    std::unique_lock<std::mutex> guard(simLock);
+    uint64_t wakeUs = wakeAfterTicks(ticks);
+    
+    while (true) {
+        SimTask* woken = nullptr;
+        if (queuePutLocked(queue, item, woken)) {
+            preemptIfOutranked(guard, woken);
+            return pdTRUE;
+        }
+        if (!self || ticks == 0 || !blockLocked(guard, wakeUs, &queue->senders)) return errQUEUE_FULL;
+    }
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void* item, BaseType_t* woken) {
+    std::lock_guard<std::mutex> guard(simLock);
+    SimTask* receiver = nullptr;
+    if (!queuePutLocked(queue, item, receiver)) return errQUEUE_FULL;
+    if (woken && receiver) *woken = pdTRUE;
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks) {
+    std::unique_lock<std::mutex> guard(simLock);
+    uint64_t wakeUs = wakeAfterTicks(ticks);
+    
+    while (true) {
+        if (queue->count > 0) {
+            memcpy(item, &queue->storage[(size_t)queue->head * queue->itemSize], queue->itemSize);
+            queue->head = (queue->head + 1) % queue->length;
+            queue->count--;
+            SimTask* sender = waitListFirst(queue->senders);
+            if (sender) makeReady(sender);
+            preemptIfOutranked(guard, sender);
+            return pdTRUE;
+        }
+        if (!self || ticks == 0 || !blockLocked(guard, wakeUs, &queue->receivers)) return errQUEUE_EMPTY;
+    }
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> guard(simLock);
+    return queue->count;
+}
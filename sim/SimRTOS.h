@@ -0,0 +1,75 @@
+#ifndef SIM_RTOS_H
+#define SIM_RTOS_H
+
+// Scheduler and virtual clock of the software-in-the-loop build.
+//
+// Every FreeRTOS task is a host thread, but only one of them runs at a time:
+// the scheduler hands the CPU to the highest-priority ready task and gets it
+// back when that task blocks (delay, notify wait, queue, driver wait). Ties
+// go to the task that has been ready longest. A task is preempted only at
+// kernel calls and clock reads, never in the middle of its own code.
+//
+// Time is virtual. While every task is blocked the clock jumps straight to
+// the next task timeout or device event, so an idle hour takes as long as
+// the work done in it. Device models (UART peers, Hall pulses, the phone)
+// schedule events with simAt()/simAfter(); an event runs between tasks, in
+// interrupt context, and may call the *FromISR functions.
+//
+// Task code does not advance the clock by itself. Each micros()/millis()
+// read costs SIM_CLOCK_READ_US, which lets busy-wait loops end; with
+// simSetCpuScale() the host CPU time a task uses is charged as well, scaled
+// to the target. Stack use is not measured.
+
+#include <stdint.h>
+#include <functional>
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define SIM_CLOCK_READ_US     1           // Virtual cost of one clock read from a task
+#define SIM_LOOP_TASK_STACK   8192        // Arduino loopTask
+#define SIM_LOOP_TASK_PRIO    1
+
+// ---- clock ------------------------------------------------------------------
+
+uint64_t simNowUs();                      // Virtual time since boot, no cost
+uint64_t simReadClockUs();                // micros()/millis(): charged to the running task
+void simBusyWaitUs(uint32_t us);          // delayMicroseconds(): spins, the clock moves on
+void simSetCpuScale(float scale);         // Virtual us per host CPU us, 0 = off (default)
+
+// ---- device events ----------------------------------------------------------
+
+void simAt(uint64_t atUs, std::function<void()> event);
+void simAfter(uint64_t delayUs, std::function<void()> event);
+bool simInTask();                         // Called from a task (not an event, not the host)
+
+void simSetInterruptsMasked(bool masked); // noInterrupts()/interrupts(): events wait
+
+// Tasks parked on a driver resource (alerts, a peripheral FIFO)
+struct SimWaitList {
+    std::vector<TaskHandle_t> tasks;
+};
+
+bool simWait(SimWaitList& list, TickType_t ticks);   // From a task: true if woken, false on timeout
+void simWakeAll(SimWaitList& list);
+
+// ---- running ----------------------------------------------------------------
+
+// Creates the Arduino loop task (setup(), then loop() once per tick) on the
+// first call. Returns when the clock reaches endUs, with every task parked;
+// call again to go on.
+void simRun(uint64_t endUs, void (*setup)(), void (*loop)());
+
+struct SimTaskStats {
+    const char* name;
+    UBaseType_t priority;
+    uint32_t resumes;                     // Times the task got the CPU
+    uint64_t runUs;                       // Virtual time that passed while it ran
+    bool deleted;
+};
+
+uint32_t simTaskCount();
+bool simGetTaskStats(uint32_t index, SimTaskStats& stats);
+uint64_t simGetEventCount();
+
+#endif
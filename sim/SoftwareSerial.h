@@ -0,0 +1,34 @@
+#ifndef SIM_SOFTWARE_SERIAL_H
+#define SIM_SOFTWARE_SERIAL_H
+
+// EspSoftwareSerial for the SIL build: a SimUart named "SW<rx pin>", with
+// the same byte timing as a hardware UART (no bit-banging cost)
+
+#include <Arduino.h>
+
+class SoftwareSerial : public Stream {
+public:
+    SoftwareSerial(int8_t rxPin, int8_t) : uart(makeName(rxPin)) {}
+    
+    void begin(uint32_t baud) { uart.begin(baud); }
+    void end() {}
+    
+    int available() override { return uart.available(); }
+    int read() override { return uart.read(); }
+    int peek() override { return uart.peek(); }
+    size_t write(const uint8_t* data, size_t length) override { return uart.write(data, length); }
+    using Print::write;
+    
+    SimUart& getUart() { return uart; }
+
+private:
+    char name[8];
+    SimUart uart;
+    
+    const char* makeName(int8_t rxPin) {
+        snprintf(name, sizeof(name), "SW%d", rxPin);
+        return name;
+    }
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef SIM_FREERTOS_H
+#define SIM_FREERTOS_H
+
+// FreeRTOS for the software-in-the-loop build (host_bike_sil), the subset
+// the main board uses. Tasks run on the SIL scheduler (SimRTOS.cpp) against
+// the virtual clock. Types and constants follow the ESP32 port: 1 ms tick,
+// stack sizes in bytes.
+
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint8_t StackType_t;            // ESP32 port: stack depths are in bytes
+
+// Control blocks for the *CreateStatic() calls. The SIL keeps its own state
+// for every task and queue, so these only have to exist.
+typedef struct { uint32_t unused; } StaticTask_t;
+typedef struct { uint32_t unused; } StaticQueue_t;
+
+#define pdFALSE                 0
+#define pdTRUE                  1
+#define pdFAIL                  pdFALSE
+#define pdPASS                  pdTRUE
+#define errQUEUE_EMPTY          pdFALSE
+#define errQUEUE_FULL           pdFALSE
+
+#define configTICK_RATE_HZ      1000
+#define configMAX_PRIORITIES    25
+#define portNUM_PROCESSORS      2
+#define portTICK_PERIOD_MS      (1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY           ((TickType_t)0xFFFFFFFFUL)
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define tskNO_AFFINITY          0x7FFFFFFF
+
+// The scheduler picks the highest-priority ready task after every interrupt
+#define portYIELD_FROM_ISR()    do {} while (0)
+
+BaseType_t xPortGetCoreID();
+void vPortYield();
+#define taskYIELD()             vPortYield()
+
+#endif
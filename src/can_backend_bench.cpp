@@ -0,0 +1,143 @@
+// CAN backend benchmark (runs on the main board, transceiver fitted)
+//
+//   pio run -e can_bench_library -t upload -t monitor
+//   pio run -e can_bench_twai    -t upload -t monitor
+//
+// BikeCANManager is started in CAN_NODE_LOOPBACK so every frame sent comes
+// straight back through the receive path. Two measurements per backend:
+//
+//   1. Throughput: send as fast as the backend accepts frames for
+//      BENCH_BURST_MS and count frames delivered to the receive callback.
+//   2. CPU per frame: send a paced stream (BENCH_PACED_FPS) and compare how
+//      often a low-priority spinner task runs on the same core against an idle
+//      baseline. The lost spinner time is what TX, the RX interrupt/driver and
+//      update() cost, divided by the number of frames.
+
+#include <Arduino.h>
+#include "BikeCANManager.h"
+
+#define BENCH_CORE          1
+#define BENCH_BURST_MS      1000
+#define BENCH_PACED_FPS     2000     // ~27% of a 500 kbps bus with 8-byte frames
+#define BENCH_PACED_MS      2000
+#define BENCH_ROUNDS        3
+
+BikeCANManager canManager;
+
+static volatile uint32_t framesReceived = 0;
+static volatile uint32_t spinCount = 0;
+
+void onBenchFrame(uint32_t id, uint8_t* data, uint8_t length) {
+    framesReceived++;
+}
+
+// Lowest useful priority on the benchmark core: counts while the core is free
+void spinnerTask(void* parameter) {
+    for (;;) {
+        spinCount++;
+    }
+}
+
+// Keep the receive side drained while waiting
+static void pumpFor(uint32_t ms) {
+    uint32_t start = millis();
+    while (millis() - start < ms) {
+        canManager.update();
+        vTaskDelay(1);
+    }
+}
+
+static uint32_t measureSpinRate(uint32_t ms) {
+    uint32_t before = spinCount;
+    vTaskDelay(pdMS_TO_TICKS(ms));
+    return spinCount - before;
+}
+
+static void runThroughput() {
+    framesReceived = 0;
+    uint32_t sent = 0, rejected = 0;
+    uint32_t start = millis();
+
+    while (millis() - start < BENCH_BURST_MS) {
+        if (canManager.sendTimeData((int)sent)) {
+            sent++;
+        } else {
+            rejected++;  // TX queue full (TWAI) or arbitration/ACK failure
+        }
+        if ((sent & 7) == 0) canManager.update();
+    }
+    uint32_t elapsed = millis() - start;
+    pumpFor(50);
+
+    Serial.printf("  throughput: sent %u, received %u in %u ms -> %.0f frames/s (%u TX rejects)\n",
+                  sent, framesReceived, elapsed, framesReceived * 1000.0f / elapsed, rejected);
+}
+
+static void runCpuPerFrame(uint32_t baselineSpins) {
+    framesReceived = 0;
+    uint32_t spinsBefore = spinCount;
+    uint32_t sent = 0;
+
+    TickType_t lastWake = xTaskGetTickCount();
+    uint32_t start = millis();
+    const uint32_t perTick = BENCH_PACED_FPS / configTICK_RATE_HZ;
+
+    while (millis() - start < BENCH_PACED_MS) {
+        for (uint32_t i = 0; i < perTick; i++) {
+            if (canManager.sendTimeData((int)sent)) sent++;
+        }
+        canManager.update();
+        vTaskDelayUntil(&lastWake, 1);
+    }
+    uint32_t elapsed = millis() - start;
+    uint32_t spins = spinCount - spinsBefore;
+    pumpFor(20);
+
+    float expected = (float)baselineSpins * elapsed / BENCH_PACED_MS;
+    float busy = 1.0f - spins / expected;
+    if (busy < 0) busy = 0;
+    float usPerFrame = framesReceived ? busy * elapsed * 1000.0f / framesReceived : 0;
+
+    Serial.printf("  paced %u fps: received %u, core busy %.1f%% -> %.1f us/frame (~%.0f cycles)\n",
+                  BENCH_PACED_FPS, framesReceived, busy * 100.0f, usPerFrame,
+                  usPerFrame * ESP.getCpuFreqMHz());
+}
+
+static void benchTask(void* parameter) {
+    // Baseline with the bus quiet
+    uint32_t baselineSpins = measureSpinRate(BENCH_PACED_MS);
+    Serial.printf("Baseline spinner: %u per %u ms\n", baselineSpins, BENCH_PACED_MS);
+
+    for (int round = 1; round <= BENCH_ROUNDS; round++) {
+        Serial.printf("Round %d (%s)\n", round, canManager.getBackendName());
+        runThroughput();
+        runCpuPerFrame(baselineSpins);
+    }
+
+    CANAlertCounters alerts = canManager.getAlertCounters();
+    Serial.printf("RX overflows %u, filtered %u, bus errors %u, TX failures %u\n",
+                  canManager.getRxOverflows(), canManager.getRxFiltered(),
+                  alerts.busErrors, alerts.txFailures);
+    Serial.println("Done.");
+    vTaskDelete(NULL);
+}
+
+void setup() {
+    Serial.begin(115200);
+    delay(500);
+    Serial.println("=== CAN backend benchmark ===");
+
+    if (!canManager.begin(CAN_TX_PIN, CAN_RX_PIN, CAN_NODE_LOOPBACK)) {
+        Serial.println("❌ CAN init failed, check transceiver");
+        return;
+    }
+    canManager.setReceiveCallback(onBenchFrame);
+    canManager.setTransmitMode(CAN_MSG_TIME_DATA, CAN_TX_PERIODIC);
+
+    xTaskCreatePinnedToCore(spinnerTask, "Spinner", 2048, NULL, 1, NULL, BENCH_CORE);
+    xTaskCreatePinnedToCore(benchTask, "Bench", 4096, NULL, 5, NULL, BENCH_CORE);
+}
+
+void loop() {
+    vTaskDelete(NULL);
+}
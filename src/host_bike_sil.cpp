@@ -0,0 +1,965 @@
+// Software-in-the-loop run of the main board: the unmodified firmware
+// (main_bike.cpp and its libraries) on the simulated ESP32 of sim/, against
+// device models of everything it is wired to.
+//
+//   pio run -e host_bike_sil
+//   .pio/build/host_bike_sil/program                       # one hour ride
+//   .pio/build/host_bike_sil/program --minutes 5 --seed 7
+//   .pio/build/host_bike_sil/program --quiet --cmd 600:tasks --cmd 1800:canstats
+//
+// Time is virtual (sim/SimRTOS.h): the hour takes as long as the firmware's
+// own work in it, usually seconds. What the world does:
+//   5 s     the master card is tapped: unlocked, KEY_PIN goes high
+//   8 s     an unknown card is tapped: refused
+//   then    a seeded ride: cruise and stop segments, Hall pulses from the
+//           wheel, brake and turn signal lines, two 14S JK-BMS packs and the
+//           VESC answering from the same power model
+//   20 s    a phone connects; BOOT is pressed 3 s later to pair it. It reads
+//           the status characteristic every RIDE_PHONE_READ_S while connected,
+//           goes out of range at 40% of the run and comes back (bonded,
+//           accepted without the button) RIDE_PHONE_AWAY_S later
+//   end     the bike stops 3 minutes before the end and is parked, the master
+//           card locks it a minute later and a charger is plugged in for the
+//           last minute (runs under 5 minutes: locked 10 s before the end)
+// The packs carry the motor, the board and what the key output powers (VESC,
+// display), so the firmware's per-profile draw ("power") has something to
+// measure; the BMS current readings get a little noise, as real ones have.
+// The display board is a second CAN node (SimCANTransport) with the parser
+// of main_display.cpp. It runs in device events, as its own CPU would: it
+// takes no time from the main board.
+//
+// --fault T:kind breaks something T seconds in, for the safety monitor to
+// catch: "packs" (both BMS stop answering), "cell" (a cell of pack 1 drops
+// under the limit), "fet" (VESC MOSFETs overheat) or "current" (pack 1
+// reports a 3 s discharge spike over the limit). The VESC and BMS models note
+// when the stop commands reach them; from the detection time the firmware
+// recorded that gives detection-to-action latency as the devices saw it. The
+// motor command makes the ride model let go of the throttle, MOS commands
+// are acknowledged and cut that pack's current. Checks the fault makes
+// meaningless (packs online, the ride's end) are left out.
+//
+// The run ends with the boot timeline (and when the display first had a
+// speed), the task profile, the display's view of the CAN bus, the
+// sensor-to-display latency, the firmware's heap allocations, the safety
+// monitor, the system event lanes and a list of checks; the exit code is
+// the number of failed checks. Allocations are counted as in env Bike_Main_heap (sim/SimHeap.h
+// says which); the heap figures themselves are fixed, there is no allocator
+// model behind them. Boot stages take only the time they wait (delays,
+// device replies): on one simulated CPU, side by side means overlapping waits.
+//
+// Options: --minutes N | --seconds N   length of the run (default 60 minutes, at least 60 s)
+//          --seed N                    ride profile
+//          --quiet                     drop the firmware's console output
+//          --cmd T:command             type a serial command at T seconds
+//          --cpu-scale F               charge host CPU time to the tasks,
+//                                      scaled (0 = clock reads only)
+//          --unplug N                  CAN harness off for N seconds at half time
+//          --fault T:kind              packs, cell, fet or current at T seconds
+
+#include <Arduino.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <NimBLEDevice.h>
+#include <MFRC522.h>
+
+#include "BikeMainHardware.h"
+#include "BikeSensorManager.h"
+#include "BikeRFIDManager.h"
+#include "BLEBikeManager.h"
+#include "BikeCANManager.h"
+#include "TaskProfiler.h"
+#include "BikePowerManager.h"
+#include "HeapMonitor.h"
+#include "BikeSafetyMonitor.h"
+#include "BootSequencer.h"
+#include "SystemEventQueue.h"
+#include "BikeLog.h"
+#include "SimCAN.h"
+#include "buffer.h"
+#include "crc.h"
+#include "datatypes.h"
+
+#define RIDE_TICK_US           10000      // Physics step
+#define RIDE_HALL_PULSE_US     2000       // Hall output high time
+#define RIDE_MASS_KG           110.0      // Bike and rider
+#define RIDE_ACCEL_MS2         0.45
+#define RIDE_BRAKE_MS2         2.0        // Brake line pressed above this deceleration
+#define RIDE_COAST_MS2         0.3
+#define RIDE_PARK_BEFORE_END_S 180        // Last stop: parked, then locked, then charged
+#define RIDE_LOCK_BEFORE_END_S 120
+#define RIDE_CHARGE_BEFORE_END_S 60
+#define RIDE_FULL_END_S        300        // Shorter runs: lock 10 s before the end, no charger
+#define RIDE_MIN_S             60         // Pairing (20-25 s) takes the card taps meanwhile
+#define RIDE_PHONE_READ_S      10
+#define RIDE_PHONE_AWAY_S      30
+#define RIDE_MOTOR_POLE_PAIRS  23         // Hub motor: ERPM per wheel RPM
+
+#define JK_CELLS               14
+#define JK_CAPACITY_AH         20.0
+#define JK_RESISTANCE_OHM      0.08       // Pack internal resistance
+#define JK_REPLY_DELAY_US      20000      // The BMS takes its time before answering
+#define JK_CURRENT_NOISE_A     0.01       // Reading noise, each way
+#define CHARGER_A              4.0        // Charger current, split between the packs
+
+// Board power at the pack terminals, W
+#define BOARD_DCDC_W           0.5        // 48 V converter, always on
+#define BOARD_CPU_W_PER_MHZ    0.0009
+#define BOARD_RADIO_W          0.1
+#define BOARD_RFID_W           0.15
+#define BOARD_KEY_ON_W         2.7        // VESC idle and the display, on the key output
+#define VESC_REPLY_DELAY_US    1000
+
+#define DISPLAY_PERIOD_US      5000       // Display board main loop
+#define DISPLAY_VOLTAGE_TOLERANCE 0.1f
+#define DISPLAY_FIRST_SPEED_MS 500        // Power-on to the first speed frame at the display
+
+// --fault
+#define FAULT_CELL_MV          -1500      // Pack 1's sixth cell, below the rest
+#define FAULT_CURRENT_A        55.0       // Added to pack 1's current reading...
+#define FAULT_CURRENT_S        3          // ...for this long
+#define FAULT_FET_C            70.0       // Added to the VESC FET temperature
+
+// Firmware side, main_bike.cpp
+extern BikeSensorManager sensorManager;
+extern BikeRFIDManager rfidManager;
+extern BLEBikeManager bleManager;
+extern TaskProfiler profiler;
+extern BikePowerManager powerManager;
+extern HeapMonitor heapMonitor;
+extern BikeSafetyMonitor safetyMonitor;
+extern BootSequencer boot;
+extern SystemEventQueue systemEvents;
+void printEventStats();
+void setup();
+void loop();
+
+struct SilOptions {
+    uint64_t durationUs;
+    uint32_t seed;
+    bool quiet;
+    float cpuScale;
+    uint32_t unplugSeconds;
+    uint32_t faultSeconds;
+    std::string fault;                 // Empty: none
+    std::vector<std::pair<uint32_t, std::string> > commands;
+};
+
+static SilOptions options;
+
+// ---- ride model -------------------------------------------------------------
+
+static uint32_t rngState;               // Ride profile
+static uint32_t noiseState = 0x9E3779B9; // Measurement noise, so the ride doesn't depend on it
+
+static float randomUnit(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return (state >> 8) / 16777216.0f;
+}
+
+static float randomUnit() {
+    return randomUnit(rngState);
+}
+
+static float randomRange(float low, float high) {
+    return low + (high - low) * randomUnit();
+}
+
+struct PackModel {
+    const char* uartName;
+    double soc0;
+    double usedAh;
+    double currentA;               // Discharge positive
+    int16_t cellOffsetMv[JK_CELLS];
+    uint16_t cycles;
+    uint32_t requests;
+    uint32_t replies;
+    float lastReportedV;           // Voltage in the last reply
+    bool silent;                   // --fault packs
+    double faultCurrentA;          // --fault current: added to the reading
+    bool dischargeOff;             // MOS switched off by the firmware
+    bool chargeOff;
+    
+    double soc() const { return soc0 - usedAh / JK_CAPACITY_AH; }
+    double cellVolts() const { return 3.0 + 1.2 * soc() - currentA * JK_RESISTANCE_OHM / JK_CELLS; }
+    double volts() const { return cellVolts() * JK_CELLS; }
+    double tempC() const { return 26.0 + currentA * 0.4; }
+};
+
+struct RideState {
+    bool started;
+    double speedMs;
+    double targetMs;
+    uint64_t segmentEndUs;
+    bool braking;
+    int signalPin;                 // LEFT_PIN, RIGHT_PIN or -1
+    uint64_t signalEndUs;
+    double wheelPhaseM;            // Since the magnet last passed the sensor
+    double distanceM;
+    double maxSpeedMs;
+    uint32_t hallPulses;
+    double motorCurrentA;
+    double dutyCycle;
+    double ampHours;               // Motor only, as the VESC counts
+    double wattHours;
+    bool charger;
+    bool motorCut;                 // The firmware zeroed the motor current: no more throttle
+    double fetFaultC;              // --fault fet
+};
+
+// --fault: what should trip, and what reached the devices after it
+struct FaultRecord {
+    SafetyRule rule;
+    bool injected;
+    uint64_t injectedUs;
+    bool tripSeen;
+    SafetySnapshot trip;           // The firmware's, as its first command arrived
+    uint64_t motorStopUs;          // First VESC current 0, 0 if none
+    uint64_t mosOffUs;             // First MOS switched off
+    uint32_t mosCommands;
+};
+
+// What the packs really carried (both, discharge positive) while each power
+// profile was in force, to hold the firmware's BMS-based figures against
+struct ProfileTruth {
+    double currentSumA;
+    uint64_t ticks;
+};
+
+static PackModel packs[2] = {
+    { "UART2", 0.92, 0, 0, { 0 }, 87, 0, 0, 0, false, 0, false, false },     // BMS1 on Serial2
+    { "UART1", 0.88, 0, 0, { 0 }, 91, 0, 0, 0, false, 0, false, false },     // BMS2 on Serial1
+};
+static RideState ride;
+static ProfileTruth truth[POWER_PROFILE_COUNT];
+static uint64_t rideEndUs;
+static FaultRecord fault;
+
+static void faultCommandSeen() {
+    if (!fault.injected || fault.tripSeen) return;
+    safetyMonitor.getSnapshot(fault.trip);
+    fault.tripSeen = true;
+}
+
+static void hallPulse() {
+    ride.hallPulses++;
+    simSetPin(HALL_PIN, HIGH);
+    simAfter(RIDE_HALL_PULSE_US, []() { simSetPin(HALL_PIN, LOW); });
+}
+
+static void setBraking(bool braking) {
+    if (braking == ride.braking) return;
+    ride.braking = braking;
+    if (braking) simSetPin(BRAKE_PIN, LOW);
+    else simReleasePin(BRAKE_PIN);
+}
+
+static void setSignal(int pin, uint64_t untilUs) {
+    if (ride.signalPin >= 0) simSetPin(ride.signalPin, LOW);
+    ride.signalPin = pin;
+    ride.signalEndUs = untilUs;
+    if (pin >= 0) simSetPin(pin, HIGH);
+}
+
+// Cruise at a random speed, or stop for a while (with a turn signal first, sometimes)
+static void nextSegment(uint64_t now) {
+    if (now >= rideEndUs || ride.motorCut) {
+        ride.targetMs = 0;
+        ride.segmentEndUs = UINT64_MAX;
+        return;
+    }
+    if (ride.targetMs > 0 && randomUnit() < 0.3f) {
+        ride.targetMs = 0;
+        ride.segmentEndUs = now + (uint64_t)(randomRange(10, 40) * 1e6);
+        if (randomUnit() < 0.5f) setSignal(randomUnit() < 0.5f ? LEFT_PIN : RIGHT_PIN, now + 6000000);
+    } else {
+        ride.targetMs = randomRange(12, 35) / 3.6;
+        ride.segmentEndUs = now + (uint64_t)(randomRange(30, 120) * 1e6);
+    }
+    if (ride.segmentEndUs > rideEndUs) ride.segmentEndUs = rideEndUs;
+}
+
+// The board as the firmware has set it up: CPU clock, and the key output
+// that powers the VESC and the display
+static double boardWatts() {
+    double watts = BOARD_DCDC_W + BOARD_RADIO_W + BOARD_RFID_W + getCpuFrequencyMhz() * BOARD_CPU_W_PER_MHZ;
+    if (simPinLevel(KEY_PIN) == HIGH) watts += BOARD_KEY_ON_W;
+    return watts;
+}
+
+// Electrical power at the packs, shared evenly between them
+static void updatePower(double accel, double dt) {
+    double v = ride.speedMs;
+    double motorWatts = 0;
+    if (!ride.braking && v > 0) {
+        double force = RIDE_MASS_KG * 9.81 * 0.008 + 0.5 * 1.2 * 0.6 * v * v;
+        if (accel > 0) force += RIDE_MASS_KG * accel;
+        motorWatts = force * v / 0.8;
+    }
+    double packV = (packs[0].volts() + packs[1].volts()) / 2;
+    double motorA = motorWatts / packV;
+    double current = (motorWatts + boardWatts()) / packV - (ride.charger ? CHARGER_A : 0);
+    
+    // A pack whose MOS for this direction is off carries none of it
+    bool carries[2];
+    int carrying = 0;
+    for (int i = 0; i < 2; i++) {
+        carries[i] = current >= 0 ? !packs[i].dischargeOff : !packs[i].chargeOff;
+        if (carries[i]) carrying++;
+    }
+    for (int i = 0; i < 2; i++) {
+        packs[i].currentA = carries[i] ? current / carrying : 0;
+        packs[i].usedAh += packs[i].currentA * dt / 3600.0;
+    }
+    ride.motorCurrentA = motorA * 1.1;
+    ride.dutyCycle = v / (45 / 3.6);
+    ride.ampHours += motorA * dt / 3600.0;
+    ride.wattHours += motorWatts * dt / 3600.0;
+    
+    ProfileTruth& t = truth[powerManager.getProfile()];
+    t.currentSumA += current;
+    t.ticks++;
+}
+
+static void physicsTick() {
+    uint64_t now = simNowUs();
+    double dt = RIDE_TICK_US / 1e6;
+    simAfter(RIDE_TICK_US, physicsTick);
+    
+    // The rider sets off once the key output is on
+    if (!ride.started) {
+        if (simPinLevel(KEY_PIN) != HIGH) {
+            updatePower(0, dt);
+            return;
+        }
+        ride.started = true;
+        nextSegment(now);
+    }
+    if (now >= ride.segmentEndUs || (ride.motorCut && ride.targetMs > 0)) nextSegment(now);
+    if (ride.signalPin >= 0 && now >= ride.signalEndUs) setSignal(-1, 0);
+    
+    double before = ride.speedMs;
+    double diff = ride.targetMs - ride.speedMs;
+    if (diff >= 0) {
+        ride.speedMs += diff < RIDE_ACCEL_MS2 * dt ? diff : RIDE_ACCEL_MS2 * dt;
+        setBraking(false);
+    } else {
+        bool hard = -diff > 1.0;
+        double decel = hard ? RIDE_BRAKE_MS2 : RIDE_COAST_MS2;
+        ride.speedMs -= -diff < decel * dt ? -diff : decel * dt;
+        setBraking(hard);
+    }
+    if (ride.speedMs > ride.maxSpeedMs) ride.maxSpeedMs = ride.speedMs;
+    updatePower((ride.speedMs - before) / dt, dt);
+    
+    // One pulse each time the magnet passes, at the exact time within the step
+    double v = ride.speedMs;
+    double travelled = v * dt;
+    double elapsed = 0;
+    ride.distanceM += travelled;
+    while (v > 0 && ride.wheelPhaseM + travelled >= WHEEL_CIRCUMFERENCE_M) {
+        double toGo = WHEEL_CIRCUMFERENCE_M - ride.wheelPhaseM;
+        elapsed += toGo / v;
+        travelled -= toGo;
+        ride.wheelPhaseM = 0;
+        simAt(now + (uint64_t)(elapsed * 1e6), hallPulse);
+    }
+    ride.wheelPhaseM += travelled;
+}
+
+// ---- UART devices -----------------------------------------------------------
+
+static void putBigEndian16(uint8_t* out, size_t& pos, uint16_t value) {
+    out[pos++] = value >> 8;
+    out[pos++] = value & 0xFF;
+}
+
+// JK-BMS "read all" reply. The interface finds the end of a frame by the
+// 0x68 end mark and the two zero checksum bytes after it: no field below can
+// hold that sequence, since every value sits behind a non-zero ID byte.
+class JKBmsModel : public SimUartDevice {
+public:
+    explicit JKBmsModel(PackModel& pack) : pack(pack), uart(nullptr) {}
+    
+    void attach() {
+        uart = SimUart::find(pack.uartName);
+        if (uart) uart->attach(this);
+    }
+    
+    void onFirmwareWrite(const uint8_t* data, size_t length) override {
+        if (length < 10 || data[0] != 0x4E || data[1] != 0x57) return;
+        if (data[8] == 0x02 && length >= 13) {
+            onMOSCommand(data[11], data[12]);
+            return;
+        }
+        if (data[8] != 0x06) return;
+        pack.requests++;
+        if (pack.silent) return;
+        PackModel* model = &pack;
+        SimUart* port = uart;
+        simAfter(JK_REPLY_DELAY_US, [model, port]() {
+            uint8_t frame[160];
+            size_t length = buildFrame(*model, frame);
+            port->send(frame, length);
+            model->replies++;
+        });
+    }
+
+private:
+    PackModel& pack;
+    SimUart* uart;
+    
+    // Charge (0xAB) or discharge (0xAC) MOS: switched, then acknowledged
+    void onMOSCommand(uint8_t dataId, uint8_t value) {
+        if (pack.silent || (dataId != 0xAB && dataId != 0xAC)) return;
+        (dataId == 0xAB ? pack.chargeOff : pack.dischargeOff) = value == 0;
+        if (value == 0 && fault.injected) {
+            fault.mosCommands++;
+            if (!fault.mosOffUs) fault.mosOffUs = simNowUs();
+            faultCommandSeen();
+        }
+        SimUart* port = uart;
+        simAfter(JK_REPLY_DELAY_US, [port, dataId, value]() {
+            uint8_t frame[24] = { 0x4E, 0x57, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x01,
+                                  dataId, value, 0x00, 0x00, 0x00, 0x01, 0x68 };
+            size_t pos = 18;
+            frame[3] = (uint8_t)(pos + 4 - 2);
+            uint16_t sum = 0;
+            for (size_t i = 0; i < pos; i++) sum += frame[i];
+            putBigEndian16(frame, pos, 0);
+            putBigEndian16(frame, pos, sum);
+            port->send(frame, pos);
+        });
+    }
+    
+    static uint16_t temperature(double celsius) {
+        return celsius >= 0 ? (uint16_t)(celsius + 0.5) : (uint16_t)(100 - celsius + 0.5);
+    }
+    
+    static size_t buildFrame(PackModel& pack, uint8_t* out) {
+        static const uint8_t header[] = { 0x4E, 0x57, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x06, 0x00, 0x01 };
+        size_t pos = sizeof(header);
+        memcpy(out, header, sizeof(header));
+        
+        out[pos++] = 0x79;
+        out[pos++] = JK_CELLS * 3;
+        double cellMv = pack.cellVolts() * 1000;
+        for (uint8_t i = 0; i < JK_CELLS; i++) {
+            out[pos++] = i + 1;
+            putBigEndian16(out, pos, (uint16_t)(cellMv + pack.cellOffsetMv[i] + 0.5));
+        }
+        out[pos++] = 0x80; putBigEndian16(out, pos, temperature(pack.tempC() + 4));
+        out[pos++] = 0x81; putBigEndian16(out, pos, temperature(pack.tempC() + 1));
+        out[pos++] = 0x82; putBigEndian16(out, pos, temperature(pack.tempC()));
+        
+        uint16_t centivolts = (uint16_t)(pack.volts() * 100 + 0.5);
+        out[pos++] = 0x83; putBigEndian16(out, pos, centivolts);
+        double noise = (randomUnit(noiseState) * 2 - 1) * JK_CURRENT_NOISE_A;
+        double reading = pack.currentA + pack.faultCurrentA + noise;
+        out[pos++] = 0x84; putBigEndian16(out, pos, (uint16_t)(10000 + reading * 100 + 0.5));
+        out[pos++] = 0x85; out[pos++] = (uint8_t)(pack.soc() * 100 + 0.5);
+        out[pos++] = 0x86; out[pos++] = 2;
+        out[pos++] = 0x87; putBigEndian16(out, pos, pack.cycles);
+        out[pos++] = 0x8B; putBigEndian16(out, pos, 0);
+        out[pos++] = 0x8C; putBigEndian16(out, pos, (pack.chargeOff ? 0 : 0x0001) | (pack.dischargeOff ? 0 : 0x0002));
+        
+        const char version[15] = "11.XW_S11.48";
+        out[pos++] = 0xB7;
+        memcpy(out + pos, version, sizeof(version));
+        pos += sizeof(version);
+        const char name[] = "JK_B2A24S15P";
+        out[pos++] = 0xBA;
+        memcpy(out + pos, name, sizeof(name));
+        pos += sizeof(name);
+        
+        out[pos++] = 0x68;
+        uint16_t sum = 0;
+        for (size_t i = 0; i < pos; i++) sum += out[i];
+        out[2] = (pos + 4 - 2) >> 8;
+        out[3] = (pos + 4 - 2) & 0xFF;
+        putBigEndian16(out, pos, 0);
+        putBigEndian16(out, pos, sum);
+        
+        pack.lastReportedV = centivolts / 100.0f;
+        return pos;
+    }
+};
+
+// VESC: COMM_GET_VALUES, and the safety stop's current commands
+class VescModel : public SimUartDevice {
+public:
+    VescModel() : uart(nullptr), requests(0), replies(0) {}
+    
+    void attach() {
+        char name[8];
+        snprintf(name, sizeof(name), "SW%d", VESC_RX);
+        uart = SimUart::find(name);
+        if (uart) uart->attach(this);
+    }
+    
+    void onFirmwareWrite(const uint8_t* data, size_t length) override {
+        if (length >= 10 && data[0] == 2 && data[1] == 5 && data[2] == COMM_SET_CURRENT) {
+            int32_t ind = 3;
+            if (buffer_get_int32(data, &ind) != 0) return;
+            ride.motorCut = true;
+            if (fault.injected && !fault.motorStopUs) {
+                fault.motorStopUs = simNowUs();
+                faultCommandSeen();
+            }
+            return;
+        }
+        if (length < 6 || data[0] != 2 || data[1] != 1 || data[2] != COMM_GET_VALUES) return;
+        requests++;
+        VescModel* model = this;
+        simAfter(VESC_REPLY_DELAY_US, [model]() { model->reply(); });
+    }
+    
+    uint32_t getRequests() const { return requests; }
+    uint32_t getReplies() const { return replies; }
+
+private:
+    SimUart* uart;
+    uint32_t requests;
+    uint32_t replies;
+    
+    void reply() {
+        uint8_t payload[80];
+        int32_t ind = 0;
+        double wheelRpm = ride.speedMs / WHEEL_CIRCUMFERENCE_M * 60;
+        double load = ride.motorCurrentA;
+        
+        payload[ind++] = COMM_GET_VALUES;
+        buffer_append_float16(payload, 30 + load * 0.5 + ride.fetFaultC, 10, &ind);   // FET
+        buffer_append_float16(payload, 32 + load * 0.8, 10, &ind);        // Motor
+        buffer_append_float32(payload, ride.motorCurrentA, 100, &ind);
+        buffer_append_float32(payload, packs[0].currentA + packs[1].currentA, 100, &ind);
+        buffer_append_int32(payload, 0, &ind);                              // Id
+        buffer_append_int32(payload, 0, &ind);                              // Iq
+        buffer_append_float16(payload, ride.dutyCycle, 1000, &ind);
+        buffer_append_float32(payload, wheelRpm * RIDE_MOTOR_POLE_PAIRS, 1, &ind);
+        buffer_append_float16(payload, packs[0].volts(), 10, &ind);
+        buffer_append_float32(payload, ride.ampHours, 10000, &ind);
+        buffer_append_float32(payload, 0, 10000, &ind);
+        buffer_append_float32(payload, ride.wattHours, 10000, &ind);
+        buffer_append_float32(payload, 0, 10000, &ind);
+        int32_t tacho = (int32_t)(ride.distanceM / WHEEL_CIRCUMFERENCE_M * RIDE_MOTOR_POLE_PAIRS * 6);
+        buffer_append_int32(payload, tacho, &ind);
+        buffer_append_int32(payload, tacho, &ind);
+        payload[ind++] = 0;                                                 // No fault
+        buffer_append_float32(payload, 0, 1000000, &ind);
+        payload[ind++] = 0;                                                 // Controller ID
+        
+        uint8_t frame[96];
+        size_t pos = 0;
+        frame[pos++] = 2;
+        frame[pos++] = (uint8_t)ind;
+        memcpy(frame + pos, payload, ind);
+        pos += ind;
+        putBigEndian16(frame, pos, crc16(payload, ind));
+        frame[pos++] = 3;
+        uart->send(frame, pos);
+        replies++;
+    }
+};
+
+static JKBmsModel bms1Model(packs[0]);
+static JKBmsModel bms2Model(packs[1]);
+static VescModel vescModel;
+
+// ---- RFID and phone ---------------------------------------------------------
+
+static const uint8_t MASTER_CARD[] = { 0x29, 0x0E, 0x72, 0x43 };     // main_bike.cpp MASTER_CARD_UID
+static const uint8_t STRANGER_CARD[] = { 0xA1, 0x5C, 0x03, 0x9E };
+static const char* PHONE_ADDRESS = "6c:4a:85:31:e0:7d";
+
+static uint32_t cardTaps;
+static uint32_t phoneReads;
+static uint32_t phoneEmptyReads;
+static bool phoneReconnectPlanned;
+
+static void phoneReadLoop() {
+    simAfter(RIDE_PHONE_READ_S * 1000000ULL, phoneReadLoop);
+    if (!simBleConnected()) return;
+    simBleRead(BIKE_STATUS_CHAR_UUID, [](const std::string& value) {
+        phoneReads++;
+        if (value.empty()) phoneEmptyReads++;
+    });
+}
+
+static void tapCard(const uint8_t* uid, uint8_t size) {
+    cardTaps++;
+    simRfidTap(uid, size, 800);
+}
+
+static void pressBoot(uint32_t holdMs) {
+    simSetPin(MANUAL_AUTHENTICATION_PIN, LOW);
+    simAfter(holdMs * 1000ULL, []() { simReleasePin(MANUAL_AUTHENTICATION_PIN); });
+}
+
+// ---- display node -----------------------------------------------------------
+
+static SimCANTransport displayTransport;
+static BikeCANManager displayManager(displayTransport);
+static BikeDataDisplay displayData;
+static CANLatencyTrace displayLatency;
+static uint32_t displayParsed;
+static uint32_t displayParseFailures;
+static uint64_t displayFirstSpeedUs;      // Power-on (both boards, time 0) to the first speed frame parsed
+
+static void onDisplayFrame(uint32_t id, uint8_t* data, uint8_t length) {
+    if (displayManager.parseCANMessage(id, data, length, displayData)) {
+        displayParsed++;
+        if (id == MSG_ID_BIKE_STATUS && !displayFirstSpeedUs) displayFirstSpeedUs = simNowUs();
+    } else {
+        displayParseFailures++;
+    }
+}
+
+static void onDisplayIsoTp(const uint8_t* payload, uint16_t length) {
+    if (!displayManager.parseIsoTpMessage(payload, length, displayData)) displayParseFailures++;
+}
+
+static void displayLoop() {
+    simAfter(DISPLAY_PERIOD_US, displayLoop);
+    displayManager.update();
+    displayLatency.onDisplayed(micros());
+}
+
+static void displayBegin() {
+    if (!displayManager.begin(0, 0, CAN_NODE_DISPLAY)) return;
+    displayManager.setReceiveCallback(onDisplayFrame);
+    displayManager.setIsoTpCallback(onDisplayIsoTp);
+    displayManager.setSubscription(CAN_GROUPS_DASHBOARD);
+    displayManager.setLatencyTrace(&displayLatency);
+    displayLoop();
+}
+
+// ---- scenario ---------------------------------------------------------------
+
+static uint64_t seconds(double s) {
+    return (uint64_t)(s * 1e6);
+}
+
+static bool fullEnd;               // Parked, locked and charged at the end
+static bool vescOnlineMidRide;
+
+// --fault kinds, in SafetyRule order
+static const char* FAULT_KINDS[SAFETY_RULE_COUNT] = { "packs", "cell", "fet", "current" };
+
+static void injectFault() {
+    fault.injected = true;
+    fault.injectedUs = simNowUs();
+    switch (fault.rule) {
+        case SAFETY_PACKS_LOST:
+            packs[0].silent = true;
+            packs[1].silent = true;
+            break;
+        case SAFETY_CELL_LOW:
+            packs[0].cellOffsetMv[5] = FAULT_CELL_MV;
+            break;
+        case SAFETY_FET_HOT:
+            ride.fetFaultC = FAULT_FET_C;
+            break;
+        default:
+            packs[0].faultCurrentA = FAULT_CURRENT_A;
+            simAfter(seconds(FAULT_CURRENT_S), []() { packs[0].faultCurrentA = 0; });
+            break;
+    }
+}
+
+static void schedule() {
+    uint64_t end = options.durationUs;
+    fullEnd = end >= seconds(RIDE_FULL_END_S);
+    rideEndUs = fullEnd ? end - seconds(RIDE_PARK_BEFORE_END_S) : end / 2;
+    
+    // Lines at rest: wheel magnet away, signals off, brake and BOOT released
+    simSetPin(HALL_PIN, LOW);
+    simSetPin(LEFT_PIN, LOW);
+    simSetPin(RIGHT_PIN, LOW);
+    ride.signalPin = -1;
+    for (int i = 0; i < 2; i++) {
+        for (int c = 0; c < JK_CELLS; c++) packs[i].cellOffsetMv[c] = (int16_t)randomRange(-6, 6);
+    }
+    
+    // The UARTs exist from the start; the devices answer whenever asked
+    bms1Model.attach();
+    bms2Model.attach();
+    vescModel.attach();
+    
+    simAt(0, displayBegin);
+    simAt(0, physicsTick);
+    simAt(seconds(5), []() { tapCard(MASTER_CARD, sizeof(MASTER_CARD)); });
+    simAt(seconds(8), []() { tapCard(STRANGER_CARD, sizeof(STRANGER_CARD)); });
+    if (fullEnd) {
+        simAt(end - seconds(RIDE_LOCK_BEFORE_END_S), []() { tapCard(MASTER_CARD, sizeof(MASTER_CARD)); });
+        simAt(end - seconds(RIDE_CHARGE_BEFORE_END_S), []() { ride.charger = true; });
+    } else if (end > seconds(10)) {
+        simAt(end - seconds(10), []() { tapCard(MASTER_CARD, sizeof(MASTER_CARD)); });
+    }
+    simAt(rideEndUs / 2, []() { vescOnlineMidRide = sensorManager.peekBikeStatus().vesc.connected; });
+    
+    simAt(seconds(20), []() { simBleConnect(PHONE_ADDRESS); });
+    simAt(seconds(23), []() { pressBoot(1000); });
+    simAt(seconds(25), phoneReadLoop);
+    
+    uint64_t away = seconds(60) > end * 2 / 5 ? seconds(60) : end * 2 / 5;
+    phoneReconnectPlanned = away + seconds(RIDE_PHONE_AWAY_S + 20) < end;
+    if (phoneReconnectPlanned) {
+        simAt(away, []() { simBleDisconnect(); });
+        simAt(away + seconds(RIDE_PHONE_AWAY_S), []() { simBleConnect(PHONE_ADDRESS); });
+    }
+    
+    if (options.unplugSeconds) {
+        simAt(end / 2, []() { simCanBus().setConnected(false); });
+        simAt(end / 2 + seconds(options.unplugSeconds), []() { simCanBus().setConnected(true); });
+    }
+    
+    for (size_t i = 0; i < options.commands.size(); i++) {
+        std::string command = options.commands[i].second;
+        simAt(seconds(options.commands[i].first), [command]() { simConsoleInput(command.c_str()); });
+    }
+    if (!options.fault.empty()) simAt(seconds(options.faultSeconds), injectFault);
+}
+
+// ---- report -----------------------------------------------------------------
+
+static TaskProfilerSnapshot taskProfile;
+static PowerSnapshot powerStats;
+static HeapSnapshot heapStats;
+static CANBusStatsSnapshot displayStats;
+static SafetySnapshot safetyStats;
+static BootTimeline bootTimeline;
+
+static uint32_t failures;
+
+static void check(bool ok, const char* what) {
+    printf("  [%s] %s\n", ok ? "PASS" : "FAIL", what);
+    if (!ok) failures++;
+}
+
+static void report(double wallSeconds) {
+    double virtualSeconds = simNowUs() / 1e6;
+    printf("\n=== SIL: %.0f s simulated in %.2f s (%.0fx), %llu device events ===\n",
+           virtualSeconds, wallSeconds, wallSeconds > 0 ? virtualSeconds / wallSeconds : 0.0,
+           (unsigned long long)simGetEventCount());
+    
+    printf("\nScheduler view (virtual time while each task held the CPU):\n");
+    printf("  %-14s %4s %10s %10s\n", "task", "prio", "resumes", "run ms");
+    for (uint32_t i = 0; i < simTaskCount(); i++) {
+        SimTaskStats stats;
+        if (!simGetTaskStats(i, stats)) continue;
+        printf("  %-14s %4u %10u %10.1f%s\n", stats.name, (unsigned)stats.priority, stats.resumes,
+               stats.runUs / 1000.0, stats.deleted ? "  (deleted)" : "");
+    }
+    fflush(stdout);
+    
+    printf("\nFirmware boot, against the first speed frame at the display:\n");
+    fflush(stdout);
+    boot.getTimeline(bootTimeline);
+    bootPrintTimeline(bootTimeline);
+    printf("  display: first speed at %.1f ms\n", displayFirstSpeedUs / 1000.0);
+    
+    printf("\nFirmware task profile:\n");
+    fflush(stdout);
+    profiler.getSnapshot(taskProfile);
+    taskPrintProfile(taskProfile);
+    
+    printf("\nFirmware power profiles, against the pack current the model drew:\n");
+    fflush(stdout);
+    powerManager.getSnapshot(powerStats);
+    powerPrintStats(powerStats);
+    printf("  model     ");
+    for (uint8_t i = 0; i < POWER_PROFILE_COUNT; i++) {
+        printf(" %s %.3f A", BikePowerManager::settings((BikePowerProfile)i).name,
+               truth[i].ticks ? truth[i].currentSumA / truth[i].ticks : 0.0);
+    }
+    printf("\n");
+    
+    printf("\nFirmware heap:\n");
+    fflush(stdout);
+    heapMonitor.getSnapshot(heapStats);
+    heapPrintStats(heapStats);
+    
+    printf("\nSafety monitor:\n");
+    fflush(stdout);
+    safetyMonitor.getSnapshot(safetyStats);
+    safetyPrintStats(safetyStats);
+    if (fault.injected) {
+        // Firmware stamps are micros(), on the same virtual clock as the devices'
+        uint32_t detectedUs = fault.trip.detectedUs;
+        printf("  fault %s at %.1f s", options.fault.c_str(), fault.injectedUs / 1e6);
+        if (fault.tripSeen) {
+            printf(": tripped %s %.1f ms later", BikeSafetyMonitor::ruleName(fault.trip.rule),
+                   (uint32_t)(detectedUs - (uint32_t)fault.injectedUs) / 1000.0);
+        }
+        printf("\n");
+        if (fault.motorStopUs) {
+            printf("  detection to VESC current 0: %.2f ms\n", (uint32_t)((uint32_t)fault.motorStopUs - detectedUs) / 1000.0);
+        }
+        if (fault.mosOffUs) {
+            printf("  detection to BMS MOS off: %.2f ms (%u MOS commands)\n",
+                   (uint32_t)((uint32_t)fault.mosOffUs - detectedUs) / 1000.0, fault.mosCommands);
+        }
+    }
+    
+    printf("\nSystem events:\n");
+    fflush(stdout);
+    printEventStats();
+    EventQueueStats eventStats;
+    systemEvents.getStats(eventStats);
+    
+    printf("\nDisplay node:\n");
+    fflush(stdout);
+    displayManager.getBusStats(displayStats);
+    canPrintBusStats(displayStats);
+    canPrintLatency(displayLatency, displayManager.getTimeSync());
+    
+    SimBleStats ble;
+    simBleGetStats(ble);
+    const BikeStatus& status = sensorManager.peekBikeStatus();
+    printf("\nRide: %.2f km, max %.1f km/h, %u Hall pulses (%lu counted), %.2f Ah\n",
+           ride.distanceM / 1000, ride.maxSpeedMs * 3.6, ride.hallPulses, sensorManager.getHallPulseCount(),
+           ride.ampHours);
+    printf("BMS: %u/%u and %u/%u requests answered | VESC: %u/%u\n", packs[0].replies, packs[0].requests,
+           packs[1].replies, packs[1].requests, vescModel.getReplies(), vescModel.getRequests());
+    printf("Phone: %u connects, %u refused, %u disconnects, %u reads, %u notifications\n",
+           ble.connects, ble.refused, ble.disconnects, ble.reads, ble.notifications);
+    printf("CAN: %u frames carried, bus busy %.2f%% | display parsed %u, failed %u\n",
+           simCanBus().getFramesCarried(), simCanBus().getBusyUs() * 100.0 / simNowUs(),
+           displayParsed, displayParseFailures);
+    printf("Log: %lu records, %lu dropped\n", (unsigned long)bikeLog.getWritten(),
+           (unsigned long)bikeLog.getDropped());
+    
+    printf("\nChecks:\n");
+    check(ride.hallPulses > 0 && ride.hallPulses == sensorManager.getHallPulseCount(),
+          "every Hall pulse counted by the interrupt");
+    bool booted = bootTimeline.stageCount > 0;
+    for (uint8_t i = 0; i < bootTimeline.stageCount; i++) booted = booted && bootTimeline.stages[i].endUs;
+    check(booted, "every boot stage ran");
+    check(displayFirstSpeedUs && displayFirstSpeedUs <= DISPLAY_FIRST_SPEED_MS * 1000ULL,
+          "display got its first speed within 500 ms of power-on");
+    check(ride.started, "master card unlocked the bike");
+    check(options.durationUs <= seconds(10) || (!rfidManager.isBikeUnlocked() && simPinLevel(KEY_PIN) == LOW),
+          "master card locked it again at the end");
+    check(simRfidField().reads >= 2, "RFID reads reached the firmware");
+    check(ble.connects >= 1 && bleManager.getBondedDeviceCount() >= 1, "phone paired with the BOOT button");
+    check(!phoneReconnectPlanned || (ble.connects >= 2 && ble.disconnects >= 1),
+          "bonded phone reconnected without the button");
+    check(phoneReads > 0 && phoneEmptyReads == 0, "status characteristic reads answered");
+    const EventLaneStats& info = eventStats.lanes[EVENT_LANE_INFO];
+    check(info.posted == cardTaps + ble.connects + ble.disconnects,
+          "every card tap and connection change posted as a system event");
+    check(info.overflows == 0 && eventStats.lanes[EVENT_LANE_SAFETY].overflows == 0 && eventStats.poolUsed == 0,
+          "no system events lost or left waiting");
+    // A fault stops the ride and may keep the packs away: the ride's own checks go
+    bool faulted = fault.injected;
+    check(faulted || (status.bms1.connected && status.bms2.connected), "both packs online");
+    check(vescOnlineMidRide, "VESC online while riding");
+    check(displayParsed > 0 && displayParseFailures == 0, "display parsed every frame");
+    check(faulted || (fabsf(displayData.battery1Volt - packs[0].lastReportedV) <= DISPLAY_VOLTAGE_TOLERANCE &&
+                      fabsf(displayData.battery2Volt - packs[1].lastReportedV) <= DISPLAY_VOLTAGE_TOLERANCE),
+          "display pack voltages match the BMS");
+    check(bikeLog.getDropped() == 0, "no log records dropped");
+    // Serial commands print with Serial.printf(), which allocates for long lines
+    check(heapStats.counting && heapStats.rideMs > 0 &&
+          (heapStats.rideAllocations == 0 || !options.commands.empty()),
+          "no heap allocations while riding");
+    
+    // Profiles: riding, parked at the end of the ride, locked (boot and end), charging
+    const PowerProfileStats* p = powerStats.stats;
+    check(p[POWER_RIDING].entries >= 1 && p[POWER_LOCKED].entries >= 2 &&
+          (!fullEnd || faulted || (p[POWER_PARKED].entries >= 1 && p[POWER_CHARGING].entries >= 1)),
+          "power profiles followed the ride");
+    check(faulted || (powerStats.profile == (fullEnd ? POWER_CHARGING : POWER_LOCKED) &&
+                      getCpuFrequencyMhz() == BikePowerManager::settings(powerStats.profile).cpuMhz),
+          "profile and CPU clock at the end");
+    check(!fullEnd || faulted || (p[POWER_LOCKED].samples && p[POWER_PARKED].samples &&
+                       p[POWER_LOCKED].currentSumA / p[POWER_LOCKED].samples <
+                       p[POWER_PARKED].currentSumA / p[POWER_PARKED].samples),
+          "measured draw lower locked than parked");
+    
+    // Safety: silent on a clean ride; with a fault, the right rule and the stop in time
+    uint32_t trips = 0;
+    for (uint8_t i = 0; i < SAFETY_RULE_COUNT; i++) trips += safetyStats.trips[i];
+    if (!faulted) {
+        check(trips == 0, "no safety trips on a normal ride");
+    } else {
+        uint32_t deadlineUs = SAFETY_ACTION_DEADLINE_MS * 1000UL;
+        bool packRule = fault.rule == SAFETY_CELL_LOW || fault.rule == SAFETY_PACK_CURRENT;
+        check(fault.tripSeen && fault.trip.rule == fault.rule, "fault tripped its safety rule");
+        check(fault.motorStopUs && (uint32_t)((uint32_t)fault.motorStopUs - fault.trip.detectedUs) <= deadlineUs,
+              "motor current 0 reached the VESC within the deadline");
+        check(!packRule || (fault.mosOffUs && (uint32_t)((uint32_t)fault.mosOffUs - fault.trip.detectedUs) <= deadlineUs &&
+                            packs[0].dischargeOff && !packs[1].dischargeOff),
+              "pack's discharge MOS switched off within the deadline");
+        check(safetyStats.deadlineMisses == 0, "stop sent without dropping the key output");
+        check(eventStats.lanes[EVENT_LANE_SAFETY].posted == trips, "stop reached systemTask on the safety lane");
+    }
+    printf("%u check(s) failed\n", failures);
+}
+
+static bool parseArgs(int argc, char** argv) {
+    options.durationUs = 3600ULL * 1000000ULL;
+    options.seed = 1;
+    options.quiet = false;
+    options.cpuScale = 0;
+    options.unplugSeconds = 0;
+    options.faultSeconds = 0;
+    
+    for (int i = 1; i < argc; i++) {
+        std::string key = argv[i];
+        if (key == "--quiet") {
+            options.quiet = true;
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+        if (key == "--minutes") options.durationUs = strtoull(value, nullptr, 10) * 60000000ULL;
+        else if (key == "--seconds") options.durationUs = strtoull(value, nullptr, 10) * 1000000ULL;
+        else if (key == "--seed") options.seed = strtoul(value, nullptr, 10);
+        else if (key == "--cpu-scale") options.cpuScale = atof(value);
+        else if (key == "--unplug") options.unplugSeconds = strtoul(value, nullptr, 10);
+        else if (key == "--cmd") {
+            const char* colon = strchr(value, ':');
+            if (!colon) return false;
+            options.commands.push_back(std::make_pair((uint32_t)strtoul(value, nullptr, 10), std::string(colon + 1)));
+        } else if (key == "--fault") {
+            const char* colon = strchr(value, ':');
+            if (!colon) return false;
+            options.faultSeconds = strtoul(value, nullptr, 10);
+            options.fault = colon + 1;
+            uint8_t kind = 0;
+            while (kind < SAFETY_RULE_COUNT && options.fault != FAULT_KINDS[kind]) kind++;
+            if (kind == SAFETY_RULE_COUNT) return false;
+            fault.rule = (SafetyRule)kind;
+        } else {
+            return false;
+        }
+    }
+    return options.durationUs >= RIDE_MIN_S * 1000000ULL && options.seed != 0;
+}
+
+int main(int argc, char** argv) {
+    if (!parseArgs(argc, argv)) {
+        fprintf(stderr, "usage: %s [--minutes N | --seconds N] [--seed N] [--quiet] [--cmd T:command]... "
+                        "[--cpu-scale F] [--unplug N] [--fault T:packs|cell|fet|current]\n", argv[0]);
+        return 1;
+    }
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    rngState = options.seed;
+    simSetCpuScale(options.cpuScale);
+    simConsoleQuiet(options.quiet);
+    
+    schedule();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    simRun(options.durationUs, setup, loop);
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    // Every task is parked; the report runs alone
+    simConsoleQuiet(false);
+    report(wall);
+    fflush(stdout);
+    _exit(failures > 255 ? 255 : failures);
+}
@@ -0,0 +1,238 @@
+// Host benchmark for the Bike_CAN signal codec.
+//
+//   pio run -e host_can_codec_bench && .pio/build/host_can_codec_bench/program
+//
+// Compares the generated pack/unpack code in BikeCANSignals.h against the
+// previous hand-written byte shuffles, and against the old transmit pattern of
+// one CAN.write() call per byte (modelled by a virtual byte sink).
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+
+#include "BikeCANSignals.h"
+
+static const uint32_t ITERATIONS = 2000000;
+static const uint32_t SAMPLES = 256;         // Distinct inputs, cycled so nothing is loop-invariant
+
+// Keeps the optimiser from discarding results
+static volatile uint32_t sink;
+
+// ---- old transmit path: one virtual call per payload byte --------------------
+
+class ByteSink {
+public:
+    virtual ~ByteSink() {}
+    virtual size_t write(uint8_t b) = 0;
+};
+
+// Stands in for CANClass: an out-of-line virtual write per byte
+class BufferSink : public ByteSink {
+public:
+    BufferSink() : pos(0) {}
+    size_t write(uint8_t b) override __attribute__((noinline));
+    uint8_t buf[8];
+    uint32_t pos;
+};
+
+size_t BufferSink::write(uint8_t b) {
+    buf[pos++ & 7] = b;
+    return 1;
+}
+
+// Opaque to the optimiser, so calls through it cannot be devirtualised
+static ByteSink* volatile canSink;
+
+// ---- legacy hand-written encoders/decoders (pre-codec layout) ----------------
+
+struct VescSample {
+    float rpm, voltage, current, tempMotor, tempFET;
+};
+
+static void legacyEncodeVesc(ByteSink& out, const VescSample& v) {
+    int16_t rpm = (int16_t)(v.rpm / 10);
+    uint16_t voltage = (uint16_t)(v.voltage * 100);
+    int16_t current = (int16_t)(v.current * 100);
+    out.write(rpm >> 8);
+    out.write(rpm & 0xFF);
+    out.write(voltage >> 8);
+    out.write(voltage & 0xFF);
+    out.write(current >> 8);
+    out.write(current & 0xFF);
+    out.write((uint8_t)(v.tempMotor + 50));
+    out.write((uint8_t)(v.tempFET + 50));
+}
+
+static void legacyDecodeVesc(const uint8_t* d, VescSample& v) {
+    v.rpm = (int16_t)((d[0] << 8) | d[1]) * 10.0f;
+    v.voltage = ((d[2] << 8) | d[3]) / 100.0f;
+    v.current = (int16_t)((d[4] << 8) | d[5]) / 100.0f;
+    v.tempMotor = d[6] - 50.0f;
+    v.tempFET = d[7] - 50.0f;
+}
+
+struct BmsSample {
+    float voltage, current, soc, temperature;
+    bool connected, charging, discharging, chgEnabled, dsgEnabled;
+    uint8_t numCells;
+};
+
+static void legacyEncodeBms(ByteSink& out, const BmsSample& b) {
+    uint16_t voltage = (uint16_t)(b.voltage * 100);
+    int16_t current = (int16_t)(b.current * 100);
+    uint8_t flags = 0;
+    if (b.connected) flags |= 0x01;
+    if (b.charging) flags |= 0x02;
+    if (b.discharging) flags |= 0x04;
+    if (b.chgEnabled) flags |= 0x08;
+    if (b.dsgEnabled) flags |= 0x10;
+    out.write(voltage >> 8);
+    out.write(voltage & 0xFF);
+    out.write(current >> 8);
+    out.write(current & 0xFF);
+    out.write((uint8_t)b.soc);
+    out.write((uint8_t)(b.temperature + 50));
+    out.write(flags);
+    out.write(b.numCells);
+}
+
+static void legacyDecodeBms(const uint8_t* d, BmsSample& b) {
+    b.voltage = ((d[0] << 8) | d[1]) / 100.0f;
+    b.current = (int16_t)((d[2] << 8) | d[3]) / 100.0f;
+    b.soc = d[4];
+    b.temperature = d[5] - 50.0f;
+    b.connected = d[6] & 0x01;
+    b.charging = d[6] & 0x02;
+    b.discharging = d[6] & 0x04;
+    b.chgEnabled = d[6] & 0x08;
+    b.dsgEnabled = d[6] & 0x10;
+    b.numCells = d[7];
+}
+
+// ---- timing -----------------------------------------------------------------
+
+typedef std::chrono::steady_clock Clock;
+
+static double nsPerIter(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double, std::nano>(end - start).count() / ITERATIONS;
+}
+
+static void report(const char* name, double legacyWrite, double codecPack,
+                   double legacyDecode, double codecUnpack) {
+    printf("%-8s encode: CAN.write x8 %6.2f ns   codec pack %6.2f ns   (%.1fx)\n",
+           name, legacyWrite, codecPack, legacyWrite / codecPack);
+    printf("%-8s decode: hand-shuffle %6.2f ns   codec unpack %6.2f ns\n",
+           name, legacyDecode, codecUnpack);
+}
+
+static void benchVesc() {
+    static VescSample in[SAMPLES], out[SAMPLES];
+    static CANVescFrame frames[SAMPLES];
+    static uint8_t payload[SAMPLES][8];
+
+    for (uint32_t i = 0; i < SAMPLES; i++) {
+        VescSample s = {(float)(i * 37) - 4000.0f, 40.0f + i * 0.05f, (float)i * 0.3f - 40.0f,
+                        20.0f + (i & 63), 15.0f + (i & 31)};
+        in[i] = s;
+        frames[i].motorRPM = s.rpm;
+        frames[i].inputVoltage = s.voltage;
+        frames[i].motorCurrent = s.current;
+        frames[i].tempMotor = s.tempMotor;
+        frames[i].tempFET = s.tempFET;
+        frames[i].pack(payload[i]);
+    }
+
+    Clock::time_point t0 = Clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        legacyEncodeVesc(*canSink, in[i & (SAMPLES - 1)]);
+    }
+    Clock::time_point t1 = Clock::now();
+
+    uint8_t data[8];
+    uint32_t acc = 0;
+    Clock::time_point t2 = Clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        frames[i & (SAMPLES - 1)].pack(data);
+        acc += data[i & 7];
+    }
+    Clock::time_point t3 = Clock::now();
+
+    Clock::time_point t4 = Clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        legacyDecodeVesc(payload[i & (SAMPLES - 1)], out[i & (SAMPLES - 1)]);
+    }
+    Clock::time_point t5 = Clock::now();
+
+    Clock::time_point t6 = Clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        frames[i & (SAMPLES - 1)].unpack(payload[i & (SAMPLES - 1)], 8);
+    }
+    Clock::time_point t7 = Clock::now();
+    sink = acc + (uint32_t)out[7].current + (uint32_t)frames[7].motorCurrent;
+
+    report("VESC", nsPerIter(t0, t1), nsPerIter(t2, t3), nsPerIter(t4, t5), nsPerIter(t6, t7));
+}
+
+static void benchBms() {
+    static BmsSample in[SAMPLES], out[SAMPLES];
+    static CANBmsFrame frames[SAMPLES];
+    static uint8_t payload[SAMPLES][8];
+
+    for (uint32_t i = 0; i < SAMPLES; i++) {
+        BmsSample s = {48.0f + i * 0.03f, (float)i * 0.2f - 25.0f, (float)(i % 101), 20.0f + (i & 31),
+                       true, (i & 1) != 0, (i & 2) != 0, true, (i & 4) != 0, 14};
+        in[i] = s;
+        frames[i].voltage = s.voltage;
+        frames[i].current = s.current;
+        frames[i].soc = s.soc;
+        frames[i].temperature = s.temperature;
+        frames[i].connected = s.connected;
+        frames[i].isCharging = s.charging;
+        frames[i].isDischarging = s.discharging;
+        frames[i].chargingEnabled = s.chgEnabled;
+        frames[i].dischargingEnabled = s.dsgEnabled;
+        frames[i].numCells = s.numCells;
+        frames[i].pack(payload[i]);
+    }
+
+    Clock::time_point t0 = Clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        legacyEncodeBms(*canSink, in[i & (SAMPLES - 1)]);
+    }
+    Clock::time_point t1 = Clock::now();
+
+    uint8_t data[8];
+    uint32_t acc = 0;
+    Clock::time_point t2 = Clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        frames[i & (SAMPLES - 1)].pack(data);
+        acc += data[i & 7];
+    }
+    Clock::time_point t3 = Clock::now();
+
+    Clock::time_point t4 = Clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        legacyDecodeBms(payload[i & (SAMPLES - 1)], out[i & (SAMPLES - 1)]);
+    }
+    Clock::time_point t5 = Clock::now();
+
+    Clock::time_point t6 = Clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        frames[i & (SAMPLES - 1)].unpack(payload[i & (SAMPLES - 1)], 8);
+    }
+    Clock::time_point t7 = Clock::now();
+    sink = acc + (uint32_t)out[7].current + (uint32_t)frames[7].current;
+
+    report("BMS", nsPerIter(t0, t1), nsPerIter(t2, t3), nsPerIter(t4, t5), nsPerIter(t6, t7));
+}
+
+int main() {
+    static BufferSink writer;
+    canSink = &writer;
+
+    printf("Bike_CAN codec benchmark, %u iterations per case\n", (unsigned)ITERATIONS);
+    benchVesc();
+    benchBms();
+    return 0;
+}
@@ -0,0 +1,364 @@
+// Host link test: main-board sender and display parser exchanging real frames.
+//
+//   pio run -e host_can_link
+//   .pio/build/host_can_link/program pair                      # two threads, in-memory bus
+//   .pio/build/host_can_link/program pair --if vcan0            # two threads over SocketCAN
+//   .pio/build/host_can_link/program display --if vcan0 &       # or two processes
+//   .pio/build/host_can_link/program main --if vcan0 --fps 50000
+//
+// The sender runs BikeCANManager in CAN_NODE_MAIN with every message type set
+// to periodic, cycling through the six data frames plus a TIME_DATA probe that
+// carries its send time in micros() (low 24 bits). The receiver runs CAN_NODE_DISPLAY and
+// feeds every frame through parseCANMessage() into a BikeDataDisplay, like
+// main_display.cpp. Both clocks are CLOCK_MONOTONIC, so probe latency is valid
+// across processes. Every LINK_ISOTP_ROUNDS rounds the sender also starts an
+// ISO-TP cell-voltage transfer (if the last one is done); the receiver checks
+// the reassembled cells for gaps or reordering. The receiver subscribes to
+// --groups; the sender skips the frames of groups it was not asked for.
+// Sensor samples are stamped every LINK_SAMPLE_ROUNDS rounds and traced to
+// the display side like on the boards, with "labels set" taken after each
+// update() pass; the display syncs its clock over CAN as on the bike.
+// --unplug disconnects the in-memory bus after the first second, as if the
+// display harness were pulled, and reconnects it N seconds later; the main
+// node has to suspend its writes and pick up again on its own.
+//
+// Options: --if loop|<ifname>   --fps N (0 = as fast as possible)
+//          --seconds N          --rcvbuf BYTES (SocketCAN receive buffer)
+//          --log FILE           save the last 64K frames the display received
+//                               as a capture for host_can_replay
+//          --groups MASK        display subscription (hex, default 3F = all)
+//          --unplug N           in-memory bus only: harness off for N seconds
+
+#include <Arduino.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BikeCANManager.h"
+#include "LoopbackCANTransport.h"
+#include "SocketCANTransport.h"
+
+#define LINK_FRAMES_PER_ROUND  7          // Six data frames + one latency probe
+#define LINK_PROBE_MASK        0xFFFFFFUL  // Signals are float: 24 bits survive exactly
+#define LINK_ISOTP_ROUNDS      20          // Rounds between segmented transfers
+#define LINK_SAMPLE_ROUNDS     10          // Rounds between new sensor samples
+
+struct LinkOptions {
+    bool runMain;
+    bool runDisplay;
+    const char* interfaceName;     // "loop" = in-memory bus
+    uint32_t fps;
+    uint32_t seconds;
+    int receiveBufferBytes;
+    const char* logPath;           // nullptr = no capture
+    uint8_t groups;                // Display subscription
+    uint32_t unplugSeconds;        // 0 = stay connected
+};
+
+static std::atomic<bool> running(true);
+
+// Sender side
+static std::atomic<uint32_t> framesSent(0);
+static std::atomic<uint32_t> txFailures(0);
+static std::atomic<uint32_t> isoTpSent(0);
+
+// Receiver side
+static std::atomic<uint32_t> framesParsed(0);
+static std::atomic<uint32_t> parseFailures(0);
+static std::atomic<uint32_t> isoTpReceived(0);
+static std::atomic<uint32_t> isoTpCorrupt(0);
+static std::mutex latencyLock;
+static std::vector<uint32_t> latencies;
+
+static BikeCANManager* displayManager = nullptr;
+static BikeDataDisplay displayData;
+static CANLogRing<65536> displayLog;
+static CANLatencyTrace displayLatency;
+
+// ---- display node -----------------------------------------------------------
+
+static void onDisplayFrame(uint32_t id, uint8_t* data, uint8_t length) {
+    if (!displayManager->parseCANMessage(id, data, length, displayData)) {
+        parseFailures++;
+        return;
+    }
+    framesParsed++;
+    
+    if (id == MSG_ID_TIME_DATA) {
+        uint32_t latency = (micros() - (uint32_t)displayData.time) & LINK_PROBE_MASK;
+        std::lock_guard<std::mutex> guard(latencyLock);
+        latencies.push_back(latency);
+    }
+}
+
+// Synthesised cells count up by 1 mV from cell 0 (see synthesise())
+static void onDisplayIsoTp(const uint8_t* payload, uint16_t length) {
+    bool ok = displayManager->parseIsoTpMessage(payload, length, displayData) && payload[0] == CAN_ISOTP_PDU_CELLS;
+    if (ok) {
+        const uint16_t* cells = (payload[1] == 1) ? displayData.battery1CellMv : displayData.battery2CellMv;
+        uint8_t count = (payload[1] == 1) ? displayData.battery1CellCount : displayData.battery2CellCount;
+        for (uint8_t i = 1; i < count && ok; i++) ok = cells[i] == cells[0] + i;
+    }
+    if (ok) isoTpReceived++;
+    else isoTpCorrupt++;
+}
+
+static void displayLoop(CANTransport* transport, const char* logPath, uint8_t groups) {
+    BikeCANManager manager(*transport);
+    displayManager = &manager;
+    if (!manager.begin(0, 0, CAN_NODE_DISPLAY)) {
+        running = false;
+        return;
+    }
+    manager.setReceiveCallback(onDisplayFrame);
+    manager.setIsoTpCallback(onDisplayIsoTp);
+    manager.setSubscription(groups);
+    manager.setLatencyTrace(&displayLatency);
+    if (logPath) manager.setLogger(&displayLog);
+    
+    while (running) {
+        uint32_t before = manager.getMessagesReceived() + manager.getRxFiltered();
+        manager.update();
+        displayLatency.onDisplayed(micros());
+        if (manager.getMessagesReceived() + manager.getRxFiltered() == before) {
+            usleep(20);  // Idle: nothing was queued
+        }
+    }
+    
+    Serial.printf("[display] received %u, filtered %u, RX overflows %u\n",
+                  manager.getMessagesReceived(), manager.getRxFiltered(), manager.getRxOverflows());
+    static CANBusStatsSnapshot stats;
+    manager.getBusStats(stats);
+    canPrintBusStats(stats);
+    canPrintLatency(displayLatency, manager.getTimeSync());
+    displayManager = nullptr;
+    
+    if (logPath) {
+        FILE* file = fopen(logPath, "wb");
+        bool ok = file && displayLog.writeCapture(file);
+        if (file) fclose(file);
+        Serial.printf("[display] %s %u frames to %s\n", ok ? "saved" : "FAILED to save", displayLog.size(), logPath);
+    }
+}
+
+// ---- main node --------------------------------------------------------------
+
+// Changing sensor values so every frame differs from the last
+static void synthesise(SharedBikeData& shared, uint32_t round) {
+    BikeStatus& s = shared.sensorData;
+    s.operationState = BIKE_UNLOCKED;
+    s.keyOn = true;
+    s.bikeSpeed = (float)(round % 60);
+    s.leftSignal = (round / 50) & 1;
+    s.rightSignal = false;
+    s.brakePressed = (round % 17) == 0;
+    
+    s.bms1.connected = s.bms2.connected = true;
+    s.bms1.voltage = 52.0f + (round % 100) * 0.01f;
+    s.bms2.voltage = 51.5f + (round % 100) * 0.01f;
+    s.bms1.current = s.bms2.current = (float)(round % 300) * 0.1f - 10.0f;
+    s.bms1.soc = s.bms2.soc = 80;
+    s.bms1.numCells = s.bms2.numCells = 14;
+    s.bms1.cellVoltageDelta = s.bms2.cellVoltageDelta = round % 40;
+    for (uint8_t i = 0; i < 14; i++) {
+        s.bms1.cellVoltagesMv[i] = 3300 + (round % 100) + i;
+        s.bms2.cellVoltagesMv[i] = 3200 + (round % 100) + i;
+    }
+    
+    s.vesc.connected = true;
+    s.vesc.motorRPM = (float)(round % 5000);
+    s.vesc.inputVoltage = s.bms1.voltage;
+    s.vesc.motorCurrent = s.bms1.current;
+    s.vesc.tempMotor = 40.0f + (round % 20);
+    s.vesc.tempFET = 35.0f + (round % 15);
+    
+    if (round % LINK_SAMPLE_ROUNDS == 0) {
+        // Sequences run 1-255 like BikeSensorManager's
+        uint8_t seq = (round / LINK_SAMPLE_ROUNDS) % 255 + 1;
+        uint32_t now = micros();
+        s.sampleSeq = s.bms1.sampleSeq = s.bms2.sampleSeq = s.vesc.sampleSeq = seq;
+        s.sampleUs = s.bms1.sampleUs = s.bms2.sampleUs = s.vesc.sampleUs = now;
+    }
+    
+    shared.bikeUnlocked = true;
+    shared.bleConnected = (round & 1) != 0;
+    shared.currentState = BIKE_UNLOCKED;
+}
+
+static void mainLoop(CANTransport* transport, uint32_t fps) {
+    BikeCANManager manager(*transport);
+    if (!manager.begin(0, 0, CAN_NODE_MAIN)) {
+        running = false;
+        return;
+    }
+    for (uint8_t t = 0; t < CAN_MSG_COUNT; t++) {
+        manager.setTransmitMode((CANMessageType)t, CAN_TX_PERIODIC);
+    }
+    
+    SharedBikeData shared;
+    memset(&shared.sensorData.analogReadings, 0, sizeof(shared.sensorData.analogReadings));
+    uint32_t round = 0;
+    uint64_t startUs = simMonotonicUs();
+    
+    while (running) {
+        if (fps > 0) {
+            // Pace rounds against the wall clock, sleeping when ahead
+            uint64_t due = (simMonotonicUs() - startUs) * fps / (1000000ULL * LINK_FRAMES_PER_ROUND);
+            if (round >= due) {
+                usleep(50);
+                continue;
+            }
+        }
+        
+        synthesise(shared, round++);
+        for (uint8_t t = 0; t < CAN_MSG_TIME_DATA; t++) {
+            if (manager.getMessagePeriod((CANMessageType)t) == 0) continue;  // Not subscribed
+            if (manager.sendMessage((CANMessageType)t, shared)) framesSent++;
+            else txFailures++;
+        }
+        if (manager.getMessagePeriod(CAN_MSG_TIME_DATA) > 0) {
+            if (manager.sendTimeData((int)(micros() & LINK_PROBE_MASK))) framesSent++;
+            else txFailures++;
+        }
+        
+        bool cells = manager.getSubscribedGroups() & CAN_GROUP_BIT(CAN_GROUP_CELLS);
+        if (cells && round % LINK_ISOTP_ROUNDS == 0 && !manager.isIsoTpBusy()) {
+            uint8_t pack = (round / LINK_ISOTP_ROUNDS) % 2 + 1;
+            const BMSData& bms = (pack == 1) ? shared.sensorData.bms1 : shared.sensorData.bms2;
+            if (manager.sendCellVoltages(bms, pack)) isoTpSent++;
+        }
+        
+        manager.update();  // Flow control for the ISO-TP sender, keeps the socket drained
+    }
+    
+    CANIsoTpStats stats = manager.getIsoTpStats();
+    Serial.printf("[main] ISO-TP sent %u, aborted %u | subscription groups 0x%02X%s, %u received\n",
+                  stats.messagesSent, stats.txAborted, manager.getSubscribedGroups(),
+                  manager.isSubscriptionActive() ? "" : " (default)", manager.getSubscriptionsReceived());
+    
+    static CANBusStatsSnapshot busStats;
+    manager.getBusStats(busStats);
+    const CANTxHealthSnapshot& health = busStats.health;
+    Serial.printf("[main] TX %s | dropped %u, suspended %u, recovered %u, backoff %u ms\n",
+                  health.suspended ? "SUSPENDED" : "ok", health.dropped, health.suspensions,
+                  health.recoveries, health.backoffMs);
+}
+
+// ---- reporting --------------------------------------------------------------
+
+static uint32_t percentile(std::vector<uint32_t>& sorted, float p) {
+    if (sorted.empty()) return 0;
+    size_t index = (size_t)(p * (sorted.size() - 1) + 0.5f);
+    return sorted[index];
+}
+
+static void report(const LinkOptions& options, uint32_t second) {
+    static uint32_t lastSent = 0, lastParsed = 0;
+    uint32_t sent = framesSent, parsed = framesParsed;
+    
+    std::vector<uint32_t> window;
+    {
+        std::lock_guard<std::mutex> guard(latencyLock);
+        window.swap(latencies);
+    }
+    std::sort(window.begin(), window.end());
+    
+    Serial.printf("[%2us]", second);
+    if (options.runMain) {
+        Serial.printf(" tx %7u fps (%u fail)", sent - lastSent, (uint32_t)txFailures);
+    }
+    if (options.runDisplay) {
+        Serial.printf(" rx %7u fps (%u bad) latency p50 %u p99 %u max %u us",
+                      parsed - lastParsed, (uint32_t)parseFailures,
+                      percentile(window, 0.5f), percentile(window, 0.99f),
+                      window.empty() ? 0 : window.back());
+    }
+    Serial.println();
+    
+    lastSent = sent;
+    lastParsed = parsed;
+}
+
+static bool parseArgs(int argc, char** argv, LinkOptions& options) {
+    if (argc < 2) return false;
+    
+    std::string mode = argv[1];
+    options.runMain = (mode == "main" || mode == "pair");
+    options.runDisplay = (mode == "display" || mode == "pair");
+    if (!options.runMain && !options.runDisplay) return false;
+    
+    options.interfaceName = "loop";
+    options.fps = 2000;
+    options.seconds = 5;
+    options.receiveBufferBytes = 0;
+    options.logPath = nullptr;
+    options.groups = CAN_GROUPS_ALL;
+    options.unplugSeconds = 0;
+    
+    for (int i = 2; i + 1 < argc; i += 2) {
+        std::string key = argv[i];
+        if (key == "--if") options.interfaceName = argv[i + 1];
+        else if (key == "--fps") options.fps = strtoul(argv[i + 1], nullptr, 10);
+        else if (key == "--seconds") options.seconds = strtoul(argv[i + 1], nullptr, 10);
+        else if (key == "--rcvbuf") options.receiveBufferBytes = atoi(argv[i + 1]);
+        else if (key == "--log") options.logPath = argv[i + 1];
+        else if (key == "--groups") options.groups = strtoul(argv[i + 1], nullptr, 16);
+        else if (key == "--unplug") options.unplugSeconds = strtoul(argv[i + 1], nullptr, 10);
+        else return false;
+    }
+    
+    // Two processes need a real (virtual) bus between them
+    bool loop = strcmp(options.interfaceName, "loop") == 0;
+    if (options.unplugSeconds && !loop) return false;
+    return !(loop && !(options.runMain && options.runDisplay));
+}
+
+int main(int argc, char** argv) {
+    LinkOptions options;
+    if (!parseArgs(argc, argv, options)) {
+        fprintf(stderr, "usage: %s main|display|pair [--if loop|vcan0] [--fps N] [--seconds N] [--rcvbuf BYTES] [--log FILE] [--groups MASK] [--unplug N]\n"
+                        "       (main/display as separate processes need a SocketCAN interface)\n", argv[0]);
+        return 1;
+    }
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    
+    LoopbackCANBus bus;
+    LoopbackCANTransport loopMain(bus), loopDisplay(bus);
+    SocketCANTransport sockMain(options.interfaceName, options.receiveBufferBytes);
+    SocketCANTransport sockDisplay(options.interfaceName, options.receiveBufferBytes);
+    
+    bool loop = strcmp(options.interfaceName, "loop") == 0;
+    CANTransport* mainTransport = loop ? (CANTransport*)&loopMain : &sockMain;
+    CANTransport* displayTransport = loop ? (CANTransport*)&loopDisplay : &sockDisplay;
+    
+    Serial.printf("Link test: %s%s over %s, %u fps target, %u s\n",
+                  options.runMain ? "main " : "", options.runDisplay ? "display " : "",
+                  options.interfaceName, options.fps, options.seconds);
+    
+    std::vector<std::thread> nodes;
+    if (options.runDisplay) nodes.push_back(std::thread(displayLoop, displayTransport, options.logPath, options.groups));
+    if (options.runMain) nodes.push_back(std::thread(mainLoop, mainTransport, options.fps));
+    
+    for (uint32_t second = 1; second <= options.seconds && running; second++) {
+        sleep(1);
+        report(options, second);
+        
+        if (options.unplugSeconds && (second == 1 || second == 1 + options.unplugSeconds)) {
+            bool connect = second != 1;
+            bus.setConnected(connect);
+            Serial.printf("---- harness %s ----\n", connect ? "plugged back in" : "unplugged");
+        }
+    }
+    running = false;
+    for (size_t i = 0; i < nodes.size(); i++) nodes[i].join();
+    
+    if (options.runMain && options.runDisplay) {
+        uint32_t sent = framesSent, parsed = framesParsed;
+        Serial.printf("Total: sent %u, parsed %u, lost %u (%.3f%%)\n", sent, parsed, sent - parsed,
+                      sent ? (sent - parsed) * 100.0f / sent : 0.0f);
+        Serial.printf("ISO-TP: started %u, reassembled %u, corrupt %u\n",
+                      (uint32_t)isoTpSent, (uint32_t)isoTpReceived, (uint32_t)isoTpCorrupt);
+    }
+    return 0;
+}
@@ -0,0 +1,248 @@
+// Host CAN capture tool: replays a capture through the display parser.
+//
+//   pio run -e host_can_replay
+//   .pio/build/host_can_replay/program replay ride.bcan               # real time
+//   .pio/build/host_can_replay/program replay ride.bcan --speed 10
+//   .pio/build/host_can_replay/program replay ride.log --speed max --repeat 100
+//   .pio/build/host_can_replay/program convert ride.log ride.bcan       # candump -> binary
+//   .pio/build/host_can_replay/program convert ride.bcan ride.log       # binary -> candump
+//   .pio/build/host_can_replay/program info ride.bcan
+//
+// Captures are binary (CANLog.h) or candump text, detected by the magic. The
+// candump reader skips every line that is not a frame, so a raw serial log
+// holding the display's "canlog" dump can be read as it is.
+//
+// Replay feeds the data frames (0x100-0x6FF except the ISO-TP channel) through
+// BikeCANManager::parseCANMessage() into a BikeDataDisplay, like main_display.cpp.
+// At 1x/10x the display state is printed once a second. At max speed the
+// time per parsed frame is reported.
+
+#include <Arduino.h>
+#include <vector>
+
+#include "BikeCANManager.h"
+#include "CANLog.h"
+#include "LoopbackCANTransport.h"
+
+struct Capture {
+    uint32_t startUs;
+    std::vector<CANLogRecord> records;
+};
+
+static bool endsWith(const char* text, const char* suffix) {
+    size_t n = strlen(text), m = strlen(suffix);
+    return n >= m && strcmp(text + n - m, suffix) == 0;
+}
+
+static bool isCandumpPath(const char* path) {
+    return endsWith(path, ".log") || endsWith(path, ".txt");
+}
+
+// ---- capture I/O ------------------------------------------------------------
+
+static bool loadCapture(const char* path, Capture& capture) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return false;
+    }
+    
+    capture.startUs = 0;
+    capture.records.clear();
+    
+    CANLogFileHeader header;
+    if (fread(&header, sizeof(header), 1, file) == 1 && canLogCheckHeader(header)) {
+        capture.startUs = header.startUs;
+        capture.records.resize(header.recordCount);
+        size_t got = fread(capture.records.data(), sizeof(CANLogRecord), header.recordCount, file);
+        capture.records.resize(got);
+        fclose(file);
+        if (got != header.recordCount) fprintf(stderr, "%s: truncated, %zu of %u records\n", path, got, header.recordCount);
+        return true;
+    }
+    
+    // Candump text
+    rewind(file);
+    char line[256];
+    uint64_t lastUs = 0;
+    while (fgets(line, sizeof(line), file)) {
+        uint64_t timeUs;
+        CANLogRecord record;
+        if (!canLogParseCandump(line, timeUs, record)) continue;
+        
+        if (capture.records.empty()) capture.startUs = (uint32_t)timeUs;
+        else record = canLogMakeRecord(canLogId(record), record.data, canLogDlc(record),
+                                       timeUs > lastUs ? (uint32_t)std::min<uint64_t>(timeUs - lastUs, CAN_LOG_DELTA_MASK) : 0,
+                                       false);
+        lastUs = timeUs;
+        capture.records.push_back(record);
+    }
+    fclose(file);
+    return true;
+}
+
+static bool saveCapture(const char* path, const Capture& capture) {
+    FILE* file = fopen(path, isCandumpPath(path) ? "w" : "wb");
+    if (!file) {
+        fprintf(stderr, "Cannot create %s\n", path);
+        return false;
+    }
+    
+    bool ok = true;
+    if (isCandumpPath(path)) {
+        char line[CAN_LOG_CANDUMP_MAX];
+        uint64_t timeUs = capture.startUs;
+        for (size_t i = 0; i < capture.records.size() && ok; i++) {
+            if (i > 0) timeUs += canLogDelta(capture.records[i]);
+            canLogFormatCandump(line, sizeof(line), timeUs, "can0", capture.records[i]);
+            ok = fprintf(file, "%s\n", line) > 0;
+        }
+    } else {
+        CANLogFileHeader header;
+        canLogInitHeader(header, capture.startUs, (uint32_t)capture.records.size());
+        ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(capture.records.data(), sizeof(CANLogRecord), capture.records.size(), file) == capture.records.size();
+    }
+    
+    return fclose(file) == 0 && ok;
+}
+
+// ---- commands ---------------------------------------------------------------
+
+static bool isDisplayData(uint32_t id) {
+    return !(id & CAN_FRAME_EXT_FLAG) && id >= MSG_ID_BIKE_STATUS && id < MSG_ID_DISPLAY_CMD &&
+           id != MSG_ID_ISOTP_TO_DISPLAY;
+}
+
+static uint64_t captureDurationUs(const Capture& capture) {
+    uint64_t total = 0;
+    for (size_t i = 1; i < capture.records.size(); i++) total += canLogDelta(capture.records[i]);
+    return total;
+}
+
+static int runInfo(const Capture& capture) {
+    uint32_t perId[0x800] = {0};
+    uint32_t extended = 0, transmitted = 0;
+    for (size_t i = 0; i < capture.records.size(); i++) {
+        uint32_t id = canLogId(capture.records[i]);
+        if (id & CAN_FRAME_EXT_FLAG) extended++;
+        else perId[id]++;
+        if (canLogIsTx(capture.records[i])) transmitted++;
+    }
+    
+    uint64_t durationUs = captureDurationUs(capture);
+    Serial.printf("%zu frames over %.3f s (%u sent by the logging node, %u extended)\n",
+                  capture.records.size(), durationUs / 1e6, transmitted, extended);
+    for (uint32_t id = 0; id < 0x800; id++) {
+        if (!perId[id]) continue;
+        Serial.printf("  0x%03X  %8u  %7.1f /s\n", id, perId[id], durationUs ? perId[id] * 1e6 / durationUs : 0.0);
+    }
+    return 0;
+}
+
+static void printDisplay(const BikeDataDisplay& bike, uint64_t logUs) {
+    Serial.printf("[%8.3f s] Speed:%.1f km/h Bat:%d%% B1:%.2fV B2:%.2fV Motor:%.1f°C ECU:%.1f°C Odo:%.1f BT:%s L:%s R:%s\n",
+                  logUs / 1e6, bike.speed, bike.batteryPercent, bike.battery1Volt, bike.battery2Volt,
+                  (float)bike.motorTemp, (float)bike.ecuTemp, bike.odometer,
+                  bike.bluetoothConnected ? "ON" : "OFF",
+                  bike.turnLeftActive ? "ON" : "OFF", bike.turnRightActive ? "ON" : "OFF");
+}
+
+// speed 0 = as fast as possible
+static int runReplay(const Capture& capture, float speed, uint32_t repeat) {
+    LoopbackCANBus bus;
+    LoopbackCANTransport idle(bus);   // Never started, only the parser is used
+    BikeCANManager parser(idle);
+    BikeDataDisplay bike;
+    
+    uint32_t parsed = 0, failed = 0, skipped = 0;
+    uint64_t parseNs = 0;
+    uint64_t startUs = simMonotonicUs();
+    uint64_t nextPrintUs = startUs + 1000000;
+    
+    for (uint32_t pass = 0; pass < repeat; pass++) {
+        uint64_t logUs = 0;
+        uint64_t passStartUs = simMonotonicUs();
+        
+        for (size_t i = 0; i < capture.records.size(); i++) {
+            CANLogRecord record = capture.records[i];
+            if (i > 0) logUs += canLogDelta(record);
+            
+            if (speed > 0) {
+                // Wait until this frame's time, scaled
+                uint64_t dueUs = passStartUs + (uint64_t)(logUs / speed);
+                uint64_t now = simMonotonicUs();
+                if (dueUs > now) usleep((useconds_t)(dueUs - now));
+                
+                if (simMonotonicUs() >= nextPrintUs) {
+                    printDisplay(bike, logUs);
+                    nextPrintUs += 1000000;
+                }
+            }
+            
+            uint32_t id = canLogId(record);
+            if (!isDisplayData(id)) {
+                skipped++;
+                continue;
+            }
+            
+            struct timespec t0, t1;
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            bool ok = parser.parseCANMessage(id, record.data, canLogDlc(record), bike);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            parseNs += (t1.tv_sec - t0.tv_sec) * 1000000000ULL + t1.tv_nsec - t0.tv_nsec;
+            
+            if (ok) parsed++;
+            else failed++;
+        }
+    }
+    
+    uint64_t wallUs = simMonotonicUs() - startUs;
+    printDisplay(bike, captureDurationUs(capture));
+    Serial.printf("Replayed %u frames in %.3f s (%u parse failures, %u skipped: not display data)\n",
+                  parsed + failed, wallUs / 1e6, failed, skipped);
+    if (parsed + failed > 0) {
+        // parseNs includes the clock_gettime pair (~20-40 ns on x86)
+        Serial.printf("Parse: %.1f ns/frame, %.0f frames/s through the whole replay loop\n",
+                      (double)parseNs / (parsed + failed), (parsed + failed + skipped) * 1e6 / (wallUs ? wallUs : 1));
+    }
+    return failed ? 2 : 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s replay <capture> [--speed 1|10|max] [--repeat N]\n"
+                        "       %s convert <in> <out.bcan|out.log>\n"
+                        "       %s info <capture>\n", argv[0], argv[0], argv[0]);
+        return 1;
+    }
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    
+    std::string command = argv[1];
+    Capture capture;
+    if (!loadCapture(argv[2], capture)) return 1;
+    
+    if (command == "info") {
+        return runInfo(capture);
+    }
+    
+    if (command == "convert" && argc == 4) {
+        if (!saveCapture(argv[3], capture)) return 1;
+        Serial.printf("Wrote %zu frames to %s\n", capture.records.size(), argv[3]);
+        return 0;
+    }
+    
+    if (command == "replay") {
+        float speed = 1.0f;
+        uint32_t repeat = 1;
+        for (int i = 3; i + 1 < argc; i += 2) {
+            std::string key = argv[i];
+            if (key == "--speed") speed = strcmp(argv[i + 1], "max") == 0 ? 0.0f : strtof(argv[i + 1], nullptr);
+            else if (key == "--repeat") repeat = strtoul(argv[i + 1], nullptr, 10);
+        }
+        return runReplay(capture, speed, repeat ? repeat : 1);
+    }
+    
+    fprintf(stderr, "Unknown command %s\n", command.c_str());
+    return 1;
+}
@@ -0,0 +1,193 @@
+// Host decoder for binary log output (BikeLog.h, "log binary" on either board).
+//
+//   pio run -e host_log_decode
+//   .pio/build/host_log_decode/program serial.txt src lib
+//   pio device monitor | .pio/build/host_log_decode/program - src lib
+//
+// The boards print "~L" lines that carry the FNV-1a hash of the format string
+// instead of the text. The decoder scans the given source files/directories for
+// BIKE_LOGE/W/I/D calls, hashes their format literals the same way and prints
+// each "~L" line as drain() would in text mode. Every other line passes through
+// unchanged. Sources have to match the firmware that wrote the log; a hash with
+// no format string is printed raw with the argument bytes in hex.
+
+#include <Arduino.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <map>
+#include <string>
+
+#include "BikeLog.h"
+
+static std::map<uint32_t, std::string> formats;
+static uint32_t collisions = 0;
+
+// ---- format strings from the sources ----------------------------------------
+
+static bool hasSourceSuffix(const std::string& path) {
+    size_t dot = path.rfind('.');
+    if (dot == std::string::npos) return false;
+    std::string suffix = path.substr(dot);
+    return suffix == ".cpp" || suffix == ".c" || suffix == ".h" || suffix == ".hpp" || suffix == ".ino";
+}
+
+// One string literal at text[i] (the opening quote); appends its value and
+// returns the index past the closing quote
+static size_t readLiteral(const std::string& text, size_t i, std::string& value) {
+    for (i++; i < text.size() && text[i] != '"'; i++) {
+        char c = text[i];
+        if (c != '\\' || i + 1 >= text.size()) {
+            value += c;
+            continue;
+        }
+        c = text[++i];
+        switch (c) {
+            case 'n': value += '\n'; break;
+            case 'r': value += '\r'; break;
+            case 't': value += '\t'; break;
+            case '0': value += '\0'; break;
+            case 'x': {
+                int code = 0;
+                while (i + 1 < text.size() && isxdigit((unsigned char)text[i + 1])) {
+                    char h = text[++i];
+                    code = code * 16 + (isdigit((unsigned char)h) ? h - '0' : (tolower(h) - 'a' + 10));
+                }
+                value += (char)code;
+                break;
+            }
+            default: value += c; break;   // \\ \" \'
+        }
+    }
+    return i + 1;
+}
+
+static void scanFile(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        fprintf(stderr, "Cannot open %s\n", path.c_str());
+        return;
+    }
+    std::string text;
+    char chunk[4096];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), file)) > 0) text.append(chunk, got);
+    fclose(file);
+    
+    // BIKE_LOGx( followed by adjacent literals; macro definitions, whose
+    // first argument is a name, are skipped
+    size_t at = 0;
+    while ((at = text.find("BIKE_LOG", at)) != std::string::npos) {
+        at += 8;
+        if (at + 1 >= text.size() || !strchr("EWID", text[at]) || text[at + 1] != '(') continue;
+        
+        std::string format;
+        bool literal = false;
+        size_t i = at + 2;
+        while (i < text.size()) {
+            while (i < text.size() && isspace((unsigned char)text[i])) i++;
+            if (i >= text.size() || text[i] != '"') break;
+            i = readLiteral(text, i, format);
+            literal = true;
+        }
+        if (!literal) continue;
+        
+        uint32_t hash = bikeLogHash(format.c_str());
+        std::map<uint32_t, std::string>::iterator known = formats.find(hash);
+        if (known != formats.end() && known->second != format) {
+            fprintf(stderr, "%s: hash %08lX also used by \"%s\"\n", path.c_str(), (unsigned long)hash, known->second.c_str());
+            collisions++;
+        }
+        formats[hash] = format;
+    }
+}
+
+static void scanPath(const std::string& path) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        fprintf(stderr, "Cannot open %s\n", path.c_str());
+        return;
+    }
+    if (!S_ISDIR(info.st_mode)) {
+        scanFile(path);
+        return;
+    }
+    
+    DIR* dir = opendir(path.c_str());
+    if (!dir) return;
+    while (struct dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.empty() || name[0] == '.') continue;
+        std::string child = path + "/" + name;
+        if (stat(child.c_str(), &info) != 0) continue;
+        if (S_ISDIR(info.st_mode)) scanPath(child);
+        else if (hasSourceSuffix(child)) scanFile(child);
+    }
+    closedir(dir);
+}
+
+// ---- log lines --------------------------------------------------------------
+
+// "~L time hash level flags payload"; false if the line is not a log record
+static bool decodeLine(const char* record, char* out, size_t outSize) {
+    unsigned long timeUs, hash;
+    unsigned level, flags;
+    char hex[2 * BIKE_LOG_PAYLOAD + 2];
+    if (sscanf(record, "~L %lx %lx %u %u %41s", &timeUs, &hash, &level, &flags, hex) != 5) return false;
+    
+    uint8_t payload[BIKE_LOG_PAYLOAD];
+    uint8_t length = 0;
+    if (strcmp(hex, "-") != 0) {
+        size_t digits = strlen(hex);
+        if (digits % 2 || digits / 2 > BIKE_LOG_PAYLOAD) return false;
+        for (size_t i = 0; i < digits; i += 2) {
+            unsigned byte;
+            if (sscanf(hex + i, "%2x", &byte) != 1) return false;
+            payload[length++] = (uint8_t)byte;
+        }
+    }
+    
+    int n = snprintf(out, outSize, "[%4lu.%06lu] %c ", timeUs / 1000000, timeUs % 1000000, bikeLogLevelLetter(level));
+    std::map<uint32_t, std::string>::const_iterator format = formats.find((uint32_t)hash);
+    if (format == formats.end()) {
+        snprintf(out + n, outSize - n, "<unknown format %08lX> %s", hash, hex);
+    } else {
+        bikeLogFormat(out + n, outSize - n, format->second.c_str(), payload, length, (flags & BIKE_LOG_TRUNCATED) != 0);
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <serial log|-> <source file or directory>...\n", argv[0]);
+        return 1;
+    }
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    
+    for (int i = 2; i < argc; i++) scanPath(argv[i]);
+    fprintf(stderr, "%zu format strings, %lu hash collisions\n", formats.size(), (unsigned long)collisions);
+    
+    FILE* input = strcmp(argv[1], "-") == 0 ? stdin : fopen(argv[1], "r");
+    if (!input) {
+        fprintf(stderr, "Cannot open %s\n", argv[1]);
+        return 1;
+    }
+    
+    char line[512];
+    char decoded[BIKE_LOG_LINE_MAX];
+    uint32_t records = 0, unknown = 0;
+    while (fgets(line, sizeof(line), input)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        const char* record = strstr(line, "~L ");   // The monitor may prefix a timestamp
+        if (record && decodeLine(record, decoded, sizeof(decoded))) {
+            records++;
+            if (strstr(decoded, "<unknown format")) unknown++;
+            printf("%.*s%s\n", (int)(record - line), line, decoded);
+        } else {
+            printf("%s\n", line);
+        }
+    }
+    if (input != stdin) fclose(input);
+    
+    fprintf(stderr, "%lu records decoded, %lu with unknown format\n", (unsigned long)records, (unsigned long)unknown);
+    return 0;
+}
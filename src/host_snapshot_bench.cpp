@@ -0,0 +1,189 @@
+// Host stress benchmark: SnapshotBuffer against the mutex it replaced.
+//
+//   pio run -e host_snapshot_bench && .pio/build/host_snapshot_bench/program [seconds]
+//
+// One writer thread publishes BikeStatus samples as fast as it can, like
+// sensorTask with no delay. Reader threads copy the latest one, like canTask
+// and displayTask. The writer runs on CPU 0 and the readers on CPU 1, so the
+// two sides really run at the same time, as on the ESP32's two cores.
+//
+//   mutex     std::mutex held for the assignment and for each copy (the old
+//             bikeDataMutex pattern)
+//   snapshot  SnapshotBuffer<BikeStatus, 4>
+//
+// Every field the readers check is derived from the writer's counter, so
+// any torn copy (fields from two different samples) gets counted.
+
+#include <Arduino.h>
+#include <pthread.h>
+#include <sched.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BikeData.h"
+#include "SnapshotBuffer.h"
+
+#define BENCH_READERS      2
+#define BENCH_SLOTS        (BENCH_READERS + 2)
+#define BENCH_BUCKET_NS    10        // Latency histogram resolution
+#define BENCH_BUCKETS      10000     // Up to 100 us; longer ones only count toward max
+
+typedef std::chrono::steady_clock Clock;
+
+struct ThreadResult {
+    uint64_t operations;
+    uint64_t torn;
+    uint32_t maxNs;
+    uint64_t buckets[BENCH_BUCKETS + 1];   // Last one: beyond the range
+    
+    void record(uint32_t ns) {
+        uint32_t bucket = ns / BENCH_BUCKET_NS;
+        buckets[bucket < BENCH_BUCKETS ? bucket : BENCH_BUCKETS]++;
+        if (ns > maxNs) maxNs = ns;
+        operations++;
+    }
+    
+    uint32_t percentile(double p) const {
+        uint64_t target = (uint64_t)(p * operations);
+        uint64_t seen = 0;
+        for (uint32_t i = 0; i < BENCH_BUCKETS; i++) {
+            seen += buckets[i];
+            if (seen > target) return (i + 1) * BENCH_BUCKET_NS;
+        }
+        return maxNs;
+    }
+};
+
+static std::atomic<bool> running(false);
+static std::atomic<bool> stopping(false);
+
+// ---- shared state under test -------------------------------------------------
+
+class MutexShared {
+public:
+    void publish(const BikeStatus& status) {
+        std::lock_guard<std::mutex> guard(lock);
+        data = status;
+    }
+    void read(BikeStatus& out) {
+        std::lock_guard<std::mutex> guard(lock);
+        out = data;
+    }
+
+private:
+    std::mutex lock;
+    BikeStatus data;
+};
+
+static void fillSample(BikeStatus& status, uint32_t k) {
+    status.sampleUs = k;
+    status.hallFrequency = (float)(k & 0xFFFFFF);
+    status.bms1.sampleUs = k;
+    status.bms1.cycles = k & 0xFFFF;
+    status.bms2.cellVoltagesMv[BMS_MAX_CELLS - 1] = k & 0xFFFF;
+    status.vesc.sampleUs = k;
+}
+
+static bool isConsistent(const BikeStatus& status) {
+    uint32_t k = status.sampleUs;
+    return status.hallFrequency == (float)(k & 0xFFFFFF) &&
+           status.bms1.sampleUs == k &&
+           status.bms1.cycles == (k & 0xFFFF) &&
+           status.bms2.cellVoltagesMv[BMS_MAX_CELLS - 1] == (k & 0xFFFF) &&
+           status.vesc.sampleUs == k;
+}
+
+// ---- threads -----------------------------------------------------------------
+
+static void pinToCpu(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static uint32_t elapsedNs(Clock::time_point start) {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+template <typename Shared>
+static void writerLoop(Shared* shared, ThreadResult* result) {
+    pinToCpu(0);
+    BikeStatus status = BikeStatus();
+    
+    while (!running) {}
+    for (uint32_t k = 1; !stopping; k++) {
+        fillSample(status, k);
+        Clock::time_point start = Clock::now();
+        shared->publish(status);
+        result->record(elapsedNs(start));
+    }
+}
+
+template <typename Shared>
+static void readerLoop(Shared* shared, ThreadResult* result) {
+    pinToCpu(1);
+    BikeStatus copy = BikeStatus();
+    
+    while (!running) {}
+    while (!stopping) {
+        Clock::time_point start = Clock::now();
+        shared->read(copy);
+        result->record(elapsedNs(start));
+        if (copy.sampleUs != 0 && !isConsistent(copy)) result->torn++;
+    }
+}
+
+// ---- reporting ---------------------------------------------------------------
+
+// Percentiles are bucket upper bounds (BENCH_BUCKET_NS resolution)
+static void printRow(const char* name, const char* role, const ThreadResult& result, double seconds) {
+    printf("  %-8s %-7s %10.0f ops/s  %7u %7u %8u %9u ns  torn %llu\n",
+           name, role, result.operations / seconds,
+           result.percentile(0.5), result.percentile(0.99), result.percentile(0.999), result.maxNs,
+           (unsigned long long)result.torn);
+}
+
+template <typename Shared>
+static void run(const char* name, uint32_t seconds) {
+    // Static: the histograms are too big for the stack
+    static Shared shared;
+    static ThreadResult writer;
+    static ThreadResult readers[BENCH_READERS];
+    memset(&writer, 0, sizeof(writer));
+    memset(readers, 0, sizeof(readers));
+    
+    running = false;
+    stopping = false;
+    std::vector<std::thread> threads;
+    threads.push_back(std::thread(writerLoop<Shared>, &shared, &writer));
+    for (uint8_t i = 0; i < BENCH_READERS; i++) {
+        threads.push_back(std::thread(readerLoop<Shared>, &shared, &readers[i]));
+    }
+    
+    running = true;
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stopping = true;
+    for (size_t i = 0; i < threads.size(); i++) threads[i].join();
+    
+    printRow(name, "writer", writer, seconds);
+    for (uint8_t i = 0; i < BENCH_READERS; i++) printRow(name, "reader", readers[i], seconds);
+}
+
+int main(int argc, char** argv) {
+    uint32_t seconds = argc > 1 ? strtoul(argv[1], nullptr, 10) : 2;
+    if (seconds == 0) seconds = 2;
+    
+    unsigned cpus = std::thread::hardware_concurrency();
+    printf("SharedBikeData stress: 1 writer (CPU 0), %d readers (CPU 1), %u s per variant, BikeStatus %u bytes\n",
+           BENCH_READERS, seconds, (unsigned)sizeof(BikeStatus));
+    if (cpus < 2) printf("Only %u CPU: the threads share it, so figures include scheduling\n", cpus);
+    printf("  variant  thread       throughput      p50     p99    p99.9       max\n");
+    
+    run<MutexShared>("mutex", seconds);
+    run<SnapshotBuffer<BikeStatus, BENCH_SLOTS> >("snapshot", seconds);
+    return 0;
+}
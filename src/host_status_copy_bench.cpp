@@ -0,0 +1,138 @@
+// Host benchmark: cost of copying BikeStatus with and without the BMS strings.
+//
+//   pio run -e host_status_copy_bench && .pio/build/host_status_copy_bench/program [copies]
+//
+//   string   BMSData as it was, with String softwareVersion/deviceInfo inside
+//            each pack (so in every BikeStatus copy)
+//   pod      BMSData today: trivially copyable, strings in BikeIdentity
+//   pod+id   BikeStatus plus a BikeIdentity copy, what a reader pays on the
+//            rare sample where the strings changed
+//
+// Heap allocations are counted by replacing operator new. The strings are
+// BMS_INFO_MAX_LEN - 1 characters long: std::string keeps up to 15 inline,
+// and the ESP32's String up to 11, so shorter values would not show the
+// allocations the board makes for real JK-BMS strings.
+
+#include <Arduino.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <stdlib.h>
+
+#include "BikeData.h"
+
+#define BENCH_DEFAULT_COPIES  2000000
+
+typedef std::chrono::steady_clock Clock;
+
+static std::atomic<uint64_t> allocations(0);
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+// ---- the layout before the strings moved out ------------------------------------
+
+struct StringBMSData : BMSData {
+    String softwareVersion;
+    String deviceInfo;
+};
+
+struct StringBikeStatus {
+    BikeOperationState operationState;
+    bool brakePressed;
+    bool leftSignal;
+    bool rightSignal;
+    bool keyOn;
+    float hallFrequency;
+    float bikeSpeed;
+    uint8_t sampleSeq;
+    uint32_t sampleUs;
+    StringBMSData bms1;
+    StringBMSData bms2;
+    VESCData vesc;
+    float analogReadings[8];
+};
+
+struct PodWithIdentity {
+    BikeStatus status;
+    BikeIdentity identity;
+};
+
+static const char* VERSION = "11.XW_S11.26H_BT_0099ab";   // BMS_INFO_MAX_LEN - 1 characters
+static const char* DEVICE = "JK_B2A24S15P_BT_0042xyz";
+
+// Keeps the compiler from dropping copies nobody reads
+static void consume(const void* p) {
+    asm volatile("" : : "r"(p) : "memory");
+}
+
+static void printRow(const char* name, size_t size, Clock::time_point start, uint64_t allocationsBefore, uint32_t copies) {
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    printf("  %-7s %6u bytes  %7.1f ns/copy  %5.2f allocations/copy\n",
+           name, (unsigned)size, ns / copies, (double)(allocations.load() - allocationsBefore) / copies);
+}
+
+// Copy assignment: the target keeps its buffers, like a reader's static copy
+template <typename T>
+static void runAssign(const char* name, const T& source, uint32_t copies) {
+    static T target;
+    uint64_t allocationsBefore = allocations.load();
+    Clock::time_point start = Clock::now();
+    for (uint32_t i = 0; i < copies; i++) {
+        target = source;
+        consume(&target);
+    }
+    printRow(name, sizeof(T), start, allocationsBefore, copies);
+}
+
+// Copy construction: a new object each time, like a by-value getBikeStatus()
+// or a temporary per received CAN frame
+template <typename T>
+static void runConstruct(const char* name, const T& source, uint32_t copies) {
+    uint64_t allocationsBefore = allocations.load();
+    Clock::time_point start = Clock::now();
+    for (uint32_t i = 0; i < copies; i++) {
+        T copy(source);
+        consume(&copy);
+    }
+    printRow(name, sizeof(T), start, allocationsBefore, copies);
+}
+
+int main(int argc, char** argv) {
+    uint32_t copies = argc > 1 ? strtoul(argv[1], nullptr, 10) : BENCH_DEFAULT_COPIES;
+    if (copies == 0) copies = BENCH_DEFAULT_COPIES;
+    
+    static StringBikeStatus withStrings;
+    withStrings.bms1.softwareVersion = VERSION;
+    withStrings.bms1.deviceInfo = DEVICE;
+    withStrings.bms2.softwareVersion = VERSION;
+    withStrings.bms2.deviceInfo = DEVICE;
+    
+    static BikeStatus pod;
+    static PodWithIdentity podWithIdentity;
+    snprintf(podWithIdentity.identity.bms1.softwareVersion, BMS_INFO_MAX_LEN, "%s", VERSION);
+    snprintf(podWithIdentity.identity.bms1.deviceInfo, BMS_INFO_MAX_LEN, "%s", DEVICE);
+    
+    printf("BikeStatus copies, %u per layout\n", copies);
+    printf("Copy assignment (reused target)\n");
+    runAssign("string", withStrings, copies);
+    runAssign("pod", pod, copies);
+    runAssign("pod+id", podWithIdentity, copies);
+    
+    printf("Copy construction (new object)\n");
+    runConstruct("string", withStrings, copies);
+    runConstruct("pod", pod, copies);
+    return 0;
+}
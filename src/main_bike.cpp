@@ -2,12 +2,19 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/queue.h>
-#include <freertos/semphr.h>
 #include "BLEBikeManager.h"
 #include "BikeRFIDManager.h"
 #include "BikeSensorManager.h"
 #include "BikeCANManager.h"
 #include "BikeData.h"
+#include "BikeDataBus.h"
+#include "SystemEventQueue.h"
+#include "TaskProfiler.h"
+#include "BikePowerManager.h"
+#include "BikeLog.h"
+#include "HeapMonitor.h"
+#include "BikeSafetyMonitor.h"
+#include "BootSequencer.h"
 
 // Create instances
 BLEBikeManager bleManager;
@@ -22,380 +29,923 @@ TaskHandle_t sensorTaskHandle = NULL;
 TaskHandle_t systemTaskHandle = NULL;
 TaskHandle_t displayTaskHandle = NULL;
 TaskHandle_t canTaskHandle = NULL;
+TaskHandle_t safetyTaskHandle = NULL;
 
 // RTOS Synchronization
-SemaphoreHandle_t bikeDataMutex;
-QueueHandle_t systemEventQueue;
+SystemEventQueue systemEvents;  // Cards, connections and stops with their payload, see postSystemEvent()
 
-// Shared data instance
-SharedBikeData sharedData;
+// Shared state, one topic per piece, each with a single writer:
+//   pack1, pack2, vesc, gpio, hall   sensorTask
+//   identity                         sensorTask (BMS strings)
+//   ble                              bleTask
+//   lock                             rfidTask
+//   state, profile                   systemTask
+// Subscribers are woken only for the topics they follow and copy only those:
+//   systemTask   lock, hall (speed), pack1 (charge current)
+//   bleTask      state
+//   sensorTask   profile
+//   safetyTask   pack1, pack2, vesc (every sample), lock
+// canTask and displayTask run on their own wakeups and copy what changed
+// since their last look (readNew()); rfidTask and safetyTask check the
+// profile's version.
+BikeDataBus dataBus;
+
+// Task wakeups, beyond the data bus topics. Every task blocks until one of
+// its events arrives; timers remain only where a protocol needs them.
+//   bleTask      connection change, BOOT button edge (BLE_EVENT_*)
+//   rfidTask     10 Hz poll (4 Hz locked or charging), the reader's IRQ pin is not wired
+//   sensorTask   BMS UART RX, input edges, Hall pulses (SENSOR_EVENT_*),
+//                the power profile's poll period for the VESC and BMS requests
+//   systemTask   queue posts, parked/charging timeouts of the power profile
+//   canTask      CAN RX and alerts, next scheduled frame
+//   displayTask  serial RX, next status print
+//   safetyTask   the action deadline of a trip, packs-lost timeout
+#define SYSTEM_EVENT_QUEUED   BUS_TASK_EVENT(0)
+#define CAN_EVENT_RX          BUS_TASK_EVENT(0)
+#define SERIAL_EVENT_RX       BUS_TASK_EVENT(0)
+#define STATUS_PERIOD_MS      5000
+#define RFID_PERIOD_MS        100     // Until the first power profile
+
+// Stack sizes in bytes, also reported against the measured high-water mark ("tasks")
+#define SYSTEM_TASK_STACK     4096
+#define BLE_TASK_STACK        4096
+#define RFID_TASK_STACK       3072
+#define SENSOR_TASK_STACK     4096
+#define CAN_TASK_STACK        3072
+#define DISPLAY_TASK_STACK    3072
+#define SAFETY_TASK_STACK     3072
+
+// Stacks and control blocks are static, like the queue: after setup() the
+// firmware leaves the heap alone ("heap" shows whether it does)
+static StackType_t systemTaskStack[SYSTEM_TASK_STACK];
+static StackType_t bleTaskStack[BLE_TASK_STACK];
+static StackType_t rfidTaskStack[RFID_TASK_STACK];
+static StackType_t sensorTaskStack[SENSOR_TASK_STACK];
+static StackType_t canTaskStack[CAN_TASK_STACK];
+static StackType_t displayTaskStack[DISPLAY_TASK_STACK];
+static StackType_t safetyTaskStack[SAFETY_TASK_STACK];
+static StaticTask_t systemTaskBuffer;
+static StaticTask_t bleTaskBuffer;
+static StaticTask_t rfidTaskBuffer;
+static StaticTask_t sensorTaskBuffer;
+static StaticTask_t canTaskBuffer;
+static StaticTask_t displayTaskBuffer;
+static StaticTask_t safetyTaskBuffer;
+
+// Loop times, wakeups and stack use per task (serial "tasks", BLE profile characteristic)
+enum TaskSlot { TASK_BLE, TASK_RFID, TASK_SENSOR, TASK_SYSTEM, TASK_CAN, TASK_DISPLAY, TASK_SAFETY, TASK_COUNT };
+TaskProfiler profiler;
+
+// Power profile (riding, parked, locked, charging), chosen in systemTask
+BikePowerManager powerManager;
+
+// Free heap, largest block and allocation rate; riding is the profile that must not allocate
+HeapMonitor heapMonitor;
+
+// Pack, cell, FET and current rules, run by safetyTask on every sample
+BikeSafetyMonitor safetyMonitor;
+
+// setup()'s stages, run side by side on both cores; the timeline also marks the first CAN frame
+BootSequencer boot;
 
 // Master RFID card for bike access
-const String MASTER_CARD_UID = "29:0E:72:43"; // Master card always authorized
+const char MASTER_CARD_UID[] = "29:0E:72:43"; // Master card always authorized
 
 // =============================================================================
 // RTOS TASK FUNCTIONS
 // =============================================================================
 
+// Queue an event for systemTask and wake it. Events posted before systemTask
+// has started wait for its first wakeup.
+bool postSystemEvent(SystemEventLane lane, const SystemEventMessage& event) {
+    if (!systemEvents.post(lane, event)) return false;
+    if (systemTaskHandle) xTaskNotify(systemTaskHandle, SYSTEM_EVENT_QUEUED, eSetBits);
+    return true;
+}
+
 // Task 1: BLE Communication Task (High Priority - Real-time communication)
-void bleTask(void *parameter) {
-    TickType_t xLastWakeTime = xTaskGetTickCount();
+void bleTask(void*) {
+    bool connected = false;
+    BikeOperationState state;
     
     Serial.println("[BLE_TASK] Started");
+    dataBus.subscribe(TOPIC_BIT(TOPIC_STATE));
+    bleManager.setWakeTask(xTaskGetCurrentTaskHandle());
+    dataBus.state.read(state);
+    bleManager.setBikeStatus(state);
+    uint32_t changed = 0;
     
     while (true) {
+        profiler.loopStart(TASK_BLE);
+        if (changed & TOPIC_BIT(TOPIC_STATE)) {
+            dataBus.state.read(state);
+            bleManager.setBikeStatus(state);
+        }
+        
         bleManager.update();
         
-        // Update shared BLE connection state
-        if (xSemaphoreTake(bikeDataMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-            bool wasConnected = sharedData.bleConnected;
-            bool currentlyConnected = bleManager.isConnected();
-            sharedData.bleConnected = currentlyConnected;
-            
-
+        // Publish the connection state if it changed
+        bool currentlyConnected = bleManager.isConnected();
+        if (connected != currentlyConnected) {
+            BIKE_LOGI("[BLE_TASK] Connection change → %s", currentlyConnected ? "Connected" : "Disconnected");
+            connected = currentlyConnected;
+            dataBus.ble.publish(connected);
             
-            // Send event if connection state changed
-            if (wasConnected != sharedData.bleConnected) {
-                SystemEvent event = sharedData.bleConnected ? EVENT_BLE_CONNECTED : EVENT_BLE_DISCONNECTED;
-                xQueueSend(systemEventQueue, &event, 0);
-                Serial.printf("[BLE_TASK] Connection change: %s → %s\n", 
-                              wasConnected ? "Connected" : "Disconnected",
-                              sharedData.bleConnected ? "Connected" : "Disconnected");
-            }
-            
-            xSemaphoreGive(bikeDataMutex);
+            // systemTask hears it as an event naming the phone
+            SystemEventMessage change = systemEvent(connected ? EVENT_BLE_CONNECTED : EVENT_BLE_DISCONNECTED);
+            bleManager.getPeerAddress(change.payload.peer.address);
+            postSystemEvent(EVENT_LANE_INFO, change);
         }
         
-        // High frequency for responsive BLE communication
-        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(50)); // 20Hz
+        // Sleep until a connection change, the BOOT button or a new bike state;
+        // the button is only timed (debounce, long press) while it is down
+        profiler.loopEnd(TASK_BLE);
+        uint32_t idle = bleManager.getNextUpdateMs();
+        changed = dataBus.waitEvents(idle == BLE_NO_TIMED_WORK ? portMAX_DELAY : pdMS_TO_TICKS(idle));
     }
 }
 
+// Settings of the power profile if it changed since the caller last looked
+const PowerProfileSettings* newPowerProfile(uint32_t& seenVersion) {
+    uint32_t version = dataBus.profile.getVersion();
+    if (version == seenVersion) return NULL;
+    seenVersion = version;
+    
+    BikePowerProfile powerProfile;
+    dataBus.profile.read(powerProfile);
+    return &BikePowerManager::settings(powerProfile);
+}
+
 // Task 2: RFID Security Task (Medium Priority - Security critical)
-void rfidTask(void *parameter) {
+void rfidTask(void*) {
     TickType_t xLastWakeTime = xTaskGetTickCount();
+    bool unlocked = false;
+    uint32_t profileVersion = 0;
+    uint32_t periodMs = RFID_PERIOD_MS;
     
     Serial.println("[RFID_TASK] Started");
     
     while (true) {
+        profiler.loopStart(TASK_RFID);
+        const PowerProfileSettings* powerProfile = newPowerProfile(profileVersion);
+        if (powerProfile && powerProfile->rfidPeriodMs != periodMs) {
+            periodMs = powerProfile->rfidPeriodMs;
+            profiler.setPeriod(TASK_RFID, periodMs);
+        }
+        
         rfidManager.update();
         
-        // Update shared RFID state
-        if (xSemaphoreTake(bikeDataMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-            bool wasUnlocked = sharedData.bikeUnlocked;
-            sharedData.bikeUnlocked = rfidManager.isBikeUnlocked();
-            
-            // Send event if unlock state changed
-            if (wasUnlocked != sharedData.bikeUnlocked) {
-                SystemEvent event = sharedData.bikeUnlocked ? EVENT_BIKE_UNLOCKED : EVENT_BIKE_LOCKED;
-                xQueueSend(systemEventQueue, &event, 0);
-            }
-            
-            xSemaphoreGive(bikeDataMutex);
+        // Every card read goes to systemTask with its UID, refused ones too
+        RFIDCardRead card;
+        if (rfidManager.takeCardRead(card)) {
+            SystemEventMessage read = systemEvent(EVENT_RFID_CARD_DETECTED);
+            memcpy(read.payload.card.uid, card.uid, card.length);
+            read.payload.card.length = card.length;
+            read.payload.card.authorized = card.authorized;
+            postSystemEvent(EVENT_LANE_INFO, read);
+        }
+        
+        // Publish the unlock state if it changed
+        bool currentlyUnlocked = rfidManager.isBikeUnlocked();
+        if (unlocked != currentlyUnlocked) {
+            unlocked = currentlyUnlocked;
+            dataBus.lock.publish(unlocked);
         }
         
-        // Medium frequency for RFID scanning
-        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(100)); // 10Hz
+        // Medium frequency for RFID scanning (polled: no IRQ line from the reader),
+        // slower while locked or charging
+        profiler.loopEnd(TASK_RFID);
+        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(periodMs));
+    }
+}
+
+// A BMS or VESC topic changes with every read (sample stamp) and on disconnect
+struct SampleMark {
+    uint8_t sampleSeq;
+    bool connected;
+    
+    bool changed(uint8_t seq, bool isConnected) {
+        if (seq == sampleSeq && isConnected == connected) return false;
+        sampleSeq = seq;
+        connected = isConnected;
+        return true;
     }
+};
+
+// GPIO and Hall topics change with their values only
+static bool sameInputs(const BusGPIOData& a, const BusGPIOData& b) {
+    return a.operationState == b.operationState && a.brakePressed == b.brakePressed &&
+           a.leftSignal == b.leftSignal && a.rightSignal == b.rightSignal && a.keyOn == b.keyOn;
+}
+
+static bool sameWheel(const BusHallData& a, const BusHallData& b) {
+    return a.hallFrequency == b.hallFrequency && a.bikeSpeed == b.bikeSpeed;
 }
 
 // Task 3: Sensor Monitoring Task (Medium Priority - Continuous monitoring)
-void sensorTask(void *parameter) {
-    TickType_t xLastWakeTime = xTaskGetTickCount();
+void sensorTask(void*) {
+    SampleMark pack1 = { 0, false };
+    SampleMark pack2 = { 0, false };
+    SampleMark vesc = { 0, false };
+    BusGPIOData inputs = BusGPIOData();
+    BusHallData wheel = BusHallData();
+    BikeIdentity identity = BikeIdentity();
+    uint32_t profileVersion = 0;
     
     Serial.println("[SENSOR_TASK] Started");
+    dataBus.subscribe(TOPIC_BIT(TOPIC_PROFILE));
+    sensorManager.setWakeTask(xTaskGetCurrentTaskHandle());
     
     while (true) {
-        sensorManager.update();
+        // BMS responses, input edges, Hall pulses and profile changes wake the
+        // task; the VESC and BMS requests run from the sensor manager's timer
+        uint32_t events = dataBus.waitEvents(pdMS_TO_TICKS(sensorManager.getNextUpdateMs()));
+        profiler.loopStart(TASK_SENSOR);
+        const PowerProfileSettings* powerProfile = newPowerProfile(profileVersion);
+        if (powerProfile) {
+            sensorManager.setPollPeriods(powerProfile->sensorPollMs, powerProfile->bmsRequestMs, powerProfile->vescPoll);
+        }
+        sensorManager.update(events);
+        
+        // Publish only the parts that changed; readers keep copying the previous ones meanwhile
+        const BikeStatus& currentData = sensorManager.peekBikeStatus();
+        if (pack1.changed(currentData.bms1.sampleSeq, currentData.bms1.connected)) dataBus.pack1.publish(currentData.bms1);
+        if (pack2.changed(currentData.bms2.sampleSeq, currentData.bms2.connected)) dataBus.pack2.publish(currentData.bms2);
+        if (vesc.changed(currentData.vesc.sampleSeq, currentData.vesc.connected)) dataBus.vesc.publish(currentData.vesc);
         
-        // Update shared sensor data
-        if (xSemaphoreTake(bikeDataMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-            sharedData.sensorData = sensorManager.getBikeStatus();
-            xSemaphoreGive(bikeDataMutex);
+        BusGPIOData currentInputs = { currentData.operationState, currentData.brakePressed, currentData.leftSignal,
+                                      currentData.rightSignal, currentData.keyOn, currentData.sampleSeq, currentData.sampleUs };
+        if (!sameInputs(currentInputs, inputs)) {
+            inputs = currentInputs;
+            dataBus.gpio.publish(inputs);
         }
         
-        // Check for emergency conditions
-        BikeStatus currentData = sensorManager.getBikeStatus();
-        // if (!currentData.bms1.connected && !currentData.bms2.connected) {
-        //     // Both BMS disconnected - emergency!
-        //     SystemEvent event = EVENT_EMERGENCY_STOP;
-        //     xQueueSend(systemEventQueue, &event, 0);
-        // }
+        BusHallData currentWheel = { currentData.hallFrequency, currentData.bikeSpeed, currentData.sampleSeq, currentData.sampleUs };
+        if (!sameWheel(currentWheel, wheel)) {
+            wheel = currentWheel;
+            dataBus.hall.publish(wheel);
+        }
         
-        // Standard sensor update rate
-        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(200)); // 5Hz
+        if (memcmp(&sensorManager.peekIdentity(), &identity, sizeof(identity)) != 0) {
+            identity = sensorManager.peekIdentity();
+            dataBus.identity.publish(identity);
+        }
+        
+        profiler.loopEnd(TASK_SENSOR);
+    }
+}
+
+// System events, from the lock topic or systemEvents; the message is all
+// there is to know about them
+void handleSystemEvent(const SystemEventMessage& event) {
+    char text[EVENT_CARD_UID_MAX * 3];
+    BIKE_LOGD("[SYSTEM_TASK] Processing event: %d", event.type);
+    
+    switch (event.type) {
+        case EVENT_RFID_CARD_DETECTED:
+            // Hex without separators, "290E7243": a log string holds 19 characters
+            // (BIKE_LOG_PAYLOAD), so a 10-byte UID shows 9 bytes and a '+'
+            text[0] = '\0';
+            for (uint8_t i = 0, length = 0; i < event.payload.card.length; i++) {
+                if (i == 9) {
+                    strcpy(text + length, "+");
+                    break;
+                }
+                length += snprintf(text + length, sizeof(text) - length, "%02X", event.payload.card.uid[i]);
+            }
+            if (event.payload.card.authorized) {
+                BIKE_LOGI("[SYSTEM] 🪪 Card %s accepted", text);
+            } else {
+                BIKE_LOGW("[SYSTEM] 🪪 Card %s refused", text);
+            }
+            break;
+        
+        case EVENT_BIKE_UNLOCKED:
+            BIKE_LOGI("[SYSTEM] 🔓 Bike UNLOCKED - System ACTIVE");
+            sensorManager.setBikeKeyState(true);
+            break;
+        
+        case EVENT_BIKE_LOCKED:
+            BIKE_LOGI("[SYSTEM] 🔒 Bike LOCKED - System STANDBY");
+            sensorManager.setBikeKeyState(false);
+            break;
+        
+        case EVENT_BLE_CONNECTED:
+        case EVENT_BLE_DISCONNECTED: {
+            // As BLEBikeManager prints it, most significant byte first
+            const uint8_t* address = event.payload.peer.address;
+            snprintf(text, sizeof(text), "%02x:%02x:%02x:%02x:%02x:%02x",
+                     address[5], address[4], address[3], address[2], address[1], address[0]);
+            if (event.type == EVENT_BLE_CONNECTED) {
+                BIKE_LOGI("[SYSTEM] 📱 BLE Connected %s - Remote access enabled", text);
+            } else {
+                BIKE_LOGI("[SYSTEM] 📱 BLE Disconnected %s - Local mode only", text);
+            }
+            break;
+        }
+        
+        case EVENT_EMERGENCY_STOP:
+            // safetyTask has already stopped the motor; until the bike is locked the state says so
+            BIKE_LOGE("[SYSTEM] 🚨 EMERGENCY STOP: %s, saw %.2f",
+                      BikeSafetyMonitor::ruleName((SafetyRule)event.payload.fault.rule), event.payload.fault.value);
+            BIKE_LOGE("[SYSTEM] 🚨 Pack %u, actions 0x%02X, handled %lu us after detection",
+                      event.payload.fault.pack, event.payload.fault.actions,
+                      (unsigned long)(micros() - event.atUs));
+            dataBus.state.publish(BIKE_OFF);
+            break;
+        
+        default:
+            BIKE_LOGW("[SYSTEM] Unknown event: %d", event.type);
+            break;
+    }
+}
+
+// Switch to the profile powerManager picked: the CPU clock here, the rest in
+// the tasks concerned when they see the profile topic change
+void applyPowerProfile() {
+    BikePowerProfile powerProfile = powerManager.getProfile();
+    const PowerProfileSettings& settings = BikePowerManager::settings(powerProfile);
+    
+    if (setCpuFrequencyMhz(settings.cpuMhz)) {
+        BIKE_LOGI("[SYSTEM] ⚡ Power profile: %s, CPU %u MHz", settings.name, settings.cpuMhz);
+    } else {
+        BIKE_LOGW("[SYSTEM] ⚡ Power profile: %s, CPU clock %u MHz refused", settings.name, settings.cpuMhz);
+    }
+    heapMonitor.setRiding(powerProfile == POWER_RIDING);
+    dataBus.profile.publish(powerProfile);
+}
+
+// Task 7: Safety Monitor Task (Highest Priority - Bounded reaction to faults)
+void safetyTask(void*) {
+    BMSData pack;
+    VESCData vesc;
+    bool unlocked;
+    uint32_t profileVersion = 0;
+    
+    Serial.println("[SAFETY_TASK] Started");
+    dataBus.subscribe(TOPIC_BIT(TOPIC_PACK1) | TOPIC_BIT(TOPIC_PACK2) | TOPIC_BIT(TOPIC_VESC) | TOPIC_BIT(TOPIC_LOCK));
+    
+    while (true) {
+        uint32_t idle = safetyMonitor.getNextCheckMs();
+        uint32_t changed = dataBus.waitEvents(idle == SAFETY_NO_TIMED_WORK ? portMAX_DELAY : pdMS_TO_TICKS(idle));
+        profiler.loopStart(TASK_SAFETY);
+        const PowerProfileSettings* powerProfile = newPowerProfile(profileVersion);
+        if (powerProfile) safetyMonitor.setBmsRequestMs(powerProfile->bmsRequestMs);
+        
+        // Every fresh sample, as it is published
+        uint8_t actions = 0;
+        if (changed & TOPIC_BIT(TOPIC_PACK1)) {
+            dataBus.pack1.read(pack);
+            actions |= safetyMonitor.checkPack(1, pack);
+        }
+        if (changed & TOPIC_BIT(TOPIC_PACK2)) {
+            dataBus.pack2.read(pack);
+            actions |= safetyMonitor.checkPack(2, pack);
+        }
+        if (changed & TOPIC_BIT(TOPIC_VESC)) {
+            dataBus.vesc.read(vesc);
+            actions |= safetyMonitor.checkVesc(vesc);
+        }
+        actions |= safetyMonitor.checkPacksLost();
+        
+        // The stop's event carries the trip: systemTask logs and acts on it
+        // without coming back to the monitor, ahead of any card or BLE event
+        if (actions) {
+            sensorManager.requestSafeStop(actions);
+            SafetySnapshot trip;
+            safetyMonitor.getSnapshot(trip);
+            SystemEventMessage stop = systemEvent(EVENT_EMERGENCY_STOP);
+            stop.atUs = trip.detectedUs;
+            stop.payload.fault.rule = trip.rule;
+            stop.payload.fault.pack = trip.pack;
+            stop.payload.fault.actions = actions;
+            stop.payload.fault.value = trip.value;
+            postSystemEvent(EVENT_LANE_SAFETY, stop);
+        }
+        
+        // Carried out in time, or the key output goes: without power the VESC stops too.
+        // The RFID manager owns the pin; it locks the bike and rfidTask publishes it.
+        safetyMonitor.acted(sensorManager.getSafeStopUs());
+        if (safetyMonitor.isActionOverdue()) {
+            rfidManager.cutPower();
+            safetyMonitor.escalate();
+            BIKE_LOGE("[SAFETY] 🚨 Stop not sent within %u ms: key output dropped", SAFETY_ACTION_DEADLINE_MS);
+        }
+        
+        // Locking the bike clears the stop
+        if (changed & TOPIC_BIT(TOPIC_LOCK)) {
+            dataBus.lock.read(unlocked);
+            if (!unlocked && safetyMonitor.isTripped()) {
+                safetyMonitor.reset();
+                sensorManager.releaseSafeStop();
+                BIKE_LOGI("[SAFETY] Bike locked: stop released");
+            }
+        }
+        
+        profiler.loopEnd(TASK_SAFETY);
     }
 }
 
 // Task 4: System Control Task (Highest Priority - Main logic controller)
-void systemTask(void *parameter) {
-    SystemEvent receivedEvent;
+void systemTask(void*) {
+    SystemEventMessage receivedEvent;
+    bool unlocked;
+    BusHallData wheel = BusHallData();
+    BMSData pack1;
+    BMSData pack2;
     
     Serial.println("[SYSTEM_TASK] Started");
+    dataBus.subscribe(TOPIC_BIT(TOPIC_LOCK) | TOPIC_BIT(TOPIC_HALL) | TOPIC_BIT(TOPIC_PACK1));
+    
+    // Initial system state and power profile, then only on changes
+    dataBus.lock.read(unlocked);
+    dataBus.state.publish(unlocked ? BIKE_ON : BIKE_LOCKED);
+    powerManager.begin(unlocked);
+    applyPowerProfile();
     
     while (true) {
-        // Process system events
-        if (xQueueReceive(systemEventQueue, &receivedEvent, pdMS_TO_TICKS(100)) == pdTRUE) {
-            Serial.printf("[SYSTEM_TASK] Processing event: %d\n", receivedEvent);
+        // Lock, speed and BMS changes arrive as topics, cards, connections and
+        // stops through systemEvents; the timeout is the power profile's next timed change
+        uint32_t idle = powerManager.getNextUpdateMs();
+        uint32_t changed = dataBus.waitEvents(idle == POWER_NO_TIMED_WORK ? portMAX_DELAY : pdMS_TO_TICKS(idle));
+        profiler.loopStart(TASK_SYSTEM);
+        
+        if (changed & TOPIC_BIT(TOPIC_LOCK)) {
+            dataBus.lock.read(unlocked);
+            handleSystemEvent(systemEvent(unlocked ? EVENT_BIKE_UNLOCKED : EVENT_BIKE_LOCKED));
             
-            switch (receivedEvent) {
-                case EVENT_BIKE_UNLOCKED:
-                    Serial.println("[SYSTEM] 🔓 Bike UNLOCKED - System ACTIVE");
-                    sensorManager.setBikeKeyState(true);
-                    break;
-                    
-                case EVENT_BIKE_LOCKED:
-                    Serial.println("[SYSTEM] 🔒 Bike LOCKED - System STANDBY");
-                    sensorManager.setBikeKeyState(false);
-                    break;
-                    
-                case EVENT_BLE_CONNECTED:
-                    Serial.println("[SYSTEM] 📱 BLE Connected - Remote access enabled");
-                    break;
-                    
-                case EVENT_BLE_DISCONNECTED:
-                    Serial.println("[SYSTEM] 📱 BLE Disconnected - Local mode only");
-                    break;
-                    
-                case EVENT_EMERGENCY_STOP:
-                    Serial.println("[SYSTEM] 🚨 EMERGENCY STOP - All systems halt");
-                    // Emergency procedures - all critical systems disabled
-                    break;
-                    
-                default:
-                    Serial.printf("[SYSTEM] Unknown event: %d\n", receivedEvent);
-                    break;
-            }
+            // Determine overall system state (bleTask forwards it to BLE)
+            dataBus.state.publish(unlocked ? BIKE_ON : BIKE_LOCKED);
         }
         
-        // Update system state
-        if (xSemaphoreTake(bikeDataMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-            // Determine overall system state
-            if (sharedData.bikeUnlocked) {
-                sharedData.currentState = BIKE_ON;
-            } else {
-                sharedData.currentState = BIKE_LOCKED;
-            }
-            
-            // Update BLE with current state
-            bleManager.setBikeStatus(sharedData.currentState);
-            
-            xSemaphoreGive(bikeDataMutex);
+        while (systemEvents.receive(receivedEvent)) {
+            handleSystemEvent(receivedEvent);
         }
         
-        // System control runs at moderate frequency
-        vTaskDelay(pdMS_TO_TICKS(50)); // 20Hz
+        // Power profile from the lock state, the speed and the charge current.
+        // Both packs are requested together: pack1 stands for the pair.
+        if (changed & TOPIC_BIT(TOPIC_HALL)) dataBus.hall.read(wheel);
+        if (changed & TOPIC_BIT(TOPIC_PACK1)) {
+            dataBus.pack1.read(pack1);
+            dataBus.pack2.read(pack2);
+            powerManager.addSample(pack1, pack2);
+        }
+        if (powerManager.update(unlocked, wheel.bikeSpeed)) applyPowerProfile();
+        
+        profiler.loopEnd(TASK_SYSTEM);
     }
 }
 
 // Task 5: CAN Communication Task (Medium Priority - Display communication)
-void canTask(void *parameter) {
-    TickType_t xLastWakeTime = xTaskGetTickCount();
+static SharedBikeData canSnapshot;  // canTask's copy, updated topic by topic
+static BusCursor canCursor;
+
+void canTask(void*) {
+    bool sending = false;
     
     Serial.println("[CAN_TASK] Started");
+    ESP32CANTransport::instance().setRxNotify(xTaskGetCurrentTaskHandle(), CAN_EVENT_RX);
     
     while (true) {
-        // Send data in sequence every 500ms
-        if (xSemaphoreTake(bikeDataMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-            // Use library's automatic sequence sending
-            canManager.sendNextInSequence(sharedData);
-            xSemaphoreGive(bikeDataMutex);
-        }
+        // Sleep until a frame arrives or the next scheduled frame is due;
+        // sensor changes alone don't wake the task, the schedule sends them
+        dataBus.waitEvents(pdMS_TO_TICKS(canManager.getIdleMs()));
+        profiler.loopStart(TASK_CAN);
         
         // Handle incoming messages
         canManager.update();
         
-        // CAN task runs at 2Hz (500ms interval)
-        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(500));
+        // Copy only the topics that changed since the last wakeup, then send
+        // whatever the scheduler has due (per-message periods, bus-load budget)
+        uint32_t readStart = micros();
+        uint32_t changed = dataBus.readNew(canCursor, canSnapshot);
+        profiler.dataRead(TASK_CAN, micros() - readStart);
+        if (changed & TOPIC_BIT(TOPIC_PROFILE)) {
+            canManager.setRateDivider(BikePowerManager::settings(canSnapshot.powerProfile).canRateDivider);
+        }
+        canManager.sendDueMessages(canSnapshot);
+        if (!sending && canManager.getMessagesSent()) {
+            sending = true;
+            boot.mark("first CAN frame");
+        }
+        
+        profiler.loopEnd(TASK_CAN);
+    }
+}
+
+// Serial commands (displayTask, woken by serial RX):
+//   canstats        per-ID CAN counters, jitter and bus load
+//   canstats reset  restart the CAN statistics
+//   shared          data bus topics: versions, age, subscribers, reader retries
+//   tasks           per-task CPU share, loop time histogram, missed deadlines, stack use
+//   power           power profile in force, time and measured draw per profile
+//   safety          safety monitor: state, last trip, detection-to-action latency
+//   heap            free heap, largest block, fragmentation, allocations (riding included)
+//   events          system event lanes: posted, waiting, peak, overflows; pool use
+//   boot            boot stages: core, start and end after power-on, first CAN frame
+//   log text        print log records as text (default)
+//   log binary      print them as "~L" lines for host_log_decode
+static CANBusStatsSnapshot canStats;  // displayTask only, kept off its stack
+static TaskProfilerSnapshot taskProfile;  // displayTask only, kept off its stack
+static PowerSnapshot powerStats;  // displayTask only, kept off its stack
+static HeapSnapshot heapStats;  // displayTask only, kept off its stack
+static SafetySnapshot safetyStats;  // displayTask only, kept off its stack
+static EventQueueStats eventStats;  // displayTask only, kept off its stack
+static BootTimeline bootTimeline;  // setup(), then displayTask
+static SharedBikeData displaySnapshot;  // displayTask's copy, updated topic by topic
+static BusCursor displayCursor;
+
+void printSharedStats() {
+    uint32_t now = millis();
+    Serial.printf("🔄 Data bus: %lu notifications\n", (unsigned long)dataBus.getNotifications());
+    Serial.println("   topic   version   age (ms)  subs  retries");
+    for (uint8_t i = 0; i < TOPIC_COUNT; i++) {
+        const BusTopicBase* topic = dataBus.topics[i];
+        Serial.printf("   %-6s %8lu %10lu %5u %8lu\n", BikeDataBus::topicName(i),
+                      (unsigned long)topic->getVersion(),
+                      topic->getVersion() ? (unsigned long)(now - topic->getChangedMs()) : 0UL,
+                      dataBus.getSubscriberCount((BikeTopic)i), (unsigned long)topic->getReadRetries());
+    }
+}
+
+void printEventStats() {
+    systemEvents.getStats(eventStats);
+    Serial.printf("📨 System events: pool %u/%u in use, peak %u (%u kept for safety)\n",
+                  eventStats.poolUsed, EVENT_POOL_SIZE, eventStats.poolMaxUsed, EVENT_SAFETY_RESERVED);
+    Serial.println("   lane     posted  waiting  peak  overflows");
+    for (uint8_t i = 0; i < EVENT_LANE_COUNT; i++) {
+        const EventLaneStats& lane = eventStats.lanes[i];
+        Serial.printf("   %-6s %8lu %8u %5u %10lu\n", SystemEventQueue::laneName(i), (unsigned long)lane.posted,
+                      lane.depth, lane.maxDepth, (unsigned long)lane.overflows);
+    }
+}
+
+void handleSerialCommand() {
+    static char line[32];
+    static uint8_t length = 0;
+    
+    while (Serial.available()) {
+        char c = Serial.read();
+        if (c != '\n' && c != '\r') {
+            if (length < sizeof(line) - 1) line[length++] = c;
+            continue;
+        }
+        if (length == 0) continue;
+        line[length] = '\0';
+        length = 0;
+        
+        if (strcmp(line, "canstats") == 0) {
+            canManager.getBusStats(canStats);
+            canPrintBusStats(canStats);
+        } else if (strcmp(line, "canstats reset") == 0) {
+            canManager.resetBusStats();
+            Serial.println("[CAN] Statistics reset");
+        } else if (strcmp(line, "shared") == 0) {
+            printSharedStats();
+        } else if (strcmp(line, "tasks") == 0) {
+            profiler.getSnapshot(taskProfile);
+            taskPrintProfile(taskProfile);
+        } else if (strcmp(line, "power") == 0) {
+            powerManager.getSnapshot(powerStats);
+            powerPrintStats(powerStats);
+        } else if (strcmp(line, "safety") == 0) {
+            safetyMonitor.getSnapshot(safetyStats);
+            safetyPrintStats(safetyStats);
+        } else if (strcmp(line, "heap") == 0) {
+            heapMonitor.getSnapshot(heapStats);
+            heapPrintStats(heapStats);
+        } else if (strcmp(line, "events") == 0) {
+            printEventStats();
+        } else if (strcmp(line, "boot") == 0) {
+            boot.getTimeline(bootTimeline);
+            bootPrintTimeline(bootTimeline);
+        } else if (strcmp(line, "log text") == 0 || strcmp(line, "log binary") == 0) {
+            bikeLog.setBinaryOutput(strcmp(line, "log binary") == 0);
+            Serial.printf("[LOG] %s output, %lu records, %lu dropped\n", bikeLog.isBinaryOutput() ? "Binary" : "Text",
+                          (unsigned long)bikeLog.getWritten(), (unsigned long)bikeLog.getDropped());
+        }
     }
 }
 
+// Wakeups per second of each task since the last status
+void printTaskWakeups(uint32_t elapsedMs) {
+    static const char* names[TASK_COUNT] = { "BLE", "RFID", "SENSOR", "SYSTEM", "CAN", "DISPLAY", "SAFETY" };
+    static uint32_t lastWakeups[TASK_COUNT];
+    
+    Serial.print("⏰ Wakeups/s:");
+    for (uint8_t i = 0; i < TASK_COUNT; i++) {
+        uint32_t wakeups = profiler.getIterations(i);
+        Serial.printf(" %s=%.1f", names[i], (wakeups - lastWakeups[i]) * 1000.0f / elapsedMs);
+        lastWakeups[i] = wakeups;
+    }
+    Serial.println();
+}
+
+// Serial.printf() takes the heap for lines over 64 characters, as most status lines are
+void statusPrintf(const char* format, ...) {
+    static char line[256];  // displayTask only
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    Serial.print(line);
+}
+
 // Task 6: Display/Logging Task (Low Priority - Non-critical output)
-void displayTask(void *parameter) {
-    TickType_t xLastWakeTime = xTaskGetTickCount();
+void displayTask(void*) {
+    uint32_t lastStatusMs = millis() - STATUS_PERIOD_MS;
     
     Serial.println("[DISPLAY_TASK] Started");
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();  // displayTaskHandle may not be stored yet
+    Serial.onReceive([self]() { xTaskNotify(self, SERIAL_EVENT_RX, eSetBits); });
     
     while (true) {
-        // Display system status every 5 seconds
-        if (xSemaphoreTake(bikeDataMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-            Serial.println("\n=== 🚲 SMART BIKE SYSTEM STATUS ===");
-            
-            // BLE Status
-            Serial.printf("📡 BLE: %s", sharedData.bleConnected ? "Connected" : "Disconnected");
-            if (bleManager.isPairingInProgress()) {
-                Serial.print(" (PAIRING - PRESS BOOT!)");
-            }
-            Serial.printf(" | Bonded: %d\n", bleManager.getBondedDeviceCount());
-            
-            // RFID & Bike Status  
-            Serial.printf("🔐 Bike: %s | Key Output: %s\n", 
-                         sharedData.bikeUnlocked ? "UNLOCKED" : "LOCKED",
-                         sharedData.sensorData.keyOn ? "HIGH" : "LOW");
-            
-            // Speed & Hall Status
-            Serial.printf("🏁 Speed: %.1f km/h | Hall: %.1f Hz | Pulses: %lu\n",
-                         sharedData.sensorData.bikeSpeed,
-                         sharedData.sensorData.hallFrequency,
-                         sensorManager.getHallPulseCount());
-            
-            // BMS Status
-            Serial.printf("🔋 BMS1: %s", sharedData.sensorData.bms1.connected ? "OK" : "FAIL");
-            if (sharedData.sensorData.bms1.connected) {
-                Serial.printf(" %.2fV %.1fA %d%% %.1f°C Δ%dmV", 
-                             sharedData.sensorData.bms1.voltage, sharedData.sensorData.bms1.current, 
-                             sharedData.sensorData.bms1.soc, sharedData.sensorData.bms1.temperature,
-                             sharedData.sensorData.bms1.cellVoltageDelta);
-            }
-            Serial.println();
-            
-            Serial.printf("🔋 BMS2: %s", sharedData.sensorData.bms2.connected ? "OK" : "FAIL");
-            if (sharedData.sensorData.bms2.connected) {
-                Serial.printf(" %.2fV %.1fA %d%% %.1f°C Δ%dmV", 
-                             sharedData.sensorData.bms2.voltage, sharedData.sensorData.bms2.current, 
-                             sharedData.sensorData.bms2.soc, sharedData.sensorData.bms2.temperature,
-                             sharedData.sensorData.bms2.cellVoltageDelta);
-            }
-            Serial.println();
-            
-            // Task Status
-            Serial.printf("⚙️  Tasks: BLE=%d RFID=%d SENSOR=%d SYSTEM=%d CAN=%d DISPLAY=%d\n",
-                         uxTaskPriorityGet(bleTaskHandle),
-                         uxTaskPriorityGet(rfidTaskHandle), 
-                         uxTaskPriorityGet(sensorTaskHandle),
-                         uxTaskPriorityGet(systemTaskHandle),
-                         uxTaskPriorityGet(canTaskHandle),
-                         uxTaskPriorityGet(displayTaskHandle));
-                         
-            Serial.printf("💾 Free Heap: %d bytes\n", ESP.getFreeHeap());
-            Serial.println("=====================================");
-            
-            xSemaphoreGive(bikeDataMutex);
+        // Sleep until a serial command arrives, the log needs draining or the next status is due
+        uint32_t sinceStatus = millis() - lastStatusMs;
+        if (sinceStatus < STATUS_PERIOD_MS) {
+            uint32_t waitMs = STATUS_PERIOD_MS - sinceStatus;
+#if BIKE_LOG_LEVEL > BIKE_LOG_LEVEL_NONE
+            if (waitMs > BIKE_LOG_DRAIN_MS) waitMs = BIKE_LOG_DRAIN_MS;
+#endif
+            dataBus.waitEvents(pdMS_TO_TICKS(waitMs));
+        }
+        profiler.loopStart(TASK_DISPLAY);
+        bikeLog.drain();  // The other tasks only queue their log records
+        heapMonitor.update();
+        handleSerialCommand();
+        
+        uint32_t now = millis();
+        if (now - lastStatusMs < STATUS_PERIOD_MS) {
+            profiler.loopEnd(TASK_DISPLAY);
+            continue;
+        }
+        uint32_t elapsedMs = now - lastStatusMs;
+        lastStatusMs = now;
+        
+        // Display system status every 5 seconds, printed from a copy of what changed since the last one
+        uint32_t readStart = micros();
+        uint32_t changed = dataBus.readNew(displayCursor, displaySnapshot);
+        profiler.dataRead(TASK_DISPLAY, micros() - readStart);
+        
+        Serial.println("\n=== 🚲 SMART BIKE SYSTEM STATUS ===");
+        
+        // BLE Status
+        statusPrintf("📡 BLE: %s", displaySnapshot.bleConnected ? "Connected" : "Disconnected");
+        if (bleManager.isPairingInProgress()) {
+            Serial.print(" (PAIRING - PRESS BOOT!)");
         }
+        statusPrintf(" | Bonded: %d\n", bleManager.getBondedDeviceCount());
         
-        // Low frequency for display updates
-        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(5000)); // Every 5 seconds
+        // RFID & Bike Status  
+        statusPrintf("🔐 Bike: %s | Key Output: %s\n", 
+                     displaySnapshot.bikeUnlocked ? "UNLOCKED" : "LOCKED",
+                     displaySnapshot.sensorData.keyOn ? "HIGH" : "LOW");
+        
+        // Speed & Hall Status
+        statusPrintf("🏁 Speed: %.1f km/h | Hall: %.1f Hz | Pulses: %lu\n",
+                     displaySnapshot.sensorData.bikeSpeed,
+                     displaySnapshot.sensorData.hallFrequency,
+                     sensorManager.getHallPulseCount());
+        
+        // BMS Status
+        statusPrintf("🔋 BMS1: %s", displaySnapshot.sensorData.bms1.connected ? "OK" : "FAIL");
+        if (displaySnapshot.sensorData.bms1.connected) {
+            statusPrintf(" %.2fV %.1fA %d%% %.1f°C Δ%dmV", 
+                         displaySnapshot.sensorData.bms1.voltage, displaySnapshot.sensorData.bms1.current, 
+                         displaySnapshot.sensorData.bms1.soc, displaySnapshot.sensorData.bms1.temperature,
+                         displaySnapshot.sensorData.bms1.cellVoltageDelta);
+        }
+        Serial.println();
+        
+        statusPrintf("🔋 BMS2: %s", displaySnapshot.sensorData.bms2.connected ? "OK" : "FAIL");
+        if (displaySnapshot.sensorData.bms2.connected) {
+            statusPrintf(" %.2fV %.1fA %d%% %.1f°C Δ%dmV", 
+                         displaySnapshot.sensorData.bms2.voltage, displaySnapshot.sensorData.bms2.current, 
+                         displaySnapshot.sensorData.bms2.soc, displaySnapshot.sensorData.bms2.temperature,
+                         displaySnapshot.sensorData.bms2.cellVoltageDelta);
+        }
+        Serial.println();
+        
+        // Task Status
+        statusPrintf("⚙️  Tasks: BLE=%d RFID=%d SENSOR=%d SYSTEM=%d CAN=%d DISPLAY=%d SAFETY=%d\n",
+                     uxTaskPriorityGet(bleTaskHandle),
+                     uxTaskPriorityGet(rfidTaskHandle), 
+                     uxTaskPriorityGet(sensorTaskHandle),
+                     uxTaskPriorityGet(systemTaskHandle),
+                     uxTaskPriorityGet(canTaskHandle),
+                     uxTaskPriorityGet(displayTaskHandle),
+                     uxTaskPriorityGet(safetyTaskHandle));
+        
+        // CAN bus summary ("canstats" prints the per-ID table)
+        canManager.getBusStats(canStats);
+        uint32_t txFailed = 0;
+        for (uint8_t i = 0; i < canStats.idCount; i++) txFailed += canStats.ids[i].txFailed;
+        statusPrintf("🚌 CAN: load %.1f%% (peak %.1f%%) | Sent: %lu | TX failed: %lu | Deferred: %lu | Groups: 0x%02X%s\n",
+                     canStats.busLoadPct, canStats.peakLoadPct,
+                     (unsigned long)canManager.getMessagesSent(), (unsigned long)txFailed,
+                     (unsigned long)canManager.getBudgetDeferrals(), canManager.getSubscribedGroups(),
+                     canManager.isSubscriptionActive() ? "" : " (default)");
+        statusPrintf("🚌 CAN controller: %s%s | Dropped: %lu | Retried: %lu | Bus-off: %lu | Recovered: %lu\n",
+                     canErrorStateName(canStats.health.errorState),
+                     canStats.health.suspended ? " (TX SUSPENDED)" : "",
+                     (unsigned long)canStats.health.dropped, (unsigned long)canStats.health.retried,
+                     (unsigned long)canStats.health.busOffs, (unsigned long)canStats.health.recoveries);
+        
+        statusPrintf("🔄 Data bus: %lu notifications | topics changed since last status: 0x%03lX\n",
+                     (unsigned long)dataBus.getNotifications(), (unsigned long)changed);
+        printTaskWakeups(elapsedMs);
+        
+        powerManager.getSnapshot(powerStats);
+        statusPrintf("⚡ Power: %s for %lu s | CPU %u MHz | CAN rate ÷%u\n",
+                     BikePowerManager::settings(powerStats.profile).name, (unsigned long)(powerStats.sinceMs / 1000),
+                     powerStats.cpuMhz, canManager.getRateDivider());
+        
+        safetyMonitor.getSnapshot(safetyStats);
+        if (safetyStats.tripped) {
+            statusPrintf("🛡️  Safety: STOPPED by %s (pack %u, %.2f)%s\n", BikeSafetyMonitor::ruleName(safetyStats.rule),
+                         safetyStats.pack, safetyStats.value, safetyStats.escalated ? " | key output dropped" : "");
+        } else {
+            statusPrintf("🛡️  Safety: OK | %lu samples checked\n", (unsigned long)safetyStats.samples);
+        }
+        
+        heapMonitor.getSnapshot(heapStats);
+        statusPrintf("💾 Heap: %lu B free | largest block %lu B | fragmentation %.1f%%",
+                     (unsigned long)heapStats.freeBytes, (unsigned long)heapStats.largestFreeBlock,
+                     heapStats.fragmentationPct);
+        if (heapStats.counting) statusPrintf(" | %.1f allocations/s", heapStats.allocationsPerSec);
+        Serial.println();
+        Serial.println("=====================================");
+        
+        profiler.loopEnd(TASK_DISPLAY);
     }
 }
 
-void setup() {
-    Serial.begin(115200);
-    delay(1000);
-    
-    Serial.println("=== 🚲 SAO KIM SMART BIKE SYSTEM ===");
-    Serial.println("🔧 Initializing RTOS Multi-Task System...");
-    
-    // Initialize RTOS synchronization objects
-    bikeDataMutex = xSemaphoreCreateMutex();
-    systemEventQueue = xQueueCreate(10, sizeof(SystemEvent));
-    
-    if (bikeDataMutex == NULL || systemEventQueue == NULL) {
-        Serial.println("❌ Failed to create RTOS synchronization objects!");
-        ESP.restart();
-    }
-    
-    // Initialize shared data
-    memset(&sharedData, 0, sizeof(SharedBikeData));
-    sharedData.currentState = BIKE_OFF;
-    
-    Serial.println("\n🔧 1. Initializing BLE System...");
+// =============================================================================
+// BOOT STAGES
+// =============================================================================
+
+// Each stage initialises one part, or starts the tasks that need it; setup()
+// says what comes before what and boot runs the rest side by side
+void bootBLE() {
+    Serial.println("\n🔧 Initializing BLE System...");
     bleManager.begin();
     bleManager.setBikeStatus(BIKE_OFF);
-    
-    Serial.println("\n🔐 2. Initializing RFID System...");
+}
+
+void bootRFID() {
+    Serial.println("\n🔐 Initializing RFID System...");
     rfidManager.begin();
     
-    // Link RFID Manager to BLE Manager for authentication
-    bleManager.setRFIDManager(&rfidManager);
-    
     // Set master card first
-    Serial.println("Setting master card...");
     rfidManager.setMasterCard(MASTER_CARD_UID);
     
-    // Clear all previous cards and add fresh
-    Serial.println("Clearing previous cards...");
+    // Clear all previous cards and add fresh (Preferences writes are done when they return)
     rfidManager.clearAllCards();
-    delay(100); // Small delay for flash write
-    
-    Serial.println("Adding authorized card...");
     rfidManager.addAuthorizedCard(MASTER_CARD_UID);
-    Serial.printf("Master card added: %s\n", MASTER_CARD_UID.c_str());
-    
-    Serial.println("\n📊 3. Initializing Sensor System...");
+    Serial.printf("Master card added: %s\n", MASTER_CARD_UID);
+}
+
+void bootSensors() {
+    Serial.println("\n📊 Initializing Sensor System...");
     sensorManager.begin();
-    
-    Serial.println("\n🔗 4. Initializing CAN Bus...");
+}
+
+void bootCAN() {
+    Serial.println("\n🔗 Initializing CAN Bus...");
     if (!canManager.begin()) {
         Serial.println("⚠️  System will continue without CAN communication");
     }
+}
+
+// Sensors, the safety monitor, the system logic and CAN: all the display needs
+void startRideTasks() {
+    sensorTaskHandle = xTaskCreateStaticPinnedToCore(
+        sensorTask,        // Task function
+        "SensorTask",      // Task name
+        SENSOR_TASK_STACK, // Stack size
+        NULL,              // Parameters
+        3,                 // Priority (Medium)
+        sensorTaskStack,   // Stack
+        &sensorTaskBuffer, // Task control block
+        1                  // Core 1
+    );
     
-    Serial.println("\n⚙️  5. Creating RTOS Tasks...");
-    
-    // Create tasks with appropriate priorities
-    xTaskCreatePinnedToCore(
+    systemTaskHandle = xTaskCreateStaticPinnedToCore(
         systemTask,         // Task function
         "SystemTask",       // Task name
-        4096,              // Stack size
+        SYSTEM_TASK_STACK, // Stack size
         NULL,              // Parameters
         5,                 // Priority (Highest)
-        &systemTaskHandle, // Task handle
+        systemTaskStack,   // Stack
+        &systemTaskBuffer, // Task control block
         1                  // Core 1
     );
     
-    xTaskCreatePinnedToCore(
-        bleTask,           // Task function
-        "BLETask",         // Task name
-        4096,              // Stack size
+    // After systemTask: a trip posts to it
+    safetyTaskHandle = xTaskCreateStaticPinnedToCore(
+        safetyTask,        // Task function
+        "SafetyTask",      // Task name
+        SAFETY_TASK_STACK, // Stack size
         NULL,              // Parameters
-        4,                 // Priority (High)
-        &bleTaskHandle,    // Task handle
-        0                  // Core 0 (WiFi/BLE core)
+        6,                 // Priority (Above everything else)
+        safetyTaskStack,   // Stack
+        &safetyTaskBuffer, // Task control block
+        1                  // Core 1 (same as Sensors)
     );
     
-    xTaskCreatePinnedToCore(
-        rfidTask,          // Task function
-        "RFIDTask",        // Task name
-        3072,              // Stack size
+    canTaskHandle = xTaskCreateStaticPinnedToCore(
+        canTask,           // Task function
+        "CANTask",         // Task name
+        CAN_TASK_STACK,    // Stack size
         NULL,              // Parameters
-        3,                 // Priority (Medium-High)
-        &rfidTaskHandle,   // Task handle
-        1                  // Core 1
+        2,                 // Priority (Medium-Low)
+        canTaskStack,      // Stack
+        &canTaskBuffer,    // Task control block
+        0                  // Core 0 (same as Display)
     );
     
-    xTaskCreatePinnedToCore(
-        sensorTask,        // Task function
-        "SensorTask",      // Task name
-        4096,              // Stack size
+    profiler.add(TASK_SENSOR, "SensorTask", sensorTaskHandle, SENSOR_TASK_STACK);
+    profiler.add(TASK_SYSTEM, "SystemTask", systemTaskHandle, SYSTEM_TASK_STACK);
+    profiler.add(TASK_SAFETY, "SafetyTask", safetyTaskHandle, SAFETY_TASK_STACK);
+    profiler.add(TASK_CAN, "CANTask", canTaskHandle, CAN_TASK_STACK);
+}
+
+void startRFIDTask() {
+    rfidTaskHandle = xTaskCreateStaticPinnedToCore(
+        rfidTask,          // Task function
+        "RFIDTask",        // Task name
+        RFID_TASK_STACK,   // Stack size
         NULL,              // Parameters
-        3,                 // Priority (Medium)
-        &sensorTaskHandle, // Task handle
+        3,                 // Priority (Medium-High)
+        rfidTaskStack,     // Stack
+        &rfidTaskBuffer,   // Task control block
         1                  // Core 1
     );
-    
-    xTaskCreatePinnedToCore(
-        canTask,           // Task function
-        "CANTask",         // Task name
-        3072,              // Stack size
+    profiler.add(TASK_RFID, "RFIDTask", rfidTaskHandle, RFID_TASK_STACK, RFID_PERIOD_MS);
+}
+
+void startBLETask() {
+    bleTaskHandle = xTaskCreateStaticPinnedToCore(
+        bleTask,           // Task function
+        "BLETask",         // Task name
+        BLE_TASK_STACK,    // Stack size
         NULL,              // Parameters
-        2,                 // Priority (Medium-Low)
-        &canTaskHandle,    // Task handle
-        0                  // Core 0 (same as Display)
+        4,                 // Priority (High)
+        bleTaskStack,      // Stack
+        &bleTaskBuffer,    // Task control block
+        0                  // Core 0 (WiFi/BLE core)
     );
-    
-    xTaskCreatePinnedToCore(
+    profiler.add(TASK_BLE, "BLETask", bleTaskHandle, BLE_TASK_STACK);
+    bleManager.setTaskProfiler(&profiler);
+}
+
+// The status print and serial commands read every manager
+void startDisplayTask() {
+    displayTaskHandle = xTaskCreateStaticPinnedToCore(
         displayTask,       // Task function
         "DisplayTask",     // Task name
-        3072,              // Stack size
+        DISPLAY_TASK_STACK,// Stack size
         NULL,              // Parameters
         1,                 // Priority (Low)
-        &displayTaskHandle,// Task handle
+        displayTaskStack,  // Stack
+        &displayTaskBuffer,// Task control block
         0                  // Core 0
     );
+    profiler.add(TASK_DISPLAY, "DisplayTask", displayTaskHandle, DISPLAY_TASK_STACK);
+}
+
+void setup() {
+    Serial.begin(115200);
+    
+    Serial.println("=== 🚲 SAO KIM SMART BIKE SYSTEM ===");
+    Serial.println("🔧 Initializing RTOS Multi-Task System...");
+    
+    // Initialize RTOS synchronization objects
+    if (!systemEvents.begin()) {
+        Serial.println("❌ Failed to create RTOS synchronization objects!");
+        ESP.restart();
+    }
+    
+    // Link RFID Manager to BLE Manager for authentication (pointer only, either may start first)
+    bleManager.setRFIDManager(&rfidManager);
+    
+    // BLE on core 0 with the NimBLE host; sensors and CAN on core 1, where
+    // their interrupts (Hall, inputs, TWAI) were always allocated; RFID on
+    // whichever core is free. Tasks start as soon as their parts are up.
+    uint8_t ble = boot.add("ble", bootBLE, 0, 0);
+    uint8_t sensors = boot.add("sensors", bootSensors, 0, 1);
+    uint8_t can = boot.add("can", bootCAN, 0, 1);
+    uint8_t rfid = boot.add("rfid", bootRFID);
+    uint8_t ride = boot.add("ride tasks", startRideTasks, BOOT_STAGE(sensors) | BOOT_STAGE(can));
+    boot.add("rfid task", startRFIDTask, BOOT_STAGE(rfid));
+    boot.add("ble task", startBLETask, BOOT_STAGE(ble));
+    boot.add("display task", startDisplayTask, BOOT_STAGE(ride) | BOOT_STAGE(rfid) | BOOT_STAGE(ble));
+    boot.run();
     
     Serial.println("\n✅ === RTOS SYSTEM READY ===");
     Serial.println("📋 Task Distribution:");
     Serial.println("   🎯 Core 0: BLE + CAN + Display");
-    Serial.println("   🎯 Core 1: System + RFID + Sensors");
+    Serial.println("   🎯 Core 1: Safety + System + RFID + Sensors");
     Serial.println("🔧 Instructions:");
     Serial.println("   - Use RFID card to lock/unlock bike");
     Serial.println("   - BLE: Press BOOT for new devices");
@@ -403,6 +953,11 @@ void setup() {
     Serial.println("   - All sensors monitoring active");
     Serial.println("   - Real-time RTOS task management");
     Serial.println("=================================");
+    boot.getTimeline(bootTimeline);
+    bootPrintTimeline(bootTimeline);
+    
+    // The steady state starts here: no heap use from now on
+    heapMonitor.begin();
     
     // Delete Arduino loop task - we use our own RTOS tasks
     vTaskDelete(NULL);
@@ -3,6 +3,8 @@
 #include <lvgl.h>
 #include <BikeDisplayUI.h>
 #include <BikeCANManager.h>
+#include <BikeLog.h>
+#include <BootSequencer.h>
 
 // Khai báo TFT
 TFT_eSPI tft = TFT_eSPI();
@@ -22,9 +24,20 @@ BikeDisplayUI dashboard;
 // CAN Manager instance
 BikeCANManager canManager;
 
+// CAN flight recorder (16 KB): last 1024 frames, dumped with the "canlog" serial command
+CANLogRing<1024> canLog;
+
+// Sensor-to-label latency per source, printed with the "latency" serial command
+CANLatencyTrace latency;
+
 // Bike data - will be updated via CAN
 BikeDataDisplay bike;
 
+// setup()'s stages, side by side on both cores; the timeline also marks the first speed shown
+BootSequencer boot;
+static BootTimeline bootTimeline;
+bool speedReceived = false;
+
 // CAN connection status
 bool canConnected = false;
 unsigned long lastCANMessage = 0;
@@ -33,12 +46,12 @@ unsigned long lastCANMessage = 0;
 void my_disp_flush(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color_p) {
   uint32_t w = (area->x2 - area->x1 + 1);
   uint32_t h = (area->y2 - area->y1 + 1);
-
+  
   tft.startWrite();
   tft.setAddrWindow(area->x1, area->y1, w, h);
   tft.pushColors((uint16_t*)&color_p->full, w * h, true);
   tft.endWrite();
-
+  
   lv_disp_flush_ready(disp);
 }
 
@@ -48,50 +61,51 @@ void onCANMessage(uint32_t id, uint8_t* data, uint8_t length) {
     lastCANMessage = millis();
     canConnected = true;
     
-    Serial.printf("📨 [onCANMessage] Received ID=0x%03X, length=%d\n", id, length);
+    BIKE_LOGD("📨 [onCANMessage] Received ID=0x%03X, length=%d", id, length);
     
     // Parse the incoming CAN message
     if (canManager.parseCANMessage(id, data, length, bike)) {
         // Successfully parsed - log key data
         switch(id) {
             case MSG_ID_BIKE_STATUS:
-                Serial.printf("[CAN] Status: Speed=%.1f km/h, BT=%s, L=%s, R=%s\n",
+                speedReceived = true;
+                BIKE_LOGD("[CAN] Status: Speed=%.1f km/h, BT=%s, L=%s, R=%s",
                             bike.speed,
                             bike.bluetoothConnected ? "ON" : "OFF",
                             bike.turnLeftActive ? "ON" : "OFF",
                             bike.turnRightActive ? "ON" : "OFF");
-                Serial.printf("📱 [CAN-RX] Bluetooth Status: bike.bluetoothConnected = %s\n", 
+                BIKE_LOGD("📱 [CAN-RX] Bluetooth Status: bike.bluetoothConnected = %s",
                             bike.bluetoothConnected ? "true" : "false");
                 break;
-                
+            
             case MSG_ID_BMS_DATA + 1: // BMS1
-                Serial.printf("[CAN] BMS1: %.2fV, %d%%, %.1f°C\n",
+                BIKE_LOGD("[CAN] BMS1: %.2fV, %d%%, %.1f°C",
                             bike.battery1Volt,
                             bike.battery1Percent,
                             (float)bike.battery1Temp);
                 break;
-                
+            
             case MSG_ID_BMS_DATA + 2: // BMS2
-                Serial.printf("[CAN] BMS2: %.2fV, %d%%, %.1f°C\n",
+                BIKE_LOGD("[CAN] BMS2: %.2fV, %d%%, %.1f°C",
                             bike.battery2Volt,
                             bike.battery2Percent,
                             (float)bike.battery2Temp);
                 break;
-                
+            
             case MSG_ID_VESC_DATA:
-                Serial.printf("[CAN] Motor: %.2fA, Motor=%.1f°C, ECU=%.1f°C\n",
+                BIKE_LOGD("[CAN] Motor: %.2fA, Motor=%.1f°C, ECU=%.1f°C",
                             bike.motorCurrent,
                             (float)bike.motorTemp,
                             (float)bike.ecuTemp);
                 break;
-                
+            
             case MSG_ID_DISTANCE_DATA:
-                Serial.printf("[CAN] Distance: Odo=%.1fkm, Trip=%.1fkm\n",
+                BIKE_LOGD("[CAN] Distance: Odo=%.1fkm, Trip=%.1fkm",
                             bike.odometer, bike.tripDistance);
                 break;
         }
     } else {
-        Serial.printf("[CAN] Parse failed for ID: 0x%03X\n", id);
+        BIKE_LOGW("[CAN] Parse failed for ID: 0x%03X", id);
     }
 }
 
@@ -102,33 +116,117 @@ void checkCANConnection() {
         if (millis() - lastCANMessage > 5000) { // No message for 5 seconds
             if (canConnected) {
                 canConnected = false;
-                Serial.println("[CAN] Connection lost");
+                BIKE_LOGW("[CAN] Connection lost");
             }
         }
         lastCheck = millis();
     }
 }
 
-void setup() {
-  Serial.begin(115200);
-  Serial.println("=== SAO KIM Display Controller ===");
-  
-  // Initialize CAN Manager first with display board pins
+// Segmented messages (cell voltages, BMS info) - data only, not a link heartbeat
+void onIsoTpMessage(const uint8_t* payload, uint16_t length) {
+    if (!canManager.parseIsoTpMessage(payload, length, bike)) {
+        BIKE_LOGW("[CAN] ISO-TP: unknown message type 0x%02X (%u bytes)", payload[0], length);
+    }
+}
+
+// Ask the main board for what the visible screen shows (re-sent by canManager.update())
+void subscribeForScreen() {
+    if (dashboard.isCellDetailVisible()) {
+        canManager.setSubscription(CAN_GROUP_BIT(CAN_GROUP_STATUS) | CAN_GROUP_BIT(CAN_GROUP_BATTERY) |
+                                   CAN_GROUP_BIT(CAN_GROUP_CELLS) | CAN_GROUP_BIT(CAN_GROUP_BMS_INFO));
+    } else {
+        canManager.setSubscription(CAN_GROUPS_DASHBOARD);
+    }
+}
+
+// Serial commands:
+//   canlog          print the CAN flight recorder as candump text
+//   canlog clear    empty it
+//   canstats        per-ID CAN counters, jitter and bus load
+//   canstats reset  restart the CAN statistics
+//   cells           toggle the per-cell voltage screen
+//   latency         sensor-to-label latency percentiles per source
+//   latency reset   restart the latency figures
+//   boot            boot stages: core, start and end after power-on, first speed shown
+//   log text        print log records as text (default)
+//   log binary      print them as "~L" lines for host_log_decode
+void handleSerialCommand() {
+    static char line[32];
+    static uint8_t length = 0;
+    
+    while (Serial.available()) {
+        char c = Serial.read();
+        if (c != '\n' && c != '\r') {
+            if (length < sizeof(line) - 1) line[length++] = c;
+            continue;
+        }
+        if (length == 0) continue;
+        line[length] = '\0';
+        length = 0;
+        
+        if (strcmp(line, "canlog") == 0) {
+            // Paused while printing so the dump is one consistent window
+            canLog.setEnabled(false);
+            Serial.printf("--- CAN log: %u frames, %u overwritten ---\n", canLog.size(), canLog.getOverwritten());
+            canLog.printCandump();
+            Serial.println("--- end CAN log ---");
+            canLog.setEnabled(true);
+        } else if (strcmp(line, "canlog clear") == 0) {
+            canLog.clear();
+            Serial.println("[CAN] Log cleared");
+        } else if (strcmp(line, "canstats") == 0) {
+            static CANBusStatsSnapshot stats;
+            canManager.getBusStats(stats);
+            canPrintBusStats(stats);
+        } else if (strcmp(line, "canstats reset") == 0) {
+            canManager.resetBusStats();
+            Serial.println("[CAN] Statistics reset");
+        } else if (strcmp(line, "cells") == 0) {
+            dashboard.showCellDetail(!dashboard.isCellDetailVisible());
+            subscribeForScreen();
+        } else if (strcmp(line, "latency") == 0) {
+            canPrintLatency(latency, canManager.getTimeSync());
+        } else if (strcmp(line, "latency reset") == 0) {
+            latency.reset();
+            Serial.println("[CAN] Latency trace reset");
+        } else if (strcmp(line, "boot") == 0) {
+            boot.getTimeline(bootTimeline);
+            bootPrintTimeline(bootTimeline);
+        } else if (strcmp(line, "log text") == 0 || strcmp(line, "log binary") == 0) {
+            bikeLog.setBinaryOutput(strcmp(line, "log binary") == 0);
+            Serial.printf("[LOG] %s output, %lu records, %lu dropped\n", bikeLog.isBinaryOutput() ? "Binary" : "Text",
+                          (unsigned long)bikeLog.getWritten(), (unsigned long)bikeLog.getDropped());
+        }
+    }
+}
+
+// Boot stages: CAN, the panel and LVGL do not need each other; the first
+// flush reaches the panel from loop(), after all three
+void bootCAN() {
+  // Initialize CAN Manager with display board pins
   if (canManager.begin(25, 26)) { // Display board CAN pins
     Serial.println("✅ CAN Manager initialized successfully");
     canManager.setReceiveCallback(onCANMessage);
+    canManager.setIsoTpCallback(onIsoTpMessage);
+    canManager.setLogger(&canLog);
+    canManager.setLatencyTrace(&latency);
     Serial.println("✅ CAN Receive callback registered");
   } else {
     Serial.println("❌ CAN Manager initialization failed");
     canConnected = false;
   }
-  
+}
+
+void bootPanel() {
   // Khởi tạo LCD
   tft.init();
   tft.setRotation(1); // Landscape 480x272
   delay(100);
   tft.fillScreen(TFT_BLACK);
-  
+}
+
+void bootLVGL() {
   // Khởi tạo LVGL
   lv_init();
   
@@ -160,6 +258,16 @@ void setup() {
   } else {
     Serial.println("❌ Failed to initialize dashboard!");
   }
+}
+
+// The subscription follows the screen the dashboard shows
+void bootSubscribe() {
+  subscribeForScreen();
+}
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("=== SAO KIM Display Controller ===");
   
   // Initialize bike data with default values
   bike.speed = 0;
@@ -183,6 +291,15 @@ void setup() {
   bike.turnLeftActive = false;     // Khởi tạo turn indicators tắt
   bike.turnRightActive = false;
   
+  // CAN on core 1, where its interrupt always was; the panel and LVGL on whichever core is free
+  uint8_t can = boot.add("can", bootCAN, 0, 1);
+  boot.add("panel", bootPanel);
+  uint8_t lvgl = boot.add("lvgl", bootLVGL);
+  boot.add("subscribe", bootSubscribe, BOOT_STAGE(can) | BOOT_STAGE(lvgl));
+  boot.run();
+  boot.getTimeline(bootTimeline);
+  bootPrintTimeline(bootTimeline);
+  
   Serial.println("🚴‍♂️ LVGL Electric Bike Dashboard with CAN Support initialized!");
   Serial.println("📡 Waiting for CAN messages from main controller...");
 }
@@ -196,24 +313,47 @@ void loop() {
   // Check CAN connection status
   checkCANConnection();
   
+  handleSerialCommand();
+  
   // Cập nhật dashboard mỗi 100ms
   if(millis() - lastUpdate > 100) {
     dashboard.updateAll(bike);
+    latency.onDisplayed(micros());  // Labels set for everything parsed since the last refresh
+    static bool speedShown = false;
+    if (!speedShown && speedReceived) {
+      speedShown = true;
+      boot.mark("first speed shown");
+    }
     lastUpdate = millis();
     
     // Debug info với CAN status
-    Serial.printf("CAN:%s Speed:%.1f km/h Bat:%d%% Motor:%.1f°C BT:%s\n",
-                  canConnected ? "OK" : "LOST",
+    BIKE_LOGD("CAN:%d Speed:%.1f km/h Bat:%d%% Motor:%.1f°C BT:%d",
+                  canConnected,
                   bike.speed,
                   bike.batteryPercent,
                   (float)bike.motorTemp,
-                  bike.bluetoothConnected ? "ON" : "OFF");
+                  bike.bluetoothConnected);
+  }
+  
+  // Print what the CAN callbacks logged; they only queue records
+  static unsigned long lastLogDrain = 0;
+  if (millis() - lastLogDrain >= BIKE_LOG_DRAIN_MS) {
+    bikeLog.drain();
+    lastLogDrain = millis();
   }
   
   // Print CAN statistics every 10 seconds
   static unsigned long lastStats = 0;
   if (millis() - lastStats > 10000) {
-    Serial.printf("[STATS] CAN Messages Received: %d\n", canManager.getMessagesReceived());
+    CANAlertCounters alerts = canManager.getAlertCounters();
+    Serial.printf("[STATS] CAN Messages Received: %d | RX overflows: %d | RX backlog max: %d/%d | filtered: %d | bus errors: %d%s\n",
+                  canManager.getMessagesReceived(),
+                  canManager.getRxOverflows(),
+                  canManager.getRxHighWater(),
+                  canManager.getRxCapacity(),
+                  canManager.getRxFiltered(),
+                  alerts.busErrors,
+                  canManager.isBusOff() ? " | BUS-OFF" : "");
     lastStats = millis();
   }
   